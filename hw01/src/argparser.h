@@ -26,6 +26,17 @@ public:
         wireframe = true;
       } else if (argv[i] == std::string("-gouraud")) {
         gouraud = true;
+      } else if (argv[i] == std::string("-adaptive_angle")) {
+        i++; assert (i < argc); 
+        adaptive_angle = atof(argv[i]);
+      } else if (argv[i] == std::string("-adaptive_pixels")) {
+        i++; assert (i < argc); 
+        adaptive_pixels = atof(argv[i]);
+      } else if (argv[i] == std::string("-adaptive_no_creases")) {
+        adaptive_creases = false;
+      } else if (argv[i] == std::string("-progressive_output")) {
+        i++; assert (i < argc); 
+        progressive_output = argv[i];
       } else {
         printf ("whoops error with command line argument %d: '%s'\n",i,argv[i]);
         assert(0);
@@ -38,6 +49,9 @@ public:
     height = 500;
     wireframe = false;
     gouraud = false;
+    adaptive_angle = 10;
+    adaptive_pixels = 0;
+    adaptive_creases = true;
   }
 
   // ==============
@@ -48,6 +62,12 @@ public:
   int height;
   bool wireframe;
   bool gouraud;
+  // what 'a' (adaptive subdivision) refines, 0 turns a test off
+  double adaptive_angle;   // degrees across an edge
+  double adaptive_pixels;  // longest edge on screen
+  bool adaptive_creases;
+  // where 'p' saves the progressive mesh, the input with .pm by default
+  std::string progressive_output;
   MTRand mtrand;
 
 };
@@ -0,0 +1,204 @@
+#ifndef _FLAT_HASH_MAP_H_
+#define _FLAT_HASH_MAP_H_
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+
+// ===================================================================================
+// An open-addressing hash table from 64 bit keys (two packed 32 bit
+// indices, see hash.h) to small values.  All the entries live in one
+// power of two array, a lookup is a mix of the key and a short linear
+// probe through neighboring entries: no allocation per entry and no
+// pointer chasing.
+//
+// Erasing shifts the following entries of the probe run back into the
+// hole (no tombstones), so a table that is edited for a long time,
+// like the edges during simplification, never needs rehashing to stay
+// fast.  Any insert or erase invalidates iterators.
+//
+// The key FLAT_HASH_EMPTY_KEY (both halves 0xffffffff) marks an empty
+// entry and can't be stored.
+// ===================================================================================
+
+#define FLAT_HASH_EMPTY_KEY (~(uint64_t)0)
+
+// grows once more than half the entries are in use, which keeps the
+// linear probes (and the shifting when erasing) to a couple of entries
+#define FLAT_HASH_MAX_LOAD_NUM 1
+#define FLAT_HASH_MAX_LOAD_DEN 2
+
+// the 64 bit finalizer of MurmurHash3: every bit of the key affects
+// every bit of the result, so the low bits used for the index are
+// good even for keys that differ only in the high half
+inline uint64_t mix_64(uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+  return key;
+}
+
+template <class V>
+class FlatHashMap {
+public:
+
+  struct Entry {
+    uint64_t first;
+    V second;
+  };
+
+  // ========================
+  // ITERATORS (over the used entries, in table order)
+  template <class E>
+  class Iterator {
+  public:
+    Iterator() : entry(NULL), end(NULL) {}
+    Iterator(E *e, E *end_) : entry(e), end(end_) { skip(); }
+    // an iterator converts to a const_iterator
+    template <class F>
+    Iterator(const Iterator<F> &other) : entry(other.entry), end(other.end) {}
+    E& operator*() const { return *entry; }
+    E* operator->() const { return entry; }
+    Iterator& operator++() { entry++; skip(); return *this; }
+    Iterator operator++(int) { Iterator tmp = *this; ++(*this); return tmp; }
+    bool operator==(const Iterator &other) const { return entry == other.entry; }
+    bool operator!=(const Iterator &other) const { return entry != other.entry; }
+  private:
+    template <class F> friend class Iterator;
+    void skip() { while (entry != end && entry->first == FLAT_HASH_EMPTY_KEY) entry++; }
+    E *entry;
+    E *end;
+  };
+  typedef Iterator<Entry> iterator;
+  typedef Iterator<const Entry> const_iterator;
+
+  // ========================
+  // CONSTRUCTOR
+  FlatHashMap() : count(0), mask(0) {}
+
+  // =========
+  // ACCESSORS
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  size_t capacity() const { return entries.size(); }
+
+  iterator begin() { return iterator(data(),data()+entries.size()); }
+  iterator end() { return iterator(data()+entries.size(),data()+entries.size()); }
+  const_iterator begin() const { return const_iterator(data(),data()+entries.size()); }
+  const_iterator end() const { return const_iterator(data()+entries.size(),data()+entries.size()); }
+
+  iterator find(uint64_t key) {
+    int i = lookup(key);
+    if (i == -1) return end();
+    return iterator(data()+i,data()+entries.size());
+  }
+  const_iterator find(uint64_t key) const {
+    int i = lookup(key);
+    if (i == -1) return end();
+    return const_iterator(data()+i,data()+entries.size());
+  }
+
+  // =========
+  // MODIFIERS
+  // the value stored for key, default constructed if it is new
+  V& operator[](uint64_t key) {
+    assert (key != FLAT_HASH_EMPTY_KEY);
+    if ((count+1)*FLAT_HASH_MAX_LOAD_DEN > entries.size()*FLAT_HASH_MAX_LOAD_NUM)
+      rehash(entries.empty() ? 16 : 2*entries.size());
+    size_t i = mix_64(key) & mask;
+    while (true) {
+      Entry &e = entries[i];
+      if (e.first == key) return e.second;
+      if (e.first == FLAT_HASH_EMPTY_KEY) {
+        e.first = key;
+        e.second = V();
+        count++;
+        return e.second;
+      }
+      i = (i+1) & mask;
+    }
+  }
+
+  // returns the number of entries removed (0 or 1)
+  size_t erase(uint64_t key) {
+    int found = lookup(key);
+    if (found == -1) return 0;
+    // walk on through the run, moving back any entry that may sit in
+    // the hole (its home is not in the circular range (hole,j])
+    size_t hole = found;
+    size_t j = hole;
+    while (true) {
+      j = (j+1) & mask;
+      if (entries[j].first == FLAT_HASH_EMPTY_KEY) break;
+      size_t home = mix_64(entries[j].first) & mask;
+      if (((j - home) & mask) >= ((j - hole) & mask)) {
+        entries[hole] = entries[j];
+        hole = j;
+      }
+    }
+    entries[hole].first = FLAT_HASH_EMPTY_KEY;
+    entries[hole].second = V();
+    count--;
+    return 1;
+  }
+
+  void clear() {
+    for (size_t i = 0; i < entries.size(); i++) {
+      entries[i].first = FLAT_HASH_EMPTY_KEY;
+      entries[i].second = V();
+    }
+    count = 0;
+  }
+
+  // make room for n entries without growing
+  void reserve(size_t n) {
+    size_t size = 16;
+    while (n*FLAT_HASH_MAX_LOAD_DEN > size*FLAT_HASH_MAX_LOAD_NUM) size *= 2;
+    if (size > entries.size()) rehash(size);
+  }
+
+private:
+
+  Entry* data() { return entries.empty() ? NULL : &entries[0]; }
+  const Entry* data() const { return entries.empty() ? NULL : &entries[0]; }
+
+  // the entry holding key, or -1
+  int lookup(uint64_t key) const {
+    if (count == 0) return -1;
+    size_t i = mix_64(key) & mask;
+    while (true) {
+      const Entry &e = entries[i];
+      if (e.first == key) return i;
+      if (e.first == FLAT_HASH_EMPTY_KEY) return -1;
+      i = (i+1) & mask;
+    }
+  }
+
+  void rehash(size_t size) {
+    assert (size >= 16 && (size & (size-1)) == 0);
+    std::vector<Entry> old;
+    old.swap(entries);
+    Entry empty;
+    empty.first = FLAT_HASH_EMPTY_KEY;
+    empty.second = V();
+    entries.assign(size,empty);
+    mask = size-1;
+    for (size_t k = 0; k < old.size(); k++) {
+      if (old[k].first == FLAT_HASH_EMPTY_KEY) continue;
+      size_t i = mix_64(old[k].first) & mask;
+      while (entries[i].first != FLAT_HASH_EMPTY_KEY) i = (i+1) & mask;
+      entries[i] = old[k];
+    }
+  }
+
+  // ==============
+  // REPRESENTATION
+  std::vector<Entry> entries;
+  size_t count;
+  size_t mask;
+};
+
+#endif // _FLAT_HASH_MAP_H_
@@ -71,6 +71,7 @@ void GLCanvas::initialize(ArgParser *_args, Mesh *_mesh) {
 
   HandleGLError("finished glcanvas initialize");
 
+  mesh->OptimizeLayout();
   mesh->initializeVBOs();
 
   HandleGLError("finished glcanvas initialize");
@@ -196,6 +197,62 @@ void GLCanvas::motion(int x, int y) {
   glutPostRedisplay();
 }
 
+// ========================================================
+// Adaptive subdivision, sized against the current view
+// ========================================================
+
+void GLCanvas::adaptiveSubdivision() {
+  AdaptiveCriteria criteria;
+  criteria.max_dihedral = args->adaptive_angle * M_PI / 180.0;
+  criteria.max_pixels = args->adaptive_pixels;
+  criteria.near_creases = args->adaptive_creases;
+  if (criteria.max_pixels > 0) {
+    // the same transform display() draws the mesh with
+    GLdouble modelview[16], projection[16];
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    camera->glPlaceCamera();
+    mesh->glFitToWindow();
+    glGetDoublev(GL_MODELVIEW_MATRIX,modelview);
+    glPopMatrix();
+    glGetDoublev(GL_PROJECTION_MATRIX,projection);
+    glGetIntegerv(GL_VIEWPORT,criteria.viewport);
+    for (int c = 0; c < 4; c++) {
+      for (int r = 0; r < 4; r++) {
+        double sum = 0;
+        for (int k = 0; k < 4; k++) sum += projection[4*k+r]*modelview[4*c+k];
+        criteria.screen[4*c+r] = sum;
+      }
+    }
+    criteria.has_screen = true;
+  }
+  mesh->AdaptiveSubdivision(criteria);
+}
+
+// ========================================================
+// Save the simplification so far as a progressive mesh
+// ========================================================
+
+void GLCanvas::saveProgressive() {
+  std::string filename = args->progressive_output;
+  if (filename == "") {
+    filename = args->input_file;
+    size_t dot = filename.rfind('.');
+    size_t slash = filename.find_last_of("/\\");
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+      filename.erase(dot);
+    filename += PROGRESSIVE_MESH_EXTENSION;
+  }
+  if (filename == args->input_file) {
+    std::cout << "ERROR! won't overwrite the input " << filename << std::endl;
+    return;
+  }
+  if (mesh->SaveProgressive(filename)) {
+    std::cout << "Saved " << filename << " (" << mesh->numVertexSplits() << " vertex splits)" << std::endl;
+  }
+}
+
 // ========================================================
 // Callback function for keyboard events
 // ========================================================
@@ -216,6 +273,11 @@ void GLCanvas::keyboard(unsigned char key, int /*x*/, int /*y*/) {
     mesh->setupVBOs();
     glutPostRedisplay();
     break;
+  case 'a': case 'A':
+    adaptiveSubdivision();
+    mesh->setupVBOs();
+    glutPostRedisplay();
+    break;
   case 'd': case 'D':
     std::cout << "Before: " << mesh->numTriangles() << "\tGoal " << (int)floor(0.9*mesh->numTriangles());
     mesh->Simplification((int)floor(0.9*mesh->numTriangles()));
@@ -223,6 +285,23 @@ void GLCanvas::keyboard(unsigned char key, int /*x*/, int /*y*/) {
     mesh->setupVBOs();
     glutPostRedisplay();
     break;
+  case 'r': case 'R':
+    mesh->SetProgressiveTriangles((int)ceil(1.1*mesh->numTriangles()));
+    std::cout << "Refined to " << mesh->numTriangles() << " (" << mesh->numAppliedVertexSplits()
+              << " of " << mesh->numVertexSplits() << " vertex splits)" << std::endl;
+    mesh->setupVBOs();
+    glutPostRedisplay();
+    break;
+  case 'c': case 'C':
+    mesh->SetProgressiveTriangles((int)floor(0.9*mesh->numTriangles()));
+    std::cout << "Coarsened to " << mesh->numTriangles() << " (" << mesh->numAppliedVertexSplits()
+              << " of " << mesh->numVertexSplits() << " vertex splits)" << std::endl;
+    mesh->setupVBOs();
+    glutPostRedisplay();
+    break;
+  case 'p': case 'P':
+    saveProgressive();
+    break;
   case 'q':  case 'Q':
     exit(0);
     break;
@@ -66,6 +66,11 @@ private:
   static void mouse(int button, int state, int x, int y);
   static void motion(int x, int y);
   static void keyboard(unsigned char key, int x, int y);
+
+  // the 'a' key
+  static void adaptiveSubdivision();
+  // the 'p' key
+  static void saveProgressive();
 };
 
 // ====================================================================
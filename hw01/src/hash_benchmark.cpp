@@ -0,0 +1,137 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <unordered_map>
+#include <cstdlib>
+
+#include "obj_parser.h"
+#include "hash.h"
+
+// =========================================
+// Micro-benchmark of the half-edge table: replays what
+// Mesh::addTriangle, Mesh::getMeshEdge and an edge collapse do to it
+// for every triangle of a model, once with the flat table (hash.h)
+// and once with the std::unordered_map and 10007a + 11003b hash it
+// replaced.  No graphics needed.
+//
+//   hash_benchmark [model.obj] [repeats]
+// =========================================
+
+// the table hash.h used to declare
+struct OldIndexPairHash {
+  size_t operator()(uint64_t key) const {
+    return 10007 * (unsigned int)(key >> 32) + 11003 * (unsigned int)key;
+  }
+};
+typedef std::unordered_map<uint64_t,int,OldIndexPairHash> OldEdgeTable;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+double elapsed_ms(Clock::time_point start) {
+  return std::chrono::duration<double,std::milli>(Clock::now() - start).count();
+}
+
+// =========================================
+
+struct Timings {
+  double add, lookup, collapse;
+  long long checksum;
+};
+
+template <class Table>
+Timings RunWorkload(const std::vector<int> &tris, int repeats) {
+  int num_halfedges = tris.size();
+  Timings best = { 1e30, 1e30, 1e30, 0 };
+  for (int r = 0; r < repeats; r++) {
+    Table edges;
+    edges.reserve(num_halfedges);
+    long long checksum = 0;
+
+    // addTriangle: check the edge is new, add it, look for its opposite
+    Clock::time_point start = Clock::now();
+    for (int e = 0; e < num_halfedges; e++) {
+      int s = tris[e];
+      int f = tris[e - e%3 + (e+1)%3];
+      if (edges.find(ordered_index_pair(s,f)) != edges.end()) checksum--;
+      edges[ordered_index_pair(s,f)] = e;
+      typename Table::iterator op = edges.find(ordered_index_pair(f,s));
+      if (op != edges.end()) checksum += op->second;
+    }
+    double add = elapsed_ms(start);
+
+    // getMeshEdge: every half-edge and its opposite (a miss on the boundary)
+    start = Clock::now();
+    for (int e = 0; e < num_halfedges; e++) {
+      int s = tris[e];
+      int f = tris[e - e%3 + (e+1)%3];
+      typename Table::const_iterator iter = edges.find(ordered_index_pair(s,f));
+      if (iter != edges.end()) checksum += iter->second;
+      iter = edges.find(ordered_index_pair(f,s));
+      if (iter != edges.end()) checksum += iter->second;
+    }
+    double lookup = elapsed_ms(start);
+
+    // collapseEdge: take a triangle's edges out and put them back
+    // (a relabeled one, like the outer edges restitched to keep)
+    start = Clock::now();
+    for (int t = 0; t < num_halfedges/3; t++) {
+      for (int k = 0; k < 3; k++)
+        edges.erase(ordered_index_pair(tris[3*t+k],tris[3*t+(k+1)%3]));
+      for (int k = 0; k < 3; k++)
+        edges[ordered_index_pair(tris[3*t+k],tris[3*t+(k+1)%3])] = 3*t+k;
+    }
+    double collapse = elapsed_ms(start);
+    checksum += edges.size();
+
+    if (add < best.add) best.add = add;
+    if (lookup < best.lookup) best.lookup = lookup;
+    if (collapse < best.collapse) best.collapse = collapse;
+    best.checksum = checksum;
+  }
+  return best;
+}
+
+void PrintRow(const std::string &name, double old_ms, double new_ms) {
+  std::cout << std::setw(14) << std::left << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << old_ms << " ms" << std::setw(10) << new_ms << " ms"
+            << std::setw(8) << old_ms / new_ms << "x" << std::endl;
+}
+
+// =========================================
+
+int main(int argc, char *argv[]) {
+  if (argc > 3) {
+    std::cerr << "usage: " << argv[0] << " [model.obj] [repeats]" << std::endl;
+    return 1;
+  }
+  std::string input_file = (argc > 1) ? argv[1] : "bunny_40k.obj";
+  int repeats = (argc > 2) ? atoi(argv[2]) : 10;
+  if (repeats < 1) repeats = 1;
+
+  ObjData data;
+  if (!LoadObj(input_file,data)) {
+    std::cerr << "ERROR! CANNOT OPEN: " << input_file << std::endl;
+    return 1;
+  }
+  std::cout << input_file << ": " << data.numVertices() << " vertices, "
+            << data.numTriangles() << " triangles, best of " << repeats << std::endl;
+
+  Timings old_times = RunWorkload<OldEdgeTable>(data.triangles,repeats);
+  Timings new_times = RunWorkload<edgeshashtype>(data.triangles,repeats);
+  if (old_times.checksum != new_times.checksum) {
+    std::cerr << "ERROR! the tables disagree" << std::endl;
+    return 1;
+  }
+
+  std::cout << std::setw(14) << std::left << "" << std::right
+            << std::setw(13) << "unordered_map" << std::setw(13) << "flat" << std::setw(9) << "speedup" << std::endl;
+  PrintRow("addTriangle",old_times.add,new_times.add);
+  PrintRow("getMeshEdge",old_times.lookup,new_times.lookup);
+  PrintRow("collapseEdge",old_times.collapse,new_times.collapse);
+  return 0;
+}
+
+// =========================================
+// =========================================
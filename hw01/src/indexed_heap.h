@@ -0,0 +1,110 @@
+#ifndef _INDEXED_HEAP_H_
+#define _INDEXED_HEAP_H_
+
+#include <cassert>
+#include <vector>
+
+// ====================================================================
+// ====================================================================
+// Binary min-heap of the ids [0,n), each with a double key.  The heap
+// position of every id is tracked, so a key can be changed or an id
+// taken out from the middle in O(log n).
+
+class IndexedMinHeap {
+
+public:
+
+  IndexedMinHeap(int n) : positions(n,-1) {}
+
+  // =========
+  // ACCESSORS
+  bool empty() const { return ids.empty(); }
+  int size() const { return ids.size(); }
+  bool contains(int id) const { return positions[id] != -1; }
+  int top() const { assert (!empty()); return ids[0]; }
+  double topKey() const { assert (!empty()); return keys[0]; }
+  double getKey(int id) const { assert (contains(id)); return keys[positions[id]]; }
+
+  // =========
+  // MODIFIERS
+  void push(int id, double key) {
+    assert (!contains(id));
+    positions[id] = ids.size();
+    ids.push_back(id);
+    keys.push_back(key);
+    siftUp(ids.size()-1);
+  }
+
+  int pop() {
+    int id = top();
+    remove(id);
+    return id;
+  }
+
+  void remove(int id) {
+    assert (contains(id));
+    int i = positions[id];
+    int last = ids.size()-1;
+    if (i != last) {
+      swapEntries(i,last);
+    }
+    ids.pop_back();
+    keys.pop_back();
+    positions[id] = -1;
+    if (i != last) {
+      siftUp(i);
+      siftDown(i);
+    }
+  }
+
+  void update(int id, double key) {
+    assert (contains(id));
+    int i = positions[id];
+    double old = keys[i];
+    keys[i] = key;
+    if (key < old) siftUp(i); else siftDown(i);
+  }
+
+private:
+
+  void swapEntries(int i, int j) {
+    int id = ids[i]; ids[i] = ids[j]; ids[j] = id;
+    double key = keys[i]; keys[i] = keys[j]; keys[j] = key;
+    positions[ids[i]] = i;
+    positions[ids[j]] = j;
+  }
+
+  void siftUp(int i) {
+    while (i > 0) {
+      int parent = (i-1)/2;
+      if (!(keys[i] < keys[parent])) break;
+      swapEntries(i,parent);
+      i = parent;
+    }
+  }
+
+  void siftDown(int i) {
+    int n = ids.size();
+    while (true) {
+      int smallest = i;
+      int left = 2*i+1;
+      int right = left+1;
+      if (left < n && keys[left] < keys[smallest]) smallest = left;
+      if (right < n && keys[right] < keys[smallest]) smallest = right;
+      if (smallest == i) break;
+      swapEntries(i,smallest);
+      i = smallest;
+    }
+  }
+
+  // ==============
+  // REPRESENTATION
+  std::vector<int> ids;        // heap order
+  std::vector<double> keys;    // parallel to ids
+  std::vector<int> positions;  // id -> index into ids, -1 if not in the heap
+};
+
+// ====================================================================
+// ====================================================================
+
+#endif
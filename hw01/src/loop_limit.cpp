@@ -0,0 +1,407 @@
+#include <cmath>
+#include <algorithm>
+
+#include "loop_limit.h"
+#include "loop_rules.h"
+
+// ====================================================================
+// ====================================================================
+// VERTEX MASKS
+
+bool LoopLimitVertex(const std::vector<int> &edge_vertex, const std::vector<int> &edge_opposite,
+                     const std::vector<float> &edge_crease, const std::vector<Vec3f> &positions,
+                     int e, Vec3f &pos, Vec3f &normal) {
+  int start = LoopFanStart(edge_opposite,e);
+  const Vec3f &p = positions[edge_vertex[start]];
+
+  // walk the fan: valence, creases, and the area weighted normal
+  Vec3f ring_sum, face_sum;
+  int valence = 0, sharp = 0;
+  int crease_edges[2] = { -1, -1 };
+  bool boundary = false, finite = false;
+  int cur = start;
+  while (true) {
+    const Vec3f &q = positions[edge_vertex[LoopNextEdge(cur)]];
+    const Vec3f &r = positions[edge_vertex[LoopPrevEdge(cur)]];
+    Vec3f n;
+    Vec3f::Cross3(n,q-p,r-p);
+    face_sum += n;
+    ring_sum += q;
+    valence++;
+    int o = edge_opposite[cur];
+    if (o == -1) { boundary = true; break; }
+    if (edge_crease[cur] > 0) {
+      if (sharp < 2) crease_edges[sharp] = cur;
+      sharp++;
+      if (!std::isinf(edge_crease[cur])) finite = true;
+    }
+    cur = LoopNextEdge(o);
+    if (cur == start) break;
+  }
+  Vec3f average = face_sum;
+  average.Normalize();
+
+  if (boundary) {
+    // a cubic B-spline along the boundary
+    const Vec3f &first = positions[edge_vertex[LoopPrevEdge(start)]];
+    const Vec3f &last = positions[edge_vertex[LoopNextEdge(cur)]];
+    pos = (2/3.0)*p + (1/6.0)*(first + last);
+    normal = average;
+    return true;
+  }
+
+  if (sharp <= 1) {
+    // smooth (or dart): the dominant left eigenvector gives the
+    // position, the two subdominant ones (cos & sin over the ring)
+    // give the tangents.  they don't depend on beta.
+    double beta = (valence > 3) ? 3/(8.0*valence) : 3/16.0;
+    double chi = 1 / (3/(8*beta) + valence);
+    pos = (1 - valence*chi)*p + chi*ring_sum;
+    Vec3f t1, t2;
+    cur = start;
+    for (int i = 0; i < valence; i++) {
+      const Vec3f &q = positions[edge_vertex[LoopNextEdge(cur)]];
+      double theta = 2*M_PI*i / valence;
+      t1 += cos(theta)*q;
+      t2 += sin(theta)*q;
+      cur = LoopNextEdge(edge_opposite[cur]);
+    }
+    Vec3f::Cross3(normal,t1,t2);
+    if (normal.Dot3(face_sum) < 0) normal = -normal;
+    if (normal.Length() > 0) normal.Normalize(); else normal = average;
+    return true;
+  }
+
+  if (sharp > 2) {
+    // corner, it never moves
+    pos = p;
+    normal = average;
+    return !finite;
+  }
+
+  // crease.  one step of the crease rules makes both crease neighbors
+  // regular crease vertices, from there on the curve is a stationary
+  // 3 point scheme: (3/4 1/8 1/8) & (1/2 1/2) with a left eigenvector
+  // of (2/3 1/6 1/6) at a regular crease vertex, (3/4 1/8 1/8) &
+  // (3/8 5/8) and (3/5 1/5 1/5) at an irregular one
+  unsigned char vertex_class = (valence == 6) ? SUBDIV_REGULAR_CREASE : SUBDIV_OTHER;
+  Vec3f q[2], mid[2];
+  for (int i = 0; i < 2; i++) {
+    int o = edge_opposite[crease_edges[i]];
+    unsigned char neighbor_class;
+    LoopEvenRule(edge_vertex,edge_opposite,edge_crease,positions,
+                 LoopFanStart(edge_opposite,o),neighbor_class);
+    q[i] = positions[edge_vertex[o]];
+    mid[i] = LoopOddRule(p,q[i],Vec3f(),Vec3f(),false,edge_crease[crease_edges[i]],
+                         vertex_class,neighbor_class);
+  }
+  Vec3f next = 0.75*p + 0.125*(q[0]+q[1]);
+  if (vertex_class == SUBDIV_REGULAR_CREASE)
+    pos = (2/3.0)*next + (1/6.0)*(mid[0]+mid[1]);
+  else
+    pos = 0.6*next + 0.2*(mid[0]+mid[1]);
+  normal = average;
+  return !finite;
+}
+
+// ====================================================================
+// ====================================================================
+// REGULAR PATCHES
+
+// the 12 quartic box spline basis functions of Stam's appendix, in
+// (u,v,w) with u = 1-v-w, as sums of  coef * u^i v^j w^k / 12
+struct BoxSplineTerm { unsigned char basis, coef, i, j, k; };
+
+static const BoxSplineTerm box_spline_terms[] = {
+  {0,1,4,0,0}, {0,2,3,1,0},
+  {1,1,4,0,0}, {1,2,3,0,1},
+  {2,1,4,0,0}, {2,2,3,0,1}, {2,6,3,1,0}, {2,6,2,1,1}, {2,12,2,2,0}, {2,6,1,2,1},
+  {2,6,1,3,0}, {2,2,0,3,1}, {2,1,0,4,0},
+  {3,6,4,0,0}, {3,24,3,0,1}, {3,24,2,0,2}, {3,8,1,0,3}, {3,1,0,0,4}, {3,24,3,1,0},
+  {3,60,2,1,1}, {3,36,1,1,2}, {3,6,0,1,3}, {3,24,2,2,0}, {3,36,1,2,1}, {3,12,0,2,2},
+  {3,8,1,3,0}, {3,6,0,3,1}, {3,1,0,4,0},
+  {4,1,4,0,0}, {4,6,3,0,1}, {4,12,2,0,2}, {4,6,1,0,3}, {4,1,0,0,4}, {4,2,3,1,0},
+  {4,6,2,1,1}, {4,6,1,1,2}, {4,2,0,1,3},
+  {5,2,1,3,0}, {5,1,0,4,0},
+  {6,1,4,0,0}, {6,6,3,0,1}, {6,12,2,0,2}, {6,6,1,0,3}, {6,1,0,0,4}, {6,8,3,1,0},
+  {6,36,2,1,1}, {6,36,1,1,2}, {6,8,0,1,3}, {6,24,2,2,0}, {6,60,1,2,1}, {6,24,0,2,2},
+  {6,24,1,3,0}, {6,24,0,3,1}, {6,6,0,4,0},
+  {7,1,4,0,0}, {7,8,3,0,1}, {7,24,2,0,2}, {7,24,1,0,3}, {7,6,0,0,4}, {7,6,3,1,0},
+  {7,36,2,1,1}, {7,60,1,1,2}, {7,24,0,1,3}, {7,12,2,2,0}, {7,36,1,2,1}, {7,24,0,2,2},
+  {7,6,1,3,0}, {7,8,0,3,1}, {7,1,0,4,0},
+  {8,2,1,0,3}, {8,1,0,0,4},
+  {9,2,0,3,1}, {9,1,0,4,0},
+  {10,2,1,0,3}, {10,1,0,0,4}, {10,6,1,1,2}, {10,6,0,1,3}, {10,6,1,2,1}, {10,12,0,2,2},
+  {10,2,1,3,0}, {10,6,0,3,1}, {10,1,0,4,0},
+  {11,1,0,0,4}, {11,2,0,1,3},
+};
+
+// is triangle t a box spline patch?  every corner has to be
+// interior, valence 6, with no creases around it
+static bool RegularTriangle(const std::vector<int> &edge_opposite, const std::vector<float> &edge_crease, int t) {
+  for (int k = 0; k < 3; k++) {
+    int e = 3*t+k;
+    int cur = e;
+    int valence = 0;
+    do {
+      if (edge_crease[cur] > 0) return false;
+      int o = edge_opposite[cur];
+      if (o == -1 || ++valence > 6) return false;
+      cur = LoopNextEdge(o);
+    } while (cur != e);
+    if (valence != 6) return false;
+  }
+  return true;
+}
+
+// the 12 control vertices of triangle t (a,b,c), numbered like Stam:
+// a b c are 3 6 7, the corners across ab bc ca are 2 10 4, and the
+// ones beside those are 0 5, 9 11, 8 1 (on the a b c side in turn)
+static void BoxSplinePatch(const std::vector<int> &ev, const std::vector<int> &eo,
+                           const std::vector<Vec3f> &positions,
+                           int t, double v, double w, Vec3f &pos, Vec3f &normal) {
+  int control[12];
+  control[3] = ev[3*t];
+  control[6] = ev[3*t+1];
+  control[7] = ev[3*t+2];
+  int slots[3][3] = { { 2, 0, 5 }, { 10, 9, 11 }, { 4, 8, 1 } };
+  for (int k = 0; k < 3; k++) {
+    int o = eo[3*t+k];
+    control[slots[k][0]] = ev[LoopPrevEdge(o)];
+    control[slots[k][1]] = ev[LoopPrevEdge(eo[LoopNextEdge(o)])];
+    control[slots[k][2]] = ev[LoopPrevEdge(eo[LoopPrevEdge(o)])];
+  }
+
+  double u = 1-v-w;
+  double pu[5], pv[5], pw[5];
+  pu[0] = pv[0] = pw[0] = 1;
+  for (int i = 1; i < 5; i++) {
+    pu[i] = pu[i-1]*u; pv[i] = pv[i-1]*v; pw[i] = pw[i-1]*w;
+  }
+  double basis[12] = { 0 }, dv[12] = { 0 }, dw[12] = { 0 };
+  int num_terms = sizeof(box_spline_terms) / sizeof(box_spline_terms[0]);
+  for (int n = 0; n < num_terms; n++) {
+    const BoxSplineTerm &term = box_spline_terms[n];
+    int i = term.i, j = term.j, k = term.k;
+    basis[term.basis] += term.coef * pu[i]*pv[j]*pw[k];
+    // d/dv and d/dw with u = 1-v-w
+    double du = i ? term.coef * i*pu[i-1]*pv[j]*pw[k] : 0;
+    dv[term.basis] += (j ? term.coef * j*pu[i]*pv[j-1]*pw[k] : 0) - du;
+    dw[term.basis] += (k ? term.coef * k*pu[i]*pv[j]*pw[k-1] : 0) - du;
+  }
+  Vec3f tv, tw;
+  pos = Vec3f(0,0,0);
+  for (int i = 0; i < 12; i++) {
+    const Vec3f &p = positions[control[i]];
+    pos += (basis[i]/12.0)*p;
+    tv += dv[i]*p;
+    tw += dw[i]*p;
+  }
+  Vec3f::Cross3(normal,tv,tw);
+  normal.Normalize();
+}
+
+// ====================================================================
+// ====================================================================
+// LOCAL SUBDIVISION
+
+// every triangle around the start of e
+static void FanTriangles(const std::vector<int> &edge_opposite, int e, std::vector<int> &tris) {
+  int start = LoopFanStart(edge_opposite,e);
+  int cur = start;
+  while (true) {
+    tris.push_back(cur/3);
+    int o = edge_opposite[cur];
+    if (o == -1) return;
+    cur = LoopNextEdge(o);
+    if (cur == start) return;
+  }
+}
+
+// copies the 2-ring of triangle t (every triangle touching a vertex of
+// a triangle touching t), with t as triangle 0.  that's all a step of
+// subdivision needs to get the 2-ring of each of t's children right.
+static void ExtractPatch(const std::vector<int> &edge_vertex, const std::vector<int> &edge_opposite,
+                         const std::vector<float> &edge_crease, const std::vector<Vec3f> &positions,
+                         int t, LoopPatch &patch) {
+  std::vector<int> ring, tris;
+  for (int k = 0; k < 3; k++) FanTriangles(edge_opposite,3*t+k,ring);
+  std::sort(ring.begin(),ring.end());
+  ring.erase(std::unique(ring.begin(),ring.end()),ring.end());
+  for (unsigned int i = 0; i < ring.size(); i++) {
+    for (int k = 0; k < 3; k++) FanTriangles(edge_opposite,3*ring[i]+k,tris);
+  }
+  std::sort(tris.begin(),tris.end());
+  tris.erase(std::unique(tris.begin(),tris.end()),tris.end());
+  // t goes first, the rest stay sorted for the lookups below
+  std::vector<int> order(1,t);
+  for (unsigned int i = 0; i < tris.size(); i++) {
+    if (tris[i] != t) order.push_back(tris[i]);
+  }
+
+  std::vector<int> verts;
+  for (unsigned int i = 0; i < tris.size(); i++) {
+    for (int k = 0; k < 3; k++) verts.push_back(edge_vertex[3*tris[i]+k]);
+  }
+  std::sort(verts.begin(),verts.end());
+  verts.erase(std::unique(verts.begin(),verts.end()),verts.end());
+
+  int num_tris = order.size();
+  patch.positions.resize(verts.size());
+  for (unsigned int i = 0; i < verts.size(); i++) patch.positions[i] = positions[verts[i]];
+  patch.edge_vertex.resize(3*num_tris);
+  patch.edge_opposite.resize(3*num_tris);
+  patch.edge_crease.resize(3*num_tris);
+  for (int i = 0; i < num_tris; i++) {
+    for (int k = 0; k < 3; k++) {
+      int e = 3*order[i]+k;
+      int f = 3*i+k;
+      patch.edge_vertex[f] = std::lower_bound(verts.begin(),verts.end(),edge_vertex[e]) - verts.begin();
+      patch.edge_crease[f] = edge_crease[e];
+      patch.edge_opposite[f] = -1;
+      int o = edge_opposite[e];
+      if (o == -1) continue;
+      std::vector<int>::iterator itr = std::lower_bound(tris.begin(),tris.end(),o/3);
+      if (itr == tris.end() || *itr != o/3) continue;
+      // where that triangle went in order: t moved to the front
+      int j = itr - tris.begin();
+      if (o/3 == t) j = 0;
+      else if (o/3 < t) j++;
+      patch.edge_opposite[f] = 3*j + o%3;
+    }
+  }
+}
+
+// one uniform step over the whole patch, laid out like
+// Mesh::LoopSubdivision: the children of triangle t are 4t..4t+3,
+// (a,ab,ca) (b,bc,ab) (c,ca,bc) (ca,ab,bc)
+static void SubdividePatch(const LoopPatch &in, LoopPatch &out) {
+  int num_verts = in.positions.size();
+  int num_halfedges = in.edge_vertex.size();
+  int num_tris = num_halfedges/3;
+  const std::vector<int> &ev = in.edge_vertex;
+  const std::vector<int> &eo = in.edge_opposite;
+
+  std::vector<int> vertex_edge(num_verts,-1);
+  for (int e = 0; e < num_halfedges; e++) {
+    int v = ev[e];
+    if (vertex_edge[v] == -1 || eo[LoopPrevEdge(e)] == -1) vertex_edge[v] = e;
+  }
+  std::vector<int> edge_child(num_halfedges,-1);
+  int num_new_verts = num_verts;
+  for (int e = 0; e < num_halfedges; e++) {
+    int o = eo[e];
+    if (o != -1 && o < e) continue;
+    edge_child[e] = num_new_verts;
+    if (o != -1) edge_child[o] = num_new_verts;
+    num_new_verts++;
+  }
+
+  out.positions.resize(num_new_verts);
+  std::vector<unsigned char> vertex_class(num_verts);
+  for (int v = 0; v < num_verts; v++) {
+    out.positions[v] = LoopEvenRule(ev,eo,in.edge_crease,in.positions,vertex_edge[v],vertex_class[v]);
+  }
+  for (int e = 0; e < num_halfedges; e++) {
+    int o = eo[e];
+    if (o != -1 && o < e) continue;
+    int a = ev[e], b = ev[LoopNextEdge(e)];
+    if (o == -1) {
+      out.positions[edge_child[e]] = LoopOddRule(in.positions[a],in.positions[b],Vec3f(),Vec3f(),
+                                                 true,in.edge_crease[e],vertex_class[a],vertex_class[b]);
+    } else {
+      out.positions[edge_child[e]] = LoopOddRule(in.positions[a],in.positions[b],
+                                                 in.positions[ev[LoopPrevEdge(e)]],in.positions[ev[LoopPrevEdge(o)]],
+                                                 false,in.edge_crease[e],vertex_class[a],vertex_class[b]);
+    }
+  }
+
+  out.edge_vertex.resize(12*num_tris);
+  out.edge_opposite.resize(12*num_tris);
+  out.edge_crease.resize(12*num_tris);
+  for (int t = 0; t < num_tris; t++) {
+    int base = 12*t;
+    int a = ev[3*t], b = ev[3*t+1], c = ev[3*t+2];
+    int ab = edge_child[3*t], bc = edge_child[3*t+1], ca = edge_child[3*t+2];
+    int verts[12] = { a, ab, ca,  b, bc, ab,  c, ca, bc,  ca, ab, bc };
+    for (int i = 0; i < 12; i++) out.edge_vertex[base+i] = verts[i];
+    for (int k = 0; k < 3; k++) {
+      int e = 3*t+k;
+      int first = base + 3*k;
+      int second = base + 3*((k+1)%3)+2;
+      float crease = (in.edge_crease[e] > 1) ? in.edge_crease[e]-1 : 0;
+      out.edge_crease[first] = out.edge_crease[second] = crease;
+      int o = eo[e];
+      if (o == -1) {
+        out.edge_opposite[first] = out.edge_opposite[second] = -1;
+      } else {
+        int other = 12*(o/3);
+        int k2 = o%3;
+        out.edge_opposite[first] = other + 3*((k2+1)%3)+2;
+        out.edge_opposite[second] = other + 3*k2;
+      }
+    }
+    int inner[3][2] = { { 1, 9 }, { 4, 10 }, { 7, 11 } };
+    for (int i = 0; i < 3; i++) {
+      out.edge_opposite[base+inner[i][0]] = base+inner[i][1];
+      out.edge_opposite[base+inner[i][1]] = base+inner[i][0];
+      out.edge_crease[base+inner[i][0]] = out.edge_crease[base+inner[i][1]] = 0;
+    }
+  }
+}
+
+// ====================================================================
+// ====================================================================
+// POINT EVALUATION
+
+void LoopLimitPoint(const std::vector<int> &edge_vertex, const std::vector<int> &edge_opposite,
+                    const std::vector<float> &edge_crease, const std::vector<Vec3f> &positions,
+                    int t, double v, double w, Vec3f &pos, Vec3f &normal) {
+  if (RegularTriangle(edge_opposite,edge_crease,t)) {
+    BoxSplinePatch(edge_vertex,edge_opposite,positions,t,v,w,pos,normal);
+    return;
+  }
+  LoopPatch patch, fine;
+  ExtractPatch(edge_vertex,edge_opposite,edge_crease,positions,t,patch);
+  double u = 1-v-w;
+  for (int level = 0; ; level++) {
+    if (level > 0 && RegularTriangle(patch.edge_opposite,patch.edge_crease,0)) {
+      BoxSplinePatch(patch.edge_vertex,patch.edge_opposite,patch.positions,0,v,w,pos,normal);
+      return;
+    }
+    int corner = (u >= 1) ? 0 : (v >= 1) ? 1 : (w >= 1) ? 2 : -1;
+    if (corner != -1 &&
+        LoopLimitVertex(patch.edge_vertex,patch.edge_opposite,patch.edge_crease,patch.positions,
+                        corner,pos,normal)) {
+      return;
+    }
+    if (level == LIMIT_MAX_LEVELS) {
+      // the triangle is tiny by now
+      double weights[3] = { u, v, w };
+      pos = Vec3f(0,0,0);
+      normal = Vec3f(0,0,0);
+      for (int k = 0; k < 3; k++) {
+        Vec3f p, n;
+        LoopLimitVertex(patch.edge_vertex,patch.edge_opposite,patch.edge_crease,patch.positions,k,p,n);
+        pos += weights[k]*p;
+        normal += weights[k]*n;
+      }
+      normal.Normalize();
+      return;
+    }
+
+    // step into the child holding the point
+    SubdividePatch(patch,fine);
+    int child;
+    double cu, cv, cw;
+    if (u >= 0.5)      { child = 0; cu = 2*u-1; cv = 2*v;   cw = 2*w;   }
+    else if (v >= 0.5) { child = 1; cu = 2*v-1; cv = 2*w;   cw = 2*u;   }
+    else if (w >= 0.5) { child = 2; cu = 2*w-1; cv = 2*u;   cw = 2*v;   }
+    else               { child = 3; cu = 1-2*v; cv = 1-2*w; cw = 1-2*u; }
+    u = cu; v = cv; w = cw;
+    ExtractPatch(fine.edge_vertex,fine.edge_opposite,fine.edge_crease,fine.positions,child,patch);
+  }
+}
+
+// ====================================================================
+// ====================================================================
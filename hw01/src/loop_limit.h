@@ -0,0 +1,52 @@
+#ifndef _LOOP_LIMIT_H_
+#define _LOOP_LIMIT_H_
+
+#include <vector>
+
+#include "vectors.h"
+
+// deepest local subdivision before a point near an extraordinary
+// vertex or a crease is blended from the limit positions of the tiny
+// triangle around it (the error shrinks 4x per level)
+#define LIMIT_MAX_LEVELS 12
+
+// ====================================================================
+// ====================================================================
+// Evaluation of the Loop limit surface (Stam '98) on the control mesh,
+// no subdivided mesh is built.
+//
+//  - at a vertex the limit position and tangents are fixed masks over
+//    its 1-ring (the left eigenvectors of the subdivision matrix)
+//  - inside a triangle whose corners are regular (valence 6, interior,
+//    no creases) the surface is a quartic box spline of the 12
+//    vertices around it, evaluated directly
+//  - any other triangle is subdivided locally, only its 2-ring is
+//    kept, until the point lands in a regular sub-triangle
+//
+// The arrays are laid out like Mesh's (see loop_rules.h).
+
+struct LoopPatch {
+  std::vector<Vec3f> positions;
+  std::vector<int> edge_vertex;
+  std::vector<int> edge_opposite;
+  std::vector<float> edge_crease;
+};
+
+// the limit position & normal at the start of half-edge e.  returns
+// false if a crease of finite sharpness touches the vertex: its limit
+// depends on more than the 1-ring, pos & normal are then what an
+// infinitely sharp crease would give.
+bool LoopLimitVertex(const std::vector<int> &edge_vertex, const std::vector<int> &edge_opposite,
+                     const std::vector<float> &edge_crease, const std::vector<Vec3f> &positions,
+                     int e, Vec3f &pos, Vec3f &normal);
+
+// the limit position & normal at barycentric (1-v-w, v, w) of the
+// corners of triangle t
+void LoopLimitPoint(const std::vector<int> &edge_vertex, const std::vector<int> &edge_opposite,
+                    const std::vector<float> &edge_crease, const std::vector<Vec3f> &positions,
+                    int t, double v, double w, Vec3f &pos, Vec3f &normal);
+
+// ====================================================================
+// ====================================================================
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef _LOOP_RULES_H_
+#define _LOOP_RULES_H_
+
+#include <vector>
+
+#include "vectors.h"
+
+// ====================================================================
+// ====================================================================
+// Loop subdivision rules with Hoppe et al. '94 creases, on the flat
+// half-edge arrays Mesh keeps: triangle t owns half-edges 3t, 3t+1,
+// 3t+2, edge_vertex[e] is the start of e and edge_opposite[e] is -1
+// on a boundary.  Shared by Mesh's subdivision passes and the limit
+// surface evaluation.
+
+// how the edge rule sees the ends of a sharp edge
+#define SUBDIV_SMOOTH 0            // smooth or dart vertex
+#define SUBDIV_REGULAR_CREASE 1    // 2 sharp edges, valence 6
+#define SUBDIV_OTHER 2             // any other crease, corner or boundary
+
+inline int LoopNextEdge(int e) { return (e % 3 == 2) ? e-2 : e+1; }
+inline int LoopPrevEdge(int e) { return (e % 3 == 0) ? e+2 : e-1; }
+
+// the first half-edge of the fan around the start of e: the one after
+// the boundary if the fan is open, e itself if it is closed
+inline int LoopFanStart(const std::vector<int> &edge_opposite, int e) {
+  int cur = e;
+  while (true) {
+    int o = edge_opposite[LoopPrevEdge(cur)];
+    if (o == -1 || o == e) return (o == -1) ? cur : e;
+    cur = o;
+  }
+}
+
+// the even (vertex) rule for the start of the half-edge start, which
+// must begin its fan (see LoopFanStart).  also classifies the vertex
+// for the odd rule.
+inline Vec3f LoopEvenRule(const std::vector<int> &edge_vertex, const std::vector<int> &edge_opposite,
+                          const std::vector<float> &edge_crease, const std::vector<Vec3f> &positions,
+                          int start, unsigned char &vertex_class) {
+  const Vec3f &pos = positions[edge_vertex[start]];
+  Vec3f ring_sum, crease_sum;
+  int valence = 0, sharp = 0;
+  int cur = start;
+  while (true) {
+    int neighbor = edge_vertex[LoopNextEdge(cur)];
+    ring_sum += positions[neighbor];
+    valence++;
+    int o = edge_opposite[cur];
+    if (o == -1) {
+      // boundary, the other boundary neighbor is at the start of the walk
+      const Vec3f &first = positions[edge_vertex[LoopPrevEdge(start)]];
+      vertex_class = SUBDIV_OTHER;
+      return 0.75*pos + 0.125*(positions[neighbor] + first);
+    }
+    if (edge_crease[cur] > 0) {
+      sharp++;
+      crease_sum += positions[neighbor];
+    }
+    cur = LoopNextEdge(o);
+    if (cur == start) break;
+  }
+  if (sharp <= 1) {
+    // smooth, or a dart
+    vertex_class = SUBDIV_SMOOTH;
+    double beta = (valence > 3) ? 3/(8.0*valence) : 3/16.0;
+    return (1 - valence*beta)*pos + beta*ring_sum;
+  } else if (sharp == 2) {
+    vertex_class = (valence == 6) ? SUBDIV_REGULAR_CREASE : SUBDIV_OTHER;
+    return 0.75*pos + 0.125*crease_sum;
+  }
+  // corner
+  vertex_class = SUBDIV_OTHER;
+  return pos;
+}
+
+// the odd (edge) rule for edge ab.  pc and pd are the corners across
+// it, unused on a boundary.
+inline Vec3f LoopOddRule(const Vec3f &pa, const Vec3f &pb, const Vec3f &pc, const Vec3f &pd,
+                         bool boundary, float crease,
+                         unsigned char class_a, unsigned char class_b) {
+  if (boundary) {
+    return 0.5*(pa+pb);
+  } else if (crease > 0 && class_a != SUBDIV_SMOOTH && class_b != SUBDIV_SMOOTH) {
+    // crease rule, leaning 5/8 towards a regular crease vertex
+    // when the other end is a corner or irregular
+    if (class_a == class_b)
+      return 0.5*(pa+pb);
+    else if (class_a == SUBDIV_REGULAR_CREASE)
+      return 0.625*pa + 0.375*pb;
+    else
+      return 0.375*pa + 0.625*pb;
+  }
+  return 0.375*(pa+pb) + 0.125*(pc+pd);
+}
+
+// ====================================================================
+// ====================================================================
+
+#endif
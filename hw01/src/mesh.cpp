@@ -5,23 +5,25 @@
 #include <sstream>
 #include <cassert>
 #include <cstddef>
+#include <cstring>
 #include <cmath>
 #include <math.h>
 #include <algorithm>
 #include <map>
 #include <set>
+#include <functional>
 
 
 #include "mesh.h"
-#include "edge.h"
-#include "vertex.h"
-#include "triangle.h"
-
-// Easier to read 
-typedef std::pair<Vertex*,Vertex*> vPair;
-
-
-int Triangle::next_triangle_id = 0;
+#include "obj_parser.h"
+#include "mesh_cache.h"
+#include "mesh_optimizer.h"
+#include "progressive_mesh.h"
+#include "quadric.h"
+#include "indexed_heap.h"
+#include "parallel_for.h"
+#include "loop_rules.h"
+#include "loop_limit.h"
 
 // helper for VBOs
 #define BUFFER_OFFSET(i) ((char *)NULL + (i))
@@ -33,145 +35,107 @@ int Triangle::next_triangle_id = 0;
 
 Mesh::~Mesh() {
   cleanupVBOs();
-
-  // delete all the triangles
-  std::vector<Triangle*> todo;
-  for (triangleshashtype::iterator iter = triangles.begin();
-       iter != triangles.end(); iter++) {
-    Triangle *t = iter->second;
-    todo.push_back(t);
-  }
-  int num_triangles = todo.size();
-  for (int i = 0; i < num_triangles; i++) {
-    removeTriangle(todo[i]);
-  }
-  // delete all the vertices
-  int num_vertices = numVertices();
-  for (int i = 0; i < num_vertices; i++) {
-    delete vertices[i];
-  }
+  // everything else lives in the std::vectors & hash tables
 }
 
 // =======================================================================
 // MODIFIERS:   ADD & REMOVE
 // =======================================================================
 
-Vertex* Mesh::addVertex(const Vec3f &position) {
+int Mesh::addVertex(const Vec3f &position) {
   int index = numVertices();
-  Vertex *v = new Vertex(index, position);
-  vertices.push_back(v);
+  vertex_positions.push_back(position);
+  vertex_parents.push_back(-1);
+  vertex_parents.push_back(-1);
   if (numVertices() == 1)
     bbox = BoundingBox(position,position);
   else 
     bbox.Extend(position);
-  return v;
+  markVertexDirty(index);
+  return index;
 }
 
 
-void Mesh::addTriangle(Vertex *a, Vertex *b, Vertex *c) {
-  // create the triangle
-  Triangle *t = new Triangle();
-  // create the edges
-  Edge *ea = new Edge(a,b,t);
-  Edge *eb = new Edge(b,c,t);
-  Edge *ec = new Edge(c,a,t);
-  // point the triangle to one of its edges
-  t->setEdge(ea);
-  // connect the edges to each other
-  ea->setNext(eb);
-  eb->setNext(ec);
-  ec->setNext(ea);
-  // verify these edges aren't already in the mesh 
-  // (which would be a bug, or a non-manifold mesh)
-  assert (edges.find(std::make_pair(a,b)) == edges.end());
-  assert (edges.find(std::make_pair(b,c)) == edges.end());
-  assert (edges.find(std::make_pair(c,a)) == edges.end());
-  // add the edges to the master list
-  edges[std::make_pair(a,b)] = ea;
-  edges[std::make_pair(b,c)] = eb;
-  edges[std::make_pair(c,a)] = ec;
-
-  // setCrease
-  if(creaseMap.count(std::make_pair(a,b)) == 1)
-    ea->setCrease(creaseMap[std::make_pair(a,b)] -1);
-  else if(creaseMap.count(std::make_pair(b,a)) == 1)
-    ea->setCrease(creaseMap[std::make_pair(b,a)] -1 );
-
-  if(creaseMap.count(std::make_pair(b,c)) == 1)
-    eb->setCrease(creaseMap[std::make_pair(b,c)]-1);
-  else if(creaseMap.count(std::make_pair(c,b)) == 1)
-    eb->setCrease(creaseMap[std::make_pair(c,b)]-1);
-  
-  if(creaseMap.count(std::make_pair(c,a)) == 1)
-    ec->setCrease(creaseMap[std::make_pair(c,a)]-1);
-  else if(creaseMap.count(std::make_pair(a,c)) == 1)
-    ec->setCrease(creaseMap[std::make_pair(a,c)]-1);
-
-
-
-  // connect up with opposite edges (if they exist)
-  edgeshashtype::iterator ea_op = edges.find(std::make_pair(b,a)); 
-  edgeshashtype::iterator eb_op = edges.find(std::make_pair(c,b)); 
-  edgeshashtype::iterator ec_op = edges.find(std::make_pair(a,c)); 
-  if (ea_op != edges.end()) { ea_op->second->setOpposite(ea); }
-  if (eb_op != edges.end()) { eb_op->second->setOpposite(eb); }
-  if (ec_op != edges.end()) { ec_op->second->setOpposite(ec); }
-  // add the triangle to the master list
-  assert (triangles.find(t->getID()) == triangles.end());
-  triangles[t->getID()] = t;
-}
-
-void Mesh::removeTriangle(Edge* edge) {
-  // Input: An edge pointer
-  // Assumptions: Triangle that pointer is on is valid
-  // Output: None
-  // Modification: Deletion of a triangle
-  Edge *ea = edge;
-  Edge *eb = ea->getNext();
-  Edge *ec = eb->getNext();
-  Vertex *a = ea->getStartVertex();
-  Vertex *b = eb->getStartVertex();
-  Vertex *c = ec->getStartVertex();
-  // remove these elements from master lists
-  edges.erase(std::make_pair(a,b)); 
-  edges.erase(std::make_pair(b,c)); 
-  edges.erase(std::make_pair(c,a)); 
-  // check that I removed it
-  assert (edges.find(std::make_pair(a,b)) == edges.end());
-  assert (edges.find(std::make_pair(b,c)) == edges.end());
-  assert (edges.find(std::make_pair(c,a)) == edges.end());
-
-  Triangle* t = edge->getTriangle();
-  triangles.erase(t->getID());
-  // clean up memory
-  delete ea;
-  delete eb;
-  delete ec;
-  delete t;
+int Mesh::addTriangle(int a, int b, int c) {
+  assert (a >= 0 && a < numVertices());
+  assert (b >= 0 && b < numVertices());
+  assert (c >= 0 && c < numVertices());
+  clearProgressive();
+  updateEdgeTable();
+  // reuse the slot of a removed triangle if there is one
+  int t;
+  if (!free_triangles.empty()) {
+    t = free_triangles.back();
+    free_triangles.pop_back();
+    assert (!isTriangle(t));
+  } else {
+    t = numTriangleSlots();
+    edge_vertex.resize(3*t+3);
+    edge_opposite.resize(3*t+3);
+    edge_crease.resize(3*t+3);
+  }
+  // create the edges, in order, so half-edge 3t+i starts at corner i
+  int verts[3] = { a, b, c };
+  for (int i = 0; i < 3; i++) {
+    edge_vertex[3*t+i] = verts[i];
+    edge_opposite[3*t+i] = -1;
+    edge_crease[3*t+i] = 0;
+  }
+  for (int i = 0; i < 3; i++) {
+    int e = 3*t+i;
+    int s = verts[i];
+    int f = verts[(i+1)%3];
+    // verify this edge isn't already in the mesh 
+    // (which would be a bug, or a non-manifold mesh)
+    assert (edges.find(ordered_index_pair(s,f)) == edges.end());
+    // add the edge to the master list
+    edges[ordered_index_pair(s,f)] = e;
+    // connect up with the opposite edge (if it exists)
+    edgeshashtype::iterator op = edges.find(ordered_index_pair(f,s));
+    if (op != edges.end()) {
+      assert (edge_opposite[op->second] == -1);
+      edge_opposite[op->second] = e;
+      edge_opposite[e] = op->second;
+      markTriangleDirty(edgeTriangle(op->second));
+    }
+  }
+  markTriangleDirty(t);
+  num_triangles++;
+  return t;
 }
 
 
-void Mesh::removeTriangle(Triangle *t) {
-  Edge *ea = t->getEdge();
-  Edge *eb = ea->getNext();
-  Edge *ec = eb->getNext();
-  Vertex *a = ea->getStartVertex();
-  Vertex *b = eb->getStartVertex();
-  Vertex *c = ec->getStartVertex();
-  // remove these elements from master lists
-  edges.erase(std::make_pair(a,b)); 
-  edges.erase(std::make_pair(b,c)); 
-  edges.erase(std::make_pair(c,a)); 
-  // check that I removed it
-  assert (edges.find(std::make_pair(a,b)) == edges.end());
-  assert (edges.find(std::make_pair(b,c)) == edges.end());
-  assert (edges.find(std::make_pair(c,a)) == edges.end());
-  triangles.erase(t->getID());
-  // clean up memory
-  delete ea;
-  delete eb;
-  delete ec;
-  delete t;
+void Mesh::removeTriangle(int t) {
+  assert (t >= 0 && t < numTriangleSlots() && isTriangle(t));
+  clearProgressive();
+  updateEdgeTable();
+  // remove the edges from the master list
+  for (int i = 0; i < 3; i++) {
+    int e = 3*t+i;
+    edges.erase(ordered_index_pair(getStartVertex(e),getEndVertex(e)));
+  }
+  // a green pair is broken up
+  if (t < (int)triangle_sibling.size() && triangle_sibling[t] != -1) {
+    triangle_sibling[triangle_sibling[t]] = -1;
+    triangle_sibling[t] = -1;
+  }
+  // disconnect from the opposite edges & free the slot.  the normals
+  // at the corners change too.
+  markTriangleDirty(t);
+  for (int i = 0; i < 3; i++) {
+    int e = 3*t+i;
+    markVertexDirty(edge_vertex[e]);
+    if (edge_opposite[e] != -1) {
+      assert (edge_opposite[edge_opposite[e]] == e);
+      edge_opposite[edge_opposite[e]] = -1;
+      markTriangleDirty(edgeTriangle(edge_opposite[e]));
+    }
+    edge_vertex[e] = -1;
+    edge_opposite[e] = -1;
+    edge_crease[e] = 0;
+  }
+  free_triangles.push_back(t);
+  num_triangles--;
 }
 
 
@@ -180,104 +144,196 @@ void Mesh::removeTriangle(Triangle *t) {
 // =======================================================================
 
 
-Edge* Mesh::getMeshEdge(Vertex *a, Vertex *b) const {
+int Mesh::getMeshEdge(int a, int b) {
   // Given two verticies you return the correct edge
-  edgeshashtype::const_iterator iter = edges.find(std::make_pair(a,b));
-  if (iter == edges.end()) return NULL;
+  updateEdgeTable();
+  edgeshashtype::const_iterator iter = edges.find(ordered_index_pair(a,b));
+  if (iter == edges.end()) return -1;
   return iter->second;
 }
 
-Vertex* Mesh::getChildVertex(Vertex *p1, Vertex *p2) const {
-  // Given two verticies you get the child
-  vphashtype::const_iterator iter = vertex_parents.find(std::make_pair(p1,p2)); 
-  if (iter == vertex_parents.end()) return NULL;
-  return iter->second; 
+bool Mesh::getOutgoingEdges(int e, std::vector<int> &ring) const {
+  ring.clear();
+  int cur = e;
+  do {
+    ring.push_back(cur);
+    cur = getOpposite(cur);
+    if (cur == -1) break;
+    cur = nextEdge(cur);
+  } while (cur != e);
+  if (cur == e) return true;
+  // hit a boundary, pick up the rest of the fan going the other way
+  cur = getOpposite(prevEdge(e));
+  while (cur != -1) {
+    ring.push_back(cur);
+    cur = getOpposite(prevEdge(cur));
+  }
+  return false;
+}
+
+// the table goes stale when LoopSubdivision rebuilds the arrays
+void Mesh::updateEdgeTable() {
+  if (!edge_table_stale) return;
+  edges.clear();
+  edges.reserve(edge_vertex.size());
+  for (int e = 0; e < (int)edge_vertex.size(); e++) {
+    if (edge_vertex[e] == -1) continue;
+    edges[ordered_index_pair(getStartVertex(e),getEndVertex(e))] = e;
+  }
+  edge_table_stale = false;
+}
+
+
+// =======================================================================
+// GEOMETRY
+// =======================================================================
+
+float Mesh::EdgeLength(int e) const {
+  Vec3f diff = getPos(getStartVertex(e)) - getPos(getEndVertex(e));
+  return diff.Length();
 }
 
-void Mesh::setParentsChild(Vertex *p1, Vertex *p2, Vertex *child) {
-  // Given two verticies and a child, you set the parent
-  // Some form of relationship between triangles?
-  assert (vertex_parents.find(std::make_pair(p1,p2)) == vertex_parents.end());
-  vertex_parents[std::make_pair(p1,p2)] = child; 
+float Mesh::DihedralAngle(int e) const {
+  // Warning this function returns 0 when there is an edge without
+  // two adjacent triangles
+
+  // Is there even an angle here?
+  if(getOpposite(e) == -1)
+    return 0;
+
+  // Find the angle of the face of a triangle
+  Vec3f normalA = getTriangleNormal(edgeTriangle(e));
+  Vec3f normalB = getTriangleNormal(edgeTriangle(getOpposite(e)));
+
+  // Using Equation theta = acos( (a . b) / (|a||b|)) 
+  double top = normalA.Dot3(normalB);
+  double bottom = normalA.Length() * normalB.Length();
+  double result = acos(top/bottom);
+  return result;
+}
+
+Vec3f Mesh::getTriangleNormal(int t) const {
+  Vec3f p1 = getPos(getTriangleVertex(t,0));
+  Vec3f p2 = getPos(getTriangleVertex(t,1));
+  Vec3f p3 = getPos(getTriangleVertex(t,2));
+
+  Vec3f v12 = p2;
+  v12 -= p1;
+  Vec3f v23 = p3;
+  v23 -= p2;
+  Vec3f normal;
+  Vec3f::Cross3(normal,v12,v23);
+  normal.Normalize();
+  return normal;
 }
 
 
 // =======================================================================
 // the load function parses very simple .obj files
 // the basic format has been extended to allow the specification 
-// of crease weights on the edges.
+// of crease weights on the edges.  binary .mcache files written by
+// obj2cache are recognized by their extension.
 // =======================================================================
 
-#define MAX_CHAR_PER_LINE 200
-
 void Mesh::Load(const std::string &input_file) {
 
-  std::ifstream istr(input_file.c_str());
-  if (!istr) {
+  markAllDirty();
+
+  if (IsMeshCacheFile(input_file)) {
+    LoadCache(input_file);
+    return;
+  }
+  if (IsProgressiveMeshFile(input_file)) {
+    LoadProgressive(input_file);
+    return;
+  }
+
+  ObjData data;
+  if (!LoadObj(input_file,data)) {
     std::cout << "ERROR! CANNOT OPEN: " << input_file << std::endl;
     return;
   }
+  if (data.num_skipped_lines > 0) {
+    std::cout << "WARNING: skipped " << data.num_skipped_lines << " unrecognized lines in " << input_file << std::endl;
+  }
 
-  char line[MAX_CHAR_PER_LINE];
-  std::string token, token2;
-  float x,y,z;
-  int a,b,c;
-  int index = 0;
-  int vert_count = 0;
-  int vert_index = 1;
-
-  // read in each line of the file
-  while (istr.getline(line,MAX_CHAR_PER_LINE)) { 
-    // put the line into a stringstream for parsing
-    std::stringstream ss;
-    ss << line;
-
-    // check for blank line
-    token = "";   
-    ss >> token;
-    if (token == "") continue;
-
-    if (token == std::string("usemtl") ||
-	token == std::string("g")) {
-      vert_index = 1; 
-      index++;
-    } else if (token == std::string("v")) {
-      vert_count++;
-      ss >> x >> y >> z;
-      addVertex(Vec3f(x,y,z));
-    } else if (token == std::string("f")) {
-      a = b = c = -1;
-      ss >> a >> b >> c;
-      a -= vert_index;
-      b -= vert_index;
-      c -= vert_index;
-      assert (a >= 0 && a < numVertices());
-      assert (b >= 0 && b < numVertices());
-      assert (c >= 0 && c < numVertices());
-      addTriangle(getVertex(a),getVertex(b),getVertex(c));
-    } else if (token == std::string("e")) {
-      a = b = -1;
-      ss >> a >> b >> token2;
-
-      // whoops: inconsistent file format, don't subtract 1
-      assert (a >= 0 && a <= numVertices());
-      assert (b >= 0 && b <= numVertices());
-      if (token2 == std::string("inf")) x = 1000000; // this is close to infinity...
-      x = atof(token2.c_str());
-      Vertex *va = getVertex(a);
-      Vertex *vb = getVertex(b);
-      Edge *ab = getMeshEdge(va,vb);
-      Edge *ba = getMeshEdge(vb,va);
-      assert (ab != NULL);
-      assert (ba != NULL);
-      ab->setCrease(x);
-      ba->setCrease(x);
-    } else if (token == std::string("vt")) {
-    } else if (token == std::string("vn")) {
-    } else if (token[0] == '#') {
-    } else {
-      printf ("LINE: '%s'",line);
-    }
+  // size everything up front, the counts are known
+  int num_verts = data.numVertices();
+  int num_tris = data.numTriangles();
+  vertex_positions.reserve(num_verts);
+  vertex_parents.reserve(2*num_verts);
+  edge_vertex.reserve(3*num_tris);
+  edge_opposite.reserve(3*num_tris);
+  edge_crease.reserve(3*num_tris);
+  edges.reserve(3*num_tris);
+
+  for (int i = 0; i < num_verts; i++) {
+    const float *p = &data.positions[3*i];
+    addVertex(Vec3f(p[0],p[1],p[2]));
+  }
+  for (int i = 0; i < num_tris; i++) {
+    addTriangle(data.triangles[3*i],data.triangles[3*i+1],data.triangles[3*i+2]);
+  }
+  for (unsigned int i = 0; i < data.creases.size(); i++) {
+    // whoops: inconsistent file format, don't subtract 1
+    int a = data.creases[i].a;
+    int b = data.creases[i].b;
+    assert (a >= 0 && a < numVertices());
+    assert (b >= 0 && b < numVertices());
+    int ab = getMeshEdge(a,b);
+    int ba = getMeshEdge(b,a);
+    assert (ab != -1);
+    assert (ba != -1);
+    setCrease(ab,data.creases[i].weight);
+    setCrease(ba,data.creases[i].weight);
+  }
+}
+
+// the cache is already laid out like our half-edge arrays, so they are
+// copied straight in (the edges table is still filled in for getMeshEdge)
+void Mesh::LoadCache(const std::string &input_file) {
+
+  MeshCache cache;
+  if (!cache.Open(input_file)) {
+    std::cout << "ERROR! CANNOT OPEN: " << input_file << std::endl;
+    return;
+  }
+  assert (numVertices() == 0 && numTriangles() == 0);
+  markAllDirty();
+
+  int num_verts = cache.numVertices();
+  int num_tris = cache.numTriangles();
+  const float *positions = cache.getPositions();
+  const int32_t *tris = cache.getTriangles();
+  const int32_t *opposites = cache.getOpposites();
+
+  vertex_positions.reserve(num_verts);
+  vertex_parents.reserve(2*num_verts);
+  for (int i = 0; i < num_verts; i++) {
+    const float *p = &positions[3*i];
+    addVertex(Vec3f(p[0],p[1],p[2]));
+  }
+
+  edge_vertex.assign(tris,tris+3*num_tris);
+  edge_opposite.assign(opposites,opposites+3*num_tris);
+  edge_crease.assign(3*num_tris,0);
+  num_triangles = num_tris;
+  edges.reserve(3*num_tris);
+  for (int e = 0; e < 3*num_tris; e++) {
+    assert (edge_vertex[e] >= 0 && edge_vertex[e] < num_verts);
+    assert (edge_opposite[e] == -1 || edge_opposite[edge_opposite[e]] == e);
+    edges[ordered_index_pair(getStartVertex(e),getEndVertex(e))] = e;
+  }
+  // a duplicate directed edge would have collapsed in the table
+  assert (edges.size() == (size_t)3*num_tris);
+
+  const MeshCacheCrease *creases = cache.getCreases();
+  for (int i = 0; i < cache.numCreases(); i++) {
+    int e = creases[i].halfedge;
+    assert (e >= 0 && e < 3*num_tris);
+    setCrease(e,creases[i].weight);
+    if (getOpposite(e) != -1)
+      setCrease(getOpposite(e),creases[i].weight);
   }
 }
 
@@ -314,39 +370,39 @@ Vec3f ComputeNormal(const Vec3f &p1, const Vec3f &p2, const Vec3f &p3) {
   return normal;
 }
 
-Vec3f getAverageNormals(Edge* givenEdge){
+Vec3f Mesh::getAverageNormals(int givenEdge) const {
 
 
   // Finding avereage normal of givenEdge
-  Edge* cur = givenEdge;
+  int cur = givenEdge;
   std::vector<Vec3f> curSum;
   bool reversed = false;
 
   do{
 
-    Triangle* curTri = (*cur).getTriangle();
     // Get that face's normal
-    Vec3f v1= (*curTri)[0]->getPos();
-    Vec3f v2= (*curTri)[1]->getPos();
-    Vec3f v3= (*curTri)[2]->getPos();   
+    int curTri = edgeTriangle(cur);
+    Vec3f v1= getPos(getTriangleVertex(curTri,0));
+    Vec3f v2= getPos(getTriangleVertex(curTri,1));
+    Vec3f v3= getPos(getTriangleVertex(curTri,2));
     // Find normal of that face
     Vec3f n = ComputeNormal(v1,v2,v3);
     //Push into curSum
     curSum.push_back(n);
-    //incremement pointer
-    cur = cur->getOpposite();
+    //incremement
+    cur = getOpposite(cur);
 
     //If opposite is a dead end
-    if(cur == NULL && !reversed){
-        cur = givenEdge->getPrev();
+    if(cur == -1 && !reversed){
+        cur = prevEdge(givenEdge);
         reversed = true;
-    }else if(cur == NULL && reversed){
+    }else if(cur == -1 && reversed){
         cur = givenEdge;
-    }else if(cur != NULL){
+    }else if(cur != -1){
         if(reversed)
-            cur = cur->getPrev();
+            cur = prevEdge(cur);
         else
-            cur = cur->getNext();
+            cur = nextEdge(cur);
     }
 
   }while ( givenEdge != cur );
@@ -356,207 +412,266 @@ Vec3f getAverageNormals(Edge* givenEdge){
 
 }
 
+// an edit that dirties more than this fraction of the triangle slots
+// gets everything re-packed and sent with one glBufferData
+#define VBO_PARTIAL_LIMIT 0.25
+// dirty entries closer together than this go up in the same
+// glBufferSubData, the clean ones between them along for the ride
+#define VBO_RUN_GAP 64
+
+// one glBufferSubData per run of flagged entries in the bound buffer
+static void UploadDirtyRuns(GLenum target, const void *data, size_t entry_bytes,
+                            const std::vector<unsigned char> &flags) {
+  const char *bytes = (const char*)data;
+  int n = flags.size();
+  int i = 0;
+  while (i < n) {
+    if (!flags[i]) { i++; continue; }
+    int begin = i, end = i+1, gap = 0;
+    for (i++; i < n; i++) {
+      if (flags[i]) { end = i+1; gap = 0; }
+      else if (++gap > VBO_RUN_GAP) break;
+    }
+    glBufferSubData(target,begin*entry_bytes,(end-begin)*entry_bytes,bytes+begin*entry_bytes);
+  }
+}
+
+static std::vector<int> FlaggedIndices(const std::vector<unsigned char> &flags) {
+  std::vector<int> indices;
+  for (int i = 0; i < (int)flags.size(); i++) {
+    if (flags[i]) indices.push_back(i);
+  }
+  return indices;
+}
+
+
 void Mesh::initializeVBOs() {
   // create a pointer for the vertex & index VBOs
   glGenBuffers(1, &mesh_tri_verts_VBO);
-  glGenBuffers(1, &mesh_tri_indices_VBO);
   glGenBuffers(1, &mesh_verts_VBO);
   glGenBuffers(1, &mesh_boundary_edge_indices_VBO);
   glGenBuffers(1, &mesh_crease_edge_indices_VBO);
   glGenBuffers(1, &mesh_other_edge_indices_VBO);
+  markAllDirty();
   setupVBOs();
 }
 
 void Mesh::setupVBOs() {
   HandleGLError("in setup mesh VBOs");
-  setupTriVBOs();
-  setupEdgeVBOs();
+  // everything is rebuilt if the buffers are too small, the shading
+  // changed, or too much of the mesh is dirty
+  std::vector<unsigned char> triangle_flags, vertex_flags;
+  bool full = vbo_all_dirty || vbo_gouraud != args->gouraud ||
+    numTriangleSlots() > vbo_triangle_capacity || numVertices() > vbo_vertex_capacity ||
+    !findDirty(triangle_flags,vertex_flags);
+  if (full) {
+    packVBOs();
+    setupTriVBOs(NULL);
+    setupEdgeVBOs(NULL,NULL);
+  } else {
+    setupTriVBOs(&triangle_flags);
+    setupEdgeVBOs(&triangle_flags,&vertex_flags);
+  }
+  vbo_num_slots = numTriangleSlots();
+  vbo_all_dirty = false;
+  dirty_triangles.clear();
+  dirty_vertices.clear();
   HandleGLError("leaving setup mesh");
 }
 
 
-void Mesh::setupTriVBOs() {
-  // Set up Triangle Vertex Buffer Object
-
-  VBOTriVert* mesh_tri_verts;
-  VBOTri* mesh_tri_indices;
-  unsigned int num_tris = triangles.size();
-
-  // allocate space for the data (goes on the heap)
-  // NOTE: VBOTriVert -> What is it
-  mesh_tri_verts = new VBOTriVert[num_tris*3];
-  mesh_tri_indices = new VBOTri[num_tris];
-
-  // write the vertex & triangle data
-  unsigned int i = 0;
-  triangleshashtype::iterator iter = triangles.begin();
-  for (; iter != triangles.end(); iter++,i++) {
-    Triangle *t = iter->second;
-
-    Vec3f a = (*t)[0]->getPos();
-    Vec3f b = (*t)[1]->getPos();
-    Vec3f c = (*t)[2]->getPos();
-    
-    if (args->gouraud) {
-
-      // Find avaerage normal of faces surrouding each vertex. (a,b,c)
-        
-      // Three Edges in triangle
-      Edge* edgeA = (*t).getEdge();
-      Edge* edgeB = (*t).getEdge()->getNext();
-      Edge* edgeC = (*t).getEdge()->getNext()->getNext();
-
-      // Call to getAverageNormals -- This function calculates the normal of 
-      // surrounding faces of a triangle. 
-      Vec3f normalA = getAverageNormals(edgeA);
-      Vec3f normalB = getAverageNormals(edgeB);
-      Vec3f normalC = getAverageNormals(edgeC);
-
-      // Send normal to VBO
-      mesh_tri_verts[i*3]   = VBOTriVert(a,normalA);
-      mesh_tri_verts[i*3+1] = VBOTriVert(b,normalB);
-      mesh_tri_verts[i*3+2] = VBOTriVert(c,normalC);
-
-    } else {
-      Vec3f normal = ComputeNormal(a,b,c);
-      mesh_tri_verts[i*3]   = VBOTriVert(a,normal);
-      mesh_tri_verts[i*3+1] = VBOTriVert(b,normal);
-      mesh_tri_verts[i*3+2] = VBOTriVert(c,normal);
+bool Mesh::findDirty(std::vector<unsigned char> &triangle_flags,
+                     std::vector<unsigned char> &vertex_flags) const {
+  // Output: the triangle slots to re-pack and the vertices to re-send,
+  //         false if that is more than VBO_PARTIAL_LIMIT of the mesh
+  int num_slots = numTriangleSlots();
+  vertex_flags.assign(numVertices(),0);
+  for (unsigned int i = 0; i < dirty_vertices.size(); i++) vertex_flags[dirty_vertices[i]] = 1;
+  triangle_flags.assign(num_slots,0);
+  for (unsigned int i = 0; i < dirty_triangles.size(); i++) triangle_flags[dirty_triangles[i]] = 1;
+
+  // a triangle moves with its corners
+  ParallelFor(num_slots,[&](int begin, int end) {
+    for (int t = begin; t < end; t++) {
+      if (triangle_flags[t] || !isTriangle(t)) continue;
+      for (int k = 0; k < 3; k++) {
+        if (vertex_flags[edge_vertex[3*t+k]]) { triangle_flags[t] = 1; break; }
+      }
+    }
+  });
+
+  if (args->gouraud) {
+    // a smooth normal averages all the triangles at a corner, so
+    // when one of them changes every other one there is re-packed
+    std::vector<unsigned char> normal_flags(numVertices(),0);
+    for (int t = 0; t < num_slots; t++) {
+      if (!triangle_flags[t] || !isTriangle(t)) continue;
+      for (int k = 0; k < 3; k++) normal_flags[edge_vertex[3*t+k]] = 1;
     }
-    mesh_tri_indices[i] = VBOTri(i*3,i*3+1,i*3+2);
+    ParallelFor(num_slots,[&](int begin, int end) {
+      for (int t = begin; t < end; t++) {
+        if (triangle_flags[t] || !isTriangle(t)) continue;
+        for (int k = 0; k < 3; k++) {
+          if (normal_flags[edge_vertex[3*t+k]]) { triangle_flags[t] = 1; break; }
+        }
+      }
+    });
   }
 
-  // cleanup old buffer data (if any)
-  glDeleteBuffers(1, &mesh_tri_verts_VBO);
-  glDeleteBuffers(1, &mesh_tri_indices_VBO);
-
-  // copy the data to each VBO
-  glBindBuffer(GL_ARRAY_BUFFER,mesh_tri_verts_VBO); 
-  glBufferData(GL_ARRAY_BUFFER,
-	       sizeof(VBOTriVert) * num_tris * 3,
-	       mesh_tri_verts,
-	       GL_STATIC_DRAW); 
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,mesh_tri_indices_VBO); 
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-	       sizeof(VBOTri) * num_tris,
-	       mesh_tri_indices, GL_STATIC_DRAW);
-
-  delete [] mesh_tri_verts;
-  delete [] mesh_tri_indices;
-
+  int count = 0;
+  for (int t = 0; t < num_slots; t++) count += triangle_flags[t];
+  return count <= VBO_PARTIAL_LIMIT*num_slots;
 }
 
 
-void Mesh::setupEdgeVBOs() {
-
-  VBOVert* mesh_verts;
-  VBOEdge* mesh_boundary_edge_indices;
-  VBOEdge* mesh_crease_edge_indices;
-  VBOEdge* mesh_other_edge_indices;
+void Mesh::packTriangle(int t) {
+  VBOTriVert *verts = &vbo_tri_verts[3*t];
+  if (t >= numTriangleSlots() || !isTriangle(t)) {
+    // a free slot, degenerate so nothing is drawn
+    Vec3f zero(0,0,0);
+    verts[0] = verts[1] = verts[2] = VBOTriVert(zero,zero);
+    return;
+  }
 
-  mesh_boundary_edge_indices = NULL;
-  mesh_crease_edge_indices = NULL;
-  mesh_other_edge_indices = NULL;
+  Vec3f a = getPos(getTriangleVertex(t,0));
+  Vec3f b = getPos(getTriangleVertex(t,1));
+  Vec3f c = getPos(getTriangleVertex(t,2));
+
+  if (vbo_gouraud) {
+    // Find avaerage normal of faces surrouding each vertex. (a,b,c)
+    verts[0] = VBOTriVert(a,getAverageNormals(3*t));
+    verts[1] = VBOTriVert(b,getAverageNormals(3*t+1));
+    verts[2] = VBOTriVert(c,getAverageNormals(3*t+2));
+  } else {
+    Vec3f normal = ComputeNormal(a,b,c);
+    verts[0] = VBOTriVert(a,normal);
+    verts[1] = VBOTriVert(b,normal);
+    verts[2] = VBOTriVert(c,normal);
+  }
+}
 
-  unsigned int num_verts = vertices.size();
 
-  // first count the edges of each type
-  num_boundary_edges = 0;
-  num_crease_edges = 0;
-  num_other_edges = 0;
-  for (edgeshashtype::iterator iter = edges.begin();
-       iter != edges.end(); iter++) {
-    Edge *e = iter->second;
-    int a = e->getStartVertex()->getIndex();
-    int b = e->getEndVertex()->getIndex();
-    if (e->getOpposite() == NULL) {
-      num_boundary_edges++;
+void Mesh::packEdges(int t) {
+  bool live = t < numTriangleSlots() && isTriangle(t);
+  for (int k = 0; k < 3; k++) {
+    int e = 3*t+k;
+    // zero length lines draw nothing
+    int a = live ? getStartVertex(e) : 0;
+    vbo_boundary_edges[e] = vbo_crease_edges[e] = vbo_other_edges[e] = VBOEdge(a,a);
+    if (!live) continue;
+    int b = getEndVertex(e);
+    if (getOpposite(e) == -1) {
+      vbo_boundary_edges[e] = VBOEdge(a,b);
     } else {
       if (a < b) continue; // don't double count edges!
-      if (e->getCrease() > 0) num_crease_edges++;
-      else num_other_edges++;
+      if (getCrease(e) > 0)
+        vbo_crease_edges[e] = VBOEdge(a,b);
+      else
+        vbo_other_edges[e] = VBOEdge(a,b);
     }
   }
+}
 
-  // allocate space for the data
-  mesh_verts = new VBOVert[num_verts];
-  if (num_boundary_edges > 0)
-    mesh_boundary_edge_indices = new VBOEdge[num_boundary_edges];
-  if (num_crease_edges > 0)
-    mesh_crease_edge_indices = new VBOEdge[num_crease_edges];
-  if (num_other_edges > 0)
-    mesh_other_edge_indices = new VBOEdge[num_other_edges];
-
-  // write the vertex data
-  for (unsigned int i = 0; i < num_verts; i++) {
-    mesh_verts[i] = VBOVert(vertices[i]->getPos());
-  }
-
-  // write the edge data
-  int bi = 0;
-  int ci = 0;
-  int oi = 0; 
-  for (edgeshashtype::iterator iter = edges.begin();
-       iter != edges.end(); iter++) {
-    Edge *e = iter->second;
-    int a = e->getStartVertex()->getIndex();
-    int b = e->getEndVertex()->getIndex();
-    if (e->getOpposite() == NULL) {
-      mesh_boundary_edge_indices[bi++] = VBOEdge(a,b);
-    } else {
-      if (a < b) continue; // don't double count edges!
-      if (e->getCrease() > 0) 
-	mesh_crease_edge_indices[ci++] = VBOEdge(a,b);
-      else 
-	mesh_other_edge_indices[oi++] = VBOEdge(a,b);
+
+void Mesh::packVBOs() {
+  vbo_gouraud = args->gouraud;
+  // leave room to grow, adaptive refinement adds slots a few at a time
+  int num_slots = numTriangleSlots();
+  vbo_triangle_capacity = num_slots + num_slots/4;
+  vbo_tri_verts.resize(3*vbo_triangle_capacity);
+  ParallelFor(vbo_triangle_capacity,[&](int begin, int end) {
+    for (int t = begin; t < end; t++) packTriangle(t);
+  });
+
+  int num_verts = numVertices();
+  vbo_vertex_capacity = num_verts + num_verts/4;
+  vbo_verts.resize(vbo_vertex_capacity);
+  ParallelFor(vbo_vertex_capacity,[&](int begin, int end) {
+    for (int v = begin; v < end; v++)
+      vbo_verts[v] = VBOVert(v < num_verts ? vertex_positions[v] : Vec3f(0,0,0));
+  });
+
+  // the edge buffers have the same capacity as the triangles
+  std::vector<VBOEdge> *edges[3] = { &vbo_boundary_edges, &vbo_crease_edges, &vbo_other_edges };
+  for (int i = 0; i < 3; i++) edges[i]->resize(3*vbo_triangle_capacity);
+  ParallelFor(vbo_triangle_capacity,[&](int begin, int end) {
+    for (int t = begin; t < end; t++) packEdges(t);
+  });
+}
+
+
+void Mesh::setupTriVBOs(const std::vector<unsigned char> *triangle_flags) {
+  // Set up Triangle Vertex Buffer Object: 3 vertices per triangle
+  // slot, NULL flags re-allocates all of it
+  glBindBuffer(GL_ARRAY_BUFFER,mesh_tri_verts_VBO);
+  if (triangle_flags == NULL) {
+    // packVBOs just re-packed it all
+    glBufferData(GL_ARRAY_BUFFER,
+                 sizeof(VBOTriVert) * vbo_tri_verts.size(),
+                 vbo_tri_verts.empty() ? NULL : &vbo_tri_verts[0],
+                 GL_DYNAMIC_DRAW);
+    return;
+  }
+  std::vector<int> slots = FlaggedIndices(*triangle_flags);
+  ParallelFor(slots.size(),[&](int begin, int end) {
+    for (int i = begin; i < end; i++) packTriangle(slots[i]);
+  });
+  if (!slots.empty())
+    UploadDirtyRuns(GL_ARRAY_BUFFER,&vbo_tri_verts[0],3*sizeof(VBOTriVert),*triangle_flags);
+}
+
+
+void Mesh::setupEdgeVBOs(const std::vector<unsigned char> *triangle_flags,
+                         const std::vector<unsigned char> *vertex_flags) {
+  // the vertex positions, then 3 edge index buffers each with an entry
+  // per half-edge slot.  NULL flags re-allocates it all.
+  GLuint vbos[3] = { mesh_boundary_edge_indices_VBO, mesh_crease_edge_indices_VBO,
+                     mesh_other_edge_indices_VBO };
+  std::vector<VBOEdge> *edges[3] = { &vbo_boundary_edges, &vbo_crease_edges, &vbo_other_edges };
+
+  if (triangle_flags == NULL) {
+    assert (vertex_flags == NULL);
+    glBindBuffer(GL_ARRAY_BUFFER,mesh_verts_VBO);
+    glBufferData(GL_ARRAY_BUFFER,
+                 sizeof(VBOVert) * vbo_verts.size(),
+                 vbo_verts.empty() ? NULL : &vbo_verts[0],
+                 GL_DYNAMIC_DRAW);
+    for (int i = 0; i < 3; i++) {
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,vbos[i]);
+      glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                   sizeof(VBOEdge) * edges[i]->size(),
+                   edges[i]->empty() ? NULL : &(*edges[i])[0],
+                   GL_DYNAMIC_DRAW);
     }
+    return;
   }
-  assert (bi == num_boundary_edges);
-  assert (ci == num_crease_edges);
-  assert (oi == num_other_edges);
 
-  // cleanup old buffer data (if any)
-  glDeleteBuffers(1, &mesh_verts_VBO);
-  glDeleteBuffers(1, &mesh_boundary_edge_indices_VBO);
-  glDeleteBuffers(1, &mesh_crease_edge_indices_VBO);
-  glDeleteBuffers(1, &mesh_other_edge_indices_VBO);
+  assert (vertex_flags != NULL);
+  std::vector<int> verts = FlaggedIndices(*vertex_flags);
+  for (unsigned int i = 0; i < verts.size(); i++) {
+    vbo_verts[verts[i]] = VBOVert(vertex_positions[verts[i]]);
+  }
+  if (!verts.empty()) {
+    glBindBuffer(GL_ARRAY_BUFFER,mesh_verts_VBO);
+    UploadDirtyRuns(GL_ARRAY_BUFFER,&vbo_verts[0],sizeof(VBOVert),*vertex_flags);
+  }
 
-  // copy the data to each VBO
-  glBindBuffer(GL_ARRAY_BUFFER,mesh_verts_VBO); 
-  glBufferData(GL_ARRAY_BUFFER,
-	       sizeof(VBOVert) * num_verts,
-	       mesh_verts,
-	       GL_STATIC_DRAW); 
-
-  if (num_boundary_edges > 0) {
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,mesh_boundary_edge_indices_VBO); 
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-		 sizeof(VBOEdge) * num_boundary_edges,
-		 mesh_boundary_edge_indices, GL_STATIC_DRAW);
-  }
-  if (num_crease_edges > 0) {
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,mesh_crease_edge_indices_VBO); 
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-		 sizeof(VBOEdge) * num_crease_edges,
-		 mesh_crease_edge_indices, GL_STATIC_DRAW);
-  }
-  if (num_other_edges > 0) {
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,mesh_other_edge_indices_VBO); 
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-		 sizeof(VBOEdge) * num_other_edges,
-		 mesh_other_edge_indices, GL_STATIC_DRAW);
-  }
-
-  delete [] mesh_verts;
-  delete [] mesh_boundary_edge_indices;
-  delete [] mesh_crease_edge_indices;
-  delete [] mesh_other_edge_indices;
+  std::vector<int> slots = FlaggedIndices(*triangle_flags);
+  ParallelFor(slots.size(),[&](int begin, int end) {
+    for (int i = begin; i < end; i++) packEdges(slots[i]);
+  });
+  if (slots.empty()) return;
+  for (int i = 0; i < 3; i++) {
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,vbos[i]);
+    UploadDirtyRuns(GL_ELEMENT_ARRAY_BUFFER,&(*edges[i])[0],3*sizeof(VBOEdge),*triangle_flags);
+  }
 }
 
 
 void Mesh::cleanupVBOs() {
+  // (never set up, e.g. by a benchmark without a window)
+  if (mesh_tri_verts_VBO == 0) return;
   glDeleteBuffers(1, &mesh_tri_verts_VBO);
-  glDeleteBuffers(1, &mesh_tri_indices_VBO);
   glDeleteBuffers(1, &mesh_verts_VBO);
   glDeleteBuffers(1, &mesh_boundary_edge_indices_VBO);
   glDeleteBuffers(1, &mesh_crease_edge_indices_VBO);
@@ -564,15 +679,94 @@ void Mesh::cleanupVBOs() {
 }
 
 
-void Mesh::drawVBOs() {
+void Mesh::OptimizeLayout() {
 
-  HandleGLError("in draw mesh");
+  clearProgressive();
+  int num_slots = numTriangleSlots();
+  int num_verts = numVertices();
+
+  std::vector<int> slots;
+  std::vector<unsigned int> indices;
+  slots.reserve(numTriangles());
+  indices.reserve(3*numTriangles());
+  for (int t = 0; t < num_slots; t++) {
+    if (!isTriangle(t)) continue;
+    slots.push_back(t);
+    for (int k = 0; k < 3; k++) indices.push_back(edge_vertex[3*t+k]);
+  }
+  double before = ComputeACMR(indices,num_verts,ACMR_FIFO_SIZE);
+
+  // the i-th triangle drawn goes in slot i
+  std::vector<int> order;
+  OptimizeVertexCache(indices,num_verts,order);
+  int num_tris = order.size();
+  std::vector<int> new_slot(num_slots,-1);
+  std::vector<unsigned int> sorted(3*num_tris);
+  for (int i = 0; i < num_tris; i++) {
+    new_slot[slots[order[i]]] = i;
+    for (int k = 0; k < 3; k++) sorted[3*i+k] = indices[3*order[i]+k];
+  }
+  std::vector<int> remap;
+  int num_used = OptimizeVertexFetch(sorted,num_verts,remap);
+  double after = ComputeACMR(sorted,num_verts,ACMR_FIFO_SIZE);
+  // vertices no triangle uses keep their order, after the rest
+  for (int v = 0; v < num_verts; v++) {
+    if (remap[v] == -1) remap[v] = num_used++;
+  }
+
+  std::vector<Vec3f> new_positions(num_verts);
+  std::vector<int> new_parents(2*num_verts);
+  for (int v = 0; v < num_verts; v++) {
+    new_positions[remap[v]] = vertex_positions[v];
+    for (int i = 0; i < 2; i++) {
+      int parent = vertex_parents[2*v+i];
+      new_parents[2*remap[v]+i] = (parent == -1) ? -1 : remap[parent];
+    }
+  }
+  std::vector<int> new_vertex(3*num_tris), new_opposite(3*num_tris);
+  std::vector<float> new_crease(3*num_tris);
+  std::vector<int> new_sibling;
+  if (!triangle_sibling.empty()) new_sibling.assign(num_tris,-1);
+  for (int i = 0; i < num_tris; i++) {
+    int t = slots[order[i]];
+    for (int k = 0; k < 3; k++) {
+      int e = 3*t+k;
+      int o = edge_opposite[e];
+      new_vertex[3*i+k] = remap[edge_vertex[e]];
+      new_opposite[3*i+k] = (o == -1) ? -1 : 3*new_slot[o/3] + o%3;
+      new_crease[3*i+k] = edge_crease[e];
+    }
+    if (t < (int)triangle_sibling.size() && triangle_sibling[t] != -1)
+      new_sibling[i] = new_slot[triangle_sibling[t]];
+  }
+
+  vertex_positions.swap(new_positions);
+  vertex_parents.swap(new_parents);
+  edge_vertex.swap(new_vertex);
+  edge_opposite.swap(new_opposite);
+  edge_crease.swap(new_crease);
+  triangle_sibling.swap(new_sibling);
+  free_triangles.clear();
+  edge_table_stale = true;
+  markAllDirty();
+
+  std::cout << "Vertex cache ACMR (FIFO " << ACMR_FIFO_SIZE << "): " << before << " -> " << after << std::endl;
+}
 
-  // scale it so it fits in the window
+
+void Mesh::glFitToWindow() const {
   Vec3f center; bbox.getCenter(center);
   float s = 1/bbox.maxDim();
   glScalef(s,s,s);
   glTranslatef(-center.x(),-center.y(),-center.z());
+}
+
+
+void Mesh::drawVBOs() {
+
+  HandleGLError("in draw mesh");
+
+  glFitToWindow();
 
   // this offset prevents "z-fighting" bewteen the edges and faces
   // so the edges will always win
@@ -582,8 +776,7 @@ void Mesh::drawVBOs() {
   } 
 
   // ======================
-  // draw all the triangles
-  unsigned int num_tris = triangles.size();
+  // draw all the triangles (free slots are degenerate)
   glColor3f(1,1,1);
 
   // select the vertex buffer
@@ -594,13 +787,8 @@ void Mesh::drawVBOs() {
   glEnableClientState(GL_NORMAL_ARRAY);
   glNormalPointer(GL_FLOAT, sizeof(VBOTriVert), BUFFER_OFFSET(12));
 
-  // select the index buffer
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh_tri_indices_VBO);
   // draw this data
-  glDrawElements(GL_TRIANGLES, 
-		 num_tris*3,
-		 GL_UNSIGNED_INT,
-		 BUFFER_OFFSET(0));
+  glDrawArrays(GL_TRIANGLES, 0, vbo_num_slots*3);
 
   glDisableClientState(GL_NORMAL_ARRAY);
   glDisableClientState(GL_VERTEX_ARRAY);
@@ -626,7 +814,7 @@ void Mesh::drawVBOs() {
     // select the index buffer
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh_boundary_edge_indices_VBO);
     // draw this data
-    glDrawElements(GL_LINES, num_boundary_edges*2, GL_UNSIGNED_INT, BUFFER_OFFSET(0));
+    glDrawElements(GL_LINES, vbo_num_slots*3*2, GL_UNSIGNED_INT, BUFFER_OFFSET(0));
 
     // draw all the interior, crease edges
     glLineWidth(3);
@@ -634,7 +822,7 @@ void Mesh::drawVBOs() {
     // select the index buffer
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh_crease_edge_indices_VBO);
     // draw this data
-    glDrawElements(GL_LINES, num_crease_edges*2, GL_UNSIGNED_INT, BUFFER_OFFSET(0));
+    glDrawElements(GL_LINES, vbo_num_slots*3*2, GL_UNSIGNED_INT, BUFFER_OFFSET(0));
 
     // draw all the interior, non-crease edges
     glLineWidth(1);
@@ -642,7 +830,7 @@ void Mesh::drawVBOs() {
     // select the index buffer
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh_other_edge_indices_VBO);
     // draw this data
-    glDrawElements(GL_LINES, num_other_edges*2, GL_UNSIGNED_INT, BUFFER_OFFSET(0));
+    glDrawElements(GL_LINES, vbo_num_slots*3*2, GL_UNSIGNED_INT, BUFFER_OFFSET(0));
 
     glDisableClientState(GL_VERTEX_ARRAY);
   }
@@ -652,915 +840,1090 @@ void Mesh::drawVBOs() {
 
 // =================================================================
 // SUBDIVISION
+// Loop subdivision with Hoppe et al. '94 crease rules, in one sweep
+// over flat arrays:
+//   1. every old vertex gets its even stencil (and a class used by
+//      the crease edge rule), walking its 1-ring
+//   2. every edge gets a new vertex and its odd stencil
+//   3. every triangle writes its 4 children straight into the new
+//      arrays, opposites included (the children of neighboring
+//      triangles are found by index arithmetic, no lookups)
+// Each step runs in parallel and writes only its own slots.
 // =================================================================
 
+void Mesh::getFanStarts(std::vector<int> &vertex_edge) const {
+  int num_halfedges = edge_vertex.size();
+  vertex_edge.assign(numVertices(),-1);
+  for (int e = 0; e < num_halfedges; e++) {
+    if (edge_vertex[e] == -1) continue;
+    int v = edge_vertex[e];
+    if (vertex_edge[v] == -1 || edge_opposite[prevEdge(e)] == -1) vertex_edge[v] = e;
+  }
+}
 
-void Mesh::LoopSubdivision() {
-  printf ("Subdivide the mesh!\n");
 
-  // =========================================
-  // Refine/Apply Mask to edges
-  // =========================================
-
-  // Divide the mesh!
-  divide();
+Vec3f Mesh::oddStencil(int e, const std::vector<unsigned char> &vertex_class) const {
+  int o = edge_opposite[e];
+  int a = edge_vertex[e];
+  int b = edge_vertex[nextEdge(e)];
+  if (o == -1) {
+    return LoopOddRule(vertex_positions[a],vertex_positions[b],Vec3f(),Vec3f(),
+                       true,edge_crease[e],vertex_class[a],vertex_class[b]);
+  }
+  return LoopOddRule(vertex_positions[a],vertex_positions[b],
+                     vertex_positions[oppositeCorner(e)],vertex_positions[oppositeCorner(o)],
+                     false,edge_crease[e],vertex_class[a],vertex_class[b]);
+}
 
-  // Update Vector
-  std::vector<std::pair<Vertex*, Vec3f>> updateVec;
-  
-  // Go through all the triangles
-  triangleshashtype::iterator iter = triangles.begin();
 
-  while(iter!=triangles.end()){
-    
-    // Each triangle has 3 edges/ each have a vertex
-    Edge* ab = (*iter).second->getEdge();
-    Edge* bc = ab->getNext();
-    Edge* ca = bc->getNext();
+int Mesh::oppositeCorner(int e) const {
+  int t = edgeTriangle(e);
+  int corner = edge_vertex[prevEdge(e)];
+  if (t >= (int)triangle_sibling.size() || triangle_sibling[t] == -1) return corner;
+  // a green pair (a,m,c) (m,b,c) stands in for its parent (a,b,c):
+  // across c->a and b->c the corner is the far end of ab, not m
+  int s = triangle_sibling[t];
+  if (e == 3*t+2 && edge_vertex[3*t+1] == edge_vertex[3*s]) return edge_vertex[3*s+1];
+  if (e == 3*t+1 && edge_vertex[3*t] == edge_vertex[3*s+1]) return edge_vertex[3*s];
+  return corner;
+}
 
-    // Saving in array to take care of
-    Edge* curEdges[3] = {ab,bc,ca};
 
-    for(int i = 0; i < 3; i++){
+void Mesh::LoopSubdivision() {
+  printf ("Subdivide the mesh!\n");
 
-      if(curEdges[i]->getStartVertex()->getRefineLevel()
-          == sub_division_level){
-        // This vertex has alread been calculated for
-        continue;
+  sub_division_level++;
+  clearProgressive();
+  markAllDirty();
+
+  int num_verts = numVertices();
+  int num_slots = numTriangleSlots();
+  int num_halfedges = 3*num_slots;
+
+  // green pairs left by AdaptiveSubdivision are split like any others
+  triangle_sibling.clear();
+
+  std::vector<int> vertex_edge;
+  getFanStarts(vertex_edge);
+
+  // number the live triangles and the edges (by their lower half-edge)
+  std::vector<int> triangle_rank(num_slots);
+  std::vector<int> edge_child(num_halfedges,-1);
+  int num_chunks = ParallelChunkCount(num_slots);
+  std::vector<int> chunk_tris(num_chunks+1,0), chunk_edges(num_chunks+1,0);
+  ParallelForChunks(num_slots,num_chunks,[&](int begin, int end, int chunk) {
+    for (int t = begin; t < end; t++) {
+      if (!isTriangle(t)) continue;
+      chunk_tris[chunk+1]++;
+      for (int e = 3*t; e < 3*t+3; e++) {
+        int o = edge_opposite[e];
+        if (o == -1 || e < o) chunk_edges[chunk+1]++;
       }
-
-      int typeVertex = identifyVertex(curEdges[i]);
-      std::vector<Vec3f> controlPts;
-      Vec3f newPos;
-      //Vec3f newPos; 
-      // 1) New Vertex
-      // 2) Old Vertex
-      // 3) New Boundry
-      // 4) Old Boundry
-      // 0) None
- 
-      if(typeVertex == 1){
-        getControlPts_newEdge(curEdges[i], controlPts);
+    }
+  });
+  for (int i = 0; i < num_chunks; i++) {
+    chunk_tris[i+1] += chunk_tris[i];
+    chunk_edges[i+1] += chunk_edges[i];
+  }
+  int num_tris = chunk_tris[num_chunks];
+  int num_new_verts = num_verts + chunk_edges[num_chunks];
+  ParallelForChunks(num_slots,num_chunks,[&](int begin, int end, int chunk) {
+    int tri = chunk_tris[chunk];
+    int child = num_verts + chunk_edges[chunk];
+    for (int t = begin; t < end; t++) {
+      if (!isTriangle(t)) continue;
+      triangle_rank[t] = tri++;
+      for (int e = 3*t; e < 3*t+3; e++) {
+        int o = edge_opposite[e];
+        if (o != -1 && o < e) continue;
+        // the opposite belongs to this edge too, and nobody else writes it
+        edge_child[e] = child;
+        if (o != -1) edge_child[o] = child;
+        child++;
       }
+    }
+  });
+
+  std::vector<Vec3f> new_positions(num_new_verts);
+  std::vector<unsigned char> vertex_class(num_verts);
 
-      if(typeVertex == 2){
-        getControlPts_oldEdge(curEdges[i], controlPts);
+  // =========================================
+  // 1. even vertices
+  ParallelFor(num_verts,[&](int begin, int end) {
+    for (int v = begin; v < end; v++) {
+      if (vertex_edge[v] == -1) {
+        // not used by any triangle
+        new_positions[v] = vertex_positions[v];
+        vertex_class[v] = SUBDIV_OTHER;
+      } else {
+        new_positions[v] = LoopEvenRule(edge_vertex,edge_opposite,edge_crease,vertex_positions,
+                                        vertex_edge[v],vertex_class[v]);
       }
+    }
+  });
 
-      if(typeVertex == 3){
-        getControlPts_newBound(curEdges[i], controlPts);
+  // =========================================
+  // 2. odd vertices, one per edge
+  std::vector<int> new_parents(2*num_new_verts,-1);
+  ParallelFor(num_halfedges,[&](int begin, int end) {
+    for (int e = begin; e < end; e++) {
+      if (edge_vertex[e] == -1) continue;
+      int o = edge_opposite[e];
+      if (o != -1 && o < e) continue;
+      int a = edge_vertex[e];
+      int b = edge_vertex[nextEdge(e)];
+      int child = edge_child[e];
+      new_parents[2*child] = a;
+      new_parents[2*child+1] = b;
+      new_positions[child] = oddStencil(e,vertex_class);
+    }
+  });
+
+  // =========================================
+  // 3. topology.  triangle (a,b,c) with edge children (ab,bc,ca)
+  // becomes (a,ab,ca) (b,bc,ab) (c,ca,bc) (ca,ab,bc), at 4*rank.
+  // the halves of old edge k are new half-edges 3k (from its start)
+  // and 3((k+1)%3)+2 (to its end), the inner edges are 1|9 4|10 7|11.
+  std::vector<int> new_vertex(12*num_tris);
+  std::vector<int> new_opposite(12*num_tris);
+  std::vector<float> new_crease(12*num_tris);
+  ParallelFor(num_slots,[&](int begin, int end) {
+    for (int t = begin; t < end; t++) {
+      if (!isTriangle(t)) continue;
+      int base = 12*triangle_rank[t];
+      int a = edge_vertex[3*t], b = edge_vertex[3*t+1], c = edge_vertex[3*t+2];
+      int ab = edge_child[3*t], bc = edge_child[3*t+1], ca = edge_child[3*t+2];
+      int verts[12] = { a, ab, ca,  b, bc, ab,  c, ca, bc,  ca, ab, bc };
+      for (int i = 0; i < 12; i++) new_vertex[base+i] = verts[i];
+
+      for (int k = 0; k < 3; k++) {
+        int e = 3*t+k;
+        int first = base + 3*k;
+        int second = base + 3*((k+1)%3)+2;
+        // the halves of a creased edge are one less sharp
+        float crease = (edge_crease[e] > 1) ? edge_crease[e]-1 : 0;
+        new_crease[first] = new_crease[second] = crease;
+        int o = edge_opposite[e];
+        if (o == -1) {
+          new_opposite[first] = new_opposite[second] = -1;
+        } else {
+          int other = 12*triangle_rank[edgeTriangle(o)];
+          int k2 = o%3;
+          new_opposite[first] = other + 3*((k2+1)%3)+2;
+          new_opposite[second] = other + 3*k2;
+        }
       }
-      
-      if(typeVertex == 4){
-        getControlPts_oldBound(curEdges[i], controlPts);
+      int inner[3][2] = { { 1, 9 }, { 4, 10 }, { 7, 11 } };
+      for (int i = 0; i < 3; i++) {
+        new_opposite[base+inner[i][0]] = base+inner[i][1];
+        new_opposite[base+inner[i][1]] = base+inner[i][0];
+        new_crease[base+inner[i][0]] = new_crease[base+inner[i][1]] = 0;
       }
-      
-      if(typeVertex == 0){
-        controlPts.push_back(curEdges[i]->getStartVertex()->getPos());
-      }//endif
-
-      // find average of control points
-      for(unsigned int c = 0; c  < controlPts.size(); c++)
-        newPos = newPos + controlPts[c];
-
-      // Toss into updateVector
-      std::pair<Vertex*, Vec3f> update(curEdges[i]->getStartVertex(), newPos);
-      updateVec.push_back(update);
-
-      // Update it's refine level
-      curEdges[i]->getStartVertex()->incrRefineLevel();
-      
-    } //forEachVertexinTriangle
-    iter++;
-  } //forEachTriangleinMesh
-
-  // Assumed that updateVec has all updates to apply
-  for(unsigned int v = 0; v < updateVec.size(); v++){
-    // For everything in my updateVec go ahead and update its point
-    Vertex* curVertex = updateVec[v].first;
-    Vec3f curChange = updateVec[v].second;
-    curVertex->setPos(curChange);
-  }
-  
+    }
+  });
+
+  vertex_positions.swap(new_positions);
+  vertex_parents.swap(new_parents);
+  edge_vertex.swap(new_vertex);
+  edge_opposite.swap(new_opposite);
+  edge_crease.swap(new_crease);
+  free_triangles.clear();
+  num_triangles = 4*num_tris;
+  // rebuilt when something needs to look edges up by vertex
+  edges.clear();
+  edge_table_stale = true;
 }
 
 // =================================================================
-// SIMPLIFICATION
+// ADAPTIVE SUBDIVISION
+// Red-green refinement with Loop stencils.  Triangles that fail the
+// criteria are split 1-to-4 (red), and so is anything left with two
+// or more split edges; a triangle with one split edge is bisected
+// (green) to keep the mesh crack free.  A green pair remembers its
+// sibling so that refining it later splits the parent it stands in
+// for instead of slicing the thin halves again.  Old vertices only
+// take the even stencil when every triangle around them went red.
 // =================================================================
 
-void Mesh::Simplification(int target_tri_count) {
-
-  int goal = numTriangles() - target_tri_count;
-  int maxRun = goal * numTriangles(); 
-  
-  for(int runs = 0; runs < maxRun && numTriangles() > target_tri_count; runs++){
-
-    // clear out any previous relationships between vertices
-    vertex_parents.clear();
-
-    // This is my edge to collapse
-    Edge* collapseEdge = getShortestEdge();
+// is the triangle in window space, or curved, or near a crease?
+static bool ProjectToWindow(const AdaptiveCriteria &criteria, const Vec3f &p, double &x, double &y) {
+  const double *m = criteria.screen;
+  double cx = m[0]*p.x() + m[4]*p.y() + m[8]*p.z() + m[12];
+  double cy = m[1]*p.x() + m[5]*p.y() + m[9]*p.z() + m[13];
+  double cw = m[3]*p.x() + m[7]*p.y() + m[11]*p.z() + m[15];
+  if (cw <= 0) return false;
+  x = criteria.viewport[0] + 0.5*criteria.viewport[2]*(cx/cw + 1);
+  y = criteria.viewport[1] + 0.5*criteria.viewport[3]*(cy/cw + 1);
+  return true;
+}
 
-    // Make sure my half edge has its pair 
-    if(collapseEdge->getOpposite() == NULL || collapseEdge->getTriangle() == NULL){
-      continue;
+bool Mesh::adaptiveTest(int t, const AdaptiveCriteria &criteria,
+                        const std::vector<unsigned char> &crease_vertex) const {
+  for (int k = 0; k < 3; k++) {
+    int e = 3*t+k;
+    if (criteria.near_creases && crease_vertex[edge_vertex[e]]) return true;
+    if (criteria.max_dihedral > 0 && edge_opposite[e] != -1 &&
+        DihedralAngle(e) > criteria.max_dihedral) return true;
+  }
+  if (criteria.max_pixels > 0 && criteria.has_screen) {
+    double x[3], y[3];
+    for (int k = 0; k < 3; k++) {
+      // partly behind the camera, leave it to the other tests
+      if (!ProjectToWindow(criteria,getPos(edge_vertex[3*t+k]),x[k],y[k])) return false;
     }
-
-    // deadVertex will be merged onto mergeVertex
-    Vertex* deadVertex = collapseEdge->getStartVertex();
-    Vertex* mergeVertex = collapseEdge->getOpposite()->getStartVertex();
-
-    // Make sure my half edge won't break the mesh
-    if(!manifoldLegal(collapseEdge, collapseEdge->getOpposite())){
-      std::cout << "Manifold Illegal" << std::endl;
-      ignoreVec.push_back(collapseEdge);
-      ignoreVec.push_back(collapseEdge->getOpposite());
-      continue;
+    for (int k = 0; k < 3; k++) {
+      double dx = x[(k+1)%3]-x[k], dy = y[(k+1)%3]-y[k];
+      if (dx*dx + dy*dy > criteria.max_pixels*criteria.max_pixels) return true;
     }
+  }
+  return false;
+}
 
-    // triangle to delete later
-    std::vector<Edge *> triangleToDelete;
-
-    // vector of pairs to save ptr to recreate altered triangles
-    std::vector<vPair> triangleToAlter;
-
-    ////////////////////////////////////////////////////////////
-    // Removing verticies adj to collapse Edge
-    Edge* cur = collapseEdge;
-
-    do{
-      // Get the edge to push into triangles to delete
-      triangleToDelete.push_back(cur);
-
-      // Get the other two verticies to save to recreate
-      vPair aPair;
-      bool isChangable = alteredTriPair(cur,deadVertex,mergeVertex, aPair);
 
-      if(isChangable){
-        triangleToAlter.push_back(aPair);
-      }
+// a green pair is (a,m,c) "A" and (m,b,c) "B", bisecting (a,b,c) at m.
+// both halves of ab are local edge 0, the outer edges are 3A+2
+// (c->a) and 3B+1 (b->c).
+static inline bool IsGreenA(const std::vector<int> &edge_vertex, int t, int s) {
+  return edge_vertex[3*t+1] == edge_vertex[3*s];
+}
 
-      // If I ever encounter a deadend, just delete what I have so far
-      cur = cur->getOpposite();
-      if(cur == NULL){ 
-        std::cout << "Ran into NULL" << std::endl;
-        break;
-      }
 
-      // Increment
-      cur = cur->getNext();
+void Mesh::AdaptiveSubdivision(const AdaptiveCriteria &criteria) {
 
-      // sanity check
-      assert(cur->getStartVertex() == deadVertex);
+  clearProgressive();
+  updateEdgeTable();
+  int num_slots = numTriangleSlots();
+  triangle_sibling.resize(num_slots,-1);
 
-    }while( cur != collapseEdge );
+  // =========================================
+  // mark
+  std::vector<unsigned char> crease_vertex(numVertices(),0);
+  if (criteria.near_creases) {
+    for (int e = 0; e < 3*num_slots; e++) {
+      if (edge_vertex[e] != -1 && edge_opposite[e] != -1 && edge_crease[e] > 0)
+        crease_vertex[edge_vertex[e]] = 1;
+    }
+  }
+  std::vector<unsigned char> marked(num_slots,0);
+  ParallelFor(num_slots,[&](int begin, int end) {
+    for (int t = begin; t < end; t++) {
+      if (isTriangle(t)) marked[t] = adaptiveTest(t,criteria,crease_vertex);
+    }
+  });
 
-    /////////////////////////////////////////////////////////////
-    // Removing/Adding
+  // =========================================
+  // close: red[t] splits t 1-to-4, parent[t] (on both halves of a
+  // green pair) splits the pair's parent 1-to-4
+  std::vector<unsigned char> red(num_slots,0), parent(num_slots,0);
+  // does the owner of e split it (not counting the neighbor)?
+  auto splits_own = [&](int e) {
+    int t = edgeTriangle(e);
+    if (red[t]) return true;
+    if (!parent[t]) return false;
+    int s = triangle_sibling[t];
+    return e == (IsGreenA(edge_vertex,t,s) ? 3*t+2 : 3*t+1);
+  };
+  auto is_split = [&](int e) {
+    return splits_own(e) || (edge_opposite[e] != -1 && splits_own(edge_opposite[e]));
+  };
+  auto count_split = [&](int t) {
+    return (int)is_split(3*t) + (int)is_split(3*t+1) + (int)is_split(3*t+2);
+  };
+  std::vector<int> work;
+  auto touch = [&](int t) {
+    for (int k = 0; k < 3; k++) {
+      if (edge_opposite[3*t+k] != -1) work.push_back(edgeTriangle(edge_opposite[3*t+k]));
+    }
+    if (triangle_sibling[t] != -1) work.push_back(triangle_sibling[t]);
+  };
+  std::function<void(int)> make_red = [&](int t) {
+    if (red[t]) return;
+    red[t] = 1;
+    int s = triangle_sibling[t];
+    if (s != -1 && parent[t]) {
+      // can't split the parent and a half of it, split both halves
+      parent[t] = parent[s] = 0;
+      make_red(s);
+    }
+    touch(t);
+  };
+  auto make_parent = [&](int t) {
+    int s = triangle_sibling[t];
+    parent[t] = parent[s] = 1;
+    touch(t);
+    touch(s);
+  };
+
+  for (int t = 0; t < num_slots; t++) {
+    if (!isTriangle(t)) continue;
+    int s = triangle_sibling[t];
+    if (s == -1) {
+      if (marked[t]) make_red(t);
+    } else if ((marked[t] || marked[s]) && !parent[t] && !red[t] && !red[s]) {
+      make_parent(t);
+    }
+    work.push_back(t);
+  }
+  while (!work.empty()) {
+    int t = work.back();
+    work.pop_back();
+    if (red[t]) continue;
+    int s = triangle_sibling[t];
+    if (s == -1 || red[s]) {
+      if (count_split(t) >= 2) make_red(t);
+      continue;
+    }
+    // a green pair.  if the finer side refines across ab the pair
+    // can't go back to its parent this time, the halves are split
+    // like any triangle instead
+    bool half_split = is_split(3*t) || is_split(3*s);
+    if (parent[t]) {
+      if (half_split) make_red(t);
+    } else if (half_split) {
+      if (count_split(t) >= 2) make_red(t);
+      if (!red[s] && count_split(s) >= 2) make_red(s);
+    } else if (is_split(IsGreenA(edge_vertex,t,s) ? 3*t+2 : 3*t+1) ||
+               is_split(IsGreenA(edge_vertex,s,t) ? 3*s+2 : 3*s+1)) {
+      make_parent(t);
+    }
+  }
 
-    // Remove all dead triangles 
-    for(unsigned int v = 0; v < triangleToDelete.size(); v++){
-      removeTriangle(triangleToDelete[v]);
+  // =========================================
+  // new vertices, positions from the mesh as it is now
+  std::vector<unsigned char> vertex_class(numVertices(),SUBDIV_OTHER);
+  std::vector<int> vertex_edge;
+  getFanStarts(vertex_edge);
+  std::vector<Vec3f> even(numVertices());
+  ParallelFor(numVertices(),[&](int begin, int end) {
+    for (int v = begin; v < end; v++) {
+      if (vertex_edge[v] == -1) continue;
+      even[v] = LoopEvenRule(edge_vertex,edge_opposite,edge_crease,vertex_positions,
+                             vertex_edge[v],vertex_class[v]);
     }
-    
-    //Recreate new triangles
-    for(unsigned int v = 0; v < triangleToAlter.size(); v++){
-      
-      if( edges.find(std::make_pair(mergeVertex,triangleToAlter[v].first)) != edges.end()){
-        return;
-      }
+  });
+  // only vertices with nothing but red triangles around them move
+  std::vector<unsigned char> moves(numVertices(),1);
+  for (int t = 0; t < num_slots; t++) {
+    if (!isTriangle(t)) continue;
+    if (red[t] && triangle_sibling[t] == -1) continue;
+    for (int k = 0; k < 3; k++) moves[edge_vertex[3*t+k]] = 0;
+  }
 
-      if ( edges.find(std::make_pair(triangleToAlter[v].first,triangleToAlter[v].second)) != edges.end()){
-        return;
-      }
+  std::fill(vertex_parents.begin(),vertex_parents.end(),-1);
+  std::vector<int> edge_child(3*num_slots,-1);
+  std::vector<float> child_crease;
+  int first_child = numVertices();
+  for (int e = 0; e < 3*num_slots; e++) {
+    if (edge_vertex[e] == -1) continue;
+    int o = edge_opposite[e];
+    if ((o != -1 && o < e) || !is_split(e)) continue;
+    int child = addVertex(oddStencil(e,vertex_class));
+    vertex_parents[2*child] = edge_vertex[e];
+    vertex_parents[2*child+1] = edge_vertex[nextEdge(e)];
+    child_crease.push_back(edge_crease[e]);
+    edge_child[e] = child;
+    if (o != -1) edge_child[o] = child;
+  }
 
-      if ( edges.find(std::make_pair(triangleToAlter[v].second,mergeVertex)) != edges.end()){
-        return;
+  // =========================================
+  // retriangulate.  creases of edges that survive are looked up by
+  // their (start,end), halves of split edges get the parent's minus 1
+  std::vector<std::pair<uint64_t,float> > old_creases;
+  std::vector<int> new_tris, green_tris;
+  int num_red = 0, num_parents = 0, num_green = 0;
+  for (int t = 0; t < num_slots; t++) {
+    if (!isTriangle(t)) continue;
+    int s = triangle_sibling[t];
+    int corners[3] = { edge_vertex[3*t], edge_vertex[3*t+1], edge_vertex[3*t+2] };
+    int mids[3] = { edge_child[3*t], edge_child[3*t+1], edge_child[3*t+2] };
+    if (parent[t]) {
+      // handled once, from the A half
+      if (!IsGreenA(edge_vertex,t,s)) continue;
+      corners[1] = edge_vertex[3*s+1];
+      mids[0] = edge_vertex[3*t+1];
+      mids[1] = edge_child[3*s+1];
+      mids[2] = edge_child[3*t+2];
+      num_parents++;
+    } else if (red[t]) {
+      num_red++;
+    } else {
+      int k = 0;
+      while (k < 3 && mids[k] == -1) k++;
+      if (k == 3) continue;
+      assert (count_split(t) == 1);
+      // rotate so the split edge is a->b
+      int a = corners[k], b = corners[(k+1)%3], c = corners[(k+2)%3];
+      green_tris.push_back(new_tris.size());
+      int verts[6] = { a, mids[k], c,  mids[k], b, c };
+      new_tris.insert(new_tris.end(),verts,verts+6);
+      num_green++;
+      continue;
+    }
+    int a = corners[0], b = corners[1], c = corners[2];
+    int ab = mids[0], bc = mids[1], ca = mids[2];
+    int verts[12] = { a, ab, ca,  b, bc, ab,  c, ca, bc,  ca, ab, bc };
+    new_tris.insert(new_tris.end(),verts,verts+12);
+  }
+  for (int t = 0; t < num_slots; t++) {
+    if (!isTriangle(t)) continue;
+    bool replaced = red[t] || parent[t] ||
+      edge_child[3*t] != -1 || edge_child[3*t+1] != -1 || edge_child[3*t+2] != -1;
+    if (!replaced) continue;
+    for (int k = 0; k < 3; k++) {
+      int e = 3*t+k;
+      old_creases.push_back(std::make_pair(ordered_index_pair(edge_vertex[e],edge_vertex[nextEdge(e)]),edge_crease[e]));
+    }
+    removeTriangle(t);
+  }
+  std::sort(old_creases.begin(),old_creases.end());
+
+  std::vector<int> added(new_tris.size()/3);
+  for (unsigned int i = 0; i < added.size(); i++) {
+    int t = addTriangle(new_tris[3*i],new_tris[3*i+1],new_tris[3*i+2]);
+    added[i] = t;
+    for (int k = 0; k < 3; k++) {
+      int e = 3*t+k;
+      int a = edge_vertex[e], b = edge_vertex[nextEdge(e)];
+      std::vector<std::pair<uint64_t,float> >::iterator itr =
+        std::lower_bound(old_creases.begin(),old_creases.end(),std::make_pair(ordered_index_pair(a,b),-HUGE_VALF));
+      float crease = 0;
+      if (itr != old_creases.end() && itr->first == ordered_index_pair(a,b)) {
+        crease = itr->second;
+      } else {
+        int child = (a >= first_child) ? a : b;
+        int other = (child == a) ? b : a;
+        if (child >= first_child &&
+            (vertex_parents[2*child] == other || vertex_parents[2*child+1] == other)) {
+          float c = child_crease[child-first_child];
+          crease = (c > 1) ? c-1 : 0;
+        }
       }
-    
-      addTriangle(mergeVertex,triangleToAlter[v].first, triangleToAlter[v].second);
+      setCrease(e,crease);
     }
+  }
+  triangle_sibling.resize(numTriangleSlots(),-1);
+  for (unsigned int i = 0; i < green_tris.size(); i++) {
+    int a = added[green_tris[i]/3];
+    int b = added[green_tris[i]/3+1];
+    triangle_sibling[a] = b;
+    triangle_sibling[b] = a;
+  }
 
+  for (int v = 0; v < first_child; v++) {
+    if (moves[v] && vertex_edge[v] != -1) setPos(v,even[v]);
   }
 
+  printf ("Adaptive subdivision: %d split, %d parents split, %d bisected, %d triangles\n",
+          num_red,num_parents,num_green,numTriangles());
 }
 
-bool Mesh::alteredTriPair(Edge* cur, Vertex* deadVertex, Vertex*  mergeVertex, vPair& alteredPair){
-  // Input: cur edges, two verticies, and an empty alteredPair
-  // Assumptions: Triangle the cur edge resides on exist, all half edges within that triangle exisit
-  // Output: True if I should recreate this triangle, false if not
-  // Modified: alteried pair has two veritice pointers
-  
-  // Get three nodes of the triangle
-  // NOTE: One is bound to be deadVertex, one might be mergeVertex
-  Vertex* a = cur->getStartVertex();                       
-  Vertex* b = cur->getNext()->getStartVertex();            
-  Vertex* c = cur->getNext()->getNext()->getStartVertex(); 
-
-  // Check if valid, if valid return pair ELSE null pair
-  if( a == mergeVertex || b == mergeVertex || c == mergeVertex ){
-    // Do nothing, leaving alterPair unititated
-    return false;
-
-  }else if( a == deadVertex){
-    // Don't include deadVertex
-    alteredPair = std::make_pair(b,c);
+// =================================================================
+// LIMIT SURFACE
+// =================================================================
 
-  }else{
-    std::cout << "ERROR 753";
-    return false;
-  }
+void Mesh::LimitVertex(int e, Vec3f &pos, Vec3f &normal) const {
+  assert (edge_vertex[e] != -1);
+  if (LoopLimitVertex(edge_vertex,edge_opposite,edge_crease,vertex_positions,e,pos,normal)) return;
+  // a crease that smooths out after a few levels, subdivide until it has
+  LoopLimitPoint(edge_vertex,edge_opposite,edge_crease,vertex_positions,
+                 edgeTriangle(e),(e%3 == 1) ? 1 : 0,(e%3 == 2) ? 1 : 0,pos,normal);
+}
 
-  return true;
+void Mesh::LimitPoint(int t, double v, double w, Vec3f &pos, Vec3f &normal) const {
+  assert (isTriangle(t));
+  assert (v >= 0 && w >= 0 && v+w <= 1);
+  LoopLimitPoint(edge_vertex,edge_opposite,edge_crease,vertex_positions,t,v,w,pos,normal);
 }
 
+// =================================================================
+// SIMPLIFICATION
+// Garland & Heckbert quadric error edge collapse.  Every interior
+// edge sits in an indexed min-heap (keyed by its lower numbered
+// half-edge) with the error of collapsing it to its best point.
+// After a collapse the edges around the merged vertex are only
+// flagged: their old cost is a lower bound on the new one (the
+// quadric only grew), so they are re-costed when they reach the top.
+// =================================================================
 
-Edge* Mesh::getShortestEdge(){
-  // Input: None
-  // Assumptions: Hashtable with edges works
-  // Output: The Edge with shortest distance between veritices 
-  // SideEffect: None
+// bits of the per half-edge flags used while simplifying
+#define EDGE_IGNORE 1   // collapse was illegal, skip until a neighbor changes
+#define EDGE_DIRTY  2   // the cost in the heap is a lower bound, recompute it
 
-  edgeshashtype::iterator iter = edges.begin();
-  double shortest_dist = 100000;
-  Edge* shortEdge;
+// boundary and crease edges are held in place by planes through the
+// edge, perpendicular to the face, weighted by this
+#define QEM_BOUNDARY_WEIGHT 1000.0
 
-  while(iter != edges.end()){
+// reject collapses that turn a face by more than ~84 degrees
+#define QEM_MIN_NORMAL_DOT 0.1
 
-    // There is no opposite
-    if((*iter).second == NULL || (*iter).second->getOpposite() == NULL){
-      iter++;
-      continue;
-    }
+static inline int CanonicalEdge(const Mesh &m, int e) {
+  int o = m.getOpposite(e);
+  return (o == -1 || e < o) ? e : o;
+}
 
+static double CollapseCost(const Quadric &q, const Vec3f &a, const Vec3f &b, Vec3f &target) {
+  if (q.Optimize(target)) return q.Evaluate(target);
+  // no unique minimum, take the best of the ends and the middle
+  Vec3f mid = 0.5*(a+b);
+  double cost_a = q.Evaluate(a);
+  double cost_b = q.Evaluate(b);
+  double cost_mid = q.Evaluate(mid);
+  if (cost_mid <= cost_a && cost_mid <= cost_b) { target = mid; return cost_mid; }
+  if (cost_a <= cost_b) { target = a; return cost_a; }
+  target = b;
+  return cost_b;
+}
 
-    // If it's in the ignore list
-    if(std::find(ignoreVec.begin(), ignoreVec.end(),(*iter).second) != ignoreVec.end()){
-      iter++;
-      continue;
-    }
-    // Compute the distance
-    Vec3f a = ((*iter).first).first->getPos();
-    Vec3f b = ((*iter).first).second->getPos();
+// would moving corner 0 of the triangle to pos flip (or flatten) it?
+static bool FlipsOver(const Vec3f &p0, const Vec3f &p1, const Vec3f &p2, const Vec3f &pos) {
+  Vec3f before, after;
+  Vec3f::Cross3(before,p1-p0,p2-p0);
+  Vec3f::Cross3(after,p1-pos,p2-pos);
+  before.Normalize();
+  after.Normalize();
+  return before.Dot3(after) < QEM_MIN_NORMAL_DOT;
+}
 
-    double delta_x = pow(a.x() - b.x(), 2.0);
-    double delta_y = pow(a.y() - b.y(), 2.0);
-    double delta_z = pow(a.z() - b.z(), 2.0);
 
-    double dist = sqrt(delta_x + delta_y + delta_z);
+void Mesh::Simplification(int target_tri_count) {
 
-    //Compare distance
-    if(dist < shortest_dist){
-      shortest_dist = dist;
-      shortEdge = (*iter).second;
+  updateEdgeTable();
+  // collapses reshape green pairs, they become ordinary triangles
+  triangle_sibling.clear();
+  // the new collapses replace the splits that led up to here, the
+  // ones above (collapsed by 'c') still apply on top
+  pm_splits.erase(pm_splits.begin(),pm_splits.begin()+pm_applied);
+  pm_applied = 0;
+  int num_slots = edge_vertex.size();
+
+  // the quadric of each vertex: the planes of its triangles (area
+  // weighted) plus constraint planes along boundaries and creases
+  std::vector<Quadric> quadrics(numVertices());
+  for (int t = 0; t < numTriangleSlots(); t++) {
+    if (!isTriangle(t)) continue;
+    const Vec3f &p0 = getPos(getTriangleVertex(t,0));
+    const Vec3f &p1 = getPos(getTriangleVertex(t,1));
+    const Vec3f &p2 = getPos(getTriangleVertex(t,2));
+    Vec3f normal;
+    Vec3f::Cross3(normal,p1-p0,p2-p0);
+    double area = 0.5*normal.Length();
+    if (area == 0) continue;
+    normal.Normalize();
+    Quadric q(normal,-normal.Dot3(p0),area);
+    for (int i = 0; i < 3; i++) quadrics[getTriangleVertex(t,i)] += q;
+
+    for (int i = 0; i < 3; i++) {
+      int e = 3*t+i;
+      if (getOpposite(e) != -1 && getCrease(e) <= 0) continue;
+      const Vec3f &a = getPos(getStartVertex(e));
+      const Vec3f &b = getPos(getEndVertex(e));
+      Vec3f along = b-a;
+      Vec3f across;
+      Vec3f::Cross3(across,along,normal);
+      if (across.Length() == 0) continue;
+      across.Normalize();
+      Quadric constraint(across,-across.Dot3(a),QEM_BOUNDARY_WEIGHT*along.Dot3(along));
+      quadrics[getStartVertex(e)] += constraint;
+      quadrics[getEndVertex(e)] += constraint;
     }
+  }
 
-    iter++;
+  // everything below is indexed by the canonical half-edge of an edge
+  std::vector<unsigned char> flags(num_slots,0);
+  std::vector<double> costs(num_slots,0);
+  std::vector<Vec3f> targets(num_slots);
+  IndexedMinHeap heap(num_slots);
+
+  // boundary edges are never collapsed, they stay out of the heap
+  for (int e = 0; e < num_slots; e++) {
+    if (edge_vertex[e] == -1) continue;
+    int o = edge_opposite[e];
+    if (o == -1 || o < e) continue;
+    int a = getStartVertex(e), b = getEndVertex(e);
+    costs[e] = CollapseCost(quadrics[a]+quadrics[b],getPos(a),getPos(b),targets[e]);
+    heap.push(e,costs[e]);
   }
 
-  return shortEdge;
+  std::vector<int> ring_a, ring_b, neighbors;
 
-}
+  while (numTriangles() > target_tri_count && !heap.empty()) {
 
-bool Mesh::manifoldLegal(Edge* a, Edge* b){
-  // Input: two verticies I will check for manifold-illegalness
-  // Assume: these veritices share an edge
-  // Output: true if its safe to remove, false if it isn't
-  // Modify: none
-  
-  std::set<Vertex*> aSet;
-  std::set<Vertex*> bSet;
-  int a_triNum = 0;
-  int b_triNum = 0;
-
-  Edge * cur = a;
-  bool reversed = false;
-  do{
-    // checking if orientation is the same
-    //assert(a->getStartVertex() == cur->getStartVertex());
-    // Get these
-    Vertex* v1 = cur->getNext()->getStartVertex();
-    Vertex* v2 = cur->getPrev()->getStartVertex();
-    a_triNum++;
-    //Try and add them in
-    aSet.insert(v1);
-    aSet.insert(v2);
-
-    if(!reversed){
-      // Approach problem like ususal
-      cur = cur->getOpposite();
-      if(cur!= NULL) cur = cur->getNext(); else reversed = true;
-      if(cur == NULL) break;
-      assert(cur->getStartVertex() == a->getStartVertex());
-    }
+    int e = heap.top();
+    int dead = getStartVertex(e);
+    int keep = getEndVertex(e);
 
-    if(reversed){
-      if(cur == NULL) cur = a->getPrev(); else cur = cur->getPrev();
-      if(cur != NULL) cur = cur->getOpposite(); else break;
-      if(cur == NULL) break;
-      assert(cur->getStartVertex() == a->getStartVertex());
+    if (flags[e] & EDGE_DIRTY) {
+      flags[e] &= ~EDGE_DIRTY;
+      costs[e] = CollapseCost(quadrics[dead]+quadrics[keep],getPos(dead),getPos(keep),targets[e]);
+      heap.update(e,costs[e]);
+      continue;
     }
-  }while(cur != a);
-
+    heap.pop();
 
-  cur = b;
-  reversed = false;
-  do{
-    // checking if orientation is the same
-    //assert(b->getStartVertex() == cur->getStartVertex());
-    // Get these
-    Vertex* v1 = cur->getNext()->getStartVertex();
-    Vertex* v2 = cur->getPrev()->getStartVertex();
-    //Try and add them in
-    bSet.insert(v1);
-    bSet.insert(v2);
-    b_triNum++;
-
-    if(!reversed){
-      // Approach problem like ususal
-      cur = cur->getOpposite();
-      if(cur!= NULL) cur = cur->getNext(); else reversed = true;
-      if(cur == NULL) break;
-      assert(cur->getStartVertex() == b->getStartVertex());
+    if (!collapseLegal(e,targets[e],ring_a,ring_b,neighbors)) {
+      flags[e] |= EDGE_IGNORE;
+      continue;
     }
 
-    if(reversed){
-      if(cur == NULL) cur = a->getPrev(); else cur = cur->getPrev();
-      if(cur != NULL) cur = cur->getOpposite(); else break;
-      if(cur == NULL) break;
-      assert(cur->getStartVertex() == b->getStartVertex());
+    // the two triangles on e are about to go, along with their edges
+    int removed[2] = { edgeTriangle(e), edgeTriangle(getOpposite(e)) };
+    for (int i = 0; i < 2; i++) {
+      for (int k = 0; k < 3; k++) {
+        int r = 3*removed[i]+k;
+        if (heap.contains(r)) heap.remove(r);
+      }
     }
 
-  }while(cur != b);
-
-
-  if(aSet.size() < a_triNum || bSet.size() < b_triNum){
-    // Repeates localally
-    return false;
+    quadrics[keep] += quadrics[dead];
+    VertexSplit split;
+    recordCollapse(e,targets[e],split);
+    pm_splits.push_front(split);
+    int start = collapseEdge(e,targets[e],ring_a);
+    if (start == -1) continue;
+
+    // every edge around the merged vertex needs a new cost, and may
+    // have become legal again.  stitching the outer edges of the
+    // removed triangles together can change which half-edge is
+    // canonical, so drop the other one from the heap.
+    getOutgoingEdges(start,ring_b);
+    for (unsigned int i = 0; i < ring_b.size(); i++) {
+      int g[2] = { ring_b[i], prevEdge(ring_b[i]) };
+      for (int j = 0; j < 2; j++) {
+        int o = getOpposite(g[j]);
+        if (o == -1) {
+          if (heap.contains(g[j])) heap.remove(g[j]);
+          continue;
+        }
+        int c = CanonicalEdge(*this,g[j]);
+        int other = (c == g[j]) ? o : g[j];
+        if (heap.contains(other)) heap.remove(other);
+        flags[c] = (flags[c] & ~EDGE_IGNORE) | EDGE_DIRTY;
+        if (!heap.contains(c)) heap.push(c,costs[c]);
+      }
+    }
   }
+}
 
-  std::vector<Vertex*> v_intersection;
-  std::set_intersection(aSet.begin(), aSet.end(),
-                          bSet.begin(), bSet.end(),
-                          std::back_inserter(v_intersection));
 
-  if(v_intersection.size() > 2){
-    return false;
+bool Mesh::collapseLegal(int e, const Vec3f &pos, std::vector<int> &ring_a,
+                         std::vector<int> &ring_b, std::vector<int> &neighbors) const {
+  // Input: interior half-edge e, whose start would merge onto its end
+  //        at pos
+  // Output: true if that leaves a manifold mesh with nothing flipped
+  int o = getOpposite(e);
+  assert (o != -1);
+  int dead = getStartVertex(e);
+  int x = getStartVertex(prevEdge(e));
+  int y = getStartVertex(prevEdge(o));
+
+  bool dead_closed = getOutgoingEdges(e,ring_a);
+  bool keep_closed = getOutgoingEdges(o,ring_b);
+
+  // an interior edge joining two boundary vertices would pinch the
+  // surface into a non-manifold vertex
+  if (!dead_closed && !keep_closed) return false;
+
+  // link condition: x and y must be the only vertices next to both
+  neighbors.clear();
+  for (unsigned int i = 0; i < ring_a.size(); i++) {
+    neighbors.push_back(getEndVertex(ring_a[i]));
+    neighbors.push_back(getStartVertex(prevEdge(ring_a[i])));
   }
-  
-  return true;
-  /*
-
-  // Storing counts in a map
-  std::map<Vertex*, unsigned int> count;
-
-  // Checking those nodes around a
-  Edge* cur = a;
-  bool reversed = false;
-
-  do{
-
-    // Collecting all verticies` from triangle
-    Vertex* one = cur->getTriangle()->getEdge()->getStartVertex();
-    Vertex* two = cur->getTriangle()->getEdge()->getNext()->getStartVertex();
-    Vertex* thr = cur->getTriangle()->getEdge()->getNext()->getNext()->getStartVertex();
-
-    // Adding those vertices to counter
-    (count.find(one) == count.end()) ? count[one] = 1: count[one] += 1;
-    (count.find(two) == count.end()) ? count[two] = 1: count[two] += 1;
-    (count.find(thr) == count.end()) ? count[thr] = 1: count[thr] += 1;
-
-    // Update cur
-    cur = cur->getOpposite();
-    // Where to iterate next
-    if(cur == NULL && !reversed){
-      cur = a->getPrev(); reversed = true;
-    }else if(cur == NULL && reversed){
-      cur = a;
-    }else if(cur != NULL && !reversed){
-      cur = cur->getNext();
-    }else if(cur!= NULL && reversed){
-      cur = cur->getPrev();
+  std::sort(neighbors.begin(),neighbors.end());
+  neighbors.erase(std::unique(neighbors.begin(),neighbors.end()),neighbors.end());
+  if (x == y) return false;
+  for (unsigned int i = 0; i < ring_b.size(); i++) {
+    int v[2] = { getEndVertex(ring_b[i]), getStartVertex(prevEdge(ring_b[i])) };
+    for (int j = 0; j < 2; j++) {
+      if (v[j] == dead || v[j] == x || v[j] == y) continue;
+      if (std::binary_search(neighbors.begin(),neighbors.end(),v[j])) return false;
     }
+  }
 
-  }while(cur != a);
-
-  // Checking those nodes around b
-  cur = b;
-  reversed = false;
-  do{
+  // x and y each lose an edge, don't fold a tetrahedron flat
+  int corners[2] = { prevEdge(e), prevEdge(o) };
+  for (int i = 0; i < 2; i++) {
+    if (getOutgoingEdges(corners[i],neighbors) && neighbors.size() <= 3) return false;
+  }
 
-    // Collecting all verticies` from triangle
-    Vertex* one = cur->getTriangle()->getEdge()->getStartVertex();
-    Vertex* two = cur->getTriangle()->getEdge()->getNext()->getStartVertex();
-    Vertex* thr = cur->getTriangle()->getEdge()->getNext()->getNext()->getStartVertex();
-
-    // Adding those vertices to counter
-    (count.find(one) == count.end()) ? count[one] = 1: count[one] += 1;
-    (count.find(two) == count.end()) ? count[two] = 1: count[two] += 1;
-    (count.find(thr) == count.end()) ? count[thr] = 1: count[thr] += 1;
-  
-    // Update cur
-    cur = cur->getOpposite();
-
-    // Where to iterate next
-    if(cur == NULL && !reversed){
-      cur = b->getPrev(); reversed = true;
-    }else if(cur == NULL && reversed){
-      cur = b;
-    }else if(cur != NULL && !reversed){
-      cur = cur->getNext();
-    }else if(cur!= NULL && reversed){
-      cur = cur->getPrev();
+  // no remaining triangle around either end may flip
+  int rt0 = edgeTriangle(e), rt1 = edgeTriangle(o);
+  const std::vector<int> *rings[2] = { &ring_a, &ring_b };
+  for (int r = 0; r < 2; r++) {
+    for (unsigned int i = 0; i < rings[r]->size(); i++) {
+      int g = (*rings[r])[i];
+      if (edgeTriangle(g) == rt0 || edgeTriangle(g) == rt1) continue;
+      if (FlipsOver(getPos(getStartVertex(g)),getPos(getEndVertex(g)),
+                    getPos(getStartVertex(prevEdge(g))),pos)) return false;
     }
-
-  }while(cur != b);
-
-  std::map<Vertex*, unsigned int>::iterator iter = count.begin();
-
-  do{
+  }
+  return true;
+}
 
 
-    // vertex a and b will be there many times
-    if((*iter).first != a->getStartVertex() && 
-        (*iter).first != b->getStartVertex()){
+int Mesh::collapseEdge(int e, const Vec3f &pos, std::vector<int> &ring) {
+  // Input: interior half-edge e that passed collapseLegal
+  // Modify: the start of e is merged onto its end, which moves to pos.
+  //         the two triangles on e are removed and their outer edges
+  //         stitched together.
+  //         their slots are not freed, the vertex split recorded for
+  //         the collapse puts them back.
+  // Output: a half-edge leaving the merged vertex (-1 if none is left)
+  int o = getOpposite(e);
+  assert (o != -1);
+  int dead = getStartVertex(e);
+  int keep = getEndVertex(e);
+  int t0 = edgeTriangle(e), t1 = edgeTriangle(o);
+
+  getOutgoingEdges(e,ring);
+
+  // take everything touching dead out of the table
+  for (int k = 0; k < 3; k++) {
+    edges.erase(ordered_index_pair(getStartVertex(3*t0+k),getEndVertex(3*t0+k)));
+    edges.erase(ordered_index_pair(getStartVertex(3*t1+k),getEndVertex(3*t1+k)));
+  }
+  for (unsigned int i = 0; i < ring.size(); i++) {
+    int g = ring[i];
+    if (edgeTriangle(g) == t0 || edgeTriangle(g) == t1) continue;
+    edges.erase(ordered_index_pair(dead,getEndVertex(g)));
+    edges.erase(ordered_index_pair(getStartVertex(prevEdge(g)),dead));
+    edge_vertex[g] = keep;
+    markTriangleDirty(edgeTriangle(g));
+  }
 
-      // greater then 2 we have a non-manifold
-      if((*iter).second >  4){ return false;}
+  // the two outer edges of each removed triangle become one edge.
+  // the first runs into keep, the second (now) out of it
+  int start = -1;
+  int sides[2][2] = { { nextEdge(e), prevEdge(e) }, { nextEdge(o), prevEdge(o) } };
+  for (int i = 0; i < 2; i++) {
+    int a = edge_opposite[sides[i][0]];
+    int b = edge_opposite[sides[i][1]];
+    float crease = std::max(edge_crease[sides[i][0]],edge_crease[sides[i][1]]);
+    if (a != -1) { edge_opposite[a] = b; edge_crease[a] = crease; markTriangleDirty(edgeTriangle(a)); }
+    if (b != -1) { edge_opposite[b] = a; edge_crease[b] = crease; markTriangleDirty(edgeTriangle(b)); }
+    if (start == -1) start = (a != -1) ? nextEdge(a) : b;
+  }
 
+  int removed[2] = { t0, t1 };
+  for (int i = 0; i < 2; i++) {
+    markTriangleDirty(removed[i]);
+    for (int k = 0; k < 3; k++) {
+      int r = 3*removed[i]+k;
+      edge_vertex[r] = -1;
+      edge_opposite[r] = -1;
+      edge_crease[r] = 0;
     }
+    num_triangles--;
+  }
 
-    // Increment iter
-    iter++;
-  }while(iter != count.end());
+  // and back in under their new keys
+  for (unsigned int i = 0; i < ring.size(); i++) {
+    int g = ring[i];
+    if (edge_vertex[g] == -1) continue;
+    int p = prevEdge(g);
+    assert (edges.find(ordered_index_pair(keep,getEndVertex(g))) == edges.end());
+    edges[ordered_index_pair(keep,getEndVertex(g))] = g;
+    assert (edges.find(ordered_index_pair(getStartVertex(p),keep)) == edges.end());
+    edges[ordered_index_pair(getStartVertex(p),keep)] = p;
+  }
 
-  return true;
-  */
+  setPos(keep,pos);
+  return start;
 }
 
-void Mesh::divide(){
-  // Purpose: Every triangle in the orginal mesh, divides into 4 new triangles
-
-  sub_division_level ++;
-
-  // Clear out any previous relationships
-  // Not the nessary case
-  vertex_parents.clear();
-  childParentMap.clear();
-
-  // =========================================
-  //  Create new triangles
-  // =========================================
-
-  triangleshashtype::iterator iter = triangles.begin();
-  std::vector<Vertex*> newTriangles;
-  std::vector<Triangle*> delTriangles;
-  
-  while(iter!= triangles.end()){
-
-    // Mark for removal
-    delTriangles.push_back((*iter).second);
-
-    Vertex* a = (*iter).second->getEdge()->getStartVertex();
-    Vertex* b = (*iter).second->getEdge()->getNext()->getStartVertex();
-    Vertex* c = (*iter).second->getEdge()->getNext()->getNext()->getStartVertex();
-
-    Vertex* ab = getChildVertex(a,b);
-    Vertex* bc = getChildVertex(b,c);     
-    Vertex* ca = getChildVertex(c,a);
-
-    if(ab == NULL){
-      ab = addVertex(a->getPos().midPoint3f(b->getPos()));
-      setParentsChild(a,b,ab);
-      childParentMap[ab] = std::make_pair(a,b);
-      if(getMeshEdge(a,b) != NULL){
-      
-        creaseMap[std::make_pair(a,ab)] = getMeshEdge(a,b)->getCrease();
-        creaseMap[std::make_pair(ab,b)] = getMeshEdge(a,b)->getCrease();
-      
-      }else if(getMeshEdge(b,a)){
-      
-        creaseMap[std::make_pair(a,ab)] = getMeshEdge(b,a)->getCrease();
-        creaseMap[std::make_pair(ab,b)] = getMeshEdge(b,a)->getCrease();
-      
-      }else{assert(false);}
+// =================================================================
+// PROGRESSIVE MESH
+// Simplification records a VertexSplit for each collapse it makes.
+// Applying them in order (coarse to fine) and undoing them in reverse
+// gives back each intermediate mesh exactly, slot for slot, because
+// the collapsed triangles' slots are never handed out again while the
+// splits are kept.
+// =================================================================
 
+void Mesh::recordCollapse(int e, const Vec3f &pos, VertexSplit &split) const {
+  // Input: half-edge e that collapseEdge is about to merge to pos
+  // Output: the split that undoes it
+  int o = getOpposite(e);
+  assert (o != -1);
+  split.dead = getStartVertex(e);
+  split.keep = getEndVertex(e);
+  split.left = getStartVertex(prevEdge(e));
+  split.right = getStartVertex(prevEdge(o));
+  split.edge = e;
+  split.opposite_edge = o;
+  int sides[4] = { nextEdge(e), prevEdge(e), nextEdge(o), prevEdge(o) };
+  split.crease[0] = getCrease(e);
+  for (int i = 0; i < 4; i++) {
+    split.outer[i] = getOpposite(sides[i]);
+    split.crease[i+1] = getCrease(sides[i]);
+  }
+  // dead's other half-edges, from the second triangle's side clockwise
+  // round to the first's, or out to the boundary and then the rest
+  // the other way
+  int back = 0, forward = 0;
+  int g = split.outer[1];
+  while (g != -1 && g != nextEdge(o)) {
+    back++;
+    g = getOpposite(prevEdge(g));
+  }
+  if (g == -1) {
+    int a = split.outer[2];
+    while (a != -1) {
+      forward++;
+      a = getOpposite(nextEdge(a));
     }
+  }
+  // they are stored in 16 bits
+  assert (back <= 65535 && forward <= 65535);
+  split.fan_back = back;
+  split.fan_forward = forward;
+  split.dead_pos = getPos(split.dead);
+  split.keep_pos = getPos(split.keep);
+  split.collapsed_pos = pos;
+}
 
-    if(bc == NULL){
-      bc = addVertex(b->getPos().midPoint3f(c->getPos()));
-      setParentsChild(b,c,bc);
-      childParentMap[bc] = std::make_pair(b,c);
-
-      if(getMeshEdge(b,c) != NULL){
-      
-        creaseMap[std::make_pair(b,bc)] = getMeshEdge(b,c)->getCrease();
-        creaseMap[std::make_pair(bc,c)] = getMeshEdge(b,c)->getCrease();
-        
-      }else if(getMeshEdge(c,b) != NULL){
-        
-        creaseMap[std::make_pair(b,bc)] = getMeshEdge(c,b)->getCrease();
-        creaseMap[std::make_pair(bc,c)] = getMeshEdge(c,b)->getCrease();
-      }else{assert(false);}
 
-    }
+void Mesh::applyVertexSplit(VertexSplit &split) {
+  int dead = split.dead, keep = split.keep;
+  int e = split.edge, o = split.opposite_edge;
+  assert (!isTriangle(edgeTriangle(e)) && !isTriangle(edgeTriangle(o)));
+  // a split read from a file learns where keep was collapsed to here
+  split.collapsed_pos = getPos(keep);
+
+  // hand dead's half-edges back to it.  the fans are walked the same
+  // way recordCollapse counted them, the stitched edges are never crossed
+  int g = split.outer[1];
+  for (int i = 0; i < split.fan_back; i++) {
+    edge_vertex[g] = dead;
+    markTriangleDirty(edgeTriangle(g));
+    g = edge_opposite[prevEdge(g)];
+  }
+  int a = split.outer[2];
+  for (int i = 0; i < split.fan_forward; i++) {
+    int h = nextEdge(a);
+    edge_vertex[h] = dead;
+    markTriangleDirty(edgeTriangle(h));
+    a = edge_opposite[h];
+  }
 
-    if(ca == NULL){
-      ca = addVertex(c->getPos().midPoint3f(a->getPos()));
-      setParentsChild(c,a,ca);
-      childParentMap[ca] = std::make_pair(c,a);
-
-      if(getMeshEdge(a,c) != NULL){
-      
-        creaseMap[std::make_pair(c,ca)] = getMeshEdge(a,c)->getCrease();
-        creaseMap[std::make_pair(ca,a)] = getMeshEdge(a,c)->getCrease();
-      
-      }else if(getMeshEdge(c,a) != NULL){
-      
-        creaseMap[std::make_pair(c,ca)] = getMeshEdge(c,a)->getCrease();
-        creaseMap[std::make_pair(ca,a)] = getMeshEdge(c,a)->getCrease();
-      }else{assert(false);}
+  // the two triangles go back in their slots, between the outer edges
+  edge_vertex[e] = dead;
+  edge_vertex[nextEdge(e)] = keep;
+  edge_vertex[prevEdge(e)] = split.left;
+  edge_vertex[o] = keep;
+  edge_vertex[nextEdge(o)] = dead;
+  edge_vertex[prevEdge(o)] = split.right;
+  edge_opposite[e] = o;
+  edge_opposite[o] = e;
+  edge_crease[e] = edge_crease[o] = split.crease[0];
+  int sides[4] = { nextEdge(e), prevEdge(e), nextEdge(o), prevEdge(o) };
+  for (int i = 0; i < 4; i++) {
+    int outer = split.outer[i];
+    edge_opposite[sides[i]] = outer;
+    edge_crease[sides[i]] = split.crease[i+1];
+    if (outer != -1) {
+      edge_opposite[outer] = sides[i];
+      edge_crease[outer] = split.crease[i+1];
+      markTriangleDirty(edgeTriangle(outer));
     }
-
-    // New Triangles
-    newTriangles.push_back(a);
-    newTriangles.push_back(ab);
-    newTriangles.push_back(ca);
-
-    newTriangles.push_back(b);
-    newTriangles.push_back(bc);
-    newTriangles.push_back(ab);
-    
-    newTriangles.push_back(c);
-    newTriangles.push_back(ca);
-    newTriangles.push_back(bc);
-
-    newTriangles.push_back(ca);
-    newTriangles.push_back(ab);
-    newTriangles.push_back(bc);
-  
-    iter++;
-  }
- 
-  // Have everything I need, remove and recreate
-
-  for(unsigned int i = 0; i < delTriangles.size(); i++){
-    removeTriangle(delTriangles[i]);
-  }
- 
-  for(unsigned int i = 0; i < newTriangles.size(); i = i + 3){
-    addTriangle(newTriangles[i], 
-        newTriangles[i+1], 
-        newTriangles[i+2]);
   }
+  markTriangleDirty(edgeTriangle(e));
+  markTriangleDirty(edgeTriangle(o));
+  num_triangles += 2;
+
+  setPos(keep,split.keep_pos);
+  setPos(dead,split.dead_pos);
+  bbox.Extend(split.dead_pos);
+  bbox.Extend(split.keep_pos);
+  edge_table_stale = true;
 }
-void Mesh::getControlPts_newEdge(Edge* edg, std::vector<Vec3f> &controlPts){
-
-  // I know this is new.
-  // How many sharp edges?
 
-  // Getting control point 1 and 2, WIN
-  Vertex* one = childParentMap[edg->getStartVertex()].first;
-  Vertex* two = childParentMap[edg->getStartVertex()].second;
-  Vertex* three = NULL;
-  Vertex* four = NULL;
 
-  Edge* curEdge = edg;
-
-  do{
-    // Using the way I build triangles
-    // Getting gettingEdge[0] gives me parent
-    Vertex* mystery = curEdge->getTriangle()->getEdge()->getStartVertex();
-    if(mystery != one && mystery != two){
+void Mesh::applyEdgeCollapse(const VertexSplit &split) {
+  // the same edits as collapseEdge, from the record alone
+  int keep = split.keep;
+  int e = split.edge, o = split.opposite_edge;
+  assert (isTriangle(edgeTriangle(e)) && isTriangle(edgeTriangle(o)));
 
-      // Means that I have one of the middle triangles, lets assert to make sure
-      assert(curEdge->getStartVertex() == edg->getStartVertex());
-      Vertex * possible = curEdge->getNext()->getOpposite()->getPrev()->getStartVertex();
+  int g = split.outer[1];
+  for (int i = 0; i < split.fan_back; i++) {
+    edge_vertex[g] = keep;
+    markTriangleDirty(edgeTriangle(g));
+    g = edge_opposite[prevEdge(g)];
+  }
+  int a = split.outer[2];
+  for (int i = 0; i < split.fan_forward; i++) {
+    int h = nextEdge(a);
+    edge_vertex[h] = keep;
+    markTriangleDirty(edgeTriangle(h));
+    a = edge_opposite[h];
+  }
 
-      if(three == NULL){
-        three = possible;
+  for (int i = 0; i < 2; i++) {
+    int x = split.outer[2*i];
+    int y = split.outer[2*i+1];
+    float crease = std::max(split.crease[2*i+1],split.crease[2*i+2]);
+    if (x != -1) { edge_opposite[x] = y; edge_crease[x] = crease; markTriangleDirty(edgeTriangle(x)); }
+    if (y != -1) { edge_opposite[y] = x; edge_crease[y] = crease; markTriangleDirty(edgeTriangle(y)); }
+  }
 
-      }else if(three != NULL && three != possible){
-        four = possible;
-        break;
-      }
-      
+  int removed[2] = { edgeTriangle(e), edgeTriangle(o) };
+  for (int i = 0; i < 2; i++) {
+    markTriangleDirty(removed[i]);
+    for (int k = 0; k < 3; k++) {
+      int r = 3*removed[i]+k;
+      edge_vertex[r] = -1;
+      edge_opposite[r] = -1;
+      edge_crease[r] = 0;
     }
+  }
+  num_triangles -= 2;
 
-    curEdge = curEdge->getOpposite()->getNext();
-  }while(curEdge != edg);
-
-
-  assert(one != NULL);
-  assert(two != NULL);
-  assert(three != NULL);
-  assert(four != NULL);
-
-
-  // Apply Specific weights!
-  // Need parent's 1 and 2's edge
-  Edge* e1 = getMeshEdge(one,edg->getStartVertex());
-  if (e1 == NULL)
-    getMeshEdge(edg->getStartVertex(), one);
-  Edge* e2 = getMeshEdge(two,edg->getStartVertex());
-  if (e2 == NULL)
-    getMeshEdge(edg->getStartVertex(), two);
-
-  assert(e1 != NULL && e2 != NULL);
-
-  int p1_sharp = adjSharpEdges(e1);
-  int p2_sharp = adjSharpEdges(e2);
-  int methodMask = -1;
-
-  // Choices
-
-  // Smooth and darts
-  if(p1_sharp <= 1){methodMask = 1;}
-  else if(p2_sharp <= 1){methodMask = 1;}
-  
-  //P1 is Reg 3 Cases Regulars
-  else if(p1_sharp == 2 && valance(e1) == 6){
-
-    // Regular Crease Vertex
-    if(p2_sharp == 2 && valance(e2) == 6){methodMask = 2;}
-    else{ methodMask = 3;}
-        
-  }else if(p1_sharp == 2 && valance(e1) == 4){
-
-    // Non-Regular Crease
-    if(p2_sharp == 2 && valance(e2)== 6){methodMask = 3;}
-    else{ methodMask = 2;}
-  
-  }else if(p1_sharp > 2){
-    //Corner
-    if(p2_sharp == 2 && valance(e2) == 6){methodMask = 3;}
-    else{ methodMask = 2;}
-  }
-
-
-
-  if(methodMask == 1){
-  // Apply weights, meaning one is a dart or just regular old smooth
-    Vec3f onePos =  (3/(double)8) * one->getPos();
-    Vec3f twoPos =  (3/(double)8) * two->getPos();
-    Vec3f threePos = (1/(double)8) * three->getPos();
-    Vec3f fourPos =  (1/(double)8) * four->getPos();
-    // Save to recalcuate
-    controlPts.push_back(onePos);
-    controlPts.push_back(twoPos);
-    controlPts.push_back(threePos);
-    controlPts.push_back(fourPos);
-
-  }else if(methodMask == 2){
-    Vec3f onePos =  (1/(double)2) * one->getPos();
-    Vec3f twoPos =  (1/(double)2) * two->getPos();
-    controlPts.push_back(onePos);
-    controlPts.push_back(twoPos);
-  }else if(methodMask == 3){
-  
-    Vec3f onePos =  (5/(double)8) * one->getPos();
-    Vec3f twoPos =  (3/(double)8) * two->getPos();
-    controlPts.push_back(onePos);
-    controlPts.push_back(twoPos);
-
-  }else{
-    // Just going to use loops
-    // Apply weights, meaning one is a dart or just regular old smooth
-    Vec3f onePos =  (3/(double)8) * one->getPos();
-    Vec3f twoPos =  (3/(double)8) * two->getPos();
-    Vec3f threePos = (1/(double)8) * three->getPos();
-    Vec3f fourPos =  (1/(double)8) * four->getPos();
-    // Save to recalcuate
-    controlPts.push_back(onePos);
-    controlPts.push_back(twoPos);
-    controlPts.push_back(threePos);
-    controlPts.push_back(fourPos);
-
-  }
-  
+  setPos(keep,split.collapsed_pos);
+  edge_table_stale = true;
 }
 
-void Mesh::getControlPts_oldEdge(Edge* edg, std::vector<Vec3f> &controlPts){
-
-  std::vector<Edge*> adjEdges;
-  int adjSharp = 0;
-  Edge* cur  = edg;
-
-  // Counting how many edges/triangles i have surounding me
-  do{
-
-    // Legal?
-    assert(cur->getStartVertex());
-    adjEdges.push_back(cur);
-    if(cur->getCrease() != 0)
-      adjSharp++;
-
-    // Increment
-    cur = cur->getOpposite();
-    assert(cur != NULL);
-    cur = cur->getNext();
-  
-  }while(cur != edg);
 
+void Mesh::setProgressiveLevel(int applied) {
+  assert (applied >= 0 && applied <= (int)pm_splits.size());
+  while (pm_applied < applied) applyVertexSplit(pm_splits[pm_applied++]);
+  while (pm_applied > applied) applyEdgeCollapse(pm_splits[--pm_applied]);
+}
 
-  // I know how valancy of this vertex, find weight
-  double weight;
 
-  if(adjEdges.size() > 3){
-    weight = (3 /((double) 8*adjEdges.size()));
-  }else if(adjEdges.size() == 3){
-    weight = 3/(double)16;
+void Mesh::SetProgressiveTriangles(int target_tri_count) {
+  // every split adds 2 triangles, stop on the first count >= the target
+  while (numTriangles() > target_tri_count && pm_applied > 0) {
+    applyEdgeCollapse(pm_splits[--pm_applied]);
   }
-
-
-  // CORNER VERTEX
-  if(adjSharp > 2){
-    // If I have a corner
-    controlPts.push_back(edg->getStartVertex()->getPos());
-    return;
-  }  
-  
-  
-  // CREASE VERTEX
-  if(adjSharp == 2){
-
-    // I have all adj edges
-    for(unsigned int i = 0; i < adjEdges.size(); i++){
-
-      //Navigating to old vertex
-      Vertex* c = adjEdges[i]->getNext()->getOpposite()->
-        getNext()->getOpposite()->getPrev()->getStartVertex();
-
-      if(adjEdges[i]->getCrease() > 0){
-        Vec3f temp =  (1/(double)8)* c->getPos();
-        controlPts.push_back(temp);
-      }
-
+  while (numTriangles() < target_tri_count) {
+    if (pm_applied == (int)pm_splits.size()) {
+      // the rest of a .pm that is still being loaded
+      VertexSplit split;
+      if (!pm_stream.ReadSplit(split)) break;
+      pm_splits.push_back(split);
     }
-
-    // Adding in oringal vertex
-    controlPts.push_back((6/(double)8) * edg->getStartVertex()->getPos());
-    return;
+    applyVertexSplit(pm_splits[pm_applied++]);
   }
+}
 
-  // I have all adj edges
-  for(unsigned int i = 0; i < adjEdges.size(); i++){
-
-    //Navigating to old vertex
-    Vertex* c = adjEdges[i]->getNext()->getOpposite()->
-      getNext()->getOpposite()->getPrev()->getStartVertex();
-
-    // Saving control points
-    Vec3f temp = weight * c->getPos();
-    controlPts.push_back(temp);
 
+// splits and collapses assume nothing else has touched the mesh, so
+// anything else that edits it drops them and frees their slots
+void Mesh::clearProgressive() {
+  if (pm_splits.empty() && !pm_stream.isOpen()) return;
+  pm_splits.clear();
+  pm_applied = 0;
+  pm_stream.Close();
+  free_triangles.clear();
+  for (int t = 0; t < numTriangleSlots(); t++) {
+    if (!isTriangle(t)) free_triangles.push_back(t);
   }
-
-  // Adding in oringal vertex
-  double oldWeight = 1 - (adjEdges.size() * weight);
-  controlPts.push_back(oldWeight * edg->getStartVertex()->getPos());
-
-
 }
-void Mesh::getControlPts_newBound(Edge* edg, std::vector<Vec3f> &controlPts){
-  std::pair<Vertex*,Vertex*> oldVert;
 
-  Vec3f one;
-  Vec3f two;
 
-  oldVert = childParentMap[edg->getStartVertex()];
+bool Mesh::SaveProgressive(const std::string &filename) {
 
-  one = (0.5) * oldVert.first->getPos();
-  two = (0.5) * oldVert.second->getPos();
-  
-  controlPts.push_back(one);
-  controlPts.push_back(two);
+  // pull in whatever of a loaded .pm hasn't been read yet
+  VertexSplit split;
+  while (pm_stream.ReadSplit(split)) pm_splits.push_back(split);
 
-  
-}
+  // the base mesh is the coarsest level
+  int applied = pm_applied;
+  setProgressiveLevel(0);
 
-void Mesh::getControlPts_oldBound(Edge* edg, std::vector<Vec3f> &controlPts){
-  // Here I run into an slight issue. 
-  // I have a vertex, x and want to find orginal vertices o 
-  // I dont know how many triangles are around/between
-
-  //std::cout << "Concider: " << edg <<std::endl;
-  
-  Edge* right = edg;
-  Edge* left =  edg;
-
-  while(true){
-    
-    right = right->getPrev();
-
-    if(right->getOpposite() != NULL){
-      right = right->getOpposite();
-      
-    }else{
-      right = right->getNext();
-      break;
-    
-    }
-  }//Finding right most
-    
-  while(true){
-
-    if(left->getOpposite() != NULL){
-      left = left->getOpposite();
-      left = left->getNext();
-    
-    }else{
-      left = left->getPrev();
-      break;
+  std::vector<bool> used(numVertices(),false);
+  std::vector<ProgressiveMeshTriangle> triangles;
+  for (int t = 0; t < numTriangleSlots(); t++) {
+    if (!isTriangle(t)) continue;
+    ProgressiveMeshTriangle tri;
+    tri.slot = t;
+    for (int i = 0; i < 3; i++) {
+      tri.verts[i] = edge_vertex[3*t+i];
+      tri.opposites[i] = edge_opposite[3*t+i];
+      tri.creases[i] = edge_crease[3*t+i];
+      used[tri.verts[i]] = true;
     }
+    triangles.push_back(tri);
+  }
+  std::vector<ProgressiveMeshVertex> vertices;
+  for (int v = 0; v < numVertices(); v++) {
+    if (!used[v]) continue;
+    ProgressiveMeshVertex vert;
+    vert.index = v;
+    for (int i = 0; i < 3; i++) vert.pos[i] = getPos(v)[i];
+    vertices.push_back(vert);
+  }
 
-  }//Finding left most
-
-  Vec3f one = right->getNext()->getOpposite()->getPrev()->getOpposite()->getPrev()->getStartVertex()->getPos();
-  Vec3f two = left->getPrev()->getOpposite()->getNext()->getOpposite()->getPrev()->getStartVertex()->getPos();
-
-  one = one * (1/(double)8);
-  two = two * (1/(double)8);
-  Vec3f org = (3/(double)4) * edg->getStartVertex()->getPos();
-
-  controlPts.push_back(one);
-  controlPts.push_back(two);
-  controlPts.push_back(org);
-  
+  ProgressiveMeshHeader header;
+  memset(&header,0,sizeof(header));
+  memcpy(header.magic,PROGRESSIVE_MESH_MAGIC,4);
+  header.version = PROGRESSIVE_MESH_VERSION;
+  header.byte_order = PROGRESSIVE_MESH_BYTE_ORDER;
+  header.header_bytes = sizeof(header);
+  header.num_vertices = numVertices();
+  header.num_triangle_slots = numTriangleSlots();
+  header.num_base_vertices = vertices.size();
+  header.num_base_triangles = triangles.size();
+  header.num_splits = pm_splits.size();
+  bool ok = WriteProgressiveMesh(filename,header,vertices,triangles,pm_splits);
+
+  setProgressiveLevel(applied);
+  return ok;
 }
 
-int Mesh::identifyVertex(Edge * edg){
-
-  Vertex* mysteryVertex = edg->getStartVertex();
-
-  if(childParentMap.count(mysteryVertex) == 1){
-  
-    // I know I have a child, easy to find if boundry
-  
-    Edge* cur  = edg;
-
-    // Counting how many edges/triangles i have surounding me
-    do{
-      // Increment
-      cur = cur->getOpposite();
-      if(cur == NULL){
-       //std::cout << "Inside ID Child: " << edg <<std::endl;
-        return 3;
-      }
-      cur = cur->getNext();
-    
-    }while(cur != edg);
-
-    return 1;
 
-  }else{
+// the base mesh goes straight into the arrays, then every split that
+// has arrived is applied.  the file stays open if it ends early, 'r'
+// picks up the rest.
+void Mesh::LoadProgressive(const std::string &input_file) {
 
-    Edge* cur  = edg;
-
-    // Counting how many edges/triangles i have surounding me
-    do{
-      // Increment
-      cur = cur->getOpposite();
-      if(cur == NULL){
-       //std::cout << "Inside ID Adult: " << edg <<std::endl;
-        return 4;
-      }
-      cur = cur->getNext();
-    
-    }while(cur != edg);
-
-    return 2;
+  ProgressiveMeshHeader header;
+  std::vector<ProgressiveMeshVertex> vertices;
+  std::vector<ProgressiveMeshTriangle> triangles;
+  if (!pm_stream.Open(input_file,header,vertices,triangles)) {
+    std::cout << "ERROR! CANNOT OPEN: " << input_file << std::endl;
+    return;
   }
-
-  return 0;
-
-  /*
-  // THIS WORKS FOR MOST CASES, NOT BOUNDS THOU!
-  Edge* curEdge = edge;
-
-  do{
-
-    curEdge = curEdge->getOpposite();
-    if(curEdge == NULL){
-      return 0;
-    }else{
-      curEdge = curEdge->getNext();
-    }
-
-  }while(curEdge != edge);
-
-
-
-    //TODO Only works for first iteration
-    if(childParentMap.count(mysteryVertex) == 1){
-      return 1;
-    }else{
-      return 2;
+  assert (numVertices() == 0 && numTriangles() == 0);
+  markAllDirty();
+
+  int num_verts = header.num_vertices;
+  int num_slots = header.num_triangle_slots;
+  vertex_positions.assign(num_verts,Vec3f(0,0,0));
+  vertex_parents.assign(2*num_verts,-1);
+  edge_vertex.assign(3*num_slots,-1);
+  edge_opposite.assign(3*num_slots,-1);
+  edge_crease.assign(3*num_slots,0);
+
+  for (unsigned int i = 0; i < vertices.size(); i++) {
+    int v = vertices[i].index;
+    assert (v >= 0 && v < num_verts);
+    const float *p = vertices[i].pos;
+    vertex_positions[v] = Vec3f(p[0],p[1],p[2]);
+    if (i == 0)
+      bbox = BoundingBox(vertex_positions[v],vertex_positions[v]);
+    else
+      bbox.Extend(vertex_positions[v]);
+  }
+  for (unsigned int i = 0; i < triangles.size(); i++) {
+    int t = triangles[i].slot;
+    assert (t >= 0 && t < num_slots && !isTriangle(t));
+    for (int k = 0; k < 3; k++) {
+      assert (triangles[i].verts[k] >= 0 && triangles[i].verts[k] < num_verts);
+      edge_vertex[3*t+k] = triangles[i].verts[k];
+      edge_opposite[3*t+k] = triangles[i].opposites[k];
+      edge_crease[3*t+k] = triangles[i].creases[k];
     }
-    
-
-  return 0;
+    num_triangles++;
+  }
+  edge_table_stale = true;
 
-  */
+  SetProgressiveTriangles(num_slots);
+  if (pm_stream.isOpen()) {
+    std::cout << "WARNING: " << input_file << " is incomplete, " << pm_splits.size()
+              << " of " << header.num_splits << " vertex splits so far" << std::endl;
+  }
 }
+
 // =================================================================
@@ -13,17 +13,7 @@
 #include "hash.h"
 #include "boundingbox.h"
 #include "argparser.h"
-
-#include "edge.h"
-#include "triangle.h"
-
-// Easier to read 
-typedef std::pair<Vertex*,Vertex*> vPair;
-
-//Lets me use these classes in my .cpp file
-class Vertex;
-class Edge;
-class Triangle;
+#include "progressive_mesh.h"
 
 // ======================================================================
 // ======================================================================
@@ -59,19 +49,44 @@ struct VBOTriVert {
   float nx, ny, nz; // normal
 };
 
-struct VBOTri {
-  VBOTri() {}
-  VBOTri(unsigned int a, unsigned int b, unsigned int c) {
-    verts[0] = a;
-    verts[1] = b;
-    verts[2] = c;
+// what AdaptiveSubdivision refines (any test that fails splits the
+// triangle, a zero turns a test off)
+struct AdaptiveCriteria {
+  AdaptiveCriteria() {
+    max_dihedral = 0;
+    max_pixels = 0;
+    near_creases = false;
+    has_screen = false;
   }
-  unsigned int verts[3];
+  double max_dihedral;   // radians between the normals across an edge
+  double max_pixels;     // longest edge on screen, needs has_screen
+  bool near_creases;     // touches a vertex on a crease
+  bool has_screen;
+  double screen[16];     // projection * modelview, column major like GL
+  int viewport[4];
 };
 
 // ======================================================================
 // ======================================================================
 // Stores and renders all the vertices, triangles, and edges for a 3D model
+//
+// Everything is kept in flat arrays and referred to by int index (-1
+// means none), there are no per-element heap objects:
+//
+//   vertex v      vertex_positions[v]
+//                 vertex_parents[2v], [2v+1]   set for the vertices made
+//                                              by the last LoopSubdivision
+//   triangle t    owns half-edges 3t, 3t+1, 3t+2, in order, so the
+//                 next/prev half-edge and the triangle of a half-edge
+//                 are plain arithmetic
+//   half-edge e   edge_vertex[e]     start vertex (-1: unused slot)
+//                 edge_opposite[e]   -1 on a boundary
+//                 edge_crease[e]
+//   green pair    triangle_sibling[t]  the other half of a triangle
+//                                      AdaptiveSubdivision bisected
+//
+// Removed triangles leave a hole in the arrays that goes on a free
+// list and is reused by the next addTriangle.
 
 class Mesh {
 
@@ -82,6 +97,17 @@ public:
   Mesh(ArgParser *a) { 
     args = a;
     sub_division_level = 0;
+    num_triangles = 0;
+    edge_table_stale = false;
+    pm_applied = 0;
+    vbo_all_dirty = true;
+    vbo_gouraud = false;
+    vbo_num_slots = 0;
+    vbo_triangle_capacity = 0;
+    vbo_vertex_capacity = 0;
+    // no VBOs until initializeVBOs (never, without a GL context)
+    mesh_tri_verts_VBO = mesh_verts_VBO = 0;
+    mesh_boundary_edge_indices_VBO = mesh_crease_edge_indices_VBO = mesh_other_edge_indices_VBO = 0;
   }
 
   ~Mesh();
@@ -90,66 +116,83 @@ public:
 
   // ========
   // VERTICES
-  int numVertices() const { return vertices.size(); }
-  Vertex* addVertex(const Vec3f &pos);
-  // look up vertex by index from original .obj file
-  Vertex* getVertex(int i) const {
-    assert (i >= 0 && i < numVertices());
-    Vertex *v = vertices[i];
-    assert (v != NULL);
-    return v; }
+  // (vertices are never removed, so this is also the range of valid indices)
+  int numVertices() const { return vertex_positions.size(); }
+  int addVertex(const Vec3f &pos);
+  const Vec3f& getPos(int v) const {
+    assert (v >= 0 && v < numVertices());
+    return vertex_positions[v]; }
+  void setPos(int v, const Vec3f &pos) {
+    assert (v >= 0 && v < numVertices());
+    vertex_positions[v] = pos;
+    markVertexDirty(v); }
 
   // ==================================================
   // PARENT VERTEX RELATIONSHIPS (used for subdivision)
-  // this creates a relationship between 3 vertices (2 parents, 1 child)
-  void setParentsChild(Vertex *p1, Vertex *p2, Vertex *child);
-  // this accessor will find a child vertex (if it exists) when given
-  // two parent vertices
-  Vertex* getChildVertex(Vertex *p1, Vertex *p2) const;
+  // the vertices made by the last LoopSubdivision sit on the edge
+  // between their two parents, every other vertex has none (-1)
+  bool isChildVertex(int v) const { return vertex_parents[2*v] != -1; }
+  int getParentVertex(int v, int i) const {
+    assert (i == 0 || i == 1);
+    return vertex_parents[2*v+i]; }
 
   // =====
   // EDGES
-  int numEdges() const { return edges.size(); }
+  int numEdges() const { return 3*numTriangles(); }
+  static int nextEdge(int e) { return (e % 3 == 2) ? e-2 : e+1; }
+  static int prevEdge(int e) { return (e % 3 == 0) ? e+2 : e-1; }
+  static int edgeTriangle(int e) { return e / 3; }
+  int getStartVertex(int e) const { assert (edge_vertex[e] != -1); return edge_vertex[e]; }
+  int getEndVertex(int e) const { return getStartVertex(nextEdge(e)); }
+  // warning!  the opposite edge might be -1!
+  int getOpposite(int e) const { assert (edge_vertex[e] != -1); return edge_opposite[e]; }
+  float getCrease(int e) const { return edge_crease[e]; }
+  void setCrease(int e, float c) {
+    edge_crease[e] = (c <= 0) ? 0 : c;
+    markTriangleDirty(edgeTriangle(e)); }
+  float EdgeLength(int e) const;
+  float DihedralAngle(int e) const;
   // this efficiently looks for an edge with the given vertices, using a hash table
-  Edge* getMeshEdge(Vertex *a, Vertex *b) const;
-  Edge* getShortestEdge();
-  int identifyVertex(Edge * edge);
+  int getMeshEdge(int a, int b);
+  // fills ring with every half-edge leaving the start vertex of e.
+  // returns false if that vertex is on a boundary (the fan is open)
+  bool getOutgoingEdges(int e, std::vector<int> &ring) const;
 
-  int adjSharpEdges(Edge* edge){
+  int adjSharpEdges(int edge) const {
     // Returne adjSharpEdges, if there is a failure to get
     // I return what I have so far
     // Assume I can circle around the edge's start vertex
     int s = 0;
-    Edge* cur = edge;
+    int cur = edge;
 
     do{
 
-      if(cur->getCrease() > 0 ){
+      if(getCrease(cur) > 0 ){
         s++;
       
       }
       // Increment
-      cur = cur->getOpposite();
-      if(cur == NULL){
+      cur = getOpposite(cur);
+      if(cur == -1){
         return s;
       }
-      cur = cur->getNext();
+      cur = nextEdge(cur);
 
     }while(cur != edge);
    return s;
   } 
 
-  int valance(Edge* edge){
+  int valance(int edge) const {
     
     int s = 0;
-    Edge* cur = edge;
+    int cur = edge;
 
     do{
       s++;
-      cur = cur->getOpposite();
-      if(cur == NULL)
+      cur = getOpposite(cur);
+      if(cur == -1)
         return -1;
-      cur = cur->getNext();
+      cur = nextEdge(cur);
     }while(cur != edge);
    return s;
   } 
@@ -157,18 +200,24 @@ public:
 
   // =========
   // TRIANGLES
-  int numTriangles() const { return triangles.size(); }
-  void addTriangle(Vertex *a, Vertex *b, Vertex *c);
-  void removeTriangle(Triangle *t);
-  void removeTriangle(Edge* edge);
-  bool alteredTriPair(Edge* cur, Vertex* deadVertex, Vertex*  mergeVertex, vPair& alteredPair);
-  // Subdivide methods
-  void divide();
-  void getControlPts_newEdge(Edge* edg, std::vector<Vec3f> &controlPts);
-  void getControlPts_oldEdge(Edge* edg, std::vector<Vec3f> &controlPts);
-  void getControlPts_newBound(Edge* edg, std::vector<Vec3f>  &controlPts);
-  void getControlPts_oldBound(Edge* edg, std::vector<Vec3f> &controlPts);
-
+  int numTriangles() const { return num_triangles; }
+  // live triangles are scattered over [0,numTriangleSlots())
+  int numTriangleSlots() const { return edge_vertex.size() / 3; }
+  bool isTriangle(int t) const { return edge_vertex[3*t] != -1; }
+  int getTriangleVertex(int t, int i) const {
+    assert (i >= 0 && i < 3);
+    return getStartVertex(3*t+i); }
+  Vec3f getTriangleNormal(int t) const;
+  int addTriangle(int a, int b, int c);
+  void removeTriangle(int t);
+
+  // =============
+  // LIMIT SURFACE
+  // where repeated LoopSubdivision converges to, evaluated on this mesh
+  // without subdividing it (see loop_limit.h)
+  void LimitVertex(int e, Vec3f &pos, Vec3f &normal) const;  // at the start of e
+  // at barycentric (1-v-w, v, w) of the corners of triangle t
+  void LimitPoint(int t, double v, double w, Vec3f &pos, Vec3f &normal) const;
 
   // ===============
   // OTHER ACCESSORS
@@ -177,15 +226,37 @@ public:
   // ===+=====
   // RENDERING
   void initializeVBOs();
+  // brings the VBOs up to date, re-packing and uploading only what
+  // changed since the last call (see markTriangleDirty)
   void setupVBOs();
+  // re-packs all of the CPU copies setupVBOs sends, without any GL
+  void packVBOs();
   void drawVBOs();
   void cleanupVBOs();
+  // scale & translate (on the current GL matrix) so the mesh fits the window
+  void glFitToWindow() const;
+  // renumbers the triangle slots in vertex cache order and the vertices
+  // in the order those use them, dropping free slots (and any
+  // progressive mesh splits)
+  void OptimizeLayout();
 
   // ==========================
   // MESH PROCESSING OPERATIONS
   void LoopSubdivision();
+  void AdaptiveSubdivision(const AdaptiveCriteria &criteria);
   void Simplification(int target_tri_count);
 
+  // ================
+  // PROGRESSIVE MESH
+  // Simplification keeps a vertex split for every collapse, these step
+  // along them.  any other change to the mesh drops them.
+  int numVertexSplits() const { return pm_splits.size(); }
+  int numAppliedVertexSplits() const { return pm_applied; }
+  // refine or coarsen to about the given count, in time proportional
+  // to the number of splits or collapses on the way
+  void SetProgressiveTriangles(int target_tri_count);
+  bool SaveProgressive(const std::string &filename);
+
 private:
 
   // don't use these constructors
@@ -193,34 +264,87 @@ private:
   const Mesh& operator=(const Mesh &/*m*/) { assert(0); exit(0); }
 
   // helper functions
-  void setupTriVBOs();
-  void setupEdgeVBOs();
-  bool manifoldLegal(Edge* a, Edge* b);
+  // every edit records what it touched here for setupVBOs, anything
+  // that rewrites the arrays wholesale calls markAllDirty
+  void markTriangleDirty(int t) { if (!vbo_all_dirty) dirty_triangles.push_back(t); }
+  void markVertexDirty(int v) { if (!vbo_all_dirty) dirty_vertices.push_back(v); }
+  void markAllDirty() {
+    vbo_all_dirty = true;
+    dirty_triangles.clear();
+    dirty_vertices.clear(); }
+  bool findDirty(std::vector<unsigned char> &triangle_flags,
+                 std::vector<unsigned char> &vertex_flags) const;
+  void packTriangle(int t);
+  void packEdges(int t);
+  void setupTriVBOs(const std::vector<unsigned char> *triangle_flags);
+  void setupEdgeVBOs(const std::vector<unsigned char> *triangle_flags,
+                     const std::vector<unsigned char> *vertex_flags);
+  // the vectors are scratch space, passed in so the simplification
+  // loop doesn't allocate
+  bool collapseLegal(int e, const Vec3f &pos, std::vector<int> &ring_a,
+                     std::vector<int> &ring_b, std::vector<int> &neighbors) const;
+  int collapseEdge(int e, const Vec3f &pos, std::vector<int> &ring);
+  Vec3f getAverageNormals(int givenEdge) const;
+  // subdivision stencils, shared by the uniform and adaptive passes
+  void getFanStarts(std::vector<int> &vertex_edge) const;
+  Vec3f oddStencil(int e, const std::vector<unsigned char> &vertex_class) const;
+  int oppositeCorner(int e) const;
+  bool adaptiveTest(int t, const AdaptiveCriteria &criteria,
+                    const std::vector<unsigned char> &crease_vertex) const;
+  void LoadCache(const std::string &input_file);
+  void LoadProgressive(const std::string &input_file);
+  void recordCollapse(int e, const Vec3f &pos, VertexSplit &split) const;
+  void applyVertexSplit(VertexSplit &split);
+  void applyEdgeCollapse(const VertexSplit &split);
+  void setProgressiveLevel(int applied);
+  void clearProgressive();
+  void updateEdgeTable();
   
   // ==============
   // REPRESENTATION
   ArgParser *args;                //Arguments
 
-  std::vector<Vertex*> vertices;  //Vector of vertices pointers
-                                  //Where are they created?
-
-  std::vector<Edge *> ignoreVec;  //Ignore when trying to simplify
-  std::map<Vertex*,vPair> childParentMap;
-  std::map<vPair,float> creaseMap;
-  
-
-  edgeshashtype edges;            //Hash table Pair<Vertex*,Vertex*> ---> Edge*
-  triangleshashtype triangles;    //Hash table of triangles
+  std::vector<Vec3f> vertex_positions;
+  std::vector<int> vertex_parents;  // 2 per vertex, -1 -1 for old vertices
+
+  std::vector<int> edge_vertex;     // 3 per triangle slot
+  std::vector<int> edge_opposite;
+  std::vector<float> edge_crease;
+  std::vector<int> free_triangles;  // slots of removed triangles
+  std::vector<int> triangle_sibling;  // green pairs, -1 (or past the end) if not
+  int num_triangles;
+
+  // the splits, coarse to fine: the mesh is the coarsest one with the
+  // first pm_applied of them applied.  their triangles' slots stay out
+  // of free_triangles while they are collapsed.
+  std::deque<VertexSplit> pm_splits;
+  int pm_applied;
+  ProgressiveMeshReader pm_stream;  // more splits still to come in a .pm
+
+  edgeshashtype edges;            //Hash table (start,end) ---> half-edge
+  bool edge_table_stale;          //edges needs rebuilding before use
   BoundingBox bbox;               //bbox?
-  vphashtype vertex_parents;      //List of parents of each vertex
 
   int sub_division_level;
-  int num_boundary_edges;
-  int num_crease_edges;
-  int num_other_edges;
+
+  // CPU copies of the VBOs, laid out by triangle slot (3 vertices or
+  // 3 half-edges each) and by vertex index, so an entry only changes
+  // when its own triangle or vertex does.  free slots hold degenerate
+  // triangles and edges, which draw nothing.
+  std::vector<VBOTriVert> vbo_tri_verts;
+  std::vector<VBOVert> vbo_verts;
+  std::vector<VBOEdge> vbo_boundary_edges;
+  std::vector<VBOEdge> vbo_crease_edges;
+  std::vector<VBOEdge> vbo_other_edges;
+  int vbo_num_slots;              // triangle slots drawn
+  int vbo_triangle_capacity;      // slots the GL buffers have room for
+  int vbo_vertex_capacity;
+  bool vbo_gouraud;               // the shading vbo_tri_verts was packed for
+  bool vbo_all_dirty;
+  std::vector<int> dirty_triangles;  // slots changed since setupVBOs
+  std::vector<int> dirty_vertices;   // vertices moved or added since
 
   GLuint mesh_tri_verts_VBO;
-  GLuint mesh_tri_indices_VBO;
   GLuint mesh_verts_VBO;
   GLuint mesh_boundary_edge_indices_VBO;
   GLuint mesh_crease_edge_indices_VBO;
@@ -0,0 +1,312 @@
+#include "glCanvas.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#endif
+
+#include "argparser.h"
+#include "mesh.h"
+
+// =========================================
+// Headless timing of the mesh operations on the bundled models, one
+// CSV row per step:
+//
+//   model,operation,parameter,milliseconds,peak_rss_kb,triangles,vertices
+//
+//   load         Mesh::Load (parameter 0)
+//   pack         Mesh::packVBOs on the loaded mesh, what setupVBOs
+//                sends to GL (no window is opened)
+//   simplify     Simplification from the loaded mesh to parameter triangles
+//   subdivide    LoopSubdivision to level parameter
+//   pack         again on the level -levels mesh (parameter = the level)
+//
+// Each load, each simplification and the run of subdivisions are
+// done by a child process, so peak_rss_kb (the high-water mark of
+// resident memory after the step) belongs to that step and its load.
+// milliseconds is the best of -repeats runs.  Anything the mesh code
+// prints goes to stderr, stdout only gets the CSV.
+//
+//   mesh_benchmark [-levels 2] [-targets 0.5,0.1,0.01] [-repeats 3]
+//                  [-gouraud] [-path dir] [-output file.csv] [model ...]
+// =========================================
+
+// the bundled models run when none are named
+const char *DEFAULT_MODELS[] = {
+  "creased_cube", "icosahedron", "bunny_200", "fandisk2", "mechpart", "nascar",
+  "hypersheet", "teapot", "bunny_1k", "complex", "al", "trumpet", "bunny_40k", NULL
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsed_ms(Clock::time_point start) {
+  return std::chrono::duration<double,std::milli>(Clock::now() - start).count();
+}
+
+// the most resident memory the process has used so far, -1 if unknown
+long PeakResidentKB() {
+#ifdef _WIN32
+  return -1;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF,&usage) != 0) return -1;
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;  // bytes
+#else
+  return usage.ru_maxrss;         // kilobytes
+#endif
+#endif
+}
+
+// =========================================
+
+struct BenchmarkOptions {
+  std::vector<std::string> models;
+  std::string path;
+  int levels;
+  std::vector<double> targets;  // fractions of the loaded triangle count
+  int repeats;
+  bool gouraud;
+};
+
+class BenchmarkRunner {
+public:
+  BenchmarkRunner(const BenchmarkOptions &o, FILE *out_) : options(o), out(out_) {
+    args.gouraud = options.gouraud;
+  }
+
+  void RunModel(const std::string &model) {
+    std::string filename = options.path + "/" + model;
+    if (filename.find('.',filename.find_last_of("/\\")+1) == std::string::npos) filename += ".obj";
+
+    int num_loaded = 0;
+    InChild([&]() { return Load(model,filename); },num_loaded);
+    if (num_loaded == 0) {
+      std::cerr << "WARNING: skipping " << model << ", nothing loaded from " << filename << std::endl;
+      return;
+    }
+    for (unsigned int i = 0; i < options.targets.size(); i++) {
+      int target = (int)(options.targets[i] * num_loaded);
+      int unused;
+      InChild([&]() { Simplify(model,filename,target); return 0; },unused);
+    }
+    if (options.levels > 0) {
+      int unused;
+      InChild([&]() { Subdivide(model,filename); return 0; },unused);
+    }
+  }
+
+private:
+
+  // load & pack, returns the triangle count
+  int Load(const std::string &model, const std::string &filename) {
+    double load_ms = 0, pack_ms = 0;
+    int num_tris = 0, num_verts = 0;
+    for (int r = 0; r < options.repeats; r++) {
+      Mesh mesh(&args);
+      Clock::time_point start = Clock::now();
+      mesh.Load(filename);
+      double ms = elapsed_ms(start);
+      if (r == 0 || ms < load_ms) load_ms = ms;
+      num_tris = mesh.numTriangles();
+      num_verts = mesh.numVertices();
+      if (num_tris == 0) return 0;
+      start = Clock::now();
+      mesh.packVBOs();
+      ms = elapsed_ms(start);
+      if (r == 0 || ms < pack_ms) pack_ms = ms;
+    }
+    Row(model,"load",0,load_ms,num_tris,num_verts);
+    Row(model,"pack",0,pack_ms,num_tris,num_verts);
+    return num_tris;
+  }
+
+  void Simplify(const std::string &model, const std::string &filename, int target) {
+    double best = 0;
+    int num_tris = 0, num_verts = 0;
+    for (int r = 0; r < options.repeats; r++) {
+      Mesh mesh(&args);
+      mesh.Load(filename);
+      Clock::time_point start = Clock::now();
+      mesh.Simplification(target);
+      double ms = elapsed_ms(start);
+      if (r == 0 || ms < best) best = ms;
+      num_tris = mesh.numTriangles();
+      num_verts = mesh.numVertices();
+    }
+    Row(model,"simplify",target,best,num_tris,num_verts);
+  }
+
+  void Subdivide(const std::string &model, const std::string &filename) {
+    std::vector<double> best(options.levels+1,0);
+    std::vector<int> num_tris(options.levels+1), num_verts(options.levels+1);
+    std::vector<long> peak(options.levels+1);
+    for (int r = 0; r < options.repeats; r++) {
+      Mesh mesh(&args);
+      mesh.Load(filename);
+      for (int level = 1; level <= options.levels; level++) {
+        Clock::time_point start = Clock::now();
+        mesh.LoopSubdivision();
+        double ms = elapsed_ms(start);
+        if (r == 0 || ms < best[level-1]) best[level-1] = ms;
+        num_tris[level-1] = mesh.numTriangles();
+        num_verts[level-1] = mesh.numVertices();
+        peak[level-1] = PeakResidentKB();
+      }
+      Clock::time_point start = Clock::now();
+      mesh.packVBOs();
+      double ms = elapsed_ms(start);
+      if (r == 0 || ms < best[options.levels]) best[options.levels] = ms;
+      num_tris[options.levels] = mesh.numTriangles();
+      num_verts[options.levels] = mesh.numVertices();
+      peak[options.levels] = PeakResidentKB();
+    }
+    for (int level = 1; level <= options.levels; level++)
+      Row(model,"subdivide",level,best[level-1],num_tris[level-1],num_verts[level-1],peak[level-1]);
+    Row(model,"pack",options.levels,best[options.levels],num_tris[options.levels],
+        num_verts[options.levels],peak[options.levels]);
+  }
+
+  void Row(const std::string &model, const char *operation, int parameter, double ms,
+           int num_tris, int num_verts, long peak_kb = -2) {
+    if (peak_kb == -2) peak_kb = PeakResidentKB();
+    fprintf(out,"%s,%s,%d,%.3f,%ld,%d,%d\n",model.c_str(),operation,parameter,ms,
+            peak_kb,num_tris,num_verts);
+    fflush(out);
+  }
+
+  // runs fn in a child process (so its memory is measured from a fresh
+  // start and handed back), result gets what fn returns
+  template <class F>
+  void InChild(const F &fn, int &result) {
+#ifdef _WIN32
+    result = fn();
+#else
+    // nothing buffered may be written twice
+    fflush(out);
+    std::cout.flush();
+    fflush(stdout);
+    int fds[2];
+    if (pipe(fds) != 0) {
+      result = fn();
+      return;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(fds[0]);
+      int r = fn();
+      std::cout.flush();
+      fflush(stdout);
+      if (write(fds[1],&r,sizeof(r)) != sizeof(r)) _exit(1);
+      _exit(0);
+    }
+    close(fds[1]);
+    if (pid < 0) {
+      close(fds[0]);
+      result = fn();
+      return;
+    }
+    result = 0;
+    if (read(fds[0],&result,sizeof(result)) != sizeof(result)) {
+      std::cerr << "ERROR! a benchmark step crashed" << std::endl;
+      result = 0;
+    }
+    close(fds[0]);
+    int status;
+    waitpid(pid,&status,0);
+#endif
+  }
+
+  // ==============
+  // REPRESENTATION
+  const BenchmarkOptions &options;
+  FILE *out;
+  ArgParser args;
+};
+
+// =========================================
+
+int main(int argc, char *argv[]) {
+  BenchmarkOptions options;
+  options.path = ".";
+  options.levels = 2;
+  options.repeats = 3;
+  options.gouraud = false;
+  options.targets.push_back(0.5);
+  options.targets.push_back(0.1);
+  options.targets.push_back(0.01);
+  std::string output_file;
+
+  for (int i = 1; i < argc; i++) {
+    if (argv[i] == std::string("-levels")) {
+      i++; assert (i < argc);
+      options.levels = atoi(argv[i]);
+    } else if (argv[i] == std::string("-targets")) {
+      i++; assert (i < argc);
+      options.targets.clear();
+      std::stringstream ss(argv[i]);
+      std::string token;
+      while (std::getline(ss,token,',')) options.targets.push_back(atof(token.c_str()));
+    } else if (argv[i] == std::string("-repeats")) {
+      i++; assert (i < argc);
+      options.repeats = atoi(argv[i]);
+    } else if (argv[i] == std::string("-gouraud")) {
+      options.gouraud = true;
+    } else if (argv[i] == std::string("-path")) {
+      i++; assert (i < argc);
+      options.path = argv[i];
+    } else if (argv[i] == std::string("-output")) {
+      i++; assert (i < argc);
+      output_file = argv[i];
+    } else if (argv[i][0] == '-') {
+      std::cerr << "usage: " << argv[0] << " [-levels n] [-targets f,f,...] [-repeats n] [-gouraud]"
+                << " [-path dir] [-output file.csv] [model ...]" << std::endl;
+      return 1;
+    } else {
+      options.models.push_back(argv[i]);
+    }
+  }
+  if (options.repeats < 1) options.repeats = 1;
+  if (options.levels < 0) options.levels = 0;
+  if (options.models.empty()) {
+    for (int i = 0; DEFAULT_MODELS[i] != NULL; i++) options.models.push_back(DEFAULT_MODELS[i]);
+  }
+
+  FILE *out;
+  if (!output_file.empty()) {
+    out = fopen(output_file.c_str(),"w");
+    if (out == NULL) {
+      std::cerr << "ERROR! cannot open " << output_file << " for writing" << std::endl;
+      return 1;
+    }
+  } else {
+    out = stdout;
+#ifndef _WIN32
+    // keep stdout for the CSV, everything else (printf & std::cout in
+    // the mesh code) goes to stderr
+    out = fdopen(dup(1),"w");
+    dup2(2,1);
+#endif
+  }
+
+  fprintf(out,"model,operation,parameter,milliseconds,peak_rss_kb,triangles,vertices\n");
+  BenchmarkRunner runner(options,out);
+  for (unsigned int i = 0; i < options.models.size(); i++) {
+    if (!output_file.empty()) std::cerr << options.models[i] << std::endl;
+    runner.RunModel(options.models[i]);
+  }
+  fclose(out);
+  return 0;
+}
+
+// =========================================
+// =========================================
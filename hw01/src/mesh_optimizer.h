@@ -0,0 +1,41 @@
+#ifndef _MESH_OPTIMIZER_H_
+#define _MESH_OPTIMIZER_H_
+
+#include <vector>
+
+// the LRU cache Forsyth's scores model
+#define VERTEX_CACHE_SIZE 32
+// the FIFO ComputeACMR is usually asked about, a typical post-transform cache
+#define ACMR_FIFO_SIZE 16
+
+// ====================================================================
+// ====================================================================
+// Draw order for indexed triangle lists, 3 indices per triangle.
+//
+//  - OptimizeVertexCache orders the triangles so consecutive ones
+//    share vertices (Forsyth, "Linear-Speed Vertex Cache Optimisation"):
+//    each vertex is scored by its place in a simulated LRU cache and by
+//    how few triangles it has left, and the best scoring triangle
+//    around the cache goes next
+//  - OptimizeVertexFetch then numbers the vertices in the order that
+//    triangle order first uses them, so the vertex data is read front
+//    to back
+//  - ComputeACMR is the average cache miss ratio: vertices transformed
+//    per triangle through a FIFO cache (3 is no reuse at all, a closed
+//    mesh can get close to 0.5)
+
+// order[i] = the triangle (index into indices/3) to draw i-th
+void OptimizeVertexCache(const std::vector<unsigned int> &indices, int num_vertices,
+                         std::vector<int> &order);
+
+// rewrites indices with the new vertex numbers, remap[old] = new or -1
+// if nothing uses it.  returns the number of vertices used.
+int OptimizeVertexFetch(std::vector<unsigned int> &indices, int num_vertices,
+                        std::vector<int> &remap);
+
+double ComputeACMR(const std::vector<unsigned int> &indices, int num_vertices, int cache_size);
+
+// ====================================================================
+// ====================================================================
+
+#endif
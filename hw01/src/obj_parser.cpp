@@ -0,0 +1,274 @@
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <thread>
+
+#include "obj_parser.h"
+#include "mapped_file.h"
+
+// don't bother spinning up threads for less than this much text
+#define OBJ_MIN_CHUNK_BYTES (1 << 20)
+
+// ====================================================================
+// ====================================================================
+// hand written scanners, they never read past 'end'
+
+static inline bool IsBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+static inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+static inline const char* SkipBlanks(const char *p, const char *end) {
+  while (p < end && IsBlank(*p)) p++;
+  return p;
+}
+
+static inline const char* SkipLine(const char *p, const char *end) {
+  const char *nl = (const char*)memchr(p,'\n',end-p);
+  return nl ? nl+1 : end;
+}
+
+static const char* ScanInt(const char *p, const char *end, int &value, bool &ok) {
+  p = SkipBlanks(p,end);
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) { negative = (*p == '-'); p++; }
+  if (p == end || !IsDigit(*p)) { ok = false; return p; }
+  int v = 0;
+  while (p < end && IsDigit(*p)) { v = 10*v + (*p - '0'); p++; }
+  value = negative ? -v : v;
+  ok = true;
+  return p;
+}
+
+static const double obj_powers_of_ten[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+static double ScalePow10(double v, int exp) {
+  // 10^0..10^22 are exact as doubles
+  while (exp > 22) { v *= 1e22; exp -= 22; }
+  while (exp < -22) { v /= 1e22; exp += 22; }
+  return exp >= 0 ? v * obj_powers_of_ten[exp] : v / obj_powers_of_ten[-exp];
+}
+
+static const char* ScanFloat(const char *p, const char *end, float &value, bool &ok) {
+  p = SkipBlanks(p,end);
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) { negative = (*p == '-'); p++; }
+  if (p < end && (*p == 'i' || *p == 'I')) {
+    // inf or infinity
+    if (end-p >= 3 && !strncmp(p+1,"nf",2)) {
+      p += 3;
+      while (p < end && !IsBlank(*p) && *p != '\n') p++;
+      value = negative ? -HUGE_VALF : HUGE_VALF;
+      ok = true;
+      return p;
+    }
+    ok = false;
+    return p;
+  }
+  unsigned long long mantissa = 0;
+  int digits = 0, exp = 0;
+  bool any = false;
+  while (p < end && IsDigit(*p)) {
+    // keep 18 significant digits, more can't change a float
+    if (digits < 18) { mantissa = 10*mantissa + (*p - '0'); if (mantissa) digits++; }
+    else exp++;
+    p++; any = true;
+  }
+  if (p < end && *p == '.') {
+    p++;
+    while (p < end && IsDigit(*p)) {
+      if (digits < 18) { mantissa = 10*mantissa + (*p - '0'); if (mantissa) digits++; exp--; }
+      p++; any = true;
+    }
+  }
+  if (!any) { ok = false; return p; }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    int e;
+    bool eok;
+    const char *q = ScanInt(p+1,end,e,eok);
+    if (eok && q > p+1 && !IsBlank(p[1])) { exp += e; p = q; }
+  }
+  double v = ScalePow10((double)mantissa,exp);
+  value = (float)(negative ? -v : v);
+  ok = true;
+  return p;
+}
+
+// ====================================================================
+// ====================================================================
+// one slice of the file, parsed independently
+
+struct ObjChunk {
+  const char *begin;
+  const char *end;
+  std::vector<float> positions;
+  std::vector<int> triangles;
+  // entries of triangles[] that came from negative (relative) indices
+  // and still need this chunk's global vertex offset added
+  std::vector<int> relative;
+  std::vector<ObjCrease> creases;
+  int skipped;
+};
+
+static void ParseChunk(ObjChunk *chunk) {
+  const char *p = chunk->begin;
+  const char *end = chunk->end;
+  chunk->skipped = 0;
+  // rough guess: 30 bytes per line, split between v and f lines
+  chunk->positions.reserve((end-p)/30);
+  chunk->triangles.reserve((end-p)/30);
+  std::vector<int> poly;
+  std::vector<bool> poly_relative;
+
+  while (p < end) {
+    p = SkipBlanks(p,end);
+    if (p == end) break;
+    const char *line_end = SkipLine(p,end);
+    char c = *p;
+    char c1 = (p+1 < line_end) ? p[1] : '\n';
+    bool ok = true;
+
+    if (c == '\n' || c == '#') {
+      // blank line or comment
+    } else if (c == 'v' && IsBlank(c1)) {
+      float x = 0, y = 0, z = 0;
+      const char *q = p+1;
+      q = ScanFloat(q,line_end,x,ok);
+      if (ok) q = ScanFloat(q,line_end,y,ok);
+      if (ok) q = ScanFloat(q,line_end,z,ok);
+      if (ok) {
+        chunk->positions.push_back(x);
+        chunk->positions.push_back(y);
+        chunk->positions.push_back(z);
+      }
+    } else if (c == 'f' && IsBlank(c1)) {
+      poly.clear();
+      poly_relative.clear();
+      int local_verts = chunk->positions.size() / 3;
+      const char *q = p+1;
+      while (ok) {
+        q = SkipBlanks(q,line_end);
+        if (q == line_end || *q == '\n') break;
+        int idx;
+        q = ScanInt(q,line_end,idx,ok);
+        if (!ok || idx == 0) { ok = false; break; }
+        // skip /vt/vn
+        while (q < line_end && *q == '/') {
+          q++;
+          while (q < line_end && (IsDigit(*q) || *q == '-')) q++;
+        }
+        if (idx > 0) {
+          poly.push_back(idx-1);
+          poly_relative.push_back(false);
+        } else {
+          poly.push_back(local_verts + idx);
+          poly_relative.push_back(true);
+        }
+      }
+      if (ok && poly.size() < 3) ok = false;
+      if (ok) {
+        for (unsigned int i = 1; i+1 < poly.size(); i++) {
+          unsigned int corner[3] = { 0, i, i+1 };
+          for (int k = 0; k < 3; k++) {
+            if (poly_relative[corner[k]]) chunk->relative.push_back(chunk->triangles.size());
+            chunk->triangles.push_back(poly[corner[k]]);
+          }
+        }
+      }
+    } else if (c == 'e' && IsBlank(c1)) {
+      ObjCrease crease;
+      const char *q = p+1;
+      q = ScanInt(q,line_end,crease.a,ok);
+      if (ok) q = ScanInt(q,line_end,crease.b,ok);
+      if (ok) q = ScanFloat(q,line_end,crease.weight,ok);
+      if (ok) chunk->creases.push_back(crease);
+    } else if ((c == 'v' && (c1 == 't' || c1 == 'n' || c1 == 'p')) ||
+               ((c == 'g' || c == 'o' || c == 's') && (IsBlank(c1) || c1 == '\n')) ||
+               (line_end-p >= 6 && !strncmp(p,"usemtl",6)) ||
+               (line_end-p >= 6 && !strncmp(p,"mtllib",6))) {
+      // not used by the mesh assignments
+    } else {
+      ok = false;
+    }
+    if (!ok) chunk->skipped++;
+    p = line_end;
+  }
+}
+
+// ====================================================================
+// ====================================================================
+
+bool LoadObj(const std::string &filename, ObjData &data, int num_threads) {
+  MappedFile file;
+  if (!file.Open(filename)) return false;
+
+  const char *begin = file.data;
+  const char *end = file.data + file.size;
+
+  if (num_threads <= 0) {
+    num_threads = std::thread::hardware_concurrency();
+    if (num_threads <= 0) num_threads = 1;
+  }
+  int max_chunks = file.size / OBJ_MIN_CHUNK_BYTES;
+  if (num_threads > max_chunks) num_threads = max_chunks;
+  if (num_threads < 1) num_threads = 1;
+
+  // split at line boundaries
+  std::vector<ObjChunk> chunks(num_threads);
+  const char *p = begin;
+  for (int i = 0; i < num_threads; i++) {
+    chunks[i].begin = p;
+    if (i == num_threads-1) {
+      p = end;
+    } else {
+      const char *target = begin + (file.size * (i+1)) / num_threads;
+      if (target < p) target = p;
+      p = (target < end) ? SkipLine(target,end) : end;
+    }
+    chunks[i].end = p;
+  }
+
+  if (num_threads == 1) {
+    ParseChunk(&chunks[0]);
+  } else {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++) threads.push_back(std::thread(ParseChunk,&chunks[i]));
+    for (int i = 0; i < num_threads; i++) threads[i].join();
+  }
+
+  // stitch together, sizing the output exactly once
+  size_t num_positions = 0, num_indices = 0, num_creases = 0;
+  for (int i = 0; i < num_threads; i++) {
+    num_positions += chunks[i].positions.size();
+    num_indices += chunks[i].triangles.size();
+    num_creases += chunks[i].creases.size();
+  }
+  data.positions.resize(num_positions);
+  data.triangles.resize(num_indices);
+  data.creases.resize(num_creases);
+  data.num_skipped_lines = 0;
+
+  size_t pos_offset = 0, tri_offset = 0, crease_offset = 0;
+  for (int i = 0; i < num_threads; i++) {
+    ObjChunk &chunk = chunks[i];
+    int vertex_offset = pos_offset / 3;
+    for (unsigned int j = 0; j < chunk.relative.size(); j++) {
+      chunk.triangles[chunk.relative[j]] += vertex_offset;
+    }
+    if (!chunk.positions.empty())
+      memcpy(&data.positions[pos_offset],&chunk.positions[0],chunk.positions.size()*sizeof(float));
+    if (!chunk.triangles.empty())
+      memcpy(&data.triangles[tri_offset],&chunk.triangles[0],chunk.triangles.size()*sizeof(int));
+    for (unsigned int j = 0; j < chunk.creases.size(); j++) {
+      data.creases[crease_offset+j] = chunk.creases[j];
+    }
+    pos_offset += chunk.positions.size();
+    tri_offset += chunk.triangles.size();
+    crease_offset += chunk.creases.size();
+    data.num_skipped_lines += chunk.skipped;
+  }
+  return true;
+}
+
+// ====================================================================
+// ====================================================================
@@ -0,0 +1,46 @@
+#ifndef _OBJ_PARSER_H_
+#define _OBJ_PARSER_H_
+
+#include <string>
+#include <vector>
+
+// ====================================================================
+// ====================================================================
+// Fast reader for the triangle .obj files used by the mesh
+// assignments.  The file is memory mapped, split into chunks at line
+// boundaries and each chunk is parsed on its own thread with a hand
+// written number scanner (no iostreams, no per-line allocation).  The
+// chunks are then stitched together, in order, into flat pre-sized
+// arrays that the Mesh can walk once to build its half-edge structure.
+//
+// Understood:  v x y z [w]       vertex position
+//              f a b c ...       polygon, fan triangulated; a/b/c and
+//                                negative (relative) indices accepted
+//              e a b weight      crease, indices exactly as written
+//                                ("inf" is an infinitely sharp crease)
+// Ignored:     vt vn vp g o s usemtl mtllib #comments
+
+struct ObjCrease {
+  int a, b;
+  float weight;
+};
+
+class ObjData {
+public:
+  ObjData() : num_skipped_lines(0) {}
+
+  int numVertices() const { return positions.size() / 3; }
+  int numTriangles() const { return triangles.size() / 3; }
+
+  // ==============
+  // REPRESENTATION
+  std::vector<float> positions;    // x,y,z per vertex
+  std::vector<int> triangles;      // 3 zero-based vertex indices per triangle
+  std::vector<ObjCrease> creases;
+  int num_skipped_lines;           // unrecognized or malformed lines
+};
+
+// num_threads <= 0 picks one thread per core (small files use one)
+bool LoadObj(const std::string &filename, ObjData &data, int num_threads = 0);
+
+#endif
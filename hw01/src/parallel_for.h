@@ -0,0 +1,55 @@
+#ifndef _PARALLEL_FOR_H_
+#define _PARALLEL_FOR_H_
+
+#include <thread>
+#include <vector>
+
+// don't bother spinning up threads for fewer items than this per thread
+#define PARALLEL_MIN_CHUNK 8192
+
+// ====================================================================
+// ====================================================================
+// Static fork/join over an index range.  [0,n) is cut into num_chunks
+// contiguous pieces, chunk i covering [n*i/num_chunks, n*(i+1)/num_chunks),
+// and each runs on its own thread (the first on the calling thread).
+// The split only depends on n and num_chunks, so a pass can count per
+// chunk, the caller prefix sums the counts, and a second pass over the
+// same chunks writes at those offsets.
+
+inline int ParallelChunkCount(int n) {
+  int num_threads = std::thread::hardware_concurrency();
+  if (num_threads < 1) num_threads = 1;
+  int max_chunks = n / PARALLEL_MIN_CHUNK;
+  if (num_threads > max_chunks) num_threads = max_chunks;
+  if (num_threads < 1) num_threads = 1;
+  return num_threads;
+}
+
+// fn(begin,end,chunk)
+template <class F>
+void ParallelForChunks(int n, int num_chunks, const F &fn) {
+  if (num_chunks <= 1) {
+    fn(0,n,0);
+    return;
+  }
+  std::vector<std::thread> threads;
+  threads.reserve(num_chunks-1);
+  for (int i = 1; i < num_chunks; i++) {
+    int begin = (int)(((long long)n * i) / num_chunks);
+    int end = (int)(((long long)n * (i+1)) / num_chunks);
+    threads.push_back(std::thread(fn,begin,end,i));
+  }
+  fn(0,(int)((long long)n / num_chunks),0);
+  for (unsigned int i = 0; i < threads.size(); i++) threads[i].join();
+}
+
+// fn(begin,end)
+template <class F>
+void ParallelFor(int n, const F &fn) {
+  ParallelForChunks(n,ParallelChunkCount(n),[&fn](int begin, int end, int) { fn(begin,end); });
+}
+
+// ====================================================================
+// ====================================================================
+
+#endif
@@ -0,0 +1,151 @@
+#include <cstring>
+#include <cassert>
+#include <iostream>
+
+#include "progressive_mesh.h"
+
+// ====================================================================
+// ====================================================================
+// READING
+
+bool ProgressiveMeshReader::Open(const std::string &filename, ProgressiveMeshHeader &header,
+                                 std::vector<ProgressiveMeshVertex> &vertices,
+                                 std::vector<ProgressiveMeshTriangle> &triangles) {
+  Close();
+  file = fopen(filename.c_str(),"rb");
+  if (file == NULL) return false;
+  if (fread(&header,sizeof(header),1,file) != 1 ||
+      strncmp(header.magic,PROGRESSIVE_MESH_MAGIC,4) != 0) {
+    std::cerr << "ERROR! " << filename << " is not a progressive mesh" << std::endl;
+    Close();
+    return false;
+  }
+  if (header.version != PROGRESSIVE_MESH_VERSION || header.byte_order != PROGRESSIVE_MESH_BYTE_ORDER ||
+      header.header_bytes != sizeof(ProgressiveMeshHeader)) {
+    std::cerr << "ERROR! " << filename << " was written by a different version or machine" << std::endl;
+    Close();
+    return false;
+  }
+  vertices.resize(header.num_base_vertices);
+  triangles.resize(header.num_base_triangles);
+  bool ok = true;
+  if (!vertices.empty())
+    ok = fread(&vertices[0],sizeof(ProgressiveMeshVertex),vertices.size(),file) == vertices.size();
+  if (ok && !triangles.empty())
+    ok = fread(&triangles[0],sizeof(ProgressiveMeshTriangle),triangles.size(),file) == triangles.size();
+  if (!ok) {
+    std::cerr << "ERROR! " << filename << " is truncated before the end of the base mesh" << std::endl;
+    Close();
+    return false;
+  }
+  num_splits = header.num_splits;
+  num_read = 0;
+  // nothing more to read
+  if (num_splits == 0) Close();
+  return true;
+}
+
+
+bool ProgressiveMeshReader::ReadSplit(VertexSplit &split) {
+  if (file == NULL) return false;
+  if (num_read == num_splits) {
+    Close();
+    return false;
+  }
+  long start = ftell(file);
+  ProgressiveMeshSplit s;
+  float creases[5] = { 0, 0, 0, 0, 0 };
+  bool ok = fread(&s,sizeof(s),1,file) == 1;
+  if (ok && (s.flags & PM_SPLIT_CREASED)) ok = fread(creases,sizeof(float),5,file) == 5;
+  if (!ok) {
+    // not all here yet, try again from the same place next time
+    clearerr(file);
+    fseek(file,start,SEEK_SET);
+    return false;
+  }
+  num_read++;
+  if (num_read == num_splits) Close();
+  split.dead = s.dead;
+  split.keep = s.keep;
+  split.left = s.left;
+  split.right = s.right;
+  split.edge = s.edge;
+  split.opposite_edge = s.opposite_edge;
+  for (int i = 0; i < 4; i++) split.outer[i] = s.outer[i];
+  for (int i = 0; i < 5; i++) split.crease[i] = creases[i];
+  split.fan_back = s.fan_back;
+  split.fan_forward = s.fan_forward;
+  split.dead_pos = Vec3f(s.dead_pos[0],s.dead_pos[1],s.dead_pos[2]);
+  split.keep_pos = Vec3f(s.keep_pos[0],s.keep_pos[1],s.keep_pos[2]);
+  // only known once the split has been applied
+  split.collapsed_pos = Vec3f(0,0,0);
+  return true;
+}
+
+
+void ProgressiveMeshReader::Close() {
+  if (file != NULL) fclose(file);
+  file = NULL;
+}
+
+
+bool IsProgressiveMeshFile(const std::string &filename) {
+  std::string ext = PROGRESSIVE_MESH_EXTENSION;
+  return filename.size() > ext.size() &&
+    filename.compare(filename.size()-ext.size(),ext.size(),ext) == 0;
+}
+
+// ====================================================================
+// ====================================================================
+// WRITING
+
+bool WriteProgressiveMesh(const std::string &filename, const ProgressiveMeshHeader &header,
+                          const std::vector<ProgressiveMeshVertex> &vertices,
+                          const std::vector<ProgressiveMeshTriangle> &triangles,
+                          const std::deque<VertexSplit> &splits) {
+  assert (header.num_base_vertices == vertices.size());
+  assert (header.num_base_triangles == triangles.size());
+  assert (header.num_splits == splits.size());
+  FILE *file = fopen(filename.c_str(),"wb");
+  if (file == NULL) {
+    std::cerr << "ERROR! cannot open " << filename << " for writing" << std::endl;
+    return false;
+  }
+  bool ok = fwrite(&header,sizeof(header),1,file) == 1;
+  if (ok && !vertices.empty())
+    ok = fwrite(&vertices[0],sizeof(ProgressiveMeshVertex),vertices.size(),file) == vertices.size();
+  if (ok && !triangles.empty())
+    ok = fwrite(&triangles[0],sizeof(ProgressiveMeshTriangle),triangles.size(),file) == triangles.size();
+  for (unsigned int i = 0; ok && i < splits.size(); i++) {
+    const VertexSplit &split = splits[i];
+    ProgressiveMeshSplit s;
+    memset(&s,0,sizeof(s));
+    s.dead = split.dead;
+    s.keep = split.keep;
+    s.left = split.left;
+    s.right = split.right;
+    s.edge = split.edge;
+    s.opposite_edge = split.opposite_edge;
+    for (int j = 0; j < 4; j++) s.outer[j] = split.outer[j];
+    s.fan_back = split.fan_back;
+    s.fan_forward = split.fan_forward;
+    for (int j = 0; j < 3; j++) {
+      s.dead_pos[j] = split.dead_pos[j];
+      s.keep_pos[j] = split.keep_pos[j];
+    }
+    bool creased = false;
+    for (int j = 0; j < 5; j++) creased |= (split.crease[j] != 0);
+    if (creased) s.flags |= PM_SPLIT_CREASED;
+    ok = fwrite(&s,sizeof(s),1,file) == 1;
+    if (ok && creased) ok = fwrite(split.crease,sizeof(float),5,file) == 5;
+  }
+  if (fclose(file) != 0) ok = false;
+  if (!ok) {
+    std::cerr << "ERROR! failed writing " << filename << std::endl;
+    remove(filename.c_str());
+  }
+  return ok;
+}
+
+// ====================================================================
+// ====================================================================
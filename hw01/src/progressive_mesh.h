@@ -0,0 +1,135 @@
+#ifndef _PROGRESSIVE_MESH_H_
+#define _PROGRESSIVE_MESH_H_
+
+#include <cstdio>
+#include <cassert>
+#include <deque>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "vectors.h"
+
+// ====================================================================
+// ====================================================================
+// Progressive mesh (Hoppe '96).  Every edge collapse Mesh::Simplification
+// makes is kept as the vertex split that undoes it, so the mesh can be
+// refined and coarsened again a split at a time.  Collapses never
+// renumber vertices or triangle slots, so a record names them directly:
+// a split puts its two triangles back in the slots they came from and
+// every record after it still applies.
+
+struct VertexSplit {
+  int dead;            // the vertex the split brings back
+  int keep;            // the vertex it comes out of
+  int left, right;     // the far corners of the two triangles
+  int edge;            // dead->keep, in the first triangle (edge/3)
+  int opposite_edge;   // keep->dead, in the second
+  // the opposites (-1 on a boundary) of the other two half-edges of
+  // each triangle: next & prev of edge, then of opposite_edge
+  int outer[4];
+  float crease[5];     // of edge, then of the 4 half-edges above
+  // dead's other outgoing half-edges, walked around dead from edge,
+  // backwards then (if the fan is open) forwards.  see Mesh::applyVertexSplit
+  int fan_back, fan_forward;
+  Vec3f dead_pos;
+  Vec3f keep_pos;      // before the collapse
+  Vec3f collapsed_pos; // of keep after it
+};
+
+// ====================================================================
+// ====================================================================
+// The .pm stream: the coarsest mesh, then the splits coarse to fine.
+//
+// Layout (native byte order):
+//   ProgressiveMeshHeader
+//   ProgressiveMeshVertex    base_vertices[num_base_vertices]
+//   ProgressiveMeshTriangle  base_triangles[num_base_triangles]
+//   num_splits times:
+//     ProgressiveMeshSplit
+//     float creases[5]       only if PM_SPLIT_CREASED is set
+//
+// A file that stops early (still being written or downloaded) is
+// read as far as it goes, the reader can be asked again later.
+
+#define PROGRESSIVE_MESH_MAGIC "PMSH"
+#define PROGRESSIVE_MESH_VERSION 1
+#define PROGRESSIVE_MESH_BYTE_ORDER 0x01020304
+#define PROGRESSIVE_MESH_EXTENSION ".pm"
+
+#define PM_SPLIT_CREASED 1
+
+struct ProgressiveMeshHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t header_bytes;
+  uint32_t num_vertices;         // at full detail
+  uint32_t num_triangle_slots;   // at full detail
+  uint32_t num_base_vertices;
+  uint32_t num_base_triangles;
+  uint32_t num_splits;
+  uint32_t reserved;
+};
+
+struct ProgressiveMeshVertex {
+  int32_t index;
+  float pos[3];
+};
+
+struct ProgressiveMeshTriangle {
+  int32_t slot;
+  int32_t verts[3];
+  int32_t opposites[3];
+  float creases[3];
+};
+
+struct ProgressiveMeshSplit {
+  int32_t dead, keep, left, right;
+  int32_t edge, opposite_edge;
+  int32_t outer[4];
+  uint16_t fan_back, fan_forward;
+  uint32_t flags;
+  float dead_pos[3];
+  float keep_pos[3];
+};
+
+// ====================================================================
+
+class ProgressiveMeshReader {
+public:
+  ProgressiveMeshReader() : file(NULL), num_splits(0), num_read(0) {}
+  ~ProgressiveMeshReader() { Close(); }
+
+  // reads the header and the base mesh, the splits are read on demand
+  bool Open(const std::string &filename, ProgressiveMeshHeader &header,
+            std::vector<ProgressiveMeshVertex> &vertices,
+            std::vector<ProgressiveMeshTriangle> &triangles);
+  // the next split.  false if there are no more, or none that have
+  // fully arrived yet (the file stays open for another try)
+  bool ReadSplit(VertexSplit &split);
+  bool isOpen() const { return file != NULL; }
+  void Close();
+
+private:
+  // don't copy the open file
+  ProgressiveMeshReader(const ProgressiveMeshReader &) { assert(0); }
+  const ProgressiveMeshReader& operator=(const ProgressiveMeshReader &) { assert(0); return *this; }
+
+  // ==============
+  // REPRESENTATION
+  FILE *file;
+  uint32_t num_splits;
+  uint32_t num_read;
+};
+
+// true if the filename ends in PROGRESSIVE_MESH_EXTENSION
+bool IsProgressiveMeshFile(const std::string &filename);
+
+// writes the base mesh and splits, coarse to fine
+bool WriteProgressiveMesh(const std::string &filename, const ProgressiveMeshHeader &header,
+                          const std::vector<ProgressiveMeshVertex> &vertices,
+                          const std::vector<ProgressiveMeshTriangle> &triangles,
+                          const std::deque<VertexSplit> &splits);
+
+#endif
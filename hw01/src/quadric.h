@@ -0,0 +1,86 @@
+#ifndef _QUADRIC_H_
+#define _QUADRIC_H_
+
+#include <cmath>
+
+#include "vectors.h"
+
+// ====================================================================
+// ====================================================================
+// Garland & Heckbert error quadric: the sum of squared distances to a
+// set of planes, stored as the 10 unique entries of the symmetric 4x4
+// matrix Q = sum (n,d)(n,d)^T.  The error of placing a vertex at p is
+// [p 1] Q [p 1]^T.
+
+class Quadric {
+
+public:
+
+  // ========================
+  // CONSTRUCTORS
+  Quadric() { Clear(); }
+  // the plane n.p + d = 0 (n unit length), scaled by weight
+  Quadric(const Vec3f &n, double d, double weight) {
+    double a = n.x(), b = n.y(), c = n.z();
+    aa = weight*a*a; ab = weight*a*b; ac = weight*a*c; ad = weight*a*d;
+    bb = weight*b*b; bc = weight*b*c; bd = weight*b*d;
+    cc = weight*c*c; cd = weight*c*d;
+    dd = weight*d*d;
+  }
+
+  void Clear() {
+    aa = ab = ac = ad = bb = bc = bd = cc = cd = dd = 0;
+  }
+
+  Quadric& operator+=(const Quadric &q) {
+    aa += q.aa; ab += q.ab; ac += q.ac; ad += q.ad;
+    bb += q.bb; bc += q.bc; bd += q.bd;
+    cc += q.cc; cd += q.cd;
+    dd += q.dd;
+    return *this;
+  }
+  friend Quadric operator+(const Quadric &q1, const Quadric &q2) {
+    Quadric q = q1; q += q2; return q;
+  }
+
+  // =========
+  // ACCESSORS
+  double Evaluate(const Vec3f &p) const {
+    double x = p.x(), y = p.y(), z = p.z();
+    return x*(aa*x + 2*ab*y + 2*ac*z + 2*ad) +
+           y*(bb*y + 2*bc*z + 2*bd) +
+           z*(cc*z + 2*cd) + dd;
+  }
+
+  // the point of least error (solves the 3x3 system by Cramer's
+  // rule).  returns false, leaving p alone, if the system is close
+  // to singular (flat or cylindrical regions) and the minimum is not
+  // a single point.
+  bool Optimize(Vec3f &p) const {
+    double c00 = bb*cc - bc*bc;
+    double c01 = ac*bc - ab*cc;
+    double c02 = ab*bc - ac*bb;
+    double det = aa*c00 + ab*c01 + ac*c02;
+    double scale = aa + bb + cc;
+    if (std::fabs(det) <= 1e-10 * scale*scale*scale) return false;
+    double c11 = aa*cc - ac*ac;
+    double c12 = ab*ac - aa*bc;
+    double c22 = aa*bb - ab*ab;
+    double inv = -1.0 / det;
+    p = Vec3f(inv * (c00*ad + c01*bd + c02*cd),
+              inv * (c01*ad + c11*bd + c12*cd),
+              inv * (c02*ad + c12*bd + c22*cd));
+    return true;
+  }
+
+private:
+
+  // ==============
+  // REPRESENTATION
+  double aa, ab, ac, ad, bb, bc, bd, cc, cd, dd;
+};
+
+// ====================================================================
+// ====================================================================
+
+#endif
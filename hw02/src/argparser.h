@@ -33,6 +33,32 @@ public:
 	i++; assert (i < argc); 
 	timestep = atof(argv[i]);
         assert (timestep > 0);
+      } else if (argv[i] == std::string("-scalar")) {
+        simd = false;
+      } else if (argv[i] == std::string("-threads")) {
+        i++; assert (i < argc); 
+        threads = atoi(argv[i]);
+      } else if (argv[i] == std::string("-frames")) {
+        i++; assert (i < argc); 
+        frames = atoi(argv[i]);
+      } else if (argv[i] == std::string("-checkpoint")) {
+        i++; assert (i < argc); 
+        checkpoint_file = argv[i];
+      } else if (argv[i] == std::string("-resume")) {
+        i++; assert (i < argc); 
+        resume_file = argv[i];
+      } else if (argv[i] == std::string("-record")) {
+        i++; assert (i < argc); 
+        record_file = argv[i];
+      } else if (argv[i] == std::string("-playback")) {
+        i++; assert (i < argc); 
+        playback_file = argv[i];
+      } else if (argv[i] == std::string("-cfl")) {
+        i++; assert (i < argc); 
+        cfl = atof(argv[i]);
+        assert (cfl > 0);
+      } else if (argv[i] == std::string("-relax_pressure")) {
+        relax_pressure = true;
       } else {
 	printf ("whoops error with command line argument %d: '%s'\n",i,argv[i]);
 	assert(0);
@@ -67,6 +93,12 @@ public:
 
     gravity = Vec3f(0,-9.8,0);
 
+    simd = true;
+    threads = 0;
+    frames = 0;
+    cfl = 0.4;
+    relax_pressure = false;
+
     // uncomment for deterministic randomness
     // mtrand = MTRand(37);
     
@@ -97,6 +129,13 @@ public:
   // used by cloth
   bool force;
   bool wireframe;  
+  bool simd;       // AVX2 force & integration kernels (if the cpu has them)
+  int threads;     // 0 == all the hardware threads
+  int frames;      // > 0: no window, just time this many steps
+  std::string checkpoint_file;   // saved at the end of -frames & by 'k', loaded by 'l'
+  std::string resume_file;       // a checkpoint to start from
+  std::string record_file;       // a frame cache, every frame is added
+  std::string playback_file;     // a frame cache to show instead of simulating
 
   // used by fluid
   int face_velocity;
@@ -104,6 +143,8 @@ public:
   double isosurface;
   bool cubes;
   bool pressure;
+  double cfl;      // a sub step moves nothing further than this many cells
+  bool relax_pressure;   // the old relaxation sweeps instead of the pressure solve
 
   // default initialization
   MTRand mtrand;
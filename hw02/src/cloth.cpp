@@ -1,5 +1,6 @@
 #include "glCanvas.h"
 #include <fstream>
+#include <algorithm>
 #include <cmath>
 #include <math.h>       /* fabs */>
 #include "cloth.h"
@@ -9,19 +10,16 @@
 using std::vector;
 
 // ================================================================================
-// TODO: Implement improved timestep fix
-//       * Define a the limit as a weird jump in points after the first iteration.
-//       * Half the time step
 // TODO: Create new cloth case
 //       * Large cloth with the corner fixed, let hung but one
 // ================================================================================
 
-Cloth::Cloth(ArgParser *_args) {
+Cloth::Cloth(ArgParser *_args) : pool(_args->threads) {
   args =_args;
 
   // open the file
   std::ifstream istr(args->cloth_file.c_str());
-  assert (istr != NULL);
+  assert (istr.good());
   std::string token;
 
   // read in the simulation parameters
@@ -54,7 +52,7 @@ Cloth::Cloth(ArgParser *_args) {
   double area = AreaOfTriangle(a,b,c) + AreaOfTriangle(a,c,d);
 
   // create the particles
-  particles = new ClothParticle[nx*ny];
+  particles.resize(nx*ny);
   double mass = area*fabric_weight / double(nx*ny);
   for (int i = 0; i < nx; i++) {
     double x = i/double(nx-1);
@@ -62,364 +60,375 @@ Cloth::Cloth(ArgParser *_args) {
     Vec3f dc = (1-x)*d + x*c;
     for (int j = 0; j < ny; j++) {
       double y = j/double(ny-1);
-      ClothParticle &p = getParticle(i,j);
+      int p = getIndex(i,j);
       Vec3f abdc = (1-y)*ab + y*dc;
-      p.setOriginalPosition(abdc);
-      p.setPosition(abdc);
-      p.setVelocity(Vec3f(0,0,0));
-      p.setMass(mass);
-      p.setFixed(false);
+      particles.setOriginalPosition(p,abdc);
+      particles.setPosition(p,abdc);
+      particles.setVelocity(p,Vec3f(0,0,0));
+      particles.setMass(p,mass);
+      particles.setFixed(p,false);
     }
   }
 
-  // the fixed particles
+  // the fixed particles (& the optional integrator settings)
+  integrator = CLOTH_EXPLICIT;
+  step_tolerance = 0.01;
+  double thickness = -1;
   while (istr >> token) {
+    if (token == "integrator") {
+      // "explicit" (the default), "implicit" or "xpbd"
+      istr >> token;
+      if (token == "explicit") integrator = CLOTH_EXPLICIT;
+      else if (token == "implicit") integrator = CLOTH_IMPLICIT;
+      else if (token == "xpbd") integrator = CLOTH_XPBD;
+      else { std::cerr << "ERROR! unknown cloth integrator " << token << std::endl; assert(0); }
+      continue;
+    } else if (token == "cg_tolerance") {
+      double tolerance;
+      istr >> tolerance; assert (tolerance > 0);
+      implicit_solver.setTolerance(tolerance);
+      continue;
+    } else if (token == "cg_max_iterations") {
+      int iterations;
+      istr >> iterations; assert (iterations > 0);
+      implicit_solver.setMaxIterations(iterations);
+      continue;
+    } else if (token == "xpbd_iterations") {
+      int iterations;
+      istr >> iterations; assert (iterations > 0);
+      xpbd_solver.setIterations(iterations);
+      continue;
+    } else if (token == "step_tolerance") {
+      istr >> step_tolerance; assert (step_tolerance > 0);
+      continue;
+    } else if (token == "sphere") {
+      // center & radius
+      Vec3f center;
+      double radius;
+      istr >> center >> radius;
+      collider.addSphere(center,radius);
+      continue;
+    } else if (token == "plane") {
+      // a point on it & the normal, the cloth stays on the normal's side
+      Vec3f point, normal;
+      istr >> point >> normal;
+      collider.addPlane(point,normal);
+      continue;
+    } else if (token == "self_collision") {
+      collider.setSelfCollision(true);
+      continue;
+    } else if (token == "collision_thickness") {
+      istr >> thickness; assert (thickness > 0);
+      continue;
+    }
     assert (token == "f");
     int i,j;
     double x,y,z;
     istr >> i >> j >> x >> y >> z;
-    ClothParticle &p = getParticle(i,j);
-    p.setPosition(Vec3f(x,y,z));
-    p.setFixed(true);
+    int p = getIndex(i,j);
+    particles.setPosition(p,Vec3f(x,y,z));
+    particles.setFixed(p,true);
   }
 
   computeBoundingBox();
-  initializeVBOs();
-  setupVBOs();
+  setupSprings();
+  computeStableTimestep();
+  // (by default a quarter of the shortest spring apart)
+  collider.setThickness(thickness > 0 ? thickness : min_structural_length / 4.0);
+  collider.setup(nx,ny,min_structural_length);
+  timestep = args->timestep;
+  substeps = 0;
+  frame = 0;
+  time = 0;
+  if (integrator == CLOTH_XPBD)
+    xpbd_solver.setupConstraints(springs);
+  ClothUseSIMD(args->simd);
+  // carry on from a checkpoint, record from there
+  if (args->resume_file != "")
+    LoadCheckpoint(args->resume_file);
+  if (args->record_file != "" && recorder.Open(args->record_file,nx,ny,frame))
+    recorder.Write(frame,time,particles);
+  if (args->playback_file != "" && playback.Open(args->playback_file)) {
+    if (playback.getNX() == nx && playback.getNY() == ny) {
+      ShowFrame(playback.firstFrame());
+    } else {
+      std::cerr << "ERROR! the frame cache " << args->playback_file << " is of a " << playback.getNX()
+                << "x" << playback.getNY() << " cloth, not this " << nx << "x" << ny << std::endl;
+      playback.Close();
+    }
+  }
+  // (the VBOs are made by initializeVBOs, if there's a window)
+  cloth_verts_VBO = 0;
 }
 
 // ================================================================================
 
 void Cloth::computeBoundingBox() {
-  box = BoundingBox(getParticle(0,0).getPosition());
+  box = BoundingBox(getPosition(0,0));
   for (int i = 0; i < nx; i++) {
     for (int j = 0; j < ny; j++) {
-      box.Extend(getParticle(i,j).getPosition());
-      box.Extend(getParticle(i,j).getOriginalPosition());
+      box.Extend(getPosition(i,j));
+      box.Extend(getOriginalPosition(i,j));
     }
   }
+  // and the spheres it might land on
+  const vector<ClothSphere> &spheres = collider.getSpheres();
+  for (unsigned int s = 0; s < spheres.size(); s++) {
+    Vec3f r(spheres[s].radius,spheres[s].radius,spheres[s].radius);
+    box.Extend(spheres[s].center - r);
+    box.Extend(spheres[s].center + r);
+  }
 }
 
 // ================================================================================
 
-const vector<ClothParticle*> Cloth::getAdjParticles(int i, int j) {
-  // Input: Given an i,j index
-  // Output: This will return the adj (structural) particles in a vector
-
-  //Check if valid index
-  assert(0 <= i && i < nx);
-  assert(0 <= j && j < nx);
-
-  vector<ClothParticle*> adjPartVec;
-  ClothParticle * ptr = NULL; 
-
-  // Get left
-  if(j - 1 >= 0){
-    ptr = &getParticle(i,j-1);
-    adjPartVec.push_back(ptr);
-  }
-  // Get right
-  if(j + 1 < ny){
-    ptr = &getParticle(i,j+1);
-    adjPartVec.push_back(ptr);
-  }
-  // Get top
-  if(i - 1 >= 0){
-    ptr = &getParticle(i-1,j);
-    adjPartVec.push_back(ptr);
+void Cloth::setupSprings() {
+  MakeClothSprings(nx,ny,particles,k_structural,k_shear,k_bend,springs);
+  min_structural_length = springs[0].rest_length[0];
+  for (int set = 0; set < 2; set++) {
+    const vector<float> &rest = springs[set].rest_length;
+    for (unsigned int s = 0; s < rest.size(); s++)
+      min_structural_length = std::min(min_structural_length,(double)rest[s]);
   }
-  // Get bottom
-  if(i + 1 < nx){
-    ptr = &getParticle(i+1,j);
-    adjPartVec.push_back(ptr);
-  }
-
-  return  adjPartVec;
 }
 
-const vector<ClothParticle*> Cloth::getShearParticles(int i, int j) {
-  // Input: Given an i,j index
-  // Output: This will return the adj (Shear) particles in a vector
-
-  //Check if valid index
-  assert(0 <= i && i < nx);
-  assert(0 <= j && j < nx);
-
-  vector<ClothParticle*> shearPartVec;
-  ClothParticle * ptr = NULL; 
-
-  // Get upperLeft
-  if(i - 1 >= 0 && j - 1 >= 0){
-    ptr = &getParticle( i-1 , j-1);
-    shearPartVec.push_back(ptr);
-  }
-
-  // Get lowerRight
-  if(i + 1 < nx && j + 1 < ny){
-    ptr = &getParticle( i + 1 , j + 1);
-    shearPartVec.push_back(ptr);
+void Cloth::computeStableTimestep() {
+  // Symplectic Euler on a spring of stiffness k between masses is stable
+  // while dt < 2 / omega.  The stiffest mode of the whole cloth has
+  // omega^2 <= 2 max(sum of k at a particle / its mass) (Gershgorin), so
+  // below 0.9 sqrt(2 m / sum k) nothing blows up however the cloth moves.
+  vector<double> stiffness(nx*ny,0.0);
+  for (unsigned int set = 0; set < springs.size(); set++) {
+    const ClothSpringSet &s = springs[set];
+    for (int n = 0; n < s.numSprings(); n++) {
+      stiffness[s.startParticle(n)] += s.k;
+      stiffness[s.startParticle(n) + s.offset] += s.k;
+    }
   }
-
-  // Get upperRight
-  if(i - 1 >= 0 && j + 1 < ny){
-    ptr = &getParticle(i-1, j+1);
-    shearPartVec.push_back(ptr);
+  double max_ratio = 0;
+  for (int p = 0; p < nx*ny; p++) {
+    if (particles.isLoose(p))
+      max_ratio = std::max(max_ratio,stiffness[p] / particles.getMass(p));
   }
-
-  // Get lowerLeft
-  if(i + 1 < nx && j - 1 >= 0){
-    ptr = &getParticle(i+1,j-1);
-    shearPartVec.push_back(ptr);
-  }
-
-  return shearPartVec;
+  stable_timestep = (max_ratio > 0) ? 0.9 * sqrt(2 / max_ratio) : 1e10;
 }
 
 // ================================================================================
 
-const vector<ClothParticle*> Cloth::getFlexParticles(int i, int j) {
-
-  //Check if valid index
-  assert(0 <= i && i < nx);
-  assert(0 <= j && j < nx);
-
-  vector<ClothParticle*> flexPartVec;
-  ClothParticle * ptr = NULL; 
-
-  // Get top
-  if(i - 2 >= 0){
-    ptr = &getParticle(i-2,j);
-    flexPartVec.push_back(ptr);
-  }
-
-  // Get bot
-  if(i + 2 < nx){
-    ptr = &getParticle(i+2,j);
-    flexPartVec.push_back(ptr);
-  }
-
-
-  // Get left
-  if(j - 2 >= 0){
-    ptr = &getParticle( i  , j - 2);
-    flexPartVec.push_back(ptr);
+void Cloth::Animate() {
+  // play the cached frames over & over, or simulate
+  if (playback.isOpen()) {
+    int next = frame+1;
+    if (next >= playback.firstFrame() + playback.numFrames()) next = playback.firstFrame();
+    ShowFrame(next);
+  } else {
+    Step();
   }
+  // redo VBOs for rendering
+  setupVBOs();
+}
 
-  // Get right
-  if(j + 2 < ny ){
-    ptr = &getParticle( i  , j + 2);
-    flexPartVec.push_back(ptr);
+void Cloth::Step() {
+  // Implicit Euler & XPBD are stable at any step and take the frame
+  // whole, explicit Euler cuts it in sub steps
+  double remaining = args->timestep;
+  while (remaining > 0) {
+    ComputeForces();
+    double dt = (integrator == CLOTH_EXPLICIT) ? ChooseTimestep(remaining) : remaining;
+    SubStep(dt);
+    remaining -= dt;
+    time += dt;
+    timestep = dt;
+    substeps++;
   }
-
-  return flexPartVec;
+  frame++;
+  if (recorder.isOpen())
+    recorder.Write(frame,time,particles);
 }
 
-// ================================================================================
-
-const Vec3f Cloth::getSpringForce(ClothParticle* a, ClothParticle* b) {
-
-  //TODO Calc spring const between these two
-  Vec3f aOrginalPos = a->getOriginalPosition();
-  Vec3f bOrginalPos = b->getOriginalPosition();
-  double restLength = aOrginalPos.Distance3f(bOrginalPos);
-  Vec3f p_i = a->getPosition();
-  Vec3f p_j = b->getPosition();
-
-  // JUMP
-  double displace = k_structural * (p_i.Distance3f(p_j) - restLength);
-  Vec3f ratio = (p_j - p_i) * (1/p_i.Distance3f(p_j));
-  return displace * ratio;
+void Cloth::ComputeForces() {
+  // Calculating Forces///////////////////////////////
+  // * Gravity & Dampening per particle
+  pool.ParallelFor(nx*ny,CLOTH_MIN_CHUNK,[&](int begin, int end) {
+      ClothExternalForces(particles,args->gravity,damping,begin,end);
+    });
+  // the springs are XPBD's constraints, not forces
+  if (integrator == CLOTH_XPBD) return;
+  // * Spring - Structural,Shear,Bend, each one once: its pull on one
+  //   end is the push on the other
+  for (unsigned int s = 0; s < springs.size(); s++)
+    SpringForces(springs[s]);
 }
 
-// ================================================================================
-
-void Cloth::Animate() {
-
-  // Get the fixed distance for  structure particles
-  double restStructLength = getParticle(0,0).getOriginalPosition().Distance3f(getParticle(0,1).getOriginalPosition());
-  double restShearLength = getParticle(0,0).getOriginalPosition().Distance3f(getParticle(1,1).getOriginalPosition());
-
-  // For each particle in the system update the states
-  for( int i = 0; i < nx; i++){
-
-    for( int j = 0; j < ny; j++){
-
-      // Trying to do eulers method
-      ClothParticle* curP = &getParticle(i,j);
-
-      // Unless fixed
-      if((curP->isFixed()))
-        continue;
-
-      // Calculating Forces///////////////////////////////
-      // * Gravity
-      // * Spring - Structural,Shear,Bend
-      // * Dampening 
-
-      Vec3f f_damp = -1* damping * curP->getVelocity();
-      Vec3f f_gravity = curP->getMass() * args->gravity;
-      // f_spring = addition of all forces
-      Vec3f f_spring;
-
-      // Structural
-      vector<ClothParticle*> adjPartVec = getAdjParticles(i,j);
-      for(unsigned int v = 0; v < adjPartVec.size(); v++)
-        f_spring = f_spring + getSpringForce(curP,adjPartVec[v]);
-      // Shear 
-      vector<ClothParticle*> shearVec = getShearParticles(i,j);
-      for(unsigned int v = 0; v < shearVec.size(); v++)
-        f_spring = f_spring + getSpringForce(curP,shearVec[v]);
-      // Flex
-      vector<ClothParticle*> flexVec = getFlexParticles(i,j);
-      for(unsigned int v = 0; v < flexVec.size(); v++)
-        f_spring = f_spring + getSpringForce(curP,flexVec[v]);
-
-      // Accleration
-      curP->setAcceleration((1/curP->getMass()) * (f_spring + f_gravity + f_damp ));
-
-      // Update Velocity
-      curP->setVelocity(curP->getVelocity() + (args->timestep * curP->getAcceleration()));
-
-      // Get last Position to check against
-      Vec3f oldPos = curP->getPosition();
-      // Update Position
-      curP->setPosition(curP->getPosition() + args->timestep * curP->getVelocity());
-
-
-      // I will halve the timestemp if i realize we are moving to fast, so the next iteration won't be as effected
-      if(fabs(oldPos.Distance3f(curP->getPosition())) >= fabs(restStructLength/4.0)){
-        //std::cout << "Happening to fast, Time Halved\n";
-        args->timestep = args->timestep/2;
-      }
+double Cloth::ChooseTimestep(double remaining) {
+  // the fastest & the most accelerated particle
+  int num_particles = nx*ny;
+  int chunks = pool.numChunks(num_particles,CLOTH_MIN_CHUNK);
+  max_speeds2.resize(chunks);
+  max_accelerations2.resize(chunks);
+  pool.ParallelForChunks(num_particles,chunks,[&](int begin, int end, int chunk) {
+      ClothMaxMotion(particles,begin,end,max_speeds2[chunk],max_accelerations2[chunk]);
+    });
+  double v = sqrt(*std::max_element(max_speeds2.begin(),max_speeds2.end()));
+  double a = sqrt(*std::max_element(max_accelerations2.begin(),max_accelerations2.end()));
+
+  // grow at most 2x a step, never past the springs' stability limit
+  double limit = std::min(2*timestep,stable_timestep);
+  // the embedded error estimate: this step's new position is off the
+  // second order (trapezoid) one by dt^2 a / 2, keep that under the
+  // tolerance
+  double tolerance = step_tolerance * min_structural_length;
+  if (a > 0) limit = std::min(limit,sqrt(2*tolerance/a));
+  // and no particle moves more than a quarter of a spring:
+  // dt (v + dt a) <= reach
+  double reach = min_structural_length / 4.0;
+  double denominator = v + sqrt(v*v + 4*a*reach);
+  if (denominator > 0) limit = std::min(limit,2*reach/denominator);
+  limit = std::max(limit,args->timestep / CLOTH_MAX_SUBSTEPS);
+
+  // even sub steps to the end of the frame (the last one is exactly
+  // what remains)
+  int steps = std::max(1,(int)ceil(remaining/limit));
+  return remaining / steps;
+}
 
+void Cloth::SubStep(double dt) {
+  // collisions follow each particle from where it starts
+  if (collider.hasCollisions())
+    collider.SavePositions(particles,pool);
+
+  if (integrator == CLOTH_XPBD) {
+    // the springs are constraints, no Provot correction needed
+    xpbd_solver.Step(particles,dt,pool);
+  } else {
+    if (integrator == CLOTH_IMPLICIT) {
+      // backward Euler, stable at any timestep
+      implicit_solver.Step(particles,springs,damping,dt);
+    } else {
+      // Eulers method on every loose particle
+      pool.ParallelFor(nx*ny,CLOTH_MIN_CHUNK,[&](int begin, int end) {
+          ClothIntegrate(particles,dt,begin,end);
+        });
     }
-  }
-
-
-  // For each particle in the system check if edges around it is overstreched
-  for(unsigned int i = 0; i < nx; i++){
-
-    for(unsigned int j = 0; j < ny; j++){
-
-      // Collecting surrounding nodes 
-      ClothParticle* curP = &getParticle(i,j);
-      vector<ClothParticle*> adjPartVec = getAdjParticles(i,j);
-
-      for(unsigned int v = 0; v < adjPartVec.size(); v++){
-        // For edge check if oversteched
-        ClothParticle * otherP = adjPartVec[v];
-
-        double distance = std::abs(curP->getPosition().Distance3f(otherP->getPosition()));
-        double max_struct_length = (1 + provot_structural_correction) *restStructLength;
-        double diff_distance = std::abs(max_struct_length - distance);
-
-        if(max_struct_length - distance < 0 && provot_structural_correction != 100){
-          // std::cout << "-=-=-=-=-= Struct Correction -=-=-=-=-=-=-==-=\n";
-          // std::cout << "Overstreched at Index: (" << i << "," << j << ")\n";
-          // std::cout << "Spring length: " << distance << std::endl;
-          // std::cout << "Spring MaxLen: " << max_struct_length << std::endl;
-          // std::cout << "Correction  : " << diff_distance << std::endl;
 
-          Vec3f line_cur_other = otherP->getPosition() - curP->getPosition();
-          Vec3f line_other_cur = curP->getPosition() - otherP->getPosition();
-          Vec3f new_cur = curP->getPosition();
-          Vec3f new_other = otherP->getPosition();
-
-
-          // Which are fixed? none, one or both?
-          if(curP->isLoose() && otherP->isLoose()){
-            // std::cout << "Both Loose\n";
-            // Move both
-            new_cur = curP->getPosition() + ((diff_distance/2.0) * ((1/line_cur_other.Length()) * line_cur_other));
-            new_other = otherP->getPosition() +((diff_distance/2.0) *((1/line_other_cur.Length()) * line_other_cur));
-
-            // std::cout << "Target:        " << max_struct_length << std::endl;
-            // std::cout << "Result:        " << std::abs(new_cur.Distance3f(new_other))<<std::endl;
-
-          }else if( curP->isLoose() && otherP->isFixed()){
-            // std::cout << "One Loose\n";
+    // pull overstretched structural & shear springs back in, and the
+    // velocities with them: a corrected particle left with the velocity
+    // that overstretched it speeds up every step, and never lets the
+    // step grow back
+    double velocity_scale = 1/dt;
+    ProvotCorrection(springs[0],provot_structural_correction,velocity_scale);
+    ProvotCorrection(springs[1],provot_structural_correction,velocity_scale);
+    ProvotCorrection(springs[2],provot_shear_correction,velocity_scale);
+    ProvotCorrection(springs[3],provot_shear_correction,velocity_scale);
+  }
 
+  if (collider.hasCollisions())
+    collider.Collide(particles,pool);
+}
 
-            new_cur = curP->getPosition() + ((diff_distance) *((1/line_cur_other.Length()) * line_cur_other));
-            // std::cout << "Target:        " << max_struct_length << std::endl;
-            // std::cout << "Result:        " << std::abs(new_cur.Distance3f(new_other))<<std::endl;
+int Cloth::minRowsPerChunk(const ClothSpringSet &set) const {
+  return std::max(2,CLOTH_MIN_CHUNK / std::max(set.columns,1));
+}
 
-          }else if( curP->isFixed() && otherP->isLoose()){
-            // std::cout << "One Loose\n";
+void Cloth::SpringForces(const ClothSpringSet &set) {
+  // By chunks of rows.  The springs of a chunk reach at most 2 rows past
+  // it, so chunks of 2 or more rows two apart share no particle: all the
+  // even chunks run at once, then all the odd ones.  The order forces
+  // add up in only depends on the chunks, so on the thread count.
+  int chunks = std::min(2*pool.numThreads(),set.rows / minRowsPerChunk(set));
+  if (chunks <= 1) {
+    ClothSpringForces(particles,set);
+    return;
+  }
+  for (int parity = 0; parity < 2; parity++) {
+    pool.Run((chunks - parity + 1)/2,[&](int task) {
+        int chunk = 2*task + parity;
+        ClothSpringForces(particles,set,ThreadPool::chunkBegin(set.rows,chunks,chunk),
+                          ThreadPool::chunkBegin(set.rows,chunks,chunk+1));
+      });
+  }
+}
 
-            new_other = otherP->getPosition() +((diff_distance) *((1/line_other_cur.Length()) * line_other_cur));
-            // std::cout << "Target:        " << max_struct_length << std::endl;
-            // std::cout << "Result:        " << std::abs(new_cur.Distance3f(new_other)) << std::endl;
+// ================================================================================
 
-          }else{
-            // Then both are fixed, in which case do nothing.
-            assert(curP->isFixed() && otherP->isFixed());
+void Cloth::ProvotCorrection(const ClothSpringSet &set, double correction, double velocity_scale) {
+  // correction factor == 100, means don't do any correction
+  if (correction == 100) return;
+  // In two colors of springs that share no particle, each color all at
+  // once: the result is the same on any number of threads.
+  assert (set.dj == 0 || set.dj == 1);
+  if (set.dj == 0) {
+    // along a row: rows share no particles, within one the even
+    // springs then the odd ones
+    pool.ParallelFor(set.rows,minRowsPerChunk(set),[&](int begin, int end) {
+        for (int row = begin; row < end; row++) {
+          for (int parity = 0; parity < 2; parity++) {
+            for (int c = parity; c < set.columns; c += 2)
+              ProvotSpring(set,row*set.columns + c,correction,velocity_scale);
           }
-
-          curP->setPosition(new_cur);
-          otherP->setPosition(new_other);
         }
-      }
-
-
-
-      //SHEAR
-      vector<ClothParticle*> shearPartVec = getShearParticles(i,j);
-      for(unsigned int v = 0; v < shearPartVec.size(); v++){
-        // For edge check if oversteched
-        ClothParticle * otherP = shearPartVec[v];
-
-        double distance = std::abs(curP->getPosition().Distance3f(otherP->getPosition()));
-        double max_shear_length = (1+ provot_shear_correction) *restShearLength;
-        double diff_distance = std::abs(max_shear_length - distance);
-
-
-        if(max_shear_length - distance < 0 && provot_shear_correction != 100){
-
-          // std::cout << "-=-=-=-=-= Shear Correction -=-=-=-=-=-=-==-=\n";
-          // std::cout << "Overstreched at Index: (" << i << "," << j << ")\n";
-          // std::cout << "Spring length: " << distance << std::endl;
-          // std::cout << "Spring MaxLen: " << max_shear_length << std::endl;
-          // std::cout << "Correction   : " << diff_distance << std::endl;
-
-          Vec3f line_cur_other = otherP->getPosition() - curP->getPosition();
-          Vec3f line_other_cur = curP->getPosition() - otherP->getPosition();
-          Vec3f new_cur = curP->getPosition();
-          Vec3f new_other = otherP->getPosition();
-
-
-          // Which are fixed? none, one or both?
-          if(curP->isLoose() && otherP->isLoose()){
-            // Move both
-            new_cur = curP->getPosition() + ((diff_distance/2.0) * ((1/line_cur_other.Length()) * line_cur_other));
-            new_other = otherP->getPosition() +((diff_distance/2.0) *((1/line_other_cur.Length()) * line_other_cur));
-            // std::cout << "Target:        " << max_shear_length << std::endl;
-            // std::cout << "Result:        " << std::abs(new_cur.Distance3f(new_other))<<std::endl;
-
-
-          }else if( curP->isLoose() && otherP->isFixed()){
-            new_cur = curP->getPosition() + ((diff_distance) *((1/line_cur_other.Length()) * line_cur_other));
-            // std::cout << "Target:        " << max_shear_length << std::endl;
-            // std::cout << "Result:        " << std::abs(new_cur.Distance3f(new_other))<<std::endl;
+      });
+  } else {
+    // from one row to the next: the even rows, then the odd ones
+    for (int parity = 0; parity < 2; parity++) {
+      int rows = (set.rows - parity + 1)/2;
+      pool.ParallelFor(rows,minRowsPerChunk(set)/2,[&](int begin, int end) {
+          for (int r = begin; r < end; r++) {
+            int row = 2*r + parity;
+            for (int c = 0; c < set.columns; c++)
+              ProvotSpring(set,row*set.columns + c,correction,velocity_scale);
+          }
+        });
+    }
+  }
+}
 
-          }else if( curP->isFixed() && otherP->isLoose()){
-            new_other = otherP->getPosition() +((diff_distance) *((1/line_other_cur.Length()) * line_other_cur));
-            // std::cout << "Target:        " << max_shear_length << std::endl;
-            // std::cout << "Result:        " << std::abs(new_cur.Distance3f(new_other))<<std::endl;
+void Cloth::ProvotSpring(const ClothSpringSet &set, int s, double correction, double velocity_scale) {
+  int a = set.startParticle(s);
+  int b = a + set.offset;
+  // both fixed, in which case do nothing
+  if (particles.isFixed(a) && particles.isFixed(b)) return;
+  Vec3f pos_a = particles.getPosition(a);
+  Vec3f pos_b = particles.getPosition(b);
+  Vec3f ab = pos_b - pos_a;
+  double length = ab.Length();
+  double max_length = (1 + correction) * set.rest_length[s];
+  if (length <= max_length) return;
+  // the part over the limit, along the spring
+  Vec3f over = ((length - max_length) / length) * ab;
+  // how far each end moves
+  Vec3f move_a(0,0,0), move_b(0,0,0);
+  if (particles.isLoose(a) && particles.isLoose(b)) {
+    // move both
+    move_a = 0.5 * over;
+    move_b = -0.5 * over;
+  } else if (particles.isLoose(a)) {
+    move_a = over;
+  } else {
+    move_b = -1 * over;
+  }
+  particles.setPosition(a,pos_a + move_a);
+  particles.setPosition(b,pos_b + move_b);
+  if (velocity_scale != 0) {
+    particles.setVelocity(a,particles.getVelocity(a) + velocity_scale * move_a);
+    particles.setVelocity(b,particles.getVelocity(b) + velocity_scale * move_b);
+  }
+}
 
-          }else{
-            // Then both are fixed, in which case do nothing.
-            assert(curP->isFixed() && otherP->isFixed());
-          }
+// ================================================================================
 
-          curP->setPosition(new_cur);
-          otherP->setPosition(new_other);
-        }
-      }
+unsigned int Cloth::Checksum() const {
+  // FNV-1a over the bits of every position & velocity
+  unsigned int hash = 2166136261u;
+  const vector<float>* arrays[] = { &particles.x, &particles.y, &particles.z,
+                                    &particles.vx, &particles.vy, &particles.vz };
+  for (int a = 0; a < 6; a++) {
+    const unsigned char *bytes = (const unsigned char*)arrays[a]->data();
+    for (size_t i = 0; i < arrays[a]->size()*sizeof(float); i++) {
+      hash ^= bytes[i];
+      hash *= 16777619u;
     }
   }
-  // redo VBOs for rendering
-  setupVBOs();
+  return hash;
 }
 
-// ================================================================================
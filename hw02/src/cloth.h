@@ -4,6 +4,11 @@
 #include "argparser.h"
 #include "boundingbox.h"
 #include "vbo_structs.h"
+#include "cloth_kernels.h"
+#include "cloth_implicit.h"
+#include "cloth_xpbd.h"
+#include "cloth_collision.h"
+#include "cloth_checkpoint.h"
 #include <vector>
 #include <map>
 
@@ -11,41 +16,18 @@ using std::vector;
 using std::pair;
 
 // =====================================================================================
-// Cloth Particles
+// Cloth System
 // =====================================================================================
 
-class ClothParticle {
-public:
-  // ACCESSORS
-  const Vec3f& getOriginalPosition() const{ return original_position; }
-  const Vec3f& getPosition() const{ return position; }
-  const Vec3f& getVelocity() const{ return velocity; }
-  const Vec3f& getAcceleration() const { return acceleration; }
-  Vec3f getForce() const { return mass*acceleration; }
-  double getMass() const { return mass; }
-  bool isFixed() const { return fixed; }
-  bool isLoose() const {return !fixed; }
-
-  // MODIFIERS
-  void setOriginalPosition(const Vec3f &p) { original_position = p; }
-  void setPosition(const Vec3f &p) { position = p; }
-  void setVelocity(const Vec3f &v) { velocity = v; }
-  void setAcceleration(const Vec3f &a) { acceleration = a; }
-  void setMass(double m) { mass = m; }
-  void setFixed(bool b) { fixed = b; }
-private:
-  // REPRESENTATION
-  Vec3f original_position;
-  Vec3f position;
-  Vec3f velocity;
-  Vec3f acceleration;
-  double mass;
-  bool fixed;
+// a thread gets at least this many particles or springs
+#define CLOTH_MIN_CHUNK 4096
+// an explicit frame is never cut in more sub steps than this
+#define CLOTH_MAX_SUBSTEPS 1000
 
-};
+// how a step moves the particles, "integrator" in the cloth file
+enum ClothIntegrator { CLOTH_EXPLICIT, CLOTH_IMPLICIT, CLOTH_XPBD };
 
 // =====================================================================================
-// Cloth System
 // =====================================================================================
 
 
@@ -53,18 +35,41 @@ class Cloth {
 
 public:
   Cloth(ArgParser *args);
-  ~Cloth() { delete [] particles; cleanupVBOs(); }
+  ~Cloth() { cleanupVBOs(); }
 
   // ACCESSORS
   const BoundingBox& getBoundingBox() const { return box; }
-  const vector<ClothParticle*> getAdjParticles (int i, int j) ;
-  const vector<ClothParticle*> getShearParticles (int i, int j) ;
-  const vector<ClothParticle*> getFlexParticles (int i, int j) ;
-  const Vec3f getSpringForce(ClothParticle* a, ClothParticle* b) ;
+  int numParticles() const { return nx*ny; }
+  int numThreads() const { return pool.numThreads(); }
+  // the last sub step & how many there have been
+  double getTimestep() const { return timestep; }
+  int numSubsteps() const { return substeps; }
+  // frames (Step) & simulated seconds since the start
+  int getFrame() const { return frame; }
+  double getTime() const { return time; }
+  // self collision contacts in the last sub step
+  int getLastContacts() const { return collider.getLastContacts(); }
+  // a hash of the positions & velocities, to compare runs
+  unsigned int Checksum() const;
 
   // PAINTING & ANIMATING
   void Paint() const; // <------What is this Paint?
+  // a step of the simulation & the VBOs to draw it
   void Animate();
+  // just the simulation (no window needed): args->timestep of
+  // simulated time, in as few sub steps as the integrator allows
+  void Step();
+
+  // CHECKPOINTS & PLAYBACK (cloth_checkpoint.cpp), false & a message
+  // if the file is no good
+  bool SaveCheckpoint(const std::string &filename) const;
+  bool LoadCheckpoint(const std::string &filename);
+  // with a -playback frame cache: put the particles where they were
+  // after frame f (clamped to the cached frames)
+  bool isPlayingBack() const { return playback.isOpen(); }
+  int firstCachedFrame() const { return playback.firstFrame(); }
+  int numCachedFrames() const { return playback.numFrames(); }
+  void ShowFrame(int f);
 
   void initializeVBOs();
   void setupVBOs();
@@ -74,25 +79,35 @@ public:
 private:
 
   // PRIVATE ACCESSORS
-  const ClothParticle& getParticle(int i, int j) const {
+  int getIndex(int i, int j) const {
     assert (i >= 0 && i < nx && j >= 0 && j < ny);
-    return particles[i + j*nx]; }
-
-  ClothParticle& getParticle(int i, int j) {
-    assert (i >= 0 && i < nx && j >= 0 && j < ny);
-    return particles[i + j*nx]; }
+    return i + j*nx; }
+  Vec3f getPosition(int i, int j) const { return particles.getPosition(getIndex(i,j)); }
+  Vec3f getOriginalPosition(int i, int j) const { return particles.getOriginalPosition(getIndex(i,j)); }
+  Vec3f getVelocity(int i, int j) const { return particles.getVelocity(getIndex(i,j)); }
+  Vec3f getForce(int i, int j) const { return particles.getForce(getIndex(i,j)); }
+  bool isFixed(int i, int j) const { return particles.isFixed(getIndex(i,j)); }
 
   Vec3f computeGouraudNormal(int i, int j) const;
 
   // HELPER FUNCTION
   void computeBoundingBox();
+  void setupSprings();
+  void computeStableTimestep();
+  void ComputeForces();
+  double ChooseTimestep(double remaining);
+  void SubStep(double dt);
+  int minRowsPerChunk(const ClothSpringSet &set) const;
+  void SpringForces(const ClothSpringSet &set);
+  void ProvotCorrection(const ClothSpringSet &set, double correction, double velocity_scale);
+  void ProvotSpring(const ClothSpringSet &set, int s, double correction, double velocity_scale);
   void AddVBOEdge(int i1, int j1, int i2, int j2, double correction);
 
   // REPRESENTATION
   ArgParser *args;
   // grid data structure
   int nx, ny;
-  ClothParticle *particles;
+  ClothParticles particles;
   BoundingBox box;
   // simulation parameters
   double damping;
@@ -103,7 +118,30 @@ private:
   // correction thresholds
   double provot_structural_correction;
   double provot_shear_correction;
-
+  // springs: 2 structural sets, 2 shear, then 2 flex (bend), see MakeClothSprings
+  vector<ClothSpringSet> springs;
+  double min_structural_length;
+  // integrator
+  ClothIntegrator integrator;
+  // explicit sub steps: the largest the springs allow, the error allowed
+  // per step (as a fraction of the shortest structural spring), the last
+  // sub step & the count
+  double stable_timestep;
+  double step_tolerance;
+  double timestep;
+  int substeps;
+  int frame;
+  double time;
+  ClothImplicitSolver implicit_solver;
+  ClothXPBDSolver xpbd_solver;
+  // spheres, planes & self collision
+  ClothCollider collider;
+  // -record & -playback frame caches
+  ClothFrameWriter recorder;
+  ClothFrameCache playback;
+  // threads for the force, integration & correction passes
+  ThreadPool pool;
+  vector<float> max_speeds2, max_accelerations2;   // of each chunk
 
   // VBOs
   GLuint cloth_verts_VBO;
@@ -0,0 +1,113 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "cloth_kernels.h"
+
+// =========================================
+// Micro-benchmark of the cloth step kernels (cloth_kernels.h) without
+// graphics: a flat square of cloth, 1m on a side and pinned at two
+// corners, is stepped with the scalar and then the AVX2 kernels.
+// Prints the time per step of the spring forces (all 6 sets) and of
+// the integration, and how far apart the two runs ended up.
+//
+//   cloth_benchmark [steps] [n ...]      (defaults: 50 steps, 256 1024)
+// =========================================
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsed_ms(Clock::time_point start) {
+  return std::chrono::duration<double,std::milli>(Clock::now() - start).count();
+}
+
+struct Timings {
+  double springs, integrate;
+  ClothParticles particles;
+};
+
+void MakeCloth(int n, ClothParticles &particles, std::vector<ClothSpringSet> &springs) {
+  particles.resize(n*n);
+  double mass = 0.3 / double(n*n);   // 300 g/m^2, denim
+  for (int j = 0; j < n; j++) {
+    for (int i = 0; i < n; i++) {
+      int p = i + j*n;
+      Vec3f pos(i/double(n-1),0,j/double(n-1));
+      particles.setOriginalPosition(p,pos);
+      particles.setPosition(p,pos);
+      particles.setMass(p,mass);
+      particles.setFixed(p,false);
+    }
+  }
+  particles.setFixed(0,true);
+  particles.setFixed(n-1,true);
+  MakeClothSprings(n,n,particles,4,4,2,springs);
+}
+
+Timings Run(int n, int steps, bool simd) {
+  Timings t;
+  std::vector<ClothSpringSet> springs;
+  MakeCloth(n,t.particles,springs);
+  ClothUseSIMD(simd);
+  t.springs = t.integrate = 0;
+  float dt = 0.0001;
+  for (int s = 0; s < steps; s++) {
+    ClothExternalForces(t.particles,Vec3f(0,-9.8,0),0.05);
+    Clock::time_point start = Clock::now();
+    for (unsigned int k = 0; k < springs.size(); k++)
+      ClothSpringForces(t.particles,springs[k]);
+    t.springs += elapsed_ms(start);
+    start = Clock::now();
+    ClothIntegrate(t.particles,dt);
+    t.integrate += elapsed_ms(start);
+  }
+  t.springs /= steps;
+  t.integrate /= steps;
+  return t;
+}
+
+void PrintRow(const std::string &name, double scalar_ms, double simd_ms) {
+  std::cout << std::setw(14) << std::left << name << std::right << std::fixed << std::setprecision(3)
+            << std::setw(10) << scalar_ms << " ms" << std::setw(10) << simd_ms << " ms"
+            << std::setw(8) << std::setprecision(2) << scalar_ms / simd_ms << "x" << std::endl;
+}
+
+// =========================================
+
+int main(int argc, char *argv[]) {
+  int steps = (argc > 1) ? atoi(argv[1]) : 50;
+  if (steps < 1) steps = 1;
+  std::vector<int> sizes;
+  for (int i = 2; i < argc; i++) sizes.push_back(atoi(argv[i]));
+  if (sizes.empty()) { sizes.push_back(256); sizes.push_back(1024); }
+
+  if (!ClothUseSIMD(true)) {
+    std::cerr << "ERROR! no AVX2 kernels on this cpu or compiler, nothing to compare" << std::endl;
+    return 1;
+  }
+
+  for (unsigned int k = 0; k < sizes.size(); k++) {
+    int n = sizes[k];
+    if (n < 2) continue;
+    Timings scalar = Run(n,steps,false);
+    Timings simd = Run(n,steps,true);
+    double difference = 0;
+    for (int p = 0; p < n*n; p++)
+      difference = std::max(difference,(scalar.particles.getPosition(p)-simd.particles.getPosition(p)).Length());
+
+    std::cout << n << "x" << n << " cloth, " << steps << " steps, positions differ by at most "
+              << std::scientific << std::setprecision(2) << difference << " m" << std::endl;
+    std::cout << std::setw(14) << std::left << "" << std::right
+              << std::setw(13) << "scalar" << std::setw(13) << "avx2" << std::setw(9) << "speedup" << std::endl;
+    PrintRow("springs",scalar.springs,simd.springs);
+    PrintRow("integrate",scalar.integrate,simd.integrate);
+  }
+  return 0;
+}
+
+// =========================================
+// =========================================
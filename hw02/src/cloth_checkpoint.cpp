@@ -0,0 +1,278 @@
+#include "glCanvas.h"
+#include <cstring>
+#include <iostream>
+#include <stddef.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "cloth.h"
+#include "cloth_checkpoint.h"
+
+// ================================================================================
+// checkpoints
+// ================================================================================
+
+bool Cloth::SaveCheckpoint(const std::string &filename) const {
+  std::ofstream ostr(filename.c_str(),std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!ostr.good()) {
+    std::cerr << "ERROR! can't write the checkpoint " << filename << std::endl;
+    return false;
+  }
+  ClothCheckpointHeader header;
+  memset(&header,0,sizeof(header));
+  header.magic = CLOTH_CHECKPOINT_MAGIC;
+  header.version = CLOTH_CHECKPOINT_VERSION;
+  header.nx = nx;
+  header.ny = ny;
+  header.integrator = integrator;
+  header.frame = frame;
+  header.substeps = substeps;
+  header.rng_size = MTRand::SAVE;
+  header.time = time;
+  header.timestep = timestep;
+  ostr.write((const char*)&header,sizeof(header));
+  const vector<float>* arrays[] = { &particles.x, &particles.y, &particles.z,
+                                    &particles.vx, &particles.vy, &particles.vz };
+  for (int a = 0; a < 6; a++)
+    ostr.write((const char*)arrays[a]->data(),arrays[a]->size()*sizeof(float));
+  // (MTRand's uint32 may be wider than 32 bits)
+  MTRand::uint32 state[MTRand::SAVE];
+  args->mtrand.save(state);
+  vector<uint32_t> rng(state,state+MTRand::SAVE);
+  ostr.write((const char*)rng.data(),rng.size()*sizeof(uint32_t));
+  if (!ostr.good()) {
+    std::cerr << "ERROR! failed writing the checkpoint " << filename << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool Cloth::LoadCheckpoint(const std::string &filename) {
+  std::ifstream istr(filename.c_str(),std::ios::in | std::ios::binary);
+  if (!istr.good()) {
+    std::cerr << "ERROR! can't read the checkpoint " << filename << std::endl;
+    return false;
+  }
+  ClothCheckpointHeader header;
+  istr.read((char*)&header,sizeof(header));
+  if (!istr.good() || header.magic != CLOTH_CHECKPOINT_MAGIC || header.version != CLOTH_CHECKPOINT_VERSION) {
+    std::cerr << "ERROR! " << filename << " isn't a cloth checkpoint" << std::endl;
+    return false;
+  }
+  if (header.nx != nx || header.ny != ny || header.integrator != integrator ||
+      header.rng_size != MTRand::SAVE) {
+    std::cerr << "ERROR! the checkpoint " << filename << " is of a " << header.nx << "x" << header.ny
+              << " cloth (integrator " << header.integrator << "), not this "
+              << nx << "x" << ny << " (integrator " << integrator << ")" << std::endl;
+    return false;
+  }
+  // read everything before changing anything
+  vector<float> values(6*nx*ny);
+  vector<uint32_t> rng(MTRand::SAVE);
+  istr.read((char*)values.data(),values.size()*sizeof(float));
+  istr.read((char*)rng.data(),rng.size()*sizeof(uint32_t));
+  if (!istr.good()) {
+    std::cerr << "ERROR! the checkpoint " << filename << " is truncated" << std::endl;
+    return false;
+  }
+  vector<float>* arrays[] = { &particles.x, &particles.y, &particles.z,
+                              &particles.vx, &particles.vy, &particles.vz };
+  for (int a = 0; a < 6; a++)
+    arrays[a]->assign(values.begin() + a*nx*ny,values.begin() + (a+1)*nx*ny);
+  MTRand::uint32 state[MTRand::SAVE];
+  std::copy(rng.begin(),rng.end(),state);
+  args->mtrand.load(state);
+  frame = header.frame;
+  substeps = header.substeps;
+  time = header.time;
+  timestep = header.timestep;
+  return true;
+}
+
+// ================================================================================
+// playback
+// ================================================================================
+
+void Cloth::ShowFrame(int f) {
+  assert (playback.isOpen());
+  int first = playback.firstFrame();
+  int last = first + playback.numFrames() - 1;
+  f = std::max(first,std::min(last,f));
+  int n = nx*ny;
+  memcpy(particles.x.data(),playback.getX(f),n*sizeof(float));
+  memcpy(particles.y.data(),playback.getY(f),n*sizeof(float));
+  memcpy(particles.z.data(),playback.getZ(f),n*sizeof(float));
+  // the velocities from how far the particles got since the frame before
+  double dt = (f > first) ? playback.getTime(f) - playback.getTime(f-1) : 0;
+  for (int i = 0; i < n; i++) {
+    if (dt > 0) {
+      particles.vx[i] = (particles.x[i] - playback.getX(f-1)[i]) / dt;
+      particles.vy[i] = (particles.y[i] - playback.getY(f-1)[i]) / dt;
+      particles.vz[i] = (particles.z[i] - playback.getZ(f-1)[i]) / dt;
+    } else {
+      particles.vx[i] = particles.vy[i] = particles.vz[i] = 0;
+    }
+  }
+  // (for the force visualization)
+  ComputeForces();
+  frame = f;
+  time = playback.getTime(f);
+}
+
+// ================================================================================
+// frame cache writer
+// ================================================================================
+
+long long ClothFrameWriter::frameOffset(int f) const {
+  return sizeof(ClothFramesHeader) + (long long)f * (sizeof(double) + 3*sizeof(float)*nx*ny);
+}
+
+bool ClothFrameWriter::Open(const std::string &filename, int _nx, int _ny, int _first_frame) {
+  nx = _nx;
+  ny = _ny;
+  // an existing cache that reaches first_frame?
+  file.open(filename.c_str(),std::ios::in | std::ios::out | std::ios::binary);
+  if (file.is_open()) {
+    ClothFramesHeader header;
+    file.read((char*)&header,sizeof(header));
+    if (file.good() && header.magic == CLOTH_FRAMES_MAGIC && header.version == CLOTH_CHECKPOINT_VERSION &&
+        header.nx == nx && header.ny == ny && header.first_frame <= _first_frame &&
+        _first_frame <= header.first_frame + header.num_frames) {
+      first_frame = header.first_frame;
+      num_frames = header.num_frames;
+      return true;
+    }
+    file.close();
+  }
+  // no, a new one
+  file.clear();
+  file.open(filename.c_str(),std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    std::cerr << "ERROR! can't write the frame cache " << filename << std::endl;
+    return false;
+  }
+  ClothFramesHeader header;
+  memset(&header,0,sizeof(header));
+  header.magic = CLOTH_FRAMES_MAGIC;
+  header.version = CLOTH_CHECKPOINT_VERSION;
+  header.nx = nx;
+  header.ny = ny;
+  header.first_frame = first_frame = _first_frame;
+  header.num_frames = num_frames = 0;
+  file.write((const char*)&header,sizeof(header));
+  file.flush();
+  return file.good();
+}
+
+bool ClothFrameWriter::Write(int frame, double time, const ClothParticles &particles) {
+  assert (isOpen());
+  assert (particles.size() == nx*ny);
+  int index = frame - first_frame;
+  if (index < 0 || index > num_frames) {
+    std::cerr << "ERROR! frame " << frame << " doesn't follow the cached frames "
+              << first_frame << " to " << first_frame+num_frames-1 << std::endl;
+    return false;
+  }
+  file.seekp(frameOffset(index));
+  file.write((const char*)&time,sizeof(double));
+  file.write((const char*)particles.x.data(),nx*ny*sizeof(float));
+  file.write((const char*)particles.y.data(),nx*ny*sizeof(float));
+  file.write((const char*)particles.z.data(),nx*ny*sizeof(float));
+  // (any frames after this one are dropped)
+  num_frames = index+1;
+  int32_t count = num_frames;
+  file.seekp(offsetof(ClothFramesHeader,num_frames));
+  file.write((const char*)&count,sizeof(count));
+  file.flush();
+  if (!file.good()) {
+    std::cerr << "ERROR! failed writing frame " << frame << " to the frame cache" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// ================================================================================
+// frame cache reader
+// ================================================================================
+
+bool ClothFrameCache::Open(const std::string &filename) {
+  Close();
+#ifdef _WIN32
+  std::ifstream istr(filename.c_str(),std::ios::in | std::ios::binary);
+  if (!istr.good()) {
+    std::cerr << "ERROR! can't read the frame cache " << filename << std::endl;
+    return false;
+  }
+  buffer.assign(std::istreambuf_iterator<char>(istr),std::istreambuf_iterator<char>());
+  data = buffer.data();
+  size = buffer.size();
+#else
+  int fd = open(filename.c_str(),O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd,&st) != 0) {
+    std::cerr << "ERROR! can't read the frame cache " << filename << std::endl;
+    if (fd >= 0) close(fd);
+    return false;
+  }
+  size = st.st_size;
+  void *map = (size > 0) ? mmap(NULL,size,PROT_READ,MAP_SHARED,fd,0) : MAP_FAILED;
+  // (the mapping stays after the file is closed)
+  close(fd);
+  if (map == MAP_FAILED) {
+    std::cerr << "ERROR! can't map the frame cache " << filename << std::endl;
+    size = 0;
+    return false;
+  }
+  data = (const char*)map;
+#endif
+  const ClothFramesHeader *h = (const ClothFramesHeader*)data;
+  if (size < sizeof(ClothFramesHeader) || h->magic != CLOTH_FRAMES_MAGIC ||
+      h->version != CLOTH_CHECKPOINT_VERSION || h->nx <= 0 || h->ny <= 0) {
+    std::cerr << "ERROR! " << filename << " isn't a cloth frame cache" << std::endl;
+    Close();
+    return false;
+  }
+  header = h;
+  // the frames that are all there
+  long long frame_size = sizeof(double) + 3*sizeof(float)*(long long)numParticles();
+  long long complete = (size - sizeof(ClothFramesHeader)) / frame_size;
+  num_frames = (int)std::min((long long)header->num_frames,complete);
+  if (num_frames == 0) {
+    std::cerr << "ERROR! the frame cache " << filename << " has no frames" << std::endl;
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void ClothFrameCache::Close() {
+#ifdef _WIN32
+  buffer.clear();
+#else
+  if (data != NULL) munmap((void*)data,size);
+#endif
+  data = NULL;
+  size = 0;
+  header = NULL;
+  num_frames = 0;
+}
+
+const char* ClothFrameCache::getFrame(int f) const {
+  assert (isOpen());
+  int index = f - firstFrame();
+  assert (index >= 0 && index < num_frames);
+  long long frame_size = sizeof(double) + 3*sizeof(float)*(long long)numParticles();
+  return data + sizeof(ClothFramesHeader) + index*frame_size;
+}
+
+double ClothFrameCache::getTime(int f) const {
+  // (not necessarily 8 byte aligned)
+  double t;
+  memcpy(&t,getFrame(f),sizeof(double));
+  return t;
+}
+
+// ================================================================================
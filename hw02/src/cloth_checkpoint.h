@@ -0,0 +1,121 @@
+#ifndef _CLOTH_CHECKPOINT_H_
+#define _CLOTH_CHECKPOINT_H_
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "cloth_kernels.h"
+
+#define CLOTH_CHECKPOINT_MAGIC 0x4b43434c   // "LCCK"
+#define CLOTH_FRAMES_MAGIC     0x4d46434c   // "LCFM"
+#define CLOTH_CHECKPOINT_VERSION 1
+
+// =====================================================================================
+// Binary files for long cloth simulations, in the machine's own byte
+// order (the magic number catches a file from the other kind):
+//
+// A checkpoint is everything a step depends on that isn't in the cloth
+// file: the positions & velocities, the last sub step (the next one
+// grows from it), the frame, sub step & time counters and the random
+// number generator.  Loaded over the same cloth file the simulation
+// goes on exactly as if it had never stopped.
+//
+// A frame cache is the positions after every frame, frame f at a fixed
+// offset, so the player maps the file into memory and jumps to any
+// frame without reading the ones before it.  The writer keeps the
+// frame count in the header up to date after every frame: a run that
+// dies leaves a usable cache.  Writing frame f drops the frames after
+// it, so a run resumed from a checkpoint overwrites what came after.
+// =====================================================================================
+
+struct ClothCheckpointHeader {
+  uint32_t magic;
+  uint32_t version;
+  int32_t nx, ny;
+  int32_t integrator;
+  int32_t frame;
+  int32_t substeps;
+  int32_t rng_size;     // MTRand::SAVE
+  double time;
+  double timestep;      // the last sub step
+  // then x y z vx vy vz, nx*ny floats each, & rng_size uint32_t
+};
+
+struct ClothFramesHeader {
+  uint32_t magic;
+  uint32_t version;
+  int32_t nx, ny;
+  int32_t first_frame;
+  int32_t num_frames;
+  // then per frame: the time (a double) and x y z, nx*ny floats each
+};
+
+// =====================================================================================
+
+class ClothFrameWriter {
+public:
+  ClothFrameWriter() : nx(0), ny(0), first_frame(0), num_frames(0) {}
+
+  bool isOpen() const { return file.is_open(); }
+  // carries on an existing cache of the same grid if it has the frames
+  // up to first_frame, otherwise starts a new one there
+  bool Open(const std::string &filename, int nx, int ny, int first_frame);
+  // frame must be in the cache or the next one
+  bool Write(int frame, double time, const ClothParticles &particles);
+
+private:
+  long long frameOffset(int f) const;
+
+  // REPRESENTATION
+  std::fstream file;
+  int nx, ny;
+  int first_frame;
+  int num_frames;
+};
+
+// =====================================================================================
+
+class ClothFrameCache {
+public:
+  ClothFrameCache() : data(NULL), size(0), header(NULL), num_frames(0) {}
+  ~ClothFrameCache() { Close(); }
+
+  bool Open(const std::string &filename);
+  void Close();
+
+  // ACCESSORS
+  bool isOpen() const { return header != NULL; }
+  int numParticles() const { return header->nx*header->ny; }
+  int getNX() const { return header->nx; }
+  int getNY() const { return header->ny; }
+  int firstFrame() const { return header->first_frame; }
+  int numFrames() const { return num_frames; }
+  // frame f of the simulation, firstFrame() <= f < firstFrame()+numFrames()
+  double getTime(int f) const;
+  const float* getX(int f) const { return getPositions(f); }
+  const float* getY(int f) const { return getPositions(f) + numParticles(); }
+  const float* getZ(int f) const { return getPositions(f) + 2*numParticles(); }
+
+private:
+  const char* getFrame(int f) const;
+  const float* getPositions(int f) const { return (const float*)(getFrame(f) + sizeof(double)); }
+
+  // don't copy the mapping
+  ClothFrameCache(const ClothFrameCache &) { assert(0); }
+  const ClothFrameCache& operator=(const ClothFrameCache &) { assert(0); return *this; }
+
+  // REPRESENTATION
+  const char *data;
+  size_t size;
+  const ClothFramesHeader *header;
+  int num_frames;
+#ifdef _WIN32
+  // (no mmap: the whole file is read in)
+  std::vector<char> buffer;
+#endif
+};
+
+// =====================================================================================
+
+#endif
@@ -0,0 +1,350 @@
+#include <algorithm>
+#include <cmath>
+#include "cloth_collision.h"
+
+// ================================================================================
+
+static Vec3f MinVec(const Vec3f &a, const Vec3f &b) {
+  return Vec3f(std::min(a.x(),b.x()),std::min(a.y(),b.y()),std::min(a.z(),b.z()));
+}
+
+static Vec3f MaxVec(const Vec3f &a, const Vec3f &b) {
+  return Vec3f(std::max(a.x(),b.x()),std::max(a.y(),b.y()),std::max(a.z(),b.z()));
+}
+
+// moves a particle push along direction, & changes its velocity by stop
+static void Nudge(ClothParticles &p, int i, const Vec3f &direction, double push, double stop) {
+  p.setPosition(i,p.getPosition(i) + push*direction);
+  p.setVelocity(i,p.getVelocity(i) + stop*direction);
+}
+
+// ================================================================================
+
+void ClothCollider::addSphere(const Vec3f &center, double radius) {
+  assert (radius > 0);
+  ClothSphere s;
+  s.center = center;
+  s.radius = radius;
+  spheres.push_back(s);
+}
+
+void ClothCollider::addPlane(const Vec3f &point, const Vec3f &normal) {
+  assert (normal.Length() > 0);
+  ClothPlane p;
+  p.point = point;
+  p.normal = normal;
+  p.normal.Normalize();
+  planes.push_back(p);
+}
+
+void ClothCollider::setup(int _nx, int _ny, double spacing) {
+  assert (spacing > 0);
+  nx = _nx;
+  ny = _ny;
+  cell_size = spacing;
+  previous_x.resize(nx*ny);
+  previous_y.resize(nx*ny);
+  previous_z.resize(nx*ny);
+}
+
+void ClothCollider::SavePositions(const ClothParticles &p, ThreadPool &pool) {
+  pool.ParallelFor(p.size(),COLLISION_MIN_CHUNK,[&](int begin, int end) {
+      std::copy(p.x.begin()+begin,p.x.begin()+end,previous_x.begin()+begin);
+      std::copy(p.y.begin()+begin,p.y.begin()+end,previous_y.begin()+begin);
+      std::copy(p.z.begin()+begin,p.z.begin()+end,previous_z.begin()+begin);
+    });
+}
+
+void ClothCollider::Collide(ClothParticles &p, ThreadPool &pool) {
+  assert (p.size() == nx*ny);
+  if (self_collision) {
+    BuildHash(p);
+    // look for contacts on all threads...
+    int num_triangles = 2*(nx-1)*(ny-1);
+    int chunks = pool.numChunks(num_triangles,COLLISION_MIN_CHUNK);
+    chunk_contacts.resize(chunks);
+    chunk_candidates.resize(chunks);
+    pool.ParallelForChunks(num_triangles,chunks,[&](int begin, int end, int chunk) {
+        chunk_contacts[chunk].clear();
+        for (int t = begin; t < end; t++)
+          FindContacts(p,t,chunk_candidates[chunk],chunk_contacts[chunk]);
+      });
+    // ...and push them apart one at a time, in triangle order
+    last_contacts = 0;
+    for (int chunk = 0; chunk < chunks; chunk++) {
+      const std::vector<Contact> &contacts = chunk_contacts[chunk];
+      for (unsigned int c = 0; c < contacts.size(); c++)
+        ResolveContact(p,contacts[c]);
+      last_contacts += contacts.size();
+    }
+  }
+  // the objects have the last word, each particle on its own
+  if (!spheres.empty() || !planes.empty()) {
+    pool.ParallelFor(p.size(),COLLISION_MIN_CHUNK,[&](int begin, int end) {
+        for (int i = begin; i < end; i++)
+          CollideObjects(p,i);
+      });
+  }
+}
+
+// ================================================================================
+// spheres & planes
+// ================================================================================
+
+void ClothCollider::CollideObjects(ClothParticles &p, int i) const {
+  if (p.isFixed(i)) return;
+  Vec3f start = getPreviousPosition(i);
+  Vec3f pos = p.getPosition(i);
+  Vec3f vel = p.getVelocity(i);
+  bool hit = false;
+
+  for (unsigned int s = 0; s < spheres.size(); s++) {
+    const Vec3f &center = spheres[s].center;
+    double radius = spheres[s].radius + thickness;
+    Vec3f normal;
+    Vec3f out = pos - center;
+    if (out.Length() < radius) {
+      // inside: straight out
+      if (out.Length() == 0) out = Vec3f(0,1,0);
+      out.Normalize();
+      normal = out;
+    } else {
+      // outside, but did it go through on the way?  the first time the
+      // path start + t move meets the sphere
+      Vec3f move = pos - start;
+      Vec3f from_center = start - center;
+      double a = move.Dot3(move);
+      double b = from_center.Dot3(move);
+      double c = from_center.Dot3(from_center) - radius*radius;
+      double discriminant = b*b - a*c;
+      if (a == 0 || c < 0 || b >= 0 || discriminant <= 0) continue;
+      double t = (-b - sqrt(discriminant)) / a;
+      if (t > 1) continue;
+      // from where it hit, the rest of the move slides along the surface
+      Vec3f hit_point = start + t*move;
+      Vec3f hit_normal = (1/radius) * (hit_point - center);
+      Vec3f rest = pos - hit_point;
+      rest -= rest.Dot3(hit_normal) * hit_normal;
+      normal = hit_point + rest - center;
+      normal.Normalize();
+    }
+    pos = center + radius * normal;
+    // nothing left moving into the sphere
+    double into = vel.Dot3(normal);
+    if (into < 0) vel -= into * normal;
+    hit = true;
+  }
+
+  for (unsigned int s = 0; s < planes.size(); s++) {
+    // a half space: anything behind it went through
+    const ClothPlane &plane = planes[s];
+    double distance = plane.normal.Dot3(pos - plane.point);
+    if (distance >= thickness) continue;
+    pos += (thickness - distance) * plane.normal;
+    double into = vel.Dot3(plane.normal);
+    if (into < 0) vel -= into * plane.normal;
+    hit = true;
+  }
+
+  if (hit) {
+    p.setPosition(i,pos);
+    p.setVelocity(i,vel);
+  }
+}
+
+// ================================================================================
+// self collision
+// ================================================================================
+
+void ClothCollider::triangleVertices(int t, int &a, int &b, int &c) const {
+  // grid square (i,j) is split along its (i,j)-(i+1,j+1) diagonal
+  int square = t/2;
+  a = (square % (nx-1)) + (square / (nx-1))*nx;
+  if (t % 2 == 0) {
+    b = a + 1;
+    c = a + 1 + nx;
+  } else {
+    b = a + 1 + nx;
+    c = a + nx;
+  }
+}
+
+bool ClothCollider::isCorner(int p, int t) const {
+  int a,b,c;
+  triangleVertices(t,a,b,c);
+  return p == a || p == b || p == c;
+}
+
+void ClothCollider::cellRange(const Vec3f &lo, const Vec3f &hi, int range[6]) const {
+  range[0] = (int)floor(lo.x() / cell_size);  range[1] = (int)floor(hi.x() / cell_size);
+  range[2] = (int)floor(lo.y() / cell_size);  range[3] = (int)floor(hi.y() / cell_size);
+  range[4] = (int)floor(lo.z() / cell_size);  range[5] = (int)floor(hi.z() / cell_size);
+}
+
+unsigned int ClothCollider::hashCell(int i, int j, int k) const {
+  unsigned int h = ((unsigned int)i * 73856093u) ^ ((unsigned int)j * 19349663u) ^ ((unsigned int)k * 83492791u);
+  return h % (unsigned int)(cell_start.size()-1);
+}
+
+void ClothCollider::BuildHash(const ClothParticles &p) {
+  int table_size = 2*p.size() + 1;
+  cell_start.assign(table_size+1,0);
+  // a counting sort: count each bucket's particles, then drop each
+  // particle in its buckets
+  for (int pass = 0; pass < 2; pass++) {
+    for (int n = 0; n < p.size(); n++) {
+      Vec3f start = getPreviousPosition(n);
+      Vec3f pos = p.getPosition(n);
+      Vec3f pad(thickness,thickness,thickness);
+      int range[6];
+      cellRange(MinVec(start,pos) - pad,MaxVec(start,pos) + pad,range);
+      for (int i = range[0]; i <= range[1]; i++) {
+        for (int j = range[2]; j <= range[3]; j++) {
+          for (int k = range[4]; k <= range[5]; k++) {
+            unsigned int h = hashCell(i,j,k);
+            if (pass == 0) cell_start[h]++;
+            else cell_particles[cell_start[h]++] = n;
+          }
+        }
+      }
+    }
+    if (pass == 0) {
+      // each bucket's start
+      int total = 0;
+      for (int h = 0; h < table_size; h++) {
+        int count = cell_start[h];
+        cell_start[h] = total;
+        total += count;
+      }
+      cell_start[table_size] = total;
+      cell_particles.resize(total);
+    }
+  }
+  // filling moved each start up to the next bucket's
+  for (int h = table_size; h > 0; h--) cell_start[h] = cell_start[h-1];
+  cell_start[0] = 0;
+}
+
+void ClothCollider::FindContacts(const ClothParticles &p, int t, std::vector<int> &candidates,
+                                 std::vector<Contact> &contacts) const {
+  SweptTriangle triangle;
+  triangle.index = t;
+  int a,b,c;
+  triangleVertices(t,a,b,c);
+  triangle.a0 = getPreviousPosition(a);  triangle.a1 = p.getPosition(a);
+  triangle.b0 = getPreviousPosition(b);  triangle.b1 = p.getPosition(b);
+  triangle.c0 = getPreviousPosition(c);  triangle.c1 = p.getPosition(c);
+  Vec3f::Cross3(triangle.n1,triangle.b1-triangle.a1,triangle.c1-triangle.a1);
+  if (triangle.n1.Length() == 0) return;
+  triangle.n1.Normalize();
+  Vec3f::Cross3(triangle.n0,triangle.b0-triangle.a0,triangle.c0-triangle.a0);
+  if (triangle.n0.Length() == 0) triangle.n0 = triangle.n1;
+  triangle.n0.Normalize();
+  Vec3f pad(thickness,thickness,thickness);
+  triangle.lo = MinVec(MinVec(MinVec(triangle.a0,triangle.b0),MinVec(triangle.c0,triangle.a1)),
+                       MinVec(triangle.b1,triangle.c1)) - pad;
+  triangle.hi = MaxVec(MaxVec(MaxVec(triangle.a0,triangle.b0),MaxVec(triangle.c0,triangle.a1)),
+                       MaxVec(triangle.b1,triangle.c1)) + pad;
+
+  // every particle in a bucket the triangle's sweep touches (some of
+  // them more than once)
+  int range[6];
+  cellRange(triangle.lo + pad,triangle.hi - pad,range);
+  candidates.clear();
+  for (int i = range[0]; i <= range[1]; i++) {
+    for (int j = range[2]; j <= range[3]; j++) {
+      for (int k = range[4]; k <= range[5]; k++) {
+        unsigned int h = hashCell(i,j,k);
+        candidates.insert(candidates.end(),cell_particles.begin()+cell_start[h],cell_particles.begin()+cell_start[h+1]);
+      }
+    }
+  }
+  unsigned int first = contacts.size();
+  for (unsigned int n = 0; n < candidates.size(); n++) {
+    int q = candidates[n];
+    if (isCorner(q,t)) continue;
+    // (buckets are shared by far away cells, and cells are bigger than
+    // the sweeps: most candidates don't come close)
+    if (std::min(previous_x[q],p.x[q]) > triangle.hi.x() || std::max(previous_x[q],p.x[q]) < triangle.lo.x() ||
+        std::min(previous_y[q],p.y[q]) > triangle.hi.y() || std::max(previous_y[q],p.y[q]) < triangle.lo.y() ||
+        std::min(previous_z[q],p.z[q]) > triangle.hi.z() || std::max(previous_z[q],p.z[q]) < triangle.lo.z())
+      continue;
+    Contact contact;
+    if (!TestParticle(p,q,triangle,contact)) continue;
+    // (contacts are rare, a sort of the candidates to drop the
+    // repeats costs more than this)
+    bool repeat = false;
+    for (unsigned int m = first; m < contacts.size() && !repeat; m++)
+      repeat = (contacts[m].particle == q);
+    if (!repeat) contacts.push_back(contact);
+  }
+}
+
+bool ClothCollider::TestParticle(const ClothParticles &p, int q, const SweptTriangle &triangle, Contact &contact) const {
+  Vec3f q0 = getPreviousPosition(q), q1 = p.getPosition(q);
+  // signed distance to the triangle's plane, at the start & end of the step
+  double d0 = triangle.n0.Dot3(q0-triangle.a0);
+  double d1 = triangle.n1.Dot3(q1-triangle.a1);
+  bool crossed = (d0 >= 0) != (d1 >= 0);
+  if (!crossed && fabs(d1) >= thickness) return false;
+
+  // where the particle meets the plane: where it crossed (everything
+  // moving in straight lines), else where it is now
+  Vec3f x = q1, ta = triangle.a1, tb = triangle.b1, tc = triangle.c1;
+  if (crossed) {
+    double s = d0 / (d0 - d1);
+    x = q0 + s*(q1-q0);
+    ta = triangle.a0 + s*(triangle.a1-triangle.a0);
+    tb = triangle.b0 + s*(triangle.b1-triangle.b0);
+    tc = triangle.c0 + s*(triangle.c1-triangle.c0);
+  }
+  // is that inside the triangle?
+  Vec3f e0 = tb - ta, e1 = tc - ta, e2 = x - ta;
+  double d00 = e0.Dot3(e0), d01 = e0.Dot3(e1), d11 = e1.Dot3(e1);
+  double d20 = e2.Dot3(e0), d21 = e2.Dot3(e1);
+  double denominator = d00*d11 - d01*d01;
+  if (denominator <= 0) return false;
+  double v = (d11*d20 - d01*d21) / denominator;
+  double w = (d00*d21 - d01*d20) / denominator;
+  double u = 1 - v - w;
+  if (u < 0 || v < 0 || w < 0) return false;
+
+  contact.particle = q;
+  contact.triangle = triangle.index;
+  contact.u = u;  contact.v = v;  contact.w = w;
+  contact.side = (d0 >= 0) ? 1 : -1;
+  return true;
+}
+
+void ClothCollider::ResolveContact(ClothParticles &p, const Contact &contact) const {
+  // where things are now (earlier contacts may have moved them)
+  int a,b,c;
+  triangleVertices(contact.triangle,a,b,c);
+  int q = contact.particle;
+  Vec3f pa = p.getPosition(a), pb = p.getPosition(b), pc = p.getPosition(c);
+  Vec3f normal;
+  Vec3f::Cross3(normal,pb-pa,pc-pa);
+  if (normal.Length() == 0) return;
+  normal.Normalize();
+  normal *= contact.side;
+  Vec3f closest = contact.u*pa + contact.v*pb + contact.w*pc;
+  double depth = thickness - normal.Dot3(p.getPosition(q) - closest);
+  if (depth <= 0) return;
+  // split the push between the particle & the triangle's corners by
+  // inverse mass, the corners by their weight in the closest point
+  double wq = p.inv_mass[q];
+  double wa = contact.u*p.inv_mass[a], wb = contact.v*p.inv_mass[b], wc = contact.w*p.inv_mass[c];
+  double total = wq + contact.u*wa + contact.v*wb + contact.w*wc;
+  if (total == 0) return;
+  double push = depth / total;
+  // & stop them moving into each other (inelastic), split the same way
+  Vec3f closest_velocity = contact.u*p.getVelocity(a) + contact.v*p.getVelocity(b) + contact.w*p.getVelocity(c);
+  double approach = normal.Dot3(p.getVelocity(q) - closest_velocity);
+  double stop = (approach < 0) ? -approach / total : 0;
+  if (wq != 0) Nudge(p,q,wq*normal,push,stop);
+  if (wa != 0) Nudge(p,a,-wa*normal,push,stop);
+  if (wb != 0) Nudge(p,b,-wb*normal,push,stop);
+  if (wc != 0) Nudge(p,c,-wc*normal,push,stop);
+}
+
+// ================================================================================
@@ -0,0 +1,119 @@
+#ifndef _CLOTH_COLLISION_H_
+#define _CLOTH_COLLISION_H_
+
+#include <vector>
+#include "cloth_kernels.h"
+#include "thread_pool.h"
+
+#define COLLISION_MIN_CHUNK 1024
+
+// =====================================================================================
+// Collisions of the cloth with spheres, planes & itself, applied at the
+// end of every step: everything is pushed a "thickness" away from
+// everything else, and whatever was moving into what it hit stops
+// (inelastic, no friction).
+//
+// Continuous: each particle is tested along its path from the start of
+// the step, so a fast one that went right through a sphere, a plane
+// or a triangle of the cloth during the step is still caught and put
+// back on the side it came from.
+//
+// Self collision, particle against triangle (2 per grid square, not
+// the particle's own), through a spatial hash (Teschner et al.
+// '03) rebuilt every step: each particle goes in every cell its path
+// (+ thickness) touches, a counting sort into a table ~2x the particle
+// count, and each triangle looks in the cells its own swept box
+// touches.  With cells the size of the grid spacing that's a few
+// cells & a few particles per triangle, so the cost is linear in the
+// number of particles.  Triangles are searched on all threads, chunk
+// by chunk, and the contacts resolved one at a time in triangle order:
+// the same on any number of threads.
+// =====================================================================================
+
+struct ClothSphere {
+  Vec3f center;
+  double radius;
+};
+
+// particles stay on the normal's side
+struct ClothPlane {
+  Vec3f point;
+  Vec3f normal;
+};
+
+class ClothCollider {
+public:
+  ClothCollider() : self_collision(false), thickness(0), nx(0), ny(0), cell_size(1), last_contacts(0) {}
+
+  // ACCESSORS
+  bool hasCollisions() const { return self_collision || !spheres.empty() || !planes.empty(); }
+  bool hasSelfCollision() const { return self_collision; }
+  double getThickness() const { return thickness; }
+  const std::vector<ClothSphere>& getSpheres() const { return spheres; }
+  const std::vector<ClothPlane>& getPlanes() const { return planes; }
+  // self collision contacts in the last step
+  int getLastContacts() const { return last_contacts; }
+
+  // MODIFIERS
+  void addSphere(const Vec3f &center, double radius);
+  void addPlane(const Vec3f &point, const Vec3f &normal);
+  void setSelfCollision(bool b) { self_collision = b; }
+  void setThickness(double t) { thickness = t; }
+  // the particles are an nx by ny grid, spacing apart (the hash cell size)
+  void setup(int nx, int ny, double spacing);
+
+  // at the start of a step
+  void SavePositions(const ClothParticles &particles, ThreadPool &pool);
+  // at the end of the step
+  void Collide(ClothParticles &particles, ThreadPool &pool);
+
+private:
+
+  struct Contact {
+    int particle;
+    int triangle;
+    float u, v, w;   // barycentric coordinates of the closest point
+    float side;      // +1 / -1, the side of the triangle the particle belongs on
+  };
+  // a triangle at the start (0) & end (1) of the step
+  struct SweptTriangle {
+    int index;
+    Vec3f a0, b0, c0, n0;
+    Vec3f a1, b1, c1, n1;
+    Vec3f lo, hi;    // bounding box of the whole sweep, + thickness
+  };
+
+  // objects
+  void CollideObjects(ClothParticles &particles, int p) const;
+  // self collision
+  void triangleVertices(int t, int &a, int &b, int &c) const;
+  bool isCorner(int p, int t) const;
+  void cellRange(const Vec3f &lo, const Vec3f &hi, int range[6]) const;
+  unsigned int hashCell(int i, int j, int k) const;
+  void BuildHash(const ClothParticles &particles);
+  void FindContacts(const ClothParticles &particles, int t, std::vector<int> &candidates,
+                    std::vector<Contact> &contacts) const;
+  bool TestParticle(const ClothParticles &particles, int p, const SweptTriangle &triangle, Contact &contact) const;
+  void ResolveContact(ClothParticles &particles, const Contact &contact) const;
+  Vec3f getPreviousPosition(int p) const { return Vec3f(previous_x[p],previous_y[p],previous_z[p]); }
+
+  // REPRESENTATION
+  std::vector<ClothSphere> spheres;
+  std::vector<ClothPlane> planes;
+  bool self_collision;
+  double thickness;
+  int nx, ny;
+  // positions at the start of the step
+  std::vector<float> previous_x, previous_y, previous_z;
+  // the spatial hash: the particles in bucket h are
+  // cell_particles[cell_start[h]] .. cell_particles[cell_start[h+1]-1]
+  double cell_size;
+  std::vector<int> cell_start;
+  std::vector<int> cell_particles;
+  // per chunk of triangles
+  std::vector<std::vector<Contact> > chunk_contacts;
+  std::vector<std::vector<int> > chunk_candidates;
+  int last_contacts;
+};
+
+#endif
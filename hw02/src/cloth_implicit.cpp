@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cmath>
+#include "cloth_implicit.h"
+
+// ================================================================================
+
+static double Dot(const std::vector<double> &a, const std::vector<double> &b) {
+  double result = 0;
+  for (unsigned int i = 0; i < a.size(); i++) result += a[i]*b[i];
+  return result;
+}
+
+// ================================================================================
+
+void ClothImplicitSolver::computeJacobians(const ClothParticles &p, const std::vector<ClothSpringSet> &springs) {
+  jacobians.resize(springs.size());
+  for (unsigned int set = 0; set < springs.size(); set++) {
+    const ClothSpringSet &s = springs[set];
+    std::vector<double> &blocks = jacobians[set];
+    blocks.resize(6*s.numSprings());
+    for (int n = 0; n < s.numSprings(); n++) {
+      int a = s.startParticle(n);
+      int b = a + s.offset;
+      double dx = p.x[b] - p.x[a];
+      double dy = p.y[b] - p.y[a];
+      double dz = p.z[b] - p.z[a];
+      double length = sqrt(dx*dx + dy*dy + dz*dz);
+      double *block = &blocks[6*n];
+      if (length == 0) {
+        std::fill(block,block+6,0.0);
+        continue;
+      }
+      dx /= length;  dy /= length;  dz /= length;
+      // k (n n^T + c (I - n n^T)), c = 1 - rest/length, but no
+      // sideways stiffness for a compressed spring (c < 0 would make
+      // the system indefinite)
+      double c = std::max(0.0,1 - s.rest_length[n]/length);
+      double k = s.k;
+      block[0] = k*((1-c)*dx*dx + c);
+      block[1] = k*(1-c)*dx*dy;
+      block[2] = k*(1-c)*dx*dz;
+      block[3] = k*((1-c)*dy*dy + c);
+      block[4] = k*(1-c)*dy*dz;
+      block[5] = k*((1-c)*dz*dz + c);
+    }
+  }
+}
+
+void ClothImplicitSolver::multiplyJacobian(const std::vector<ClothSpringSet> &springs,
+                                           const std::vector<double> &x, std::vector<double> &result) const {
+  std::fill(result.begin(),result.end(),0.0);
+  for (unsigned int set = 0; set < springs.size(); set++) {
+    const ClothSpringSet &s = springs[set];
+    const double *blocks = jacobians[set].data();
+    for (int n = 0; n < s.numSprings(); n++) {
+      int a = 3*s.startParticle(n);
+      int b = a + 3*s.offset;
+      const double *K = blocks + 6*n;
+      double dx = x[b]   - x[a];
+      double dy = x[b+1] - x[a+1];
+      double dz = x[b+2] - x[a+2];
+      double fx = K[0]*dx + K[1]*dy + K[2]*dz;
+      double fy = K[1]*dx + K[3]*dy + K[4]*dz;
+      double fz = K[2]*dx + K[4]*dy + K[5]*dz;
+      result[a] += fx;  result[a+1] += fy;  result[a+2] += fz;
+      result[b] -= fx;  result[b+1] -= fy;  result[b+2] -= fz;
+    }
+  }
+}
+
+void ClothImplicitSolver::multiplySystem(const ClothParticles &p, const std::vector<ClothSpringSet> &springs,
+                                         double damping, double dt, const std::vector<double> &x,
+                                         std::vector<double> &result) const {
+  multiplyJacobian(springs,x,result);
+  for (int i = 0; i < p.size(); i++) {
+    double m = p.mass[i] + dt*damping;
+    for (int c = 0; c < 3; c++)
+      result[3*i+c] = m*x[3*i+c] - dt*dt*result[3*i+c];
+  }
+  filter(p,result);
+}
+
+void ClothImplicitSolver::filter(const ClothParticles &p, std::vector<double> &x) const {
+  for (int i = 0; i < p.size(); i++) {
+    if (p.isFixed(i)) x[3*i] = x[3*i+1] = x[3*i+2] = 0;
+  }
+}
+
+// ================================================================================
+
+void ClothImplicitSolver::Step(ClothParticles &p, const std::vector<ClothSpringSet> &springs,
+                               double damping, double dt) {
+  int n = 3*p.size();
+  diagonal.resize(n);  rhs.resize(n);  dv.resize(n);
+  r.resize(n);  z.resize(n);  d.resize(n);  q.resize(n);
+
+  computeJacobians(p,springs);
+
+  // right hand side h (F + h dF/dx v), the velocities go in d for now
+  for (int i = 0; i < p.size(); i++) {
+    d[3*i] = p.vx[i];  d[3*i+1] = p.vy[i];  d[3*i+2] = p.vz[i];
+  }
+  multiplyJacobian(springs,d,q);
+  for (int i = 0; i < p.size(); i++) {
+    rhs[3*i]   = dt*(p.fx[i] + dt*q[3*i]);
+    rhs[3*i+1] = dt*(p.fy[i] + dt*q[3*i+1]);
+    rhs[3*i+2] = dt*(p.fz[i] + dt*q[3*i+2]);
+  }
+  filter(p,rhs);
+
+  // the preconditioner: the diagonal of the system, each spring adds
+  // its block's diagonal to both ends
+  for (int i = 0; i < p.size(); i++) {
+    double m = p.mass[i] + dt*damping;
+    diagonal[3*i] = diagonal[3*i+1] = diagonal[3*i+2] = m;
+  }
+  for (unsigned int set = 0; set < springs.size(); set++) {
+    const ClothSpringSet &s = springs[set];
+    const std::vector<double> &blocks = jacobians[set];
+    for (int k = 0; k < s.numSprings(); k++) {
+      int a = 3*s.startParticle(k);
+      int b = a + 3*s.offset;
+      for (int c = 0; c < 3; c++) {
+        double h2K = dt*dt*blocks[6*k + (c == 0 ? 0 : (c == 1 ? 3 : 5))];
+        diagonal[a+c] += h2K;
+        diagonal[b+c] += h2K;
+      }
+    }
+  }
+
+  // preconditioned conjugate gradient from dv = 0
+  std::fill(dv.begin(),dv.end(),0.0);
+  r = rhs;
+  for (int i = 0; i < n; i++) z[i] = r[i] / diagonal[i];
+  d = z;
+  double rz = Dot(r,z);
+  double target = tolerance*tolerance*Dot(rhs,rhs);
+  last_iterations = 0;
+  while (last_iterations < max_iterations && Dot(r,r) > target) {
+    multiplySystem(p,springs,damping,dt,d,q);
+    double dq = Dot(d,q);
+    if (dq <= 0) break;
+    double alpha = rz / dq;
+    for (int i = 0; i < n; i++) {
+      dv[i] += alpha*d[i];
+      r[i] -= alpha*q[i];
+    }
+    for (int i = 0; i < n; i++) z[i] = r[i] / diagonal[i];
+    double rz_new = Dot(r,z);
+    double beta = rz_new / rz;
+    rz = rz_new;
+    for (int i = 0; i < n; i++) d[i] = z[i] + beta*d[i];
+    filter(p,d);
+    last_iterations++;
+  }
+
+  // v += dv, x += h v
+  for (int i = 0; i < p.size(); i++) {
+    if (p.isFixed(i)) continue;
+    p.vx[i] += dv[3*i];  p.vy[i] += dv[3*i+1];  p.vz[i] += dv[3*i+2];
+    p.x[i] += dt*p.vx[i];  p.y[i] += dt*p.vy[i];  p.z[i] += dt*p.vz[i];
+  }
+}
+
+// ================================================================================
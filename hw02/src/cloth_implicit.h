@@ -0,0 +1,63 @@
+#ifndef _CLOTH_IMPLICIT_H_
+#define _CLOTH_IMPLICIT_H_
+
+#include <vector>
+#include "cloth_kernels.h"
+
+// =====================================================================================
+// Backward Euler for the cloth (Baraff & Witkin '98): the velocity change
+// dv of a step of size h solves
+//
+//   (M - h dF/dv - h^2 dF/dx) dv = h (F + h dF/dx v)
+//
+// dF/dv is the damping (-damping I per particle).  dF/dx is assembled
+// from the springs, one symmetric 3x3 block per spring (compressed
+// springs keep only their stretch direction so the matrix stays
+// definite), and multiplied without ever forming the sparse matrix.
+// The system is solved by conjugate gradient with a Jacobi (diagonal)
+// preconditioner; fixed particles are filtered out of every vector so
+// their dv stays 0.
+// =====================================================================================
+
+class ClothImplicitSolver {
+public:
+  ClothImplicitSolver() : tolerance(1e-4), max_iterations(200), last_iterations(0) {}
+
+  // ACCESSORS
+  double getTolerance() const { return tolerance; }
+  int getMaxIterations() const { return max_iterations; }
+  int getLastIterations() const { return last_iterations; }
+
+  // MODIFIERS
+  // CG stops when the residual is down to tolerance * the right hand side
+  void setTolerance(double t) { tolerance = t; }
+  void setMaxIterations(int n) { max_iterations = n; }
+
+  // moves the particles one step of size dt, particles.f* must hold the
+  // total force of the current state (ClothExternalForces + ClothSpringForces)
+  void Step(ClothParticles &particles, const std::vector<ClothSpringSet> &springs,
+            double damping, double dt);
+
+private:
+
+  void computeJacobians(const ClothParticles &particles, const std::vector<ClothSpringSet> &springs);
+  // result = dF/dx x (spring part only)
+  void multiplyJacobian(const std::vector<ClothSpringSet> &springs,
+                        const std::vector<double> &x, std::vector<double> &result) const;
+  // result = S A x, S zeroes the fixed particles
+  void multiplySystem(const ClothParticles &particles, const std::vector<ClothSpringSet> &springs,
+                      double damping, double dt, const std::vector<double> &x, std::vector<double> &result) const;
+  void filter(const ClothParticles &particles, std::vector<double> &x) const;
+
+  // REPRESENTATION
+  double tolerance;
+  int max_iterations;
+  int last_iterations;
+  // per spring set, 6 entries per spring: xx xy xz yy yz zz of dF_a/dx_b
+  std::vector<std::vector<double> > jacobians;
+  // 3 entries per particle (x y z), kept to not reallocate every step
+  std::vector<double> diagonal;   // of the system, the preconditioner
+  std::vector<double> rhs, dv, r, z, d, q;
+};
+
+#endif
@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <cmath>
+#include "cloth_kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CLOTH_HAVE_AVX2 1
+#include <immintrin.h>
+#define CLOTH_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define CLOTH_HAVE_AVX2 0
+#endif
+
+// ================================================================================
+
+void ClothParticles::resize(int n) {
+  std::vector<float>* arrays[] = { &x, &y, &z, &vx, &vy, &vz, &fx, &fy, &fz,
+                                   &ox, &oy, &oz, &mass, &inv_mass };
+  for (unsigned int a = 0; a < sizeof(arrays)/sizeof(arrays[0]); a++)
+    arrays[a]->assign(n,0);
+}
+
+// ================================================================================
+
+static void AddSpringSet(int nx, const ClothParticles &particles, int first_i, int first_j,
+                         int di, int dj, int columns, int rows, float k,
+                         std::vector<ClothSpringSet> &springs) {
+  ClothSpringSet s;
+  s.di = di;
+  s.dj = dj;
+  s.first = first_i + first_j*nx;
+  s.offset = di + dj*nx;
+  s.columns = std::max(columns,0);
+  s.rows = std::max(rows,0);
+  if (s.columns == 0 || s.rows == 0) s.columns = s.rows = 0;
+  s.row_stride = nx;
+  s.k = k;
+  s.rest_length.resize(s.numSprings());
+  for (int n = 0; n < s.numSprings(); n++) {
+    int a = s.startParticle(n);
+    s.rest_length[n] = particles.getOriginalPosition(a).Distance3f(particles.getOriginalPosition(a+s.offset));
+  }
+  springs.push_back(s);
+}
+
+void MakeClothSprings(int nx, int ny, const ClothParticles &particles,
+                      float k_structural, float k_shear, float k_bend,
+                      std::vector<ClothSpringSet> &springs) {
+  assert (particles.size() == nx*ny);
+  springs.clear();
+  // structural: to the next particle along i, along j
+  AddSpringSet(nx,particles,0,0,1,0,nx-1,ny  ,k_structural,springs);
+  AddSpringSet(nx,particles,0,0,0,1,nx  ,ny-1,k_structural,springs);
+  // shear: both diagonals of every grid square, (i,j)-(i+1,j+1) & (i+1,j)-(i,j+1)
+  AddSpringSet(nx,particles,0,0, 1,1,nx-1,ny-1,k_shear,springs);
+  AddSpringSet(nx,particles,1,0,-1,1,nx-1,ny-1,k_shear,springs);
+  // flex: skip one particle along i, along j
+  AddSpringSet(nx,particles,0,0,2,0,nx-2,ny  ,k_bend,springs);
+  AddSpringSet(nx,particles,0,0,0,2,nx  ,ny-2,k_bend,springs);
+}
+
+// ================================================================================
+// scalar kernels
+// ================================================================================
+
+static void SpringForcesScalar(ClothParticles &p, const ClothSpringSet &s, int row, int c_begin) {
+  int base = s.first + row*s.row_stride;
+  const float *rest = &s.rest_length[row*s.columns];
+  for (int c = c_begin; c < s.columns; c++) {
+    int a = base + c;
+    int b = a + s.offset;
+    float dx = p.x[b] - p.x[a];
+    float dy = p.y[b] - p.y[a];
+    float dz = p.z[b] - p.z[a];
+    float length = sqrtf(dx*dx + dy*dy + dz*dz);
+    if (length == 0) continue;
+    float scale = s.k * (length - rest[c]) / length;
+    p.fx[a] += scale*dx;  p.fy[a] += scale*dy;  p.fz[a] += scale*dz;
+    p.fx[b] -= scale*dx;  p.fy[b] -= scale*dy;  p.fz[b] -= scale*dz;
+  }
+}
+
+static float IntegrateScalar(ClothParticles &p, float dt, int begin, int end) {
+  float max_step2 = 0;
+  for (int i = begin; i < end; i++) {
+    float inv = p.inv_mass[i];
+    p.vx[i] += dt * p.fx[i] * inv;
+    p.vy[i] += dt * p.fy[i] * inv;
+    p.vz[i] += dt * p.fz[i] * inv;
+    float sx = dt * p.vx[i];
+    float sy = dt * p.vy[i];
+    float sz = dt * p.vz[i];
+    p.x[i] += sx;  p.y[i] += sy;  p.z[i] += sz;
+    max_step2 = std::max(max_step2, sx*sx + sy*sy + sz*sz);
+  }
+  return max_step2;
+}
+
+// ================================================================================
+// AVX2 kernels, 8 particles at a time, the remainder of a row (or of the
+// particles) by the scalar code
+// ================================================================================
+
+#if CLOTH_HAVE_AVX2
+
+CLOTH_AVX2
+static void SpringForcesAVX2(ClothParticles &p, const ClothSpringSet &s, int row_begin, int row_end) {
+  float *x = p.x.data(), *y = p.y.data(), *z = p.z.data();
+  float *fx = p.fx.data(), *fy = p.fy.data(), *fz = p.fz.data();
+  const __m256 k = _mm256_set1_ps(s.k);
+  const __m256 zero = _mm256_setzero_ps();
+  for (int row = row_begin; row < row_end; row++) {
+    int base = s.first + row*s.row_stride;
+    const float *rest = &s.rest_length[row*s.columns];
+    int c = 0;
+    for (; c + 8 <= s.columns; c += 8) {
+      int a = base + c;
+      int b = a + s.offset;
+      __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x+b),_mm256_loadu_ps(x+a));
+      __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y+b),_mm256_loadu_ps(y+a));
+      __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z+b),_mm256_loadu_ps(z+a));
+      __m256 length2 = _mm256_fmadd_ps(dx,dx,_mm256_fmadd_ps(dy,dy,_mm256_mul_ps(dz,dz)));
+      __m256 length = _mm256_sqrt_ps(length2);
+      __m256 scale = _mm256_div_ps(_mm256_mul_ps(k,_mm256_sub_ps(length,_mm256_loadu_ps(rest+c))),length);
+      // a spring of length 0 has no direction, skip it
+      scale = _mm256_and_ps(scale,_mm256_cmp_ps(length2,zero,_CMP_GT_OQ));
+      // the a ends are written back before the b ends are read: with a
+      // short offset (1 or 2) the two ranges overlap
+      _mm256_storeu_ps(fx+a,_mm256_fmadd_ps(scale,dx,_mm256_loadu_ps(fx+a)));
+      _mm256_storeu_ps(fy+a,_mm256_fmadd_ps(scale,dy,_mm256_loadu_ps(fy+a)));
+      _mm256_storeu_ps(fz+a,_mm256_fmadd_ps(scale,dz,_mm256_loadu_ps(fz+a)));
+      _mm256_storeu_ps(fx+b,_mm256_fnmadd_ps(scale,dx,_mm256_loadu_ps(fx+b)));
+      _mm256_storeu_ps(fy+b,_mm256_fnmadd_ps(scale,dy,_mm256_loadu_ps(fy+b)));
+      _mm256_storeu_ps(fz+b,_mm256_fnmadd_ps(scale,dz,_mm256_loadu_ps(fz+b)));
+    }
+    SpringForcesScalar(p,s,row,c);
+  }
+}
+
+CLOTH_AVX2
+static float IntegrateAVX2(ClothParticles &p, float dt, int begin, int end) {
+  const __m256 step = _mm256_set1_ps(dt);
+  __m256 max_step2 = _mm256_setzero_ps();
+  int i = begin;
+  for (; i + 8 <= end; i += 8) {
+    __m256 dt_inv = _mm256_mul_ps(step,_mm256_loadu_ps(&p.inv_mass[i]));
+    __m256 vx = _mm256_fmadd_ps(dt_inv,_mm256_loadu_ps(&p.fx[i]),_mm256_loadu_ps(&p.vx[i]));
+    __m256 vy = _mm256_fmadd_ps(dt_inv,_mm256_loadu_ps(&p.fy[i]),_mm256_loadu_ps(&p.vy[i]));
+    __m256 vz = _mm256_fmadd_ps(dt_inv,_mm256_loadu_ps(&p.fz[i]),_mm256_loadu_ps(&p.vz[i]));
+    _mm256_storeu_ps(&p.vx[i],vx);
+    _mm256_storeu_ps(&p.vy[i],vy);
+    _mm256_storeu_ps(&p.vz[i],vz);
+    __m256 sx = _mm256_mul_ps(step,vx);
+    __m256 sy = _mm256_mul_ps(step,vy);
+    __m256 sz = _mm256_mul_ps(step,vz);
+    _mm256_storeu_ps(&p.x[i],_mm256_add_ps(_mm256_loadu_ps(&p.x[i]),sx));
+    _mm256_storeu_ps(&p.y[i],_mm256_add_ps(_mm256_loadu_ps(&p.y[i]),sy));
+    _mm256_storeu_ps(&p.z[i],_mm256_add_ps(_mm256_loadu_ps(&p.z[i]),sz));
+    max_step2 = _mm256_max_ps(max_step2,_mm256_fmadd_ps(sx,sx,_mm256_fmadd_ps(sy,sy,_mm256_mul_ps(sz,sz))));
+  }
+  float lanes[8];
+  _mm256_storeu_ps(lanes,max_step2);
+  float result = IntegrateScalar(p,dt,i,end);
+  for (int l = 0; l < 8; l++) result = std::max(result,lanes[l]);
+  return result;
+}
+
+static bool CpuHasAVX2() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+static bool use_avx2 = CpuHasAVX2();
+
+bool ClothUseSIMD(bool simd) {
+  use_avx2 = simd && CpuHasAVX2();
+  return use_avx2;
+}
+
+#else
+
+static bool use_avx2 = false;
+
+bool ClothUseSIMD(bool) { return false; }
+
+#endif
+
+bool ClothUsingSIMD() { return use_avx2; }
+
+// ================================================================================
+
+void ClothExternalForces(ClothParticles &p, const Vec3f &gravity, float damping) {
+  ClothExternalForces(p,gravity,damping,0,p.size());
+}
+
+void ClothExternalForces(ClothParticles &p, const Vec3f &gravity, float damping, int begin, int end) {
+  float gx = gravity.x(), gy = gravity.y(), gz = gravity.z();
+  for (int i = begin; i < end; i++) {
+    p.fx[i] = p.mass[i]*gx - damping*p.vx[i];
+    p.fy[i] = p.mass[i]*gy - damping*p.vy[i];
+    p.fz[i] = p.mass[i]*gz - damping*p.vz[i];
+  }
+}
+
+void ClothSpringForces(ClothParticles &particles, const ClothSpringSet &springs) {
+  ClothSpringForces(particles,springs,0,springs.rows);
+}
+
+void ClothSpringForces(ClothParticles &particles, const ClothSpringSet &springs, int row_begin, int row_end) {
+#if CLOTH_HAVE_AVX2
+  if (use_avx2) {
+    SpringForcesAVX2(particles,springs,row_begin,row_end);
+    return;
+  }
+#endif
+  for (int row = row_begin; row < row_end; row++)
+    SpringForcesScalar(particles,springs,row,0);
+}
+
+float ClothIntegrate(ClothParticles &particles, float dt) {
+  return ClothIntegrate(particles,dt,0,particles.size());
+}
+
+float ClothIntegrate(ClothParticles &particles, float dt, int begin, int end) {
+  float max_step2;
+#if CLOTH_HAVE_AVX2
+  if (use_avx2)
+    max_step2 = IntegrateAVX2(particles,dt,begin,end);
+  else
+#endif
+    max_step2 = IntegrateScalar(particles,dt,begin,end);
+  return sqrtf(max_step2);
+}
+
+void ClothMaxMotion(const ClothParticles &p, int begin, int end,
+                    float &max_speed2, float &max_acceleration2) {
+  max_speed2 = max_acceleration2 = 0;
+  for (int i = begin; i < end; i++) {
+    // (fixed particles have inv_mass == 0 but may have a velocity)
+    float inv = p.inv_mass[i];
+    float speed2 = p.vx[i]*p.vx[i] + p.vy[i]*p.vy[i] + p.vz[i]*p.vz[i];
+    float force2 = p.fx[i]*p.fx[i] + p.fy[i]*p.fy[i] + p.fz[i]*p.fz[i];
+    if (inv != 0) max_speed2 = std::max(max_speed2,speed2);
+    max_acceleration2 = std::max(max_acceleration2,force2*inv*inv);
+  }
+}
+
+// ================================================================================
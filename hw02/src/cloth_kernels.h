@@ -0,0 +1,95 @@
+#ifndef _CLOTH_KERNELS_H_
+#define _CLOTH_KERNELS_H_
+
+#include <cassert>
+#include <vector>
+#include "vectors.h"
+
+// =====================================================================================
+// Cloth particles, structure of arrays: one float array per coordinate,
+// indexed by i + j*nx, so 8 neighboring particles along i come in with
+// a single AVX load.
+// =====================================================================================
+
+class ClothParticles {
+public:
+  void resize(int n);
+  int size() const { return (int)x.size(); }
+
+  // ACCESSORS
+  Vec3f getPosition(int p) const { return Vec3f(x[p],y[p],z[p]); }
+  Vec3f getOriginalPosition(int p) const { return Vec3f(ox[p],oy[p],oz[p]); }
+  Vec3f getVelocity(int p) const { return Vec3f(vx[p],vy[p],vz[p]); }
+  Vec3f getForce(int p) const { return Vec3f(fx[p],fy[p],fz[p]); }
+  double getMass(int p) const { return mass[p]; }
+  bool isFixed(int p) const { return inv_mass[p] == 0; }
+  bool isLoose(int p) const { return inv_mass[p] != 0; }
+
+  // MODIFIERS
+  void setPosition(int p, const Vec3f &v) { x[p] = v.x(); y[p] = v.y(); z[p] = v.z(); }
+  void setOriginalPosition(int p, const Vec3f &v) { ox[p] = v.x(); oy[p] = v.y(); oz[p] = v.z(); }
+  void setVelocity(int p, const Vec3f &v) { vx[p] = v.x(); vy[p] = v.y(); vz[p] = v.z(); }
+  void setMass(int p, double m) { mass[p] = m; if (inv_mass[p] != 0) inv_mass[p] = 1/m; }
+  // fixed particles have no inverse mass: forces never move them
+  void setFixed(int p, bool b) { inv_mass[p] = b ? 0 : 1/mass[p]; }
+
+  // REPRESENTATION
+  std::vector<float> x, y, z;      // position
+  std::vector<float> vx, vy, vz;   // velocity
+  std::vector<float> fx, fy, fz;   // total force of the last step
+  std::vector<float> ox, oy, oz;   // original (rest) position
+  std::vector<float> mass;
+  std::vector<float> inv_mass;     // 0 == fixed
+};
+
+// =====================================================================================
+// The springs of one kind along one grid direction: from particle
+// p = first + c + r*row_stride to p + offset, for c < columns, r < rows.
+// Within a row the springs (and both their ends) are consecutive
+// particles, which is what the kernels vectorize over.
+// =====================================================================================
+
+struct ClothSpringSet {
+  int di, dj;      // the grid step from one end to the other
+  int first;
+  int offset;
+  int columns, rows;
+  int row_stride;
+  float k;
+  std::vector<float> rest_length;  // columns*rows, row by row
+  int numSprings() const { return columns*rows; }
+  int startParticle(int s) const { return first + s%columns + (s/columns)*row_stride; }
+};
+
+// the structural (2), shear (2) & flex (2) spring sets of an nx by ny
+// grid, in that order, rest lengths from the original positions
+void MakeClothSprings(int nx, int ny, const ClothParticles &particles,
+                      float k_structural, float k_shear, float k_bend,
+                      std::vector<ClothSpringSet> &springs);
+
+// =====================================================================================
+// Kernels.  AVX2 (+FMA) when the compiler can target it and the cpu has
+// it, else plain loops.  The two sum the same forces in a different
+// order, so they agree to float rounding, not bit for bit.
+// =====================================================================================
+
+// false forces the scalar kernels, returns whether AVX2 is used
+bool ClothUseSIMD(bool simd);
+bool ClothUsingSIMD();
+
+// force = mass * gravity - damping * velocity
+void ClothExternalForces(ClothParticles &particles, const Vec3f &gravity, float damping);
+void ClothExternalForces(ClothParticles &particles, const Vec3f &gravity, float damping, int begin, int end);
+// adds every spring of the set (or of rows [row_begin,row_end) of it):
+// its pull on one end is the push on the other
+void ClothSpringForces(ClothParticles &particles, const ClothSpringSet &springs);
+void ClothSpringForces(ClothParticles &particles, const ClothSpringSet &springs, int row_begin, int row_end);
+// explicit Euler on the loose particles, returns the longest move
+float ClothIntegrate(ClothParticles &particles, float dt);
+float ClothIntegrate(ClothParticles &particles, float dt, int begin, int end);
+// the largest squared speed & squared acceleration (force / mass) of
+// the loose particles in [begin,end)
+void ClothMaxMotion(const ClothParticles &particles, int begin, int end,
+                    float &max_speed2, float &max_acceleration2);
+
+#endif
@@ -33,11 +33,10 @@ void Cloth::setupVBOs() {
   // mesh surface positions & normals
   for (int i = 0; i < nx; i++) {
     for (int j = 0; j < ny; j++) {
-      const ClothParticle &p = getParticle(i,j);
-      const Vec3f &pos = p.getPosition();
+      Vec3f pos = getPosition(i,j);
       Vec3f normal = computeGouraudNormal(i,j); 
       Vec3f color = Vec3f(0,0,0);
-      if (p.isFixed()) 
+      if (isFixed(i,j)) 
 	color = Vec3f(0,1,0);
       cloth_verts.push_back(VBOPosNormalColor(pos,normal,color));
     }
@@ -68,10 +67,10 @@ void Cloth::setupVBOs() {
   // velocity & force visualization
   for (int i = 0; i < nx; i++) {
     for (int j = 0; j < ny; j++) {
-      const ClothParticle &p = getParticle(i,j);
-      const Vec3f &pos = p.getPosition();
-      const Vec3f &vel = p.getVelocity();
-      const Vec3f &frc = p.getForce();
+      Vec3f pos = getPosition(i,j);
+      Vec3f vel = getVelocity(i,j);
+      // (the pins don't move, whatever pulls on them)
+      Vec3f frc = isFixed(i,j) ? Vec3f(0,0,0) : getForce(i,j);
 
       float dt = args->timestep;
 
@@ -179,6 +178,19 @@ void Cloth::drawVBOs() {
     glDisableClientState(GL_VERTEX_ARRAY);
   }
 
+  // =====================================================================================
+  // the spheres the cloth collides with
+  // =====================================================================================
+  const std::vector<ClothSphere> &spheres = collider.getSpheres();
+  for (unsigned int s = 0; s < spheres.size(); s++) {
+    glColor3f(0.5,0.5,1);
+    glLineWidth(1);
+    glPushMatrix();
+    glTranslatef(spheres[s].center.x(),spheres[s].center.y(),spheres[s].center.z());
+    glutWireSphere(spheres[s].radius,24,16);
+    glPopMatrix();
+  }
+
   // =====================================================================================
   // render the velocity at each particle
   // =====================================================================================
@@ -219,6 +231,8 @@ void Cloth::drawVBOs() {
 }
 
 void Cloth::cleanupVBOs() { 
+  // never made (no window)
+  if (cloth_verts_VBO == 0) return;
   glDeleteBuffers(1, &cloth_verts_VBO);
   glDeleteBuffers(1, &cloth_quad_indices_VBO);
   glDeleteBuffers(1, &cloth_happy_edge_indices_VBO);
@@ -234,10 +248,10 @@ void Cloth::cleanupVBOs() {
 
 void Cloth::AddVBOEdge(int i1, int j1, int i2, int j2, double correction) {
   Vec3f a_o, b_o, a, b;
-  a = getParticle(i1,j1).getPosition();
-  b = getParticle(i2,j2).getPosition();
-  a_o = getParticle(i1,j1).getOriginalPosition();
-  b_o = getParticle(i2,j2).getOriginalPosition();
+  a = getPosition(i1,j1);
+  b = getPosition(i2,j2);
+  a_o = getOriginalPosition(i1,j1);
+  b_o = getOriginalPosition(i2,j2);
   double length_o,length;
   length = (a-b).Length();
   length_o = (a_o-b_o).Length();
@@ -254,16 +268,16 @@ void Cloth::AddVBOEdge(int i1, int j1, int i2, int j2, double correction) {
 Vec3f Cloth::computeGouraudNormal(int i, int j) const {
   assert (i >= 0 && i < nx && j >= 0 && j < ny);
 
-  Vec3f pos = getParticle(i,j).getPosition();
+  Vec3f pos = getPosition(i,j);
   Vec3f north = pos;
   Vec3f south = pos;
   Vec3f east = pos;
   Vec3f west = pos;
   
-  if (i-1 >= 0) north = getParticle(i-1,j).getPosition();
-  if (i+1 < nx) south = getParticle(i+1,j).getPosition();
-  if (j-1 >= 0) east = getParticle(i,j-1).getPosition();
-  if (j+1 < ny) west = getParticle(i,j+1).getPosition();
+  if (i-1 >= 0) north = getPosition(i-1,j);
+  if (i+1 < nx) south = getPosition(i+1,j);
+  if (j-1 >= 0) east = getPosition(i,j-1);
+  if (j+1 < ny) west = getPosition(i,j+1);
 
   Vec3f vns = north - south;
   Vec3f vwe = west - east;
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+#include "cloth_xpbd.h"
+
+// ================================================================================
+
+void ClothXPBDSolver::setupConstraints(const std::vector<ClothSpringSet> &springs) {
+  // greedy coloring: each constraint gets the lowest color neither of
+  // its particles has yet.  A particle has at most 12 springs, so 23
+  // colors are enough
+  int num_particles = 0;
+  int num_constraints = 0;
+  for (unsigned int set = 0; set < springs.size(); set++) {
+    const ClothSpringSet &s = springs[set];
+    num_constraints += s.numSprings();
+    for (int n = 0; n < s.numSprings(); n++)
+      num_particles = std::max(num_particles,s.startParticle(n)+s.offset+1);
+  }
+  std::vector<uint64_t> used(num_particles,0);
+  std::vector<int> color(num_constraints);
+  std::vector<int> color_count;
+  int c = 0;
+  for (unsigned int set = 0; set < springs.size(); set++) {
+    const ClothSpringSet &s = springs[set];
+    for (int n = 0; n < s.numSprings(); n++, c++) {
+      int pa = s.startParticle(n);
+      int pb = pa + s.offset;
+      uint64_t taken = used[pa] | used[pb];
+      int k = 0;
+      while (taken & ((uint64_t)1 << k)) k++;
+      assert (k < 64);
+      color[c] = k;
+      used[pa] |= (uint64_t)1 << k;
+      used[pb] |= (uint64_t)1 << k;
+      if (k >= (int)color_count.size()) color_count.resize(k+1,0);
+      color_count[k]++;
+    }
+  }
+
+  // the batches, in color order
+  batch_start.assign(color_count.size()+1,0);
+  for (unsigned int k = 0; k < color_count.size(); k++)
+    batch_start[k+1] = batch_start[k] + color_count[k];
+  std::vector<int> next(batch_start.begin(),batch_start.end()-1);
+  a.resize(num_constraints);
+  b.resize(num_constraints);
+  rest_length.resize(num_constraints);
+  compliance.resize(num_constraints);
+  lambda.assign(num_constraints,0);
+  c = 0;
+  for (unsigned int set = 0; set < springs.size(); set++) {
+    const ClothSpringSet &s = springs[set];
+    for (int n = 0; n < s.numSprings(); n++, c++) {
+      int slot = next[color[c]]++;
+      a[slot] = s.startParticle(n);
+      b[slot] = a[slot] + s.offset;
+      rest_length[slot] = s.rest_length[n];
+      compliance[slot] = (s.k > 0) ? 1/s.k : 1e30f;
+    }
+  }
+}
+
+// ================================================================================
+
+void ClothXPBDSolver::projectBatch(ClothParticles &p, int begin, int end, double alpha_scale) {
+  for (int c = begin; c < end; c++) {
+    int pa = a[c];
+    int pb = b[c];
+    double wa = p.inv_mass[pa];
+    double wb = p.inv_mass[pb];
+    if (wa + wb == 0) continue;
+    double dx = p.x[pa] - p.x[pb];
+    double dy = p.y[pa] - p.y[pb];
+    double dz = p.z[pa] - p.z[pb];
+    double length = sqrt(dx*dx + dy*dy + dz*dz);
+    if (length == 0) continue;
+    // C = length - rest, its gradient is +-(a-b)/length
+    double alpha = compliance[c] * alpha_scale;
+    double delta_lambda = (-(length - rest_length[c]) - alpha*lambda[c]) / (wa + wb + alpha);
+    lambda[c] += delta_lambda;
+    double s = delta_lambda / length;
+    p.x[pa] += wa*s*dx;  p.y[pa] += wa*s*dy;  p.z[pa] += wa*s*dz;
+    p.x[pb] -= wb*s*dx;  p.y[pb] -= wb*s*dy;  p.z[pb] -= wb*s*dz;
+  }
+}
+
+void ClothXPBDSolver::Step(ClothParticles &p, double dt, ThreadPool &pool) {
+  previous_x.resize(p.size());
+  previous_y.resize(p.size());
+  previous_z.resize(p.size());
+
+  // predict with the external forces only
+  pool.ParallelFor(p.size(),XPBD_MIN_CHUNK,[&](int begin, int end) {
+      std::copy(p.x.begin()+begin,p.x.begin()+end,previous_x.begin()+begin);
+      std::copy(p.y.begin()+begin,p.y.begin()+end,previous_y.begin()+begin);
+      std::copy(p.z.begin()+begin,p.z.begin()+end,previous_z.begin()+begin);
+      ClothIntegrate(p,dt,begin,end);
+    });
+
+  // project, one color at a time
+  std::fill(lambda.begin(),lambda.end(),0.0f);
+  double alpha_scale = 1/(dt*dt);
+  for (int i = 0; i < iterations; i++) {
+    for (int k = 0; k < numColors(); k++) {
+      int first = batch_start[k];
+      pool.ParallelFor(batch_start[k+1]-first,XPBD_MIN_CHUNK,[&](int begin, int end) {
+          projectBatch(p,first+begin,first+end,alpha_scale);
+        });
+    }
+  }
+
+  // the velocity is whatever got the particles where they are
+  float inv_dt = 1/dt;
+  pool.ParallelFor(p.size(),XPBD_MIN_CHUNK,[&](int begin, int end) {
+      for (int i = begin; i < end; i++) {
+        p.vx[i] = (p.x[i] - previous_x[i]) * inv_dt;
+        p.vy[i] = (p.y[i] - previous_y[i]) * inv_dt;
+        p.vz[i] = (p.z[i] - previous_z[i]) * inv_dt;
+      }
+    });
+}
+
+// ================================================================================
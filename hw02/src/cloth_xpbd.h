@@ -0,0 +1,59 @@
+#ifndef _CLOTH_XPBD_H_
+#define _CLOTH_XPBD_H_
+
+#include <vector>
+#include "cloth_kernels.h"
+#include "thread_pool.h"
+
+#define XPBD_MIN_CHUNK 2048
+
+// =====================================================================================
+// Extended position based dynamics (Macklin, Mueller & Chentanez '16)
+// for the cloth: every spring is a distance constraint with compliance
+// 1/k, so a spring's stiffness is its k no matter the timestep or the
+// number of iterations.  A step moves the particles by gravity &
+// damping alone, projects the constraints a number of times, and takes
+// the velocities from how far the particles got.
+//
+// The constraints are greedily colored so no two of one color share a
+// particle, and stored color by color: a color is a batch whose
+// constraints can be projected all at once, on any number of threads,
+// always with the same result.
+//
+// (smaller batches or particle ranges than XPBD_MIN_CHUNK aren't split)
+// =====================================================================================
+
+class ClothXPBDSolver {
+public:
+  ClothXPBDSolver() : iterations(10) {}
+
+  // ACCESSORS
+  int getIterations() const { return iterations; }
+  int numColors() const { return (int)batch_start.size()-1; }
+
+  // MODIFIERS
+  void setIterations(int n) { iterations = n; }
+  // one constraint per spring, compliance 1/k
+  void setupConstraints(const std::vector<ClothSpringSet> &springs);
+
+  // moves the particles one step of size dt, particles.f* must hold the
+  // external forces (ClothExternalForces)
+  void Step(ClothParticles &particles, double dt, ThreadPool &pool);
+
+private:
+
+  void projectBatch(ClothParticles &particles, int begin, int end, double alpha_scale);
+
+  // REPRESENTATION
+  int iterations;
+  // the constraints, color by color: batch c is [batch_start[c],batch_start[c+1])
+  std::vector<int> a, b;
+  std::vector<float> rest_length;
+  std::vector<float> compliance;
+  std::vector<float> lambda;
+  std::vector<int> batch_start;
+  // positions at the start of the step
+  std::vector<float> previous_x, previous_y, previous_z;
+};
+
+#endif
@@ -16,6 +16,7 @@
 
 #define BETA_0 1.7
 #define EPSILON 0.0001
+#define FLUID_MAX_SUBSTEPS 1000
 
 // ==============================================================
 // ==============================================================
@@ -25,6 +26,7 @@
 
 Fluid::Fluid(ArgParser *_args) {
   args = _args;
+  dt = args->timestep;
   Load();
   marchingCubes = new MarchingCubes(nx+1,ny+1,nz+1,dx,dy,dz);
   SetEmptySurfaceFull();
@@ -33,7 +35,6 @@ Fluid::Fluid(ArgParser *_args) {
 }
 
 Fluid::~Fluid() { 
-  delete [] cells; 
   delete marchingCubes; 
   cleanupVBOs(); 
 }
@@ -45,10 +46,11 @@ void Fluid::Load() {
   // open the file
   assert (args->fluid_file != "");
   std::ifstream istr(args->fluid_file.c_str());
-  assert (istr != NULL);
+  assert (istr.good());
   std::string token, token2, token3, mode;
 
 
+  Foster = false;
   istr >> mode;
   if(mode == "Foster"){
     Foster = true;
@@ -61,7 +63,7 @@ void Fluid::Load() {
   istr >> nx >> ny >> nz;  assert (token=="grid");
   assert (nx > 0 && ny > 0 && nz > 0);
   istr >> token >> dx >> dy >> dz; assert (token=="cell_dimensions");
-  cells = new Cell[(nx+2)*(ny+2)*(nz+2)];
+  grid.resize(nx,ny,nz);
 
   // simulation parameters
   istr >> token >> token2;  assert (token=="flow");
@@ -97,9 +99,9 @@ void Fluid::Load() {
     for (i = -1; i <= nx; i++) {
       for (j = -1; j <= ny; j++) {
         for (k = -1; k <= nz; k++) {
-          getCell(i,j,k)->set_u_plus((2*args->mtrand.rand()-1)*max_dim);
-    getCell(i,j,k)->set_v_plus((2*args->mtrand.rand()-1)*max_dim);
-    getCell(i,j,k)->set_w_plus((2*args->mtrand.rand()-1)*max_dim);
+          set_u_plus(i,j,k,(2*args->mtrand.rand()-1)*max_dim);
+          set_v_plus(i,j,k,(2*args->mtrand.rand()-1)*max_dim);
+          set_w_plus(i,j,k,(2*args->mtrand.rand()-1)*max_dim);
         }
       }
     }
@@ -113,9 +115,9 @@ void Fluid::Load() {
     assert(i >= 0 && i < nx);
     assert(j >= 0 && j < ny);
     assert(k >= 0 && k < nz);
-    if      (token == "u") getCell(i,j,k)->set_u_plus(velocity);
-    else if (token == "v") getCell(i,j,k)->set_v_plus(velocity);
-    else if (token == "w") getCell(i,j,k)->set_w_plus(velocity);
+    if      (token == "u") set_u_plus(i,j,k,velocity);
+    else if (token == "v") set_v_plus(i,j,k,velocity);
+    else if (token == "w") set_w_plus(i,j,k,velocity);
     else assert(0);
   }
   SetBoundaryVelocities();
@@ -160,10 +162,9 @@ void Fluid::GenerateParticles(const std::string &shape, const std::string &place
         for (double z = 0.5*spacing*dz; z < nz*dz; z += spacing*dz) {
           Vec3f pos = Vec3f(x,y,z);
           if (inShape(pos,shape)) {
-            Cell *cell = getCell(int(x/dx),int(y/dy),int(z/dz));
-            FluidParticle *p = new FluidParticle();
-            p->setPosition(pos);
-            cell->addParticle(p);
+            FluidParticle p;
+            p.setPosition(pos);
+            grid.particles.push_back(p);
           }
         }
       }
@@ -176,13 +177,14 @@ void Fluid::GenerateParticles(const std::string &shape, const std::string &place
                         args->mtrand.rand()*ny*dy,
                         args->mtrand.rand()*nz*dz);
       if (inShape(pos,shape)) {      
-        Cell *cell = getCell(int(pos.x()/dx),int(pos.y()/dy),int(pos.z()/dz));
-        FluidParticle *p = new FluidParticle();
-        p->setPosition(pos);
-        cell->addParticle(p);
+        FluidParticle p;
+        p.setPosition(pos);
+        grid.particles.push_back(p);
       }
     }
   }
+  // into their cells
+  grid.SortParticles(dx,dy,dz);
 }
 
 // ==============================================================
@@ -192,6 +194,48 @@ void Fluid::GenerateParticles(const std::string &shape, const std::string &place
 // ==============================================================
 
 void Fluid::Animate() {
+  // args->timestep of simulated time, in sub steps as long as the CFL
+  // limit allows (the last one exactly what remains)
+  double remaining = args->timestep;
+  while (remaining > 0) {
+    dt = remaining / std::max(1,(int)ceil(remaining / MaxTimestep()));
+    Step();
+    remaining -= dt;
+  }
+  setupVBOs();
+}
+
+double Fluid::MaxTimestep() const {
+  // the fastest face velocity
+  const fluid_real *u = grid.u.data(), *v = grid.v.data(), *w = grid.w.data();
+  fluid_real max_velocity = 0;
+  for (int i = 0; i < nx; i++) {
+    for (int j = 0; j < ny; j++) {
+      int c0 = grid.index(i,j,0);
+      for (int c = c0; c < c0+nz; c++) {
+        max_velocity = my_max(max_velocity,fabs(u[c]));
+        max_velocity = my_max(max_velocity,fabs(v[c]));
+        max_velocity = my_max(max_velocity,fabs(w[c]));
+      }
+    }
+  }
+  double h = my_min(dx,my_min(dy,dz));
+  double limit = args->timestep;
+  // CFL: nothing crosses more than args->cfl of a cell, counting what
+  // gravity adds during the step: dt (u + dt g) <= cfl h
+  double reach = args->cfl * h;
+  double g = args->gravity.Length();
+  double denominator = max_velocity + sqrt(square(max_velocity) + 4*g*reach);
+  if (denominator > 0) limit = my_min(limit,2*reach/denominator);
+  // the explicit viscosity term is stable while
+  // viscosity dt (1/dx^2 + 1/dy^2 + 1/dz^2) <= 1/2
+  double diffusion = viscosity * (1/square(dx) + 1/square(dy) + 1/square(dz));
+  if (diffusion > 0) limit = my_min(limit,0.5/diffusion);
+  // never more than FLUID_MAX_SUBSTEPS a frame
+  return my_max(limit,args->timestep / FLUID_MAX_SUBSTEPS);
+}
+
+void Fluid::Step() {
   // MainMaster
 
   // the animation manager:  this is what gets done each timestep!
@@ -204,24 +248,31 @@ void Fluid::Animate() {
   SetBoundaryVelocities();
   
   // compressible / incompressible flow
-  int count = 0;
-  if (compressible == false) {
-    double max_divergence = 0;
-    for (int iters = 0; iters < 20; iters++) {
-      count++;
-      // What is diverance?
-      if(Foster)
-        max_divergence = AdjustForIncompressibility_Foster();
-      else
-        max_divergence = AdjustForIncompressibility();
-
-      SetBoundaryVelocities();
-      if (max_divergence < EPSILON) break;
+  if (compressible == false && args->relax_pressure == false) {
+    // a pressure solve makes the flow divergence free & updates the
+    // pressures in one go
+    if (!pressure_solver.Project(grid,dx,dy,dz,dt)) {
+      std::cout << "pressure solve stopped after " << pressure_solver.getLastIterations()
+                << " iterations, divergence " << pressure_solver.getLastResidual() << " left" << std::endl;
+    }
+    SetBoundaryVelocities();
+  } else {
+    if (compressible == false) {
+      double max_divergence = 0;
+      for (int iters = 0; iters < 20; iters++) {
+        // What is diverance?
+        if(Foster)
+          max_divergence = AdjustForIncompressibility_Foster();
+        else
+          max_divergence = AdjustForIncompressibility();
+
+        SetBoundaryVelocities();
+        if (max_divergence < EPSILON) break;
+      }
     }
+    UpdatePressures();
   }
 
-  UpdatePressures();
-
   CopyVelocities();
 
   // advanced the particles through the fluid
@@ -230,72 +281,95 @@ void Fluid::Animate() {
 
   // What does this do?
   SetEmptySurfaceFull();
-
-  setupVBOs();
 }
 
 // ==============================================================
 
 void Fluid::ComputeNewVelocities() {
-  double dt = args->timestep;
-  int i,j,k;
-
   // using the formulas from Foster & Metaxas
   // Updates to new_?_plus
 
-  for (i = 0; i < nx-1; i++) {
-    for (j = 0; j < ny; j++) {
-      for (k = 0; k < nz; k++) {
-        Cell *cell = getCell(i,j,k);
-        double new_u_plus =
-          get_u_plus(i,j,k) +            
-          dt * ((1/dx) * (square(get_u_avg(i,j,k)) - square(get_u_avg(i+1,j,k))) +
-                (1/dy) * (get_uv_plus(i,j-1,k) - get_uv_plus(i,j,k)) + 
-                (1/dz) * (get_uw_plus(i,j,k-1) - get_uw_plus(i,j,k)) +
-                args->gravity.x() +
-                (1/dx) * (getPressure(i,j,k)-getPressure(i+1,j,k)) +
-                (viscosity/square(dx)) * (get_u_plus(i+1,j  ,k  ) - 2*get_u_plus(i,j,k) + get_u_plus(i-1,j  ,k  )) +
-                (viscosity/square(dy)) * (get_u_plus(i  ,j+1,k  ) - 2*get_u_plus(i,j,k) + get_u_plus(i  ,j-1,k  )) +
-                (viscosity/square(dz)) * (get_u_plus(i  ,j  ,k+1) - 2*get_u_plus(i,j,k) + get_u_plus(i  ,j  ,k-1)) );
-        cell->set_new_u_plus(new_u_plus);
+  // straight on the arrays: cell (i,j,k) is c, (i+1,j,k) c+sx,
+  // (i,j+1,k) c+sy & (i,j,k+1) c+1, so the loops along k are plain
+  // streams through memory the compiler can vectorize
+  const int sx = grid.sx, sy = grid.sy;
+  const fluid_real *u = grid.u.data(), *v = grid.v.data(), *w = grid.w.data();
+  const fluid_real *p = grid.pressure.data();
+  fluid_real *new_u = grid.new_u.data(), *new_v = grid.new_v.data(), *new_w = grid.new_w.data();
+  const fluid_real half = 0.5;
+  const fluid_real step = dt;
+  const fluid_real inv_dx = 1/dx, inv_dy = 1/dy, inv_dz = 1/dz;
+  const fluid_real nu_dx = viscosity/square(dx), nu_dy = viscosity/square(dy), nu_dz = viscosity/square(dz);
+  const fluid_real gx = args->gravity.x(), gy = args->gravity.y(), gz = args->gravity.z();
+
+  for (int i = 0; i < nx-1; i++) {
+    for (int j = 0; j < ny; j++) {
+      int c0 = grid.index(i,j,0);
+      FLUID_NO_ALIAS
+      for (int c = c0; c < c0+nz; c++) {
+        // u v at the (+x,+y) edge & u w at the (+x,+z) edge, of this cell & the one before
+        fluid_real uv = half*(u[c] + u[c+sy]) * half*(v[c] + v[c+sx]);
+        fluid_real uv_before = half*(u[c-sy] + u[c]) * half*(v[c-sy] + v[c-sy+sx]);
+        fluid_real uw = half*(u[c] + u[c+1]) * half*(w[c] + w[c+sx]);
+        fluid_real uw_before = half*(u[c-1] + u[c]) * half*(w[c-1] + w[c-1+sx]);
+        new_u[c] =
+          u[c] +
+          step * (inv_dx * (square(half*(u[c-sx] + u[c])) - square(half*(u[c] + u[c+sx]))) +
+                  inv_dy * (uv_before - uv) +
+                  inv_dz * (uw_before - uw) +
+                  gx +
+                  inv_dx * (p[c] - p[c+sx]) +
+                  nu_dx * (u[c+sx] - 2*u[c] + u[c-sx]) +
+                  nu_dy * (u[c+sy] - 2*u[c] + u[c-sy]) +
+                  nu_dz * (u[c+1 ] - 2*u[c] + u[c-1 ]) );
       }
     }
   }
 
-  for (i = 0; i < nx; i++) {
-    for (j = 0; j < ny-1; j++) {
-      for (k = 0; k < nz; k++) {  
-        Cell *cell = getCell(i,j,k);
-        double new_v_plus =
-          get_v_plus(i,j,k) +
-          dt * ((1/dx) * (get_uv_plus(i-1,j,k) - get_uv_plus(i,j,k)) +
-                (1/dy) * (square(get_v_avg(i,j,k)) - square(get_v_avg(i,j+1,k))) +
-                (1/dz) * (get_vw_plus(i,j,k-1) - get_vw_plus(i,j,k)) +
-                args->gravity.y() +
-                (1/dy) * (getPressure(i,j,k)-getPressure(i,j+1,k)) +
-                (viscosity/square(dx)) * (get_v_plus(i+1,j  ,k  ) - 2*get_v_plus(i,j,k) + get_v_plus(i-1,j  ,k  )) +
-                (viscosity/square(dy)) * (get_v_plus(i  ,j+1,k  ) - 2*get_v_plus(i,j,k) + get_v_plus(i  ,j-1,k  )) +
-                (viscosity/square(dz)) * (get_v_plus(i  ,j  ,k+1) - 2*get_v_plus(i,j,k) + get_v_plus(i  ,j  ,k-1)) );
-        cell->set_new_v_plus(new_v_plus);
+  for (int i = 0; i < nx; i++) {
+    for (int j = 0; j < ny-1; j++) {
+      int c0 = grid.index(i,j,0);
+      FLUID_NO_ALIAS
+      for (int c = c0; c < c0+nz; c++) {
+        // u v at the (+x,+y) edge & v w at the (+y,+z) edge, of this cell & the one before
+        fluid_real uv = half*(u[c] + u[c+sy]) * half*(v[c] + v[c+sx]);
+        fluid_real uv_before = half*(u[c-sx] + u[c-sx+sy]) * half*(v[c-sx] + v[c]);
+        fluid_real vw = half*(v[c] + v[c+1]) * half*(w[c] + w[c+sy]);
+        fluid_real vw_before = half*(v[c-1] + v[c]) * half*(w[c-1] + w[c-1+sy]);
+        new_v[c] =
+          v[c] +
+          step * (inv_dx * (uv_before - uv) +
+                  inv_dy * (square(half*(v[c-sy] + v[c])) - square(half*(v[c] + v[c+sy]))) +
+                  inv_dz * (vw_before - vw) +
+                  gy +
+                  inv_dy * (p[c] - p[c+sy]) +
+                  nu_dx * (v[c+sx] - 2*v[c] + v[c-sx]) +
+                  nu_dy * (v[c+sy] - 2*v[c] + v[c-sy]) +
+                  nu_dz * (v[c+1 ] - 2*v[c] + v[c-1 ]) );
       }
     }
   }
 
-  for (i = 0; i < nx; i++) {
-    for (j = 0; j < ny; j++) {
-      for (k = 0; k < nz-1; k++) {
-        Cell *cell = getCell(i,j,k);
-        double new_w_plus =
-          get_w_plus(i,j,k) +
-          dt * ((1/dx) * (get_uw_plus(i-1,j,k) - get_uw_plus(i,j,k)) +
-                (1/dy) * (get_vw_plus(i,j-1,k) - get_vw_plus(i,j,k)) +
-                (1/dz) * (square(get_w_avg(i,j,k)) - square(get_w_avg(i,j,k+1))) +
-                args->gravity.z() +
-                (1/dz) * (getPressure(i,j,k)-getPressure(i,j,k+1)) +
-                (viscosity/square(dx)) * (get_w_plus(i+1,j  ,k  ) - 2*get_w_plus(i,j,k) + get_w_plus(i-1,j  ,k  )) +
-                (viscosity/square(dy)) * (get_w_plus(i  ,j+1,k  ) - 2*get_w_plus(i,j,k) + get_w_plus(i  ,j-1,k  )) +
-                (viscosity/square(dz)) * (get_w_plus(i  ,j  ,k+1) - 2*get_w_plus(i,j,k) + get_w_plus(i  ,j  ,k-1)) );
-        cell->set_new_w_plus(new_w_plus);
+  for (int i = 0; i < nx; i++) {
+    for (int j = 0; j < ny; j++) {
+      int c0 = grid.index(i,j,0);
+      FLUID_NO_ALIAS
+      for (int c = c0; c < c0+nz-1; c++) {
+        // u w at the (+x,+z) edge & v w at the (+y,+z) edge, of this cell & the one before
+        fluid_real uw = half*(u[c] + u[c+1]) * half*(w[c] + w[c+sx]);
+        fluid_real uw_before = half*(u[c-sx] + u[c-sx+1]) * half*(w[c-sx] + w[c]);
+        fluid_real vw = half*(v[c] + v[c+1]) * half*(w[c] + w[c+sy]);
+        fluid_real vw_before = half*(v[c-sy] + v[c-sy+1]) * half*(w[c-sy] + w[c]);
+        new_w[c] =
+          w[c] +
+          step * (inv_dx * (uw_before - uw) +
+                  inv_dy * (vw_before - vw) +
+                  inv_dz * (square(half*(w[c-1] + w[c])) - square(half*(w[c] + w[c+1]))) +
+                  gz +
+                  inv_dz * (p[c] - p[c+1]) +
+                  nu_dx * (w[c+sx] - 2*w[c] + w[c-sx]) +
+                  nu_dy * (w[c+sy] - 2*w[c] + w[c-sy]) +
+                  nu_dz * (w[c+1 ] - 2*w[c] + w[c-1 ]) );
       }
     }
   }
@@ -309,23 +383,23 @@ void Fluid::SetBoundaryVelocities() {
   // zero out flow perpendicular to the boundaries (no sources or sinks)
   for (int j = -1; j <= ny; j++) {
     for (int k = -1; k <= nz; k++) {
-      getCell(-1  ,j,k)->set_u_plus(0);
-      getCell(nx-1,j,k)->set_u_plus(0);
-      getCell(nx  ,j,k)->set_u_plus(0);
+      set_u_plus(-1  ,j,k,0);
+      set_u_plus(nx-1,j,k,0);
+      set_u_plus(nx  ,j,k,0);
     }
   }
   for (int i = -1; i <= nx; i++) {
     for (int k = -1; k <= nz; k++) {
-      getCell(i,-1  ,k)->set_v_plus(0);
-      getCell(i,ny-1,k)->set_v_plus(0);
-      getCell(i,ny  ,k)->set_v_plus(0);
+      set_v_plus(i,-1  ,k,0);
+      set_v_plus(i,ny-1,k,0);
+      set_v_plus(i,ny  ,k,0);
     }
   }
   for (int i = -1; i <= nx; i++) {
     for (int j = -1; j <= ny; j++) {
-      getCell(i,j,-1  )->set_w_plus(0);
-      getCell(i,j,nz-1)->set_w_plus(0);
-      getCell(i,j,nz  )->set_w_plus(0);
+      set_w_plus(i,j,-1  ,0);
+      set_w_plus(i,j,nz-1,0);
+      set_w_plus(i,j,nz  ,0);
     }
   }
 
@@ -335,69 +409,67 @@ void Fluid::SetBoundaryVelocities() {
   double zx_sign = (zx_free_slip) ? 1 : -1;
   for (int i = 0; i < nx; i++) {
     for (int j = -1; j <= ny; j++) {
-      getCell(i,j,-1)->set_u_plus(xy_sign*getCell(i,j,0)->get_u_plus());
-      getCell(i,j,nz)->set_u_plus(xy_sign*getCell(i,j,nz-1)->get_u_plus());
+      set_u_plus(i,j,-1,xy_sign*get_u_plus(i,j,0));
+      set_u_plus(i,j,nz,xy_sign*get_u_plus(i,j,nz-1));
     }
     for (int k = -1; k <= nz; k++) {
-      getCell(i,-1,k)->set_u_plus(zx_sign*getCell(i,0,k)->get_u_plus());
-      getCell(i,ny,k)->set_u_plus(zx_sign*getCell(i,ny-1,k)->get_u_plus());
+      set_u_plus(i,-1,k,zx_sign*get_u_plus(i,0,k));
+      set_u_plus(i,ny,k,zx_sign*get_u_plus(i,ny-1,k));
     }
   }
   for (int j = 0; j < ny; j++) {
     for (int i = -1; i <= nx; i++) {
-      getCell(i,j,-1)->set_v_plus(xy_sign*getCell(i,j,0)->get_v_plus());
-      getCell(i,j,nz)->set_v_plus(xy_sign*getCell(i,j,nz-1)->get_v_plus());
+      set_v_plus(i,j,-1,xy_sign*get_v_plus(i,j,0));
+      set_v_plus(i,j,nz,xy_sign*get_v_plus(i,j,nz-1));
     }
     for (int k = -1; k <= nz; k++) {
-      getCell(-1,j,k)->set_v_plus(yz_sign*getCell(0,j,k)->get_v_plus());
-      getCell(nx,j,k)->set_v_plus(yz_sign*getCell(nx-1,j,k)->get_v_plus());
+      set_v_plus(-1,j,k,yz_sign*get_v_plus(0,j,k));
+      set_v_plus(nx,j,k,yz_sign*get_v_plus(nx-1,j,k));
     }
   }
   for (int k = 0; k < nz; k++) {
     for (int i = -1; i <= nx; i++) {
-      getCell(i,-1,k)->set_w_plus(zx_sign*getCell(i,0,k)->get_w_plus());
-      getCell(i,ny,k)->set_w_plus(zx_sign*getCell(i,ny-1,k)->get_w_plus());
+      set_w_plus(i,-1,k,zx_sign*get_w_plus(i,0,k));
+      set_w_plus(i,ny,k,zx_sign*get_w_plus(i,ny-1,k));
     }
     for (int j = -1; j <= ny; j++) {
-      getCell(-1,j,k)->set_w_plus(yz_sign*getCell(0,j,k)->get_w_plus());
-      getCell(nx,j,k)->set_w_plus(yz_sign*getCell(nx-1,j,k)->get_w_plus());
+      set_w_plus(-1,j,k,yz_sign*get_w_plus(0,j,k));
+      set_w_plus(nx,j,k,yz_sign*get_w_plus(nx-1,j,k));
     }
   }
 }
 
 // ==============================================================
 
-void Fluid::EmptyVelocities(int i, int j, int k) {
-  Cell *c = getCell(i,j,k);
-  if (c->getStatus() != CELL_EMPTY) return;
-  Cell *ciplus = getCell(i+1,j,k);
-  Cell *cjplus = getCell(i,j+1,k);
-  Cell *ckplus = getCell(i,j,k+1);
-  if (ciplus->getStatus() == CELL_EMPTY)
-    c->set_new_u_plus(0);
-  if (cjplus->getStatus() == CELL_EMPTY)
-    c->set_new_v_plus(0);
-  if (ckplus->getStatus() == CELL_EMPTY)
-    c->set_new_w_plus(0);
-}
-
 void Fluid::CopyVelocities() {
-  double dt = args->timestep;
+  const int sx = grid.sx, sy = grid.sy;
+  const unsigned char *status = grid.status.data();
+  fluid_real *u = grid.u.data(), *v = grid.v.data(), *w = grid.w.data();
+  fluid_real *new_u = grid.new_u.data(), *new_v = grid.new_v.data(), *new_w = grid.new_w.data();
+  // nothing should cross half a cell in a step
+  const fluid_real max_u = 0.5*dx/dt, max_v = 0.5*dy/dt, max_w = 0.5*dz/dt;
+  int too_fast = 0;
   for (int i = 0; i < nx; i++) {
     for (int j = 0; j < ny; j++) {
-      for (int k = 0; k < nz; k++) {
-  Cell *c = getCell(i,j,k);
-  EmptyVelocities(i,j,k);
-  c->copyVelocity();
-  if (fabs(c->get_u_plus()) > 0.5*dx/dt ||
-      fabs(c->get_v_plus()) > 0.5*dy/dt ||
-      fabs(c->get_w_plus()) > 0.5*dz/dt) {
+      int c0 = grid.index(i,j,0), c1 = c0+nz;
+      FLUID_NO_ALIAS
+      for (int c = c0; c < c1; c++) {
+        u[c] = new_u[c]; new_u[c] = 0;
+        v[c] = new_v[c]; new_v[c] = 0;
+        w[c] = new_w[c]; new_w[c] = 0;
+        // nothing flows between two empty cells
+        bool empty = (status[c] == CELL_EMPTY);
+        if (empty & (status[c+sx] == CELL_EMPTY)) u[c] = 0;
+        if (empty & (status[c+sy] == CELL_EMPTY)) v[c] = 0;
+        if (empty & (status[c+1] == CELL_EMPTY)) w[c] = 0;
+        too_fast |= (fabs(u[c]) > max_u) | (fabs(v[c]) > max_v) | (fabs(w[c]) > max_w);
+      }
+    }
+  }
+  if (too_fast) {
     // velocity has exceeded reasonable threshhold
     std::cout << "velocity has exceeded reasonable threshhold, stopping animation" << std::endl;
     args->animate=false;
-  }
-      }
-    }
   }
 }
 
@@ -410,53 +482,42 @@ double Fluid::AdjustForIncompressibility_Foster(){
   // note it takes 2-5 iterations to converage on some episone descripbed
   // the paper.
 
+  // (a cell's adjustment changes the divergence of the next ones, so
+  // this sweep has to go cell by cell, in order)
+  const int sx = grid.sx, sy = grid.sy;
+  fluid_real *new_u = grid.new_u.data(), *new_v = grid.new_v.data(), *new_w = grid.new_w.data();
+  const fluid_real inv_dx = 1/dx, inv_dy = 1/dy, inv_dz = 1/dz;
+  const fluid_real dt_dx = dt/dx, dt_dy = dt/dy, dt_dz = dt/dz;
+  // Our relaxation coffient taken into account
+  const fluid_real beta = BETA_0/((2*dt) * (1/square(dx) + 1/square(dy) + 1/square(dz)));
 
- double max_divergence = -1;
-
-  for (int i = -1; i <= nx; i++) {
-    for (int j = -1; j <= ny; j++) {
-      for (int k = -1; k <= nz; k++) {
-        // For each cell in the system
-
-        if (i >= 0 && i < nx && j >= 0 && j < ny && k >= 0 && k < nz) {
-
-          // Get divergence
-          double divergence = 
-          - ( (1/dx) * (get_new_u_plus(i,j,k) - get_new_u_plus(i-1,j,k)) +
-          (1/dy) * (get_new_v_plus(i,j,k) - get_new_v_plus(i,j-1,k)) +
-          (1/dz) * (get_new_w_plus(i,j,k) - get_new_w_plus(i,j,k-1)) );
-
-          if(max_divergence < fabs(divergence)) max_divergence = fabs(divergence);
-
-          // Take the change in time into concideration
-          double dt = args->timestep;
-
-          // Our relaxation coffient taken into account
-          double beta = BETA_0/((2*dt) * (1/square(dx) + 1/square(dy) + 1/square(dz)));
-          double dp = beta*(divergence);
-
-          // Update the velocities (based on the equations 5-7 provdied in paper)
-          adjust_new_u_plus(i,j,k, (dt/dx)*dp);
-          adjust_new_u_plus(i-1,j,k, -1*(dt/dx)*dp);
-
-          adjust_new_v_plus(i,j,k, (dt/dy)*dp);
-          adjust_new_v_plus(i,j-1,k, -1*(dt/dy)*dp);
-
-          adjust_new_w_plus(i,j,k, (dt/dz)*dp);
-          adjust_new_w_plus(i,j,k-1, -1*(dt/dz)*dp);
-
+  double max_divergence = -1;
 
+  for (int i = 0; i < nx; i++) {
+    for (int j = 0; j < ny; j++) {
+      int c0 = grid.index(i,j,0);
+      for (int c = c0; c < c0+nz; c++) {
+        // Get divergence
+        fluid_real divergence =
+          - ( inv_dx * (new_u[c] - new_u[c-sx]) +
+              inv_dy * (new_v[c] - new_v[c-sy]) +
+              inv_dz * (new_w[c] - new_w[c-1]) );
 
-        }else{
-          // We have a boundry cell
+        if(max_divergence < fabs(divergence)) max_divergence = fabs(divergence);
 
+        fluid_real dp = beta*divergence;
 
+        // Update the velocities (based on the equations 5-7 provdied in paper)
+        new_u[c] += dt_dx*dp;
+        new_u[c-sx] -= dt_dx*dp;
 
+        new_v[c] += dt_dy*dp;
+        new_v[c-sy] -= dt_dy*dp;
 
-        }
+        new_w[c] += dt_dz*dp;
+        new_w[c-1] -= dt_dz*dp;
       }
-
-    }//for each cell
+    }
   }
 
   return max_divergence;
@@ -466,62 +527,55 @@ double Fluid::AdjustForIncompressibility_Foster(){
 
 double Fluid::AdjustForIncompressibility() {
   // JUMP
+  const int sx = grid.sx, sy = grid.sy;
+  const unsigned char *status = grid.status.data();
+  fluid_real *new_u = grid.new_u.data(), *new_v = grid.new_v.data(), *new_w = grid.new_w.data();
+  const fluid_real inv_dx = 1/dx, inv_dy = 1/dy, inv_dz = 1/dz;
 
- double max_divergence = -1;
-
-  for (int i = -1; i <= nx; i++) {
-    for (int j = -1; j <= ny; j++) {
-      for (int k = -1; k <= nz; k++) {
-        // For each cell in the system
-        Cell *c = getCell(i,j,k);
-
-        if (i >= 0 && i < nx && j >= 0 && j < ny && k >= 0 && k < nz) {
+  double max_divergence = -1;
 
-          // If you're not full skip
-          if(c->getStatus() != CELL_FULL)
-            continue;
-
-          // Get divergence
-          double divergence = 
-          - ( (1/dx) * (get_new_u_plus(i,j,k) - get_new_u_plus(i-1,j,k)) +
-          (1/dy) * (get_new_v_plus(i,j,k) - get_new_v_plus(i,j-1,k)) +
-          (1/dz) * (get_new_w_plus(i,j,k) - get_new_w_plus(i,j,k-1)) );
-
-          if(max_divergence < fabs(divergence)) max_divergence = fabs(divergence);
-
-          //Spread the unhappyness to "full" cells
-          double chunk = divergence / (double) getLegalAdjCells(i,j,k);
-
-          //Stats /////////////////////
-          // printf("-=-=-=-=-=--=-=\n");
-          // printf("-=-=-[%d,%d,%d]-=-=-=-\n",i,j,k);
-          // printf("divergence:  %f\n",divergence);
-          // printf("divergance chunk: %f\n", chunk);
-
-          // East Face
-          if(legal_full_cell(i+1,j,k))
-            adjust_new_u_plus(i,j,k,chunk);
-
-          // South Face
-          if(legal_full_cell(i,j+1,k))
-            adjust_new_v_plus(i,j,k,chunk);
-
-          // Face-me
-          if(legal_full_cell(i,j,k+1))
-            adjust_new_w_plus(i,j,k,chunk);
-
-          // West Face
-          if(legal_full_cell(i-1,j,k))
-            adjust_new_u_plus(i-1,j,k, -1*chunk);
-
-          // North Face
-          if(legal_full_cell(i,j-1,k))
-            adjust_new_v_plus(i,j-1,k, -1*chunk);
-
-          // Face-Away
-          if(legal_full_cell(i,j,k-1))
-            adjust_new_w_plus(i,j,k-1,-1*chunk);
-        }
+  for (int i = 0; i < nx; i++) {
+    for (int j = 0; j < ny; j++) {
+      int c0 = grid.index(i,j,0);
+      for (int c = c0; c < c0+nz; c++) {
+        // If you're not full skip
+        if(status[c] != CELL_FULL)
+          continue;
+
+        // Get divergence
+        fluid_real divergence =
+          - ( inv_dx * (new_u[c] - new_u[c-sx]) +
+              inv_dy * (new_v[c] - new_v[c-sy]) +
+              inv_dz * (new_w[c] - new_w[c-1]) );
+
+        if(max_divergence < fabs(divergence)) max_divergence = fabs(divergence);
+
+        //Spread the unhappyness to "full" cells
+        fluid_real chunk = divergence / (fluid_real) getLegalAdjCells(c);
+
+        // East Face
+        if(legal_full_cell(c+sx))
+          new_u[c] += chunk;
+
+        // South Face
+        if(legal_full_cell(c+sy))
+          new_v[c] += chunk;
+
+        // Face-me
+        if(legal_full_cell(c+1))
+          new_w[c] += chunk;
+
+        // West Face
+        if(legal_full_cell(c-sx))
+          new_u[c-sx] -= chunk;
+
+        // North Face
+        if(legal_full_cell(c-sy))
+          new_v[c-sy] -= chunk;
+
+        // Face-Away
+        if(legal_full_cell(c-1))
+          new_w[c-1] -= chunk;
       }
     }
   }
@@ -531,34 +585,26 @@ double Fluid::AdjustForIncompressibility() {
 // ==============================================================
 
 void Fluid::UpdatePressures() {
-  for (int i = -1; i <= nx; i++) {
-    for (int j = -1; j <= ny; j++) {
-      for (int k = -1; k <= nz; k++) {
-        // For each cell in the system
-        Cell *c = getCell(i,j,k);
-        if (i >= 0 && i < nx && j >= 0 && j < ny && k >= 0 && k < nz) {
-          // compute divergence and increment/decrement pressure
-          double pressure = c->getPressure();
-          double divergence = 
-            - ( (1/dx) * (get_new_u_plus(i,j,k) - get_new_u_plus(i-1,j,k)) +
-          (1/dy) * (get_new_v_plus(i,j,k) - get_new_v_plus(i,j-1,k)) +
-          (1/dz) * (get_new_w_plus(i,j,k) - get_new_w_plus(i,j,k-1)) );
-          double dt = args->timestep;
-          double beta = BETA_0/((2*dt) * (1/square(dx) + 1/square(dy) + 1/square(dz)));
-          double dp = beta*divergence;
-          c->setPressure(pressure + dp);
-        } else {
-          // zero out boundary cells (just in case)
-          c->setPressure(0);
-        }
-
+  // compute divergence and increment/decrement pressure (the
+  // padding's pressures stay 0)
+  const int sx = grid.sx, sy = grid.sy;
+  const unsigned char *status = grid.status.data();
+  const fluid_real *new_u = grid.new_u.data(), *new_v = grid.new_v.data(), *new_w = grid.new_w.data();
+  fluid_real *pressure = grid.pressure.data();
+  const fluid_real inv_dx = 1/dx, inv_dy = 1/dy, inv_dz = 1/dz;
+  const fluid_real beta = BETA_0/((2*dt) * (1/square(dx) + 1/square(dy) + 1/square(dz)));
+  for (int i = 0; i < nx; i++) {
+    for (int j = 0; j < ny; j++) {
+      int c0 = grid.index(i,j,0);
+      FLUID_NO_ALIAS
+      for (int c = c0; c < c0+nz; c++) {
+        fluid_real divergence =
+          - ( inv_dx * (new_u[c] - new_u[c-sx]) +
+              inv_dy * (new_v[c] - new_v[c-sy]) +
+              inv_dz * (new_w[c] - new_w[c-1]) );
+        pressure[c] += beta*divergence;
         // zero out empty cells (From Foster 2001 paper)
-        if (c->getStatus() == CELL_EMPTY) {
-          c->setPressure(0);
-        }
-
-        // ========================================
-
+        if (status[c] == CELL_EMPTY) pressure[c] = 0;
       }
     }
   }
@@ -567,102 +613,49 @@ void Fluid::UpdatePressures() {
 // ==============================================================
 
 void Fluid::MoveParticles() {
-
-  // Get timestep 
-  double dt = args->timestep;
-
   // For each particle
-  for (int i = 0; i < nx; i++) {
-    for (int j = 0; j < ny; j++) {
-      for (int k = 0; k < nz; k++) {
-
-        Cell *cell = getCell(i,j,k);
-
-        // Get particles inside cell
-        std::vector<FluidParticle*> &particles = cell->getParticles();
-
-        for (unsigned int iter = 0; iter < particles.size(); iter++) {
-
-          // For each particle in cell
-          FluidParticle *p = particles[iter];
-          Vec3f pos = p->getPosition();
-          Vec3f vel = getInterpolatedVelocity(pos);
-
-          // Update
-          Vec3f pos2 = pos + vel*dt;
-
-
-          // euler integration
-          p->setPosition(pos2);
-
-          // I will halve the timestemp if i realize we are moving to fast, so the next iteration won't be as effected
-          if(fabs(pos.Distance3f(pos2)) >= fabs(dx)){
-            args->timestep = args->timestep/2;
-            std::cout << "Happening to fast, Time Halved -->" << args->timestep << std::endl;
-          }
-
-        }
-      }
-    }
+  for (unsigned int n = 0; n < grid.particles.size(); n++) {
+    FluidParticle &p = grid.particles[n];
+    Vec3f pos = p.getPosition();
+    Vec3f vel = getInterpolatedVelocity(pos);
+    // euler integration (the CFL limit on dt keeps this under a cell)
+    p.setPosition(pos + vel*dt);
   }
 }
 
 // ==============================================================
 
 void Fluid::ReassignParticles() {
-  for (int i = 0; i < nx; i++) {
-    for (int j = 0; j < ny; j++) {
-      for (int k = 0; k < nz; k++) {
-        Cell *cell = getCell(i,j,k);
-  std::vector<FluidParticle*> &particles = cell->getParticles();
-        for (unsigned int iter = 0; iter < particles.size(); iter++) {
-          FluidParticle *p = particles[iter];
-          Vec3f pos = p->getPosition();
-          int i2 = (int)my_min(double(nx-1),my_max(0.0,floor(pos.x()/dx)));
-          int j2 = (int)my_min(double(ny-1),my_max(0.0,floor(pos.y()/dy)));
-          int k2 = (int)my_min(double(nz-1),my_max(0.0,floor(pos.z()/dz)));
-          // if the particle has crossed one of the cell faces 
-          // assign it to the new cell
-          if (i != i2 || j != j2 || k != k2) {
-            cell->removeParticle(p);
-            getCell(i2,j2,k2)->addParticle(p);
-          } 
-        }
-      }
-    }
-  }
+  // if a particle has crossed one of the cell faces it goes in the new cell
+  grid.SortParticles(dx,dy,dz);
 }
 
 // ==============================================================
 
 void Fluid::SetEmptySurfaceFull() {
-  int i,j,k;
-  for (i = 0; i < nx; i++) {
-    for (j = 0; j < ny; j++) {
-      for (k = 0; k < nz; k++) {
-        Cell *cell = getCell(i,j,k);
-        if (cell->numParticles() == 0)
-          cell->setStatus(CELL_EMPTY);
-        else 
-          cell->setStatus(CELL_FULL);
-      }
+  const int sx = grid.sx, sy = grid.sy;
+  unsigned char *status = grid.status.data();
+  const int *cell_start = grid.cell_start.data();
+  for (int i = 0; i < nx; i++) {
+    for (int j = 0; j < ny; j++) {
+      int c0 = grid.index(i,j,0);
+      FLUID_NO_ALIAS
+      for (int c = c0; c < c0+nz; c++)
+        status[c] = (cell_start[c+1] == cell_start[c]) ? CELL_EMPTY : CELL_FULL;
     }
   }
 
   // pick out the boundary cells
-  for (i = 0; i < nx; i++) {
-    for (j = 0; j < ny; j++) {
-      for (k = 0; k < nz; k++) {
-        Cell *cell = getCell(i,j,k);
-        if (cell->getStatus() == CELL_FULL &&
-            (getCell(i-1,j,k)->getStatus() == CELL_EMPTY ||
-             getCell(i+1,j,k)->getStatus() == CELL_EMPTY ||
-             getCell(i,j-1,k)->getStatus() == CELL_EMPTY ||
-             getCell(i,j+1,k)->getStatus() == CELL_EMPTY ||
-             getCell(i,j,k-1)->getStatus() == CELL_EMPTY ||
-             getCell(i,j,k+1)->getStatus() == CELL_EMPTY)) {
-          cell->setStatus(CELL_SURFACE);
-        }
+  for (int i = 0; i < nx; i++) {
+    for (int j = 0; j < ny; j++) {
+      int c0 = grid.index(i,j,0);
+      FLUID_NO_ALIAS
+      for (int c = c0; c < c0+nz; c++) {
+        bool next_to_empty =
+          (status[c-sx] == CELL_EMPTY) | (status[c+sx] == CELL_EMPTY) |
+          (status[c-sy] == CELL_EMPTY) | (status[c+sy] == CELL_EMPTY) |
+          (status[c-1] == CELL_EMPTY) | (status[c+1] == CELL_EMPTY);
+        status[c] = (status[c] == CELL_FULL && next_to_empty) ? CELL_SURFACE : status[c];
       }
     }
   }
@@ -6,7 +6,8 @@
 #include "argparser.h"
 #include "boundingbox.h"
 #include "vectors.h"
-#include "cell.h"
+#include "fluid_grid.h"
+#include "fluid_pressure.h"
 #include "vbo_structs.h"
 
 class ArgParser;
@@ -32,6 +33,7 @@ public:
 
   // ===============================
   // ANIMATION & RENDERING FUNCTIONS
+  // args->timestep of simulated time (in one or more sub steps)
   void Animate();
   BoundingBox getBoundingBox() const {
     return BoundingBox(Vec3f(0,0,0),Vec3f(nx*dx,ny*dy,nz*dz)); }
@@ -40,19 +42,23 @@ private:
 
   // ==============
   // CELL ACCESSORS
+  // (the sweeps over the whole grid index the arrays directly)
   int Index(int i, int j, int k) const {
     assert (i >= -1 && i <= nx);
     assert (j >= -1 && j <= ny);
     assert (k >= -1 && k <= nz);
-    return (i+1)*(ny+2)*(nz+2) + (j+1)*(nz+2) + (k+1);
+    return grid.index(i,j,k);
   }
-  Cell* getCell(int i, int j, int k) const { return &cells[Index(i,j,k)]; }
+  enum CELL_STATUS getStatus(int i, int j, int k) const { return (enum CELL_STATUS)grid.status[Index(i,j,k)]; }
+  int numParticles(int i, int j, int k) const { return grid.numParticles(Index(i,j,k)); }
 
   // =================
   // ANIMATION HELPERS
+  // the longest sub step the velocities & viscosity allow
+  double MaxTimestep() const;
+  void Step();
   void ComputeNewVelocities();
   void SetBoundaryVelocities();
-  void EmptyVelocities(int i, int j, int k);
   void CopyVelocities();
   double AdjustForIncompressibility();
   double AdjustForIncompressibility_Foster();
@@ -64,14 +70,14 @@ private:
   // =====================
   // NAVIER-STOKES HELPERS
   Vec3f getInterpolatedVelocity(const Vec3f &pos) const;
-  double getPressure(int i, int j, int k) const { return getCell(i,j,k)->getPressure(); }
+  double getPressure(int i, int j, int k) const { return grid.pressure[Index(i,j,k)]; }
   // velocity accessors
-  double get_u_plus(int i, int j, int k) const { return getCell(i,j,k)->get_u_plus(); }
-  double get_v_plus(int i, int j, int k) const { return getCell(i,j,k)->get_v_plus(); }  
-  double get_w_plus(int i, int j, int k) const { return getCell(i,j,k)->get_w_plus(); }  
-  double get_new_u_plus(int i, int j, int k) const { return getCell(i,j,k)->get_new_u_plus(); }  
-  double get_new_v_plus(int i, int j, int k) const { return getCell(i,j,k)->get_new_v_plus(); }  
-  double get_new_w_plus(int i, int j, int k) const { return getCell(i,j,k)->get_new_w_plus(); }  
+  double get_u_plus(int i, int j, int k) const { return grid.u[Index(i,j,k)]; }
+  double get_v_plus(int i, int j, int k) const { return grid.v[Index(i,j,k)]; }
+  double get_w_plus(int i, int j, int k) const { return grid.w[Index(i,j,k)]; }
+  double get_new_u_plus(int i, int j, int k) const { return grid.new_u[Index(i,j,k)]; }
+  double get_new_v_plus(int i, int j, int k) const { return grid.new_v[Index(i,j,k)]; }
+  double get_new_w_plus(int i, int j, int k) const { return grid.new_w[Index(i,j,k)]; }
   double get_u_avg(int i, int j, int k) const { return 0.5*(get_u_plus(i-1,j,k)+get_u_plus(i,j,k)); }
   double get_v_avg(int i, int j, int k) const { return 0.5*(get_v_plus(i,j-1,k)+get_v_plus(i,j,k)); }
   double get_w_avg(int i, int j, int k) const { return 0.5*(get_w_plus(i,j,k-1)+get_w_plus(i,j,k)); }
@@ -81,13 +87,10 @@ private:
     return 0.5*(get_u_plus(i,j,k) + get_u_plus(i,j,k+1)) * 0.5*(get_w_plus(i,j,k) + get_w_plus(i+1,j,k)); }
   double get_vw_plus(int i, int j, int k) const { 
     return 0.5*(get_v_plus(i,j,k) + get_v_plus(i,j,k+1)) * 0.5*(get_w_plus(i,j,k) + get_w_plus(i,j+1,k)); }
-  // velocity modifiers
-  void set_new_u_plus(int i, int j, int k, double f) { getCell(i,j,k)->set_new_u_plus(f); }
-  void set_new_v_plus(int i, int j, int k, double f) { getCell(i,j,k)->set_new_v_plus(f); }
-  void set_new_w_plus(int i, int j, int k, double f) { getCell(i,j,k)->set_new_w_plus(f); }
-  void adjust_new_u_plus(int i, int j, int k, double f) { getCell(i,j,k)->adjust_new_u_plus(f); }
-  void adjust_new_v_plus(int i, int j, int k, double f) { getCell(i,j,k)->adjust_new_v_plus(f); }
-  void adjust_new_w_plus(int i, int j, int k, double f) { getCell(i,j,k)->adjust_new_w_plus(f); }
+  // velocity modifiers (the velocity now & the new one)
+  void set_u_plus(int i, int j, int k, double f) { int c = Index(i,j,k); grid.u[c] = grid.new_u[c] = f; }
+  void set_v_plus(int i, int j, int k, double f) { int c = Index(i,j,k); grid.v[c] = grid.new_v[c] = f; }
+  void set_w_plus(int i, int j, int k, double f) { int c = Index(i,j,k); grid.w[c] = grid.new_w[c] = f; }
 
   // ========================================
   // RENDERING SURFACE (using Marching Cubes)
@@ -106,27 +109,12 @@ private:
   void CompressibleSurfaceCell(int i, int j, int k);
   double getAreaSquares(const Vec3f& a, Vec3f&b) const ;
 
-  bool legal_full_cell(int i, int j, int k){
-    // Are you a boundry?
-    if (i >= 0 && i < nx && j >= 0 && j < ny && k >= 0 && k < nz){
-      // Are you full?
-      if(getCell(i,j,k)->getStatus() == CELL_FULL){
-        return true;
-      }
-    }
-    return false;
-  }
-  unsigned int getLegalAdjCells(int i, int j, int k){
-    int count = 0;
-
-    if(legal_full_cell(i+1,j,k)) count++;
-    if(legal_full_cell(i-1,j,k)) count++;
-    if(legal_full_cell(i,j+1,k)) count++;
-    if(legal_full_cell(i,j-1,k)) count++;
-    if(legal_full_cell(i,j,k+1)) count++;
-    if(legal_full_cell(i,j,k-1)) count++;
-
-    return count;
+  // cell c is full of fluid (the padding never is, it stays CELL_SURFACE)
+  bool legal_full_cell(int c) const { return grid.status[c] == CELL_FULL; }
+  unsigned int getLegalAdjCells(int c) const {
+    return legal_full_cell(c+grid.sx) + legal_full_cell(c-grid.sx) +
+      legal_full_cell(c+grid.sy) + legal_full_cell(c-grid.sy) +
+      legal_full_cell(c+1) + legal_full_cell(c-1);
   }
 
   // don't use this constructor
@@ -139,7 +127,9 @@ private:
   // fluid parameters
   int nx,ny,nz;     // number of grid cells in each dimension
   double dx,dy,dz;  // dimensions of each grid cell
-  Cell *cells;      // NOTE: padded with extra cells on each side
+  double dt;        // the current sub step
+  FluidGrid grid;   // NOTE: padded with extra cells on each side
+  FluidPressureSolver pressure_solver;
 
   // simulation parameters
   bool xy_free_slip;
@@ -0,0 +1,50 @@
+#include <algorithm>
+#include <cmath>
+#include "fluid_grid.h"
+
+// ================================================================================
+
+void FluidGrid::resize(int _nx, int _ny, int _nz) {
+  nx = _nx;
+  ny = _ny;
+  nz = _nz;
+  sy = nz+2;
+  sx = (ny+2)*sy;
+  int n = (nx+2)*sx;
+  std::vector<fluid_real>* arrays[] = { &u, &v, &w, &new_u, &new_v, &new_w, &pressure };
+  for (unsigned int a = 0; a < sizeof(arrays)/sizeof(arrays[0]); a++)
+    arrays[a]->assign(n,0);
+  status.assign(n,CELL_SURFACE);
+  particles.clear();
+  cell_start.assign(n+1,0);
+}
+
+// ================================================================================
+
+void FluidGrid::SortParticles(double dx, double dy, double dz) {
+  // counting sort: count each cell's particles, the running sum is
+  // where each cell starts, then deal the particles out
+  int n = (int)particles.size();
+  particle_cell.resize(n);
+  std::fill(cell_start.begin(),cell_start.end(),0);
+  for (int p = 0; p < n; p++) {
+    Vec3f pos = particles[p].getPosition();
+    int i = (int)std::min(double(nx-1),std::max(0.0,floor(pos.x()/dx)));
+    int j = (int)std::min(double(ny-1),std::max(0.0,floor(pos.y()/dy)));
+    int k = (int)std::min(double(nz-1),std::max(0.0,floor(pos.z()/dz)));
+    particle_cell[p] = index(i,j,k);
+    cell_start[particle_cell[p]+1]++;
+  }
+  for (int c = 0; c < size(); c++)
+    cell_start[c+1] += cell_start[c];
+  sorted.resize(n);
+  for (int p = 0; p < n; p++)
+    sorted[cell_start[particle_cell[p]]++] = particles[p];
+  // (each start got moved to the next cell's)
+  for (int c = size(); c > 0; c--)
+    cell_start[c] = cell_start[c-1];
+  cell_start[0] = 0;
+  particles.swap(sorted);
+}
+
+// ================================================================================
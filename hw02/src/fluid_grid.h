@@ -0,0 +1,77 @@
+#ifndef _FLUID_GRID_H_
+#define _FLUID_GRID_H_
+
+#include <vector>
+#include "cell.h"
+
+// the grid's velocities & pressures are doubles, or floats with
+// -DFLUID_FLOAT (cmake -DFLUID_FLOAT=ON): half the memory to stream
+// through every sweep, twice the numbers per vector instruction
+#ifdef FLUID_FLOAT
+typedef float fluid_real;
+#else
+typedef double fluid_real;
+#endif
+
+// before a loop along k that reads some arrays & writes others: they
+// never overlap (else the compiler wants more run time overlap checks
+// than it's willing to make and won't vectorize)
+#if defined(__clang__)
+#define FLUID_NO_ALIAS _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#define FLUID_NO_ALIAS _Pragma("GCC ivdep")
+#else
+#define FLUID_NO_ALIAS
+#endif
+
+// =====================================================================================
+// The MAC grid of the fluid, one flat array per quantity, padded with
+// a layer of cells all around.  Cell (i,j,k), -1 <= i <= nx etc., is
+// entry (i+1)*sx + (j+1)*sy + (k+1): its neighbors are sx, sy & 1
+// away, so a stencil is a few loads at fixed offsets and a loop along
+// k walks every array in order.
+//
+// u[c] is the velocity through the +x face of cell c (v the +y face, w
+// the +z face), new_u etc. the velocities being worked out for the end
+// of the step.
+//
+// The marker particles are one array sorted by cell: the particles in
+// cell c are particles[cell_start[c]] .. particles[cell_start[c+1]-1].
+// =====================================================================================
+
+class FluidGrid {
+public:
+  FluidGrid() : nx(0), ny(0), nz(0), sx(0), sy(0) {}
+
+  // nx by ny by nz cells (plus the padding), everything 0, every cell a
+  // CELL_SURFACE (the padding stays that way) & no particles
+  void resize(int nx, int ny, int nz);
+
+  // ACCESSORS
+  int size() const { return (int)pressure.size(); }
+  int index(int i, int j, int k) const { return (i+1)*sx + (j+1)*sy + (k+1); }
+  int numParticles(int c) const { return cell_start[c+1] - cell_start[c]; }
+
+  // puts the particles in the cells they're in (the nearest cell of
+  // the grid for the ones that got outside), in cell order
+  void SortParticles(double dx, double dy, double dz);
+
+  // REPRESENTATION (public, for the fluid's loops)
+  int nx, ny, nz;
+  int sx, sy;   // how far the next i & the next j are (the next k is 1)
+  std::vector<fluid_real> u, v, w;
+  std::vector<fluid_real> new_u, new_v, new_w;
+  std::vector<fluid_real> pressure;
+  std::vector<unsigned char> status;   // CELL_STATUS
+  std::vector<FluidParticle> particles;
+  std::vector<int> cell_start;
+
+private:
+  // for sorting
+  std::vector<int> particle_cell;
+  std::vector<FluidParticle> sorted;
+};
+
+// =====================================================================================
+
+#endif
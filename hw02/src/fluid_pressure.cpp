@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cmath>
+#include "fluid_pressure.h"
+
+// MIC(0): how much of the dropped fill in goes back on the diagonal, &
+// how small a pivot gets before falling back to plain incomplete Cholesky
+#define MIC_TAU 0.97
+#define MIC_SIGMA 0.25
+
+// ================================================================================
+
+// (4 partial results, so each add doesn't wait on the one before &
+// the compiler can vectorize without reordering the arithmetic itself)
+static double Dot(const std::vector<fluid_real> &a, const std::vector<fluid_real> &b) {
+  double sum[4] = { 0, 0, 0, 0 };
+  unsigned int n = a.size(), i = 0;
+  for (; i+4 <= n; i += 4) {
+    for (int l = 0; l < 4; l++) sum[l] += a[i+l]*b[i+l];
+  }
+  for (; i < n; i++) sum[0] += a[i]*b[i];
+  return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+static double MaxAbs(const std::vector<fluid_real> &a) {
+  double result = 0;
+  for (unsigned int i = 0; i < a.size(); i++) result = std::max(result,(double)fabs(a[i]));
+  return result;
+}
+
+// q += alpha s, r -= alpha t & how big the biggest r is now
+static double Update(std::vector<fluid_real> &q, std::vector<fluid_real> &r,
+                     const std::vector<fluid_real> &s, const std::vector<fluid_real> &t, fluid_real alpha) {
+  fluid_real result[4] = { 0, 0, 0, 0 };
+  unsigned int n = q.size(), i = 0;
+  for (; i+4 <= n; i += 4) {
+    for (int l = 0; l < 4; l++) {
+      q[i+l] += alpha*s[i+l];
+      r[i+l] -= alpha*t[i+l];
+      fluid_real x = fabs(r[i+l]);
+      result[l] = (x > result[l]) ? x : result[l];
+    }
+  }
+  for (; i < n; i++) {
+    q[i] += alpha*s[i];
+    r[i] -= alpha*t[i];
+    result[0] = std::max(result[0],(fluid_real)fabs(r[i]));
+  }
+  return std::max(std::max(result[0],result[1]),std::max(result[2],result[3]));
+}
+
+// (anything with particles in it, FULL or SURFACE)
+static bool isFluid(unsigned char status) { return status != CELL_EMPTY; }
+
+// ================================================================================
+
+void FluidPressureSolver::BuildMatrix(const FluidGrid &grid, double dx, double dy, double dz, double dt) {
+  const int nx = grid.nx, ny = grid.ny, nz = grid.nz;
+  const int sx = grid.sx, sy = grid.sy;
+  const unsigned char *status = grid.status.data();
+  const fluid_real ax = dt/(dx*dx), ay = dt/(dy*dy), az = dt/(dz*dz);
+  coefficient_x = -ax;  coefficient_y = -ay;  coefficient_z = -az;
+  diagonal.assign(grid.size(),0);
+  plus_x.assign(grid.size(),0);
+  plus_y.assign(grid.size(),0);
+  plus_z.assign(grid.size(),0);
+  for (int i = 0; i < nx; i++) {
+    for (int j = 0; j < ny; j++) {
+      for (int k = 0; k < nz; k++) {
+        int c = grid.index(i,j,k);
+        if (!isFluid(status[c])) continue;
+        // every face that isn't a wall, into fluid or into an empty cell
+        diagonal[c] = ax*((i > 0) + (i < nx-1)) + ay*((j > 0) + (j < ny-1)) + az*((k > 0) + (k < nz-1));
+        plus_x[c] = (i < nx-1 && isFluid(status[c+sx]));
+        plus_y[c] = (j < ny-1 && isFluid(status[c+sy]));
+        plus_z[c] = (k < nz-1 && isFluid(status[c+1]));
+      }
+    }
+  }
+}
+
+void FluidPressureSolver::BuildPreconditioner(const FluidGrid &grid) {
+  // the incomplete Cholesky factor L D L^T has L's off diagonals from
+  // A, so all there is to work out is D, cell by cell in order
+  const int sx = grid.sx, sy = grid.sy;
+  const double ax = coefficient_x, ay = coefficient_y, az = coefficient_z;
+  precon.assign(grid.size(),0);
+  for (int i = 0; i < grid.nx; i++) {
+    for (int j = 0; j < grid.ny; j++) {
+      int c0 = grid.index(i,j,0);
+      for (int c = c0; c < c0+grid.nz; c++) {
+        if (diagonal[c] == 0) continue;
+        // the coefficients to the cells before
+        double x = ax*plus_x[c-sx], y = ay*plus_y[c-sy], z = az*plus_z[c-1];
+        double px = x*precon[c-sx], py = y*precon[c-sy], pz = z*precon[c-1];
+        double e = diagonal[c] - px*px - py*py - pz*pz
+          - MIC_TAU * (x*(ay*plus_y[c-sx] + az*plus_z[c-sx])*precon[c-sx]*precon[c-sx] +
+                       y*(ax*plus_x[c-sy] + az*plus_z[c-sy])*precon[c-sy]*precon[c-sy] +
+                       z*(ax*plus_x[c-1] + ay*plus_y[c-1])*precon[c-1]*precon[c-1]);
+        if (e < MIC_SIGMA*diagonal[c]) e = diagonal[c];
+        precon[c] = 1/sqrt(e);
+      }
+    }
+  }
+}
+
+void FluidPressureSolver::ApplyPreconditioner(const FluidGrid &grid, const std::vector<fluid_real> &_r,
+                                              std::vector<fluid_real> &_z) const {
+  // row by row along k: the terms from the rows before (after) are a
+  // plain stream, then each cell only waits on its neighbor in the row
+  // (outside the fluid precon is 0, so z is too)
+  const int nx = grid.nx, ny = grid.ny, nz = grid.nz;
+  const int sx = grid.sx, sy = grid.sy;
+  const fluid_real *r = _r.data();
+  const unsigned char *px = plus_x.data(), *py = plus_y.data(), *pz = plus_z.data();
+  const fluid_real ax = coefficient_x, ay = coefficient_y, az = coefficient_z;
+  const fluid_real *e = precon.data();
+  fluid_real *z = _z.data();
+  // L y = r
+  for (int i = 0; i < nx; i++) {
+    for (int j = 0; j < ny; j++) {
+      int c0 = grid.index(i,j,0), c1 = c0+nz;
+      FLUID_NO_ALIAS
+      for (int c = c0; c < c1; c++)
+        z[c] = (r[c] - ax*px[c-sx]*e[c-sx]*z[c-sx] - ay*py[c-sy]*e[c-sy]*z[c-sy]) * e[c];
+      fluid_real y = 0;
+      for (int c = c0; c < c1; c++) {
+        y = z[c] - az*pz[c-1]*e[c-1]*e[c] * y;
+        z[c] = y;
+      }
+    }
+  }
+  // L^T z = y
+  for (int i = nx-1; i >= 0; i--) {
+    for (int j = ny-1; j >= 0; j--) {
+      int c0 = grid.index(i,j,0), c1 = c0+nz;
+      FLUID_NO_ALIAS
+      for (int c = c0; c < c1; c++)
+        z[c] = (z[c] - ax*px[c]*e[c]*z[c+sx] - ay*py[c]*e[c]*z[c+sy]) * e[c];
+      fluid_real y = 0;
+      for (int c = c1-1; c >= c0; c--) {
+        y = z[c] - az*pz[c]*e[c]*e[c] * y;
+        z[c] = y;
+      }
+    }
+  }
+}
+
+void FluidPressureSolver::Multiply(const FluidGrid &grid, const std::vector<fluid_real> &_x,
+                                   std::vector<fluid_real> &_result) const {
+  const int sx = grid.sx, sy = grid.sy;
+  const fluid_real *x = _x.data();
+  const fluid_real *d = diagonal.data();
+  const unsigned char *px = plus_x.data(), *py = plus_y.data(), *pz = plus_z.data();
+  const fluid_real ax = coefficient_x, ay = coefficient_y, az = coefficient_z;
+  fluid_real *result = _result.data();
+  for (int i = 0; i < grid.nx; i++) {
+    for (int j = 0; j < grid.ny; j++) {
+      int c0 = grid.index(i,j,0), c1 = c0+grid.nz;
+      FLUID_NO_ALIAS
+      for (int c = c0; c < c1; c++) {
+        result[c] = d[c]*x[c] +
+          ax*(px[c]*x[c+sx] + px[c-sx]*x[c-sx]) +
+          ay*(py[c]*x[c+sy] + py[c-sy]*x[c-sy]) +
+          az*(pz[c]*x[c+1] + pz[c-1]*x[c-1]);
+      }
+    }
+  }
+}
+
+// ================================================================================
+
+bool FluidPressureSolver::Project(FluidGrid &grid, double dx, double dy, double dz, double dt) {
+  const int nx = grid.nx, ny = grid.ny, nz = grid.nz;
+  const int sx = grid.sx, sy = grid.sy;
+  const unsigned char *status = grid.status.data();
+  fluid_real *new_u = grid.new_u.data(), *new_v = grid.new_v.data(), *new_w = grid.new_w.data();
+  const int n = grid.size();
+  BuildMatrix(grid,dx,dy,dz,dt);
+  BuildPreconditioner(grid);
+
+  // the right hand side, -the divergence of every fluid cell (in r)
+  const fluid_real inv_dx = 1/dx, inv_dy = 1/dy, inv_dz = 1/dz;
+  q.assign(n,0);
+  r.assign(n,0);
+  z.assign(n,0);
+  s.assign(n,0);
+  t.assign(n,0);
+  int fluid_cells = 0, empty_cells = 0;
+  double total = 0;
+  for (int i = 0; i < nx; i++) {
+    for (int j = 0; j < ny; j++) {
+      int c0 = grid.index(i,j,0);
+      for (int c = c0; c < c0+nz; c++) {
+        if (!isFluid(status[c])) { empty_cells++; continue; }
+        r[c] = - ( inv_dx * (new_u[c] - new_u[c-sx]) +
+                   inv_dy * (new_v[c] - new_v[c-sy]) +
+                   inv_dz * (new_w[c] - new_w[c-1]) );
+        total += r[c];
+        fluid_cells++;
+      }
+    }
+  }
+  // fluid everywhere: only the walls, so the pressure is only known up
+  // to a constant & the divergences have to add up to 0 (they do, but
+  // for round off)
+  if (empty_cells == 0 && fluid_cells > 0) {
+    fluid_real mean = total / fluid_cells;
+    for (int c = 0; c < n; c++)
+      if (diagonal[c] != 0) r[c] -= mean;
+  }
+
+  // preconditioned conjugate gradient from q = 0
+  last_residual = MaxAbs(r);
+  double target = tolerance*last_residual;
+  last_iterations = 0;
+  if (last_residual > 0) {
+    ApplyPreconditioner(grid,r,z);
+    s = z;
+    double rz = Dot(r,z);
+    while (last_iterations < max_iterations) {
+      Multiply(grid,s,t);
+      double st = Dot(s,t);
+      if (st <= 0) break;
+      last_residual = Update(q,r,s,t,rz/st);
+      last_iterations++;
+      if (last_residual <= target) break;
+      ApplyPreconditioner(grid,r,z);
+      double rz_new = Dot(r,z);
+      fluid_real beta = rz_new / rz;
+      rz = rz_new;
+      for (int c = 0; c < n; c++) s[c] = z[c] + beta*s[c];
+    }
+  }
+
+  // the new velocities -= dt grad q, through every face but the walls'
+  // (between two empty cells q is 0 on both sides)
+  const fluid_real dt_dx = dt/dx, dt_dy = dt/dy, dt_dz = dt/dz;
+  const fluid_real *p = q.data();
+  fluid_real *pressure = grid.pressure.data();
+  for (int i = 0; i < nx; i++) {
+    for (int j = 0; j < ny; j++) {
+      int c0 = grid.index(i,j,0);
+      if (i < nx-1) {
+        FLUID_NO_ALIAS
+        for (int c = c0; c < c0+nz; c++) new_u[c] -= dt_dx * (p[c+sx] - p[c]);
+      }
+      if (j < ny-1) {
+        FLUID_NO_ALIAS
+        for (int c = c0; c < c0+nz; c++) new_v[c] -= dt_dy * (p[c+sy] - p[c]);
+      }
+      FLUID_NO_ALIAS
+      for (int c = c0; c < c0+nz-1; c++) new_w[c] -= dt_dz * (p[c+1] - p[c]);
+      // & the pressures (zeroed in the empty cells, as in Foster 2001)
+      FLUID_NO_ALIAS
+      for (int c = c0; c < c0+nz; c++)
+        pressure[c] = (status[c] == CELL_EMPTY) ? 0 : pressure[c] + p[c];
+    }
+  }
+  return last_residual <= target;
+}
+
+// ================================================================================
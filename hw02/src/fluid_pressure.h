@@ -0,0 +1,76 @@
+#ifndef _FLUID_PRESSURE_H_
+#define _FLUID_PRESSURE_H_
+
+#include <vector>
+#include "fluid_grid.h"
+
+// =====================================================================================
+// The pressure projection of the fluid: the pressure change q that
+// makes the new velocities divergence free in every cell with fluid in
+// it (FULL or SURFACE) solves the Poisson equation
+//
+//   -dt laplacian(q) = -divergence(new velocities)
+//
+// with q = 0 in the empty cells (the free surface) and no flow through
+// the walls of the grid (a wall face drops out of its cell's
+// diagonal).  The matrix is never formed, just its diagonal and the
+// coefficient to the +x, +y & +z neighbor of every cell, in arrays
+// laid out like the grid's, so multiplying is the same fixed offset
+// stencil as the other sweeps.  It's solved by conjugate gradient with
+// a modified incomplete Cholesky preconditioner, MIC(0) (Bridson,
+// "Fluid Simulation for Computer Graphics", ch. 5): tens of iterations
+// even on big grids.  The two triangular solves of the preconditioner
+// go cell by cell in order, everything else is a stream through the
+// arrays.
+// =====================================================================================
+
+class FluidPressureSolver {
+public:
+  FluidPressureSolver() : tolerance(1e-6), max_iterations(200), last_iterations(0), last_residual(0),
+                          coefficient_x(0), coefficient_y(0), coefficient_z(0) {}
+
+  // ACCESSORS
+  double getTolerance() const { return tolerance; }
+  int getMaxIterations() const { return max_iterations; }
+  int getLastIterations() const { return last_iterations; }
+  // the largest divergence left, after the last solve
+  double getLastResidual() const { return last_residual; }
+
+  // MODIFIERS
+  // CG stops when the largest divergence left is down to tolerance *
+  // the largest one before
+  void setTolerance(double t) { tolerance = t; }
+  void setMaxIterations(int n) { max_iterations = n; }
+
+  // subtracts dt * the gradient of q from grid.new_u/v/w & adds q to
+  // grid.pressure (zero in the empty cells), the new velocities' wall
+  // faces must already be set; false if CG ran out of iterations
+  bool Project(FluidGrid &grid, double dx, double dy, double dz, double dt);
+
+private:
+
+  void BuildMatrix(const FluidGrid &grid, double dx, double dy, double dz, double dt);
+  void BuildPreconditioner(const FluidGrid &grid);
+  // z = M^-1 r
+  void ApplyPreconditioner(const FluidGrid &grid, const std::vector<fluid_real> &r, std::vector<fluid_real> &z) const;
+  // result = A x
+  void Multiply(const FluidGrid &grid, const std::vector<fluid_real> &x, std::vector<fluid_real> &result) const;
+
+  // REPRESENTATION
+  double tolerance;
+  int max_iterations;
+  int last_iterations;
+  double last_residual;
+  // the matrix: the diagonal, & whether cell c & c+sx (c+sy, c+1) are
+  // both fluid, when the coefficient between them is coefficient_x (the
+  // same for every pair, so it's one byte per cell streamed through
+  // instead of a number), all 0 outside the fluid
+  std::vector<fluid_real> diagonal;
+  std::vector<unsigned char> plus_x, plus_y, plus_z;
+  double coefficient_x, coefficient_y, coefficient_z;
+  std::vector<fluid_real> precon;   // 1 / the diagonal of the MIC(0) factor
+  // kept to not reallocate every step
+  std::vector<fluid_real> q, r, z, s, t;
+};
+
+#endif
@@ -36,18 +36,9 @@ void Fluid::setupVBOs() {
   // =====================================================================================
   // setup the particles
   // =====================================================================================
-  for (int x = 0; x < nx; x++) {
-    for (int y = 0; y < ny; y++) {
-      for (int z = 0; z < nz; z++) {
-	Cell *cell = getCell(x,y,z);
-	std::vector<FluidParticle*> &particles = cell->getParticles();
-	for (unsigned int iter = 0; iter < particles.size(); iter++) {
-	  FluidParticle *p = particles[iter];
-	  Vec3f v = p->getPosition();
-	  fluid_particles.push_back(VBOPos(v));
-	}
-      }
-    }
+  for (unsigned int n = 0; n < grid.particles.size(); n++) {
+    Vec3f v = grid.particles[n].getPosition();
+    fluid_particles.push_back(VBOPos(v));
   }
 
   // =====================================================================================
@@ -178,7 +169,7 @@ void Fluid::setupVBOs() {
 			 Vec3f((i+0.9)*dx,(j+0.1)*dy,(k+0.9)*dz),
 			 Vec3f((i+0.9)*dx,(j+0.9)*dy,(k+0.1)*dz),
 			 Vec3f((i+0.9)*dx,(j+0.9)*dy,(k+0.9)*dz) };
-          double p = getCell(i,j,k)->getPressure();
+          double p = getPressure(i,j,k);
           p *= 0.1;
           if (p > 1) p = 1;
           if (p < -1) p = -1;
@@ -208,11 +199,10 @@ void Fluid::setupVBOs() {
 			 Vec3f((i+0.9)*dx,(j+0.1)*dy,(k+0.9)*dz),
 			 Vec3f((i+0.9)*dx,(j+0.9)*dy,(k+0.1)*dz),
 			 Vec3f((i+0.9)*dx,(j+0.9)*dy,(k+0.9)*dz) };
-	Cell *cell = getCell(i,j,k);
 	Vec3f color;
-	if (cell->getStatus() == CELL_FULL) {
+	if (getStatus(i,j,k) == CELL_FULL) {
 	  color = Vec3f(1,0,0);
-	} else if (cell->getStatus() == CELL_SURFACE) {
+	} else if (getStatus(i,j,k) == CELL_SURFACE) {
 	  color=Vec3f(0,0,1);
 	} else {
 	  continue;
@@ -386,12 +376,12 @@ double Fluid::getIsovalue(int i, int j, int k) const {
   i = my_max(0,(my_min(i,nx-1)));
   j = my_max(0,(my_min(j,ny-1)));
   k = my_max(0,(my_min(k,nz-1)));
-  Cell *c = getCell(i,j,k);
-  if (c->getStatus() == CELL_EMPTY) return 0;
+  enum CELL_STATUS status = getStatus(i,j,k);
+  if (status == CELL_EMPTY) return 0;
   // note: this is technically not a correct thing to do
   //       the number of particles is not an indication of it's "fullness"
-  if (c->getStatus() == CELL_SURFACE) return 0.5 + c->numParticles()/double(density);
-  if (c->getStatus() == CELL_FULL) return 2;
+  if (status == CELL_SURFACE) return 0.5 + numParticles(i,j,k)/double(density);
+  if (status == CELL_FULL) return 2;
   assert(0);
   return 0;
 }
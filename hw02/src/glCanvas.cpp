@@ -96,6 +96,7 @@ void GLCanvas::Load() {
     cloth = new Cloth(args);
   if (args->fluid_file != "")
     fluid = new Fluid(args);
+  if (cloth) cloth->initializeVBOs();
   if (cloth) cloth->setupVBOs();
   if (fluid) fluid->setupVBOs();
 }
@@ -307,6 +308,35 @@ void GLCanvas::keyboard(unsigned char key, int /*x*/, int /*y*/) {
     args->pressure = !args->pressure;
     glutPostRedisplay();
     break; 
+  case 'k':  case 'K': 
+  case 'l':  case 'L': {
+    // save / load a checkpoint of the cloth
+    if (!cloth) break;
+    std::string filename = (args->checkpoint_file != "") ? args->checkpoint_file : "cloth.checkpoint";
+    if (key == 'k' || key == 'K') {
+      if (cloth->SaveCheckpoint(filename))
+        std::cout << "frame " << cloth->getFrame() << " saved to " << filename << std::endl;
+    } else if (cloth->LoadCheckpoint(filename)) {
+      std::cout << "frame " << cloth->getFrame() << " loaded from " << filename << std::endl;
+      cloth->setupVBOs();
+      glutPostRedisplay();
+    }
+    break; 
+  }
+  case '[':  case ']': 
+  case '{':  case '}': {
+    // scrub through the -playback frames, 1 (or 10) at a time
+    if (!cloth || !cloth->isPlayingBack()) {
+      printf ("nothing to scrub through, load a frame cache with -playback\n");
+      break;
+    }
+    int frames = (key == '[' || key == ']') ? 1 : 10;
+    if (key == '[' || key == '{') frames = -frames;
+    cloth->ShowFrame(cloth->getFrame() + frames);
+    cloth->setupVBOs();
+    glutPostRedisplay();
+    break; 
+  }
   case 'r':  case 'R': 
     // reset system
     Load();
@@ -1,7 +1,9 @@
 #include "glCanvas.h"
 
 #include <iostream> 
+#include <chrono>
 #include "argparser.h"
+#include "cloth.h"
 
 // =========================================
 // =========================================
@@ -12,6 +14,37 @@ int main(int argc, char *argv[]) {
     std::cout << "ERROR: no simulation specified" << std::endl;
     return 0;
   }
+  if (args.frames > 0) {
+    // no window, time the cloth frames
+    if (args.cloth_file == "") {
+      std::cout << "ERROR: -frames only runs a cloth simulation" << std::endl;
+      return 0;
+    }
+    Cloth cloth(&args);
+    if (cloth.isPlayingBack()) {
+      // time jumping around the cached frames
+      int first = cloth.firstCachedFrame();
+      int count = cloth.numCachedFrames();
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      for (int i = 0; i < args.frames; i++)
+        cloth.ShowFrame(first + args.mtrand.randInt(count-1));
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::cout << cloth.numParticles() << " particles, " << args.frames << " random frames of the "
+                << count << " cached: " << 1000 * seconds / args.frames << " ms per frame" << std::endl;
+      return 0;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < args.frames; i++)
+      cloth.Step();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << cloth.numParticles() << " particles, " << args.frames << " frames ("
+              << cloth.numSubsteps() << " steps) on " << cloth.numThreads() << " threads: "
+              << seconds << " s, " << args.frames * args.timestep / seconds
+              << " simulated s/s, checksum " << std::hex << cloth.Checksum() << std::dec << std::endl;
+    if (args.checkpoint_file != "" && cloth.SaveCheckpoint(args.checkpoint_file))
+      std::cout << "frame " << cloth.getFrame() << " saved to " << args.checkpoint_file << std::endl;
+    return 0;
+  }
   glutInit(&argc,argv);
   GLCanvas::initialize(&args);
   return 0;
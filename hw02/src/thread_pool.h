@@ -0,0 +1,158 @@
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// checks this many times for work (or for the workers to finish),
+// yielding in between, before going to sleep: a cloth step hands out a
+// few dozen small jobs back to back
+#define THREAD_POOL_SPIN 1000
+
+// ====================================================================
+// ====================================================================
+// A fixed set of worker threads for fork/join loops.  Run(n,fn) calls
+// fn(task) for every task in [0,n), task t always on thread
+// t % numThreads() (0 is the calling thread), and returns when all are
+// done.  ParallelFor cuts [0,n) into numChunks contiguous pieces that
+// only depend on n, the thread count and the minimum chunk size, so
+// anything summed per chunk and combined in chunk order comes out
+// the same every run.  No allocation per job.
+
+class ThreadPool {
+public:
+
+  // 0 threads == one per hardware thread
+  ThreadPool(int num_threads = 0) : generation(0), pending(0), quit(false), job(NULL), context(NULL), num_tasks(0) {
+    if (num_threads <= 0) num_threads = std::thread::hardware_concurrency();
+    if (num_threads <= 0) num_threads = 1;
+    for (int i = 1; i < num_threads; i++)
+      workers.push_back(std::thread(&ThreadPool::worker,this,i));
+  }
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      quit = true;
+      generation++;
+    }
+    wake.notify_all();
+    for (unsigned int i = 0; i < workers.size(); i++) workers[i].join();
+  }
+
+  int numThreads() const { return (int)workers.size() + 1; }
+
+  // pieces of at least min_chunk items, at most one per thread
+  int numChunks(int n, int min_chunk) const {
+    int chunks = (min_chunk > 0) ? n / min_chunk : n;
+    if (chunks > numThreads()) chunks = numThreads();
+    if (chunks < 1) chunks = 1;
+    return chunks;
+  }
+  static int chunkBegin(int n, int num_chunks, int chunk) {
+    return (int)(((long long)n * chunk) / num_chunks);
+  }
+
+  // fn(task)
+  template <class F>
+  void Run(int n, const F &fn) {
+    if (n <= 1 || workers.empty()) {
+      for (int t = 0; t < n; t++) fn(t);
+      return;
+    }
+    start(n,&Call<F>,(void*)&fn);
+    for (int t = 0; t < n; t += numThreads()) fn(t);
+    finish();
+  }
+
+  // fn(begin,end,chunk)
+  template <class F>
+  void ParallelForChunks(int n, int num_chunks, const F &fn) {
+    Run(num_chunks,[&](int chunk) {
+        fn(chunkBegin(n,num_chunks,chunk),chunkBegin(n,num_chunks,chunk+1),chunk);
+      });
+  }
+
+  // fn(begin,end)
+  template <class F>
+  void ParallelFor(int n, int min_chunk, const F &fn) {
+    ParallelForChunks(n,numChunks(n,min_chunk),[&](int begin, int end, int) { fn(begin,end); });
+  }
+
+private:
+
+  template <class F>
+  static void Call(void *fn, int task) { (*(const F*)fn)(task); }
+
+  void start(int n, void (*j)(void*,int), void *c) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      job = j;
+      context = c;
+      num_tasks = n;
+      pending = (int)workers.size();
+      generation++;
+    }
+    wake.notify_all();
+  }
+
+  void finish() {
+    for (int spin = 0; spin < THREAD_POOL_SPIN; spin++) {
+      if (pending.load() == 0) return;
+      std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock,[this]() { return pending.load() == 0; });
+  }
+
+  void worker(int index) {
+    unsigned long seen = 0;
+    while (true) {
+      // look for the next job, spinning a little before sleeping
+      bool found = false;
+      for (int spin = 0; spin < THREAD_POOL_SPIN && !found; spin++) {
+        found = (generation.load() != seen);
+        if (!found) std::this_thread::yield();
+      }
+      std::unique_lock<std::mutex> lock(mutex);
+      if (!found) wake.wait(lock,[&]() { return generation.load() != seen; });
+      seen = generation.load();
+      if (quit) return;
+      void (*j)(void*,int) = job;
+      void *c = context;
+      int n = num_tasks;
+      lock.unlock();
+      for (int t = index; t < n; t += numThreads()) j(c,t);
+      if (--pending == 0) {
+        std::lock_guard<std::mutex> done_lock(mutex);
+        done.notify_one();
+      }
+    }
+  }
+
+  // don't copy the threads
+  ThreadPool(const ThreadPool &) { assert(0); }
+  const ThreadPool& operator=(const ThreadPool &) { assert(0); return *this; }
+
+  // ==============
+  // REPRESENTATION
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  std::atomic<unsigned long> generation;
+  std::atomic<int> pending;
+  bool quit;
+  // the current job
+  void (*job)(void*,int);
+  void *context;
+  int num_tasks;
+};
+
+// ====================================================================
+// ====================================================================
+
+#endif
@@ -30,6 +30,9 @@ public:
       if (!strcmp(argv[i],"-input") || !strcmp(argv[i],"-i")) {
 	i++; assert (i < argc); 
 	input_file = argv[i];
+      } else if (!strcmp(argv[i],"-output") || !strcmp(argv[i],"-o")) {
+	i++; assert (i < argc); 
+	output_file = argv[i];
       } else if (!strcmp(argv[i],"-size")) {
 	i++; assert (i < argc); 
 	width = atoi(argv[i]);
@@ -92,6 +95,7 @@ public:
   void Usage(char* program_name) {
     std::cerr << "Usage: " << program_name << " -input <input_file> [ options ]\n";
     std::cerr << "   options:\n";
+    std::cerr << "     -output <file.pfm | file.exr | file.ppm>\n";
     std::cerr << "     -size <width> <height>\n";
     std::cerr << "     -num_form_factor_samples <num_samples>\n";
     std::cerr << "     -sphere_rasterization <horiz> <vert>\n";
@@ -110,6 +114,7 @@ public:
   void DefaultValues() {
     // BASIC RENDERING PARAMETERS
     input_file = NULL;
+    output_file = NULL;
     width = 400;
     height = 400;
     raytracing_animation = false;
@@ -147,6 +152,7 @@ public:
 
   // BASIC RENDERING PARAMETERS
   char *input_file;
+  char *output_file;
   int width;
   int height;
   bool raytracing_animation;
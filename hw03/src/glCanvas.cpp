@@ -7,6 +7,7 @@
 #include "photon_mapping.h"
 #include "mesh.h"
 #include "raytree.h"
+#include "hdr_image.h"
 #include "utils.h"
 
 // ========================================================
@@ -30,6 +31,7 @@ bool GLCanvas::altPressed = false;
 int GLCanvas::raytracing_x;
 int GLCanvas::raytracing_y;
 int GLCanvas::raytracing_skip;
+HDRImage* GLCanvas::framebuffer = NULL;
 
 // ========================================================
 // Initialize all appropriate OpenGL variables, set
@@ -247,12 +249,7 @@ void GLCanvas::keyboard(unsigned char key, int x, int y) {
     args->gather_indirect=false;
     args->raytracing_animation = !args->raytracing_animation;
     if (args->raytracing_animation) {
-      raytracing_skip = my_max(args->width,args->height) / 10;
-      if (raytracing_skip % 2 == 0) raytracing_skip++;
-      assert (raytracing_skip >= 1);
-      raytracing_x = raytracing_skip/2;
-      raytracing_y = raytracing_skip/2;
-      display(); // clear out any old rendering
+      StartRaytracingAnimation();
       printf ("raytracing animation started, press 'R' to stop\n");
     } else
       printf ("raytracing animation stopped, press 'R' to start\n");    
@@ -306,12 +303,7 @@ void GLCanvas::keyboard(unsigned char key, int x, int y) {
     args->gather_indirect = true;
     args->raytracing_animation = !args->raytracing_animation;
     if (args->raytracing_animation) {
-      raytracing_skip = my_max(args->width,args->height) / 10;
-      if (raytracing_skip % 2 == 0) raytracing_skip++;
-      assert (raytracing_skip >= 1);
-      raytracing_x = raytracing_skip/2;
-      raytracing_y = raytracing_skip/2;
-      display(); // clear out any old rendering
+      StartRaytracingAnimation();
       printf ("photon mapping animation started, press 'G' to stop\n");
     } else
       printf ("photon mapping animation stopped, press 'G' to start\n");    
@@ -348,6 +340,11 @@ void GLCanvas::keyboard(unsigned char key, int x, int y) {
     glutPostRedisplay();
     break;
 
+    // save the linear ray traced image (.pfm, .exr or .ppm)
+  case 'o':  case 'O':
+    SaveFramebuffer();
+    break;
+
     // VISUALIZATIONS
   case 'w':  case 'W':
     // render wireframe mode
@@ -386,6 +383,7 @@ void GLCanvas::keyboard(unsigned char key, int x, int y) {
     delete GLCanvas::raytracer;
     delete GLCanvas::radiosity;
     delete GLCanvas::mesh;
+    delete GLCanvas::framebuffer;
     exit(0);
     break;
   default:
@@ -394,6 +392,29 @@ void GLCanvas::keyboard(unsigned char key, int x, int y) {
 }
 
 
+// reset the progressive scan and the linear framebuffer
+void GLCanvas::StartRaytracingAnimation() {
+  raytracing_skip = my_max(args->width,args->height) / 10;
+  if (raytracing_skip % 2 == 0) raytracing_skip++;
+  assert (raytracing_skip >= 1);
+  raytracing_x = raytracing_skip/2;
+  raytracing_y = raytracing_skip/2;
+  if (framebuffer == NULL) framebuffer = new HDRImage();
+  framebuffer->Allocate(args->width,args->height);
+  display(); // clear out any old rendering
+}
+
+// write the un-clamped linear colors of the last ray tracing pass
+void GLCanvas::SaveFramebuffer() {
+  if (framebuffer == NULL) {
+    printf ("nothing to save, press 'R' or 'G' to ray trace first\n");
+    return;
+  }
+  std::string filename = args->output_file ? args->output_file : "output.pfm";
+  if (framebuffer->Save(filename))
+    printf ("saved %dx%d image to %s\n", framebuffer->Width(), framebuffer->Height(), filename.c_str());
+}
+
 // trace a ray through pixel (i,j) of the image an return the color
 Vec3f GLCanvas::TraceRay(double i, double j) {
   // compute and set the pixel color
@@ -473,6 +494,7 @@ int GLCanvas::DrawPixel() {
 
   // compute the color and position of intersection
   Vec3f color= TraceRay(raytracing_x, raytracing_y);
+  framebuffer->SetBlock(raytracing_x, raytracing_y, raytracing_skip, color);
   double r = linear_to_srgb(color.x());
   double g = linear_to_srgb(color.y());
   double b = linear_to_srgb(color.z());
@@ -510,6 +532,7 @@ void GLCanvas::idle() {
     for (int i = 0; i < 100; i++) {
       if (!DrawPixel()) {
 	args->raytracing_animation = false;
+	if (args->output_file) SaveFramebuffer();
 	break;
       }
     }
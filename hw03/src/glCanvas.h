@@ -31,6 +31,7 @@ class Mesh;
 class RayTracer;
 class Radiosity;
 class PhotonMapping;
+class HDRImage;
 
 // ====================================================================
 // NOTE:  All the methods and variables of this class are static
@@ -67,6 +68,9 @@ private:
   static int raytracing_y;
   static int raytracing_skip;
 
+  // linear radiance of the most recent ray traced image
+  static HDRImage *framebuffer;
+
   // Callback functions for mouse and keyboard events
   static void display(void);
   static void reshape(int w, int h);
@@ -76,6 +80,8 @@ private:
   static void idle();
   
   static int DrawPixel();
+  static void StartRaytracingAnimation();
+  static void SaveFramebuffer();
   static Vec3f TraceRay(double i, double j);
 };
 
@@ -0,0 +1,164 @@
+#include "group.h"
+#include "material.h"
+#include "argparser.h"
+#include "vertex.h"
+#include "mesh.h"
+#include "ray.h"
+#include "hit.h"
+#include "utils.h"
+
+// ====================================================================
+// ====================================================================
+
+Group::~Group() {
+  for (unsigned int i = 0; i < children.size(); i++) { delete children[i]; }
+  delete bbox;
+}
+
+int Group::addVertex(const Vec3f &pos) {
+  GroupVertex v;
+  v.position = pos;
+  v.s = v.t = 0;
+  verts.push_back(v);
+  return verts.size()-1;
+}
+
+void Group::setTextureCoordinates(int i, double s, double t) {
+  assert (i >= 0 && i < numVertices());
+  verts[i].s = s;
+  verts[i].t = t;
+}
+
+void Group::addQuad(int a, int b, int c, int d, Material *m) {
+  assert (m != NULL);
+  GroupQuad q;
+  q.v[0] = a; q.v[1] = b; q.v[2] = c; q.v[3] = d;
+  for (int i = 0; i < 4; i++) {
+    assert (q.v[i] >= 0 && q.v[i] < numVertices());
+    extendBoundingBox(verts[q.v[i]].position);
+  }
+  // same as Face::computeNormal, average of the two triangle normals
+  const Vec3f &pa = verts[a].position;
+  const Vec3f &pb = verts[b].position;
+  const Vec3f &pc = verts[c].position;
+  const Vec3f &pd = verts[d].position;
+  Vec3f n1,n2;
+  Vec3f::Cross3(n1,pb-pa,pc-pb);
+  Vec3f::Cross3(n2,pc-pa,pd-pc);
+  n1.Normalize();
+  n2.Normalize();
+  q.normal = 0.5*(n1+n2);
+  q.material = m;
+  quads.push_back(q);
+}
+
+void Group::addChild(Primitive *p) {
+  assert (p != NULL);
+  children.push_back(p);
+}
+
+void Group::extendBoundingBox(const Vec3f &pos) {
+  if (bbox == NULL)
+    bbox = new BoundingBox(pos,pos);
+  else
+    bbox->Extend(pos);
+}
+
+// ====================================================================
+// RAY TRACING
+
+// slab test, so a ray that misses a prototype skips all of its quads
+static bool IntersectsBox(const Ray &r, const BoundingBox &bb, double t_max) {
+  double t0 = 0, t1 = t_max;
+  for (int i = 0; i < 3; i++) {
+    double o = r.getOrigin()[i];
+    double d = r.getDirection()[i];
+    double lo = bb.getMin()[i] - EPSILON;
+    double hi = bb.getMax()[i] + EPSILON;
+    if (fabs(d) < 1e-12) {
+      if (o < lo || o > hi) return false;
+      continue;
+    }
+    double ta = (lo - o) / d;
+    double tb = (hi - o) / d;
+    if (ta > tb) std::swap(ta,tb);
+    t0 = my_max(t0,ta);
+    t1 = my_min(t1,tb);
+    if (t0 > t1) return false;
+  }
+  return true;
+}
+
+bool Group::triangle_intersect(const Ray &r, Hit &h, const GroupQuad &q, int a, int b, int c) const {
+  const GroupVertex &va = verts[q.v[a]];
+  const GroupVertex &vb = verts[q.v[b]];
+  const GroupVertex &vc = verts[q.v[c]];
+  Vec3f e1 = vb.position - va.position;
+  Vec3f e2 = vc.position - va.position;
+  Vec3f p;
+  Vec3f::Cross3(p,r.getDirection(),e2);
+  double det = e1.Dot3(p);
+  if (fabs(det) <= 0.000001) return false;
+  Vec3f s = r.getOrigin() - va.position;
+  double beta = s.Dot3(p) / det;
+  if (beta < -0.00001 || beta > 1.00001) return false;
+  Vec3f qv;
+  Vec3f::Cross3(qv,s,e1);
+  double gamma = r.getDirection().Dot3(qv) / det;
+  if (gamma < -0.00001 || beta + gamma > 1.00001) return false;
+  double t = e2.Dot3(qv) / det;
+  if (t <= EPSILON || t >= h.getT()) return false;
+  h.set(t,q.material,q.normal);
+  double alpha = 1 - beta - gamma;
+  h.setTextureCoords(alpha * va.s + beta * vb.s + gamma * vc.s,
+                     alpha * va.t + beta * vb.t + gamma * vc.t);
+  return true;
+}
+
+bool Group::intersect(const Ray &r, Hit &h) const {
+  bool answer = false;
+  if (bbox != NULL && IntersectsBox(r,*bbox,h.getT())) {
+    for (unsigned int i = 0; i < quads.size(); i++) {
+      const GroupQuad &q = quads[i];
+      if (!args->intersect_backfacing && q.normal.Dot3(r.getDirection()) >= 0) continue;
+      if (triangle_intersect(r,h,q,0,1,2) || triangle_intersect(r,h,q,0,2,3)) answer = true;
+    }
+  }
+  for (unsigned int i = 0; i < children.size(); i++) {
+    // not all primitives respect the current closest hit, so test on a copy
+    Hit h2 = h;
+    if (children[i]->intersect(r,h2) && h2.getT() < h.getT()) {
+      h = h2;
+      answer = true;
+    }
+  }
+  return answer;
+}
+
+// ====================================================================
+// RADIOSITY
+// Each placement of the group needs its own patches (they carry their
+// own radiance), so the quads are copied into the mesh here.  Any
+// Instance transform is applied by Mesh::addVertex.
+
+void Group::addRasterizedFaces(Mesh *m, ArgParser *args) {
+  int offset = m->numVertices();
+  for (unsigned int i = 0; i < verts.size(); i++) {
+    Vertex *v = m->addVertex(verts[i].position);
+    v->setTextureCoordinates(verts[i].s,verts[i].t);
+  }
+  for (unsigned int i = 0; i < quads.size(); i++) {
+    const GroupQuad &q = quads[i];
+    m->addRasterizedPrimitiveFace(m->getVertex(offset+q.v[0]),
+                                  m->getVertex(offset+q.v[1]),
+                                  m->getVertex(offset+q.v[2]),
+                                  m->getVertex(offset+q.v[3]),
+                                  q.material);
+  }
+  for (unsigned int i = 0; i < children.size(); i++) {
+    children[i]->addRasterizedFaces(m,args);
+  }
+}
+
+// ====================================================================
+// ====================================================================
@@ -0,0 +1,72 @@
+#ifndef _GROUP_H_
+#define _GROUP_H_
+
+#include <vector>
+#include "primitive.h"
+#include "boundingbox.h"
+#include "vectors.h"
+
+// ====================================================================
+// ====================================================================
+// A named collection of quads and primitives in its own local
+// coordinate system (a "prototype" in the .obj file).  A group is
+// stored once and referenced by any number of Instances, so the ray
+// caster only needs memory for the unique geometry.  The quads are
+// kept as a compact vertex/index list rather than as half-edge Faces.
+
+class Group : public Primitive {
+
+public:
+  // CONSTRUCTOR & DESTRUCTOR
+  Group(ArgParser *a) : args(a), bbox(NULL) { material = NULL; }
+  ~Group();
+
+  // =========
+  // MODIFIERS
+  // the group owns its children
+  int addVertex(const Vec3f &pos);
+  void setTextureCoordinates(int i, double s, double t);
+  void addQuad(int a, int b, int c, int d, Material *m);
+  void addChild(Primitive *p);
+
+  // =========
+  // ACCESSORS
+  int numVertices() const { return verts.size(); }
+  int numQuads() const { return quads.size(); }
+  int numChildren() const { return children.size(); }
+
+  // for ray tracing
+  bool intersect(const Ray &r, Hit &h) const;
+
+  // for OpenGL rendering & radiosity
+  void addRasterizedFaces(Mesh *m, ArgParser *args);
+
+private:
+
+  struct GroupVertex {
+    Vec3f position;
+    double s,t;
+  };
+  struct GroupQuad {
+    int v[4];
+    Vec3f normal;
+    Material *material;
+  };
+
+  bool triangle_intersect(const Ray &r, Hit &h, const GroupQuad &q, int a, int b, int c) const;
+  void extendBoundingBox(const Vec3f &pos);
+
+  // ==============
+  // REPRESENTATION
+  ArgParser *args;
+  std::vector<GroupVertex> verts;
+  std::vector<GroupQuad> quads;
+  std::vector<Primitive*> children;
+  // local space bounds of the quads (children test themselves)
+  BoundingBox *bbox;
+};
+
+// ====================================================================
+// ====================================================================
+
+#endif
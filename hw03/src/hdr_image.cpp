@@ -0,0 +1,232 @@
+#include <cstdio>
+#include <cstring>
+#include "hdr_image.h"
+#include "utils.h"
+
+
+// ====================================================================================
+// helpers for building little endian binary headers
+
+static bool HostIsLittleEndian() {
+  unsigned int one = 1;
+  return *((unsigned char*)&one) == 1;
+}
+
+static void PutInt32(std::vector<unsigned char> &buf, int v) {
+  unsigned int u = (unsigned int)v;
+  for (int i = 0; i < 4; i++) buf.push_back((u >> (8*i)) & 0xff);
+}
+
+static void PutUInt64(std::vector<unsigned char> &buf, unsigned long long v) {
+  for (int i = 0; i < 8; i++) buf.push_back((v >> (8*i)) & 0xff);
+}
+
+static void PutFloat(std::vector<unsigned char> &buf, float f) {
+  int v;
+  memcpy(&v,&f,4);
+  PutInt32(buf,v);
+}
+
+static void PutString(std::vector<unsigned char> &buf, const char *s) {
+  buf.insert(buf.end(),s,s+strlen(s)+1);
+}
+
+static void PutAttribute(std::vector<unsigned char> &buf, const char *name, const char *type, int size) {
+  PutString(buf,name);
+  PutString(buf,type);
+  PutInt32(buf,size);
+}
+
+static bool HasExtension(const std::string &filename, const std::string &ext) {
+  int len = filename.length();
+  int elen = ext.length();
+  return len > elen && filename.substr(len-elen) == ext;
+}
+
+// ====================================================================================
+
+unsigned short FloatToHalf(float f) {
+  unsigned int x;
+  memcpy(&x,&f,4);
+  unsigned int sign = (x >> 16) & 0x8000;
+  unsigned int mant = x & 0x007fffff;
+  int exp = (x >> 23) & 0xff;
+
+  // infinity & NaN
+  if (exp == 0xff) {
+    if (mant == 0) return sign | 0x7c00;
+    return sign | 0x7e00;
+  }
+  int e = exp - 127 + 15;
+  // too big, clamp to infinity
+  if (e >= 31) return sign | 0x7c00;
+  // too small for a normalized half
+  if (e <= 0) {
+    if (e < -10) return sign;
+    mant |= 0x00800000;
+    int shift = 14 - e;
+    unsigned int h = mant >> shift;
+    unsigned int rem = mant & ((1u << shift) - 1);
+    unsigned int halfway = 1u << (shift - 1);
+    if (rem > halfway || (rem == halfway && (h & 1))) h++;
+    return sign | h;
+  }
+  unsigned int h = sign | (e << 10) | (mant >> 13);
+  unsigned int rem = mant & 0x1fff;
+  // a carry out of the mantissa correctly bumps the exponent
+  if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) h++;
+  return h;
+}
+
+// ====================================================================================
+
+void HDRImage::SetBlock(int x, int y, int size, const Vec3f &value) {
+  int x0 = my_max(0,x-size/2);
+  int y0 = my_max(0,y-size/2);
+  int x1 = my_min(width,x-size/2+size);
+  int y1 = my_min(height,y-size/2+size);
+  for (int j = y0; j < y1; j++) {
+    for (int i = x0; i < x1; i++) {
+      SetPixel(i,j,value);
+    }
+  }
+}
+
+bool HDRImage::Save(const std::string &filename) const {
+  if (HasExtension(filename,".pfm")) return SavePFM(filename);
+  if (HasExtension(filename,".exr")) return SaveEXR(filename);
+  if (HasExtension(filename,".ppm")) return SavePPM(filename);
+  std::cerr << "ERROR: Unknown image format (use .pfm, .exr, or .ppm): " << filename << std::endl;
+  return false;
+}
+
+// ====================================================================================
+// PFM stores rows bottom to top, same as our memory layout, so the
+// whole buffer goes out in a single write.  The sign of the scale
+// factor in the header records the byte order.
+
+bool HDRImage::SavePFM(const std::string &filename) const {
+  FILE *file = fopen(filename.c_str(), "wb");
+  if (file == NULL) {
+    std::cerr << "Unable to open " << filename << " for writing\n";
+    return false;
+  }
+  fprintf (file, "PF\n");
+  fprintf (file, "%d %d\n", width,height);
+  fprintf (file, "%s\n", HostIsLittleEndian() ? "-1.0" : "1.0");
+  size_t count = data.size();
+  bool ok = (count == 0 || fwrite(&data[0],sizeof(float),count,file) == count);
+  fclose(file);
+  if (!ok) std::cerr << "ERROR: short write to " << filename << std::endl;
+  return ok;
+}
+
+// ====================================================================================
+// Minimal OpenEXR writer: single part, scanline, NO_COMPRESSION, one
+// scanline per block, HALF channels B,G,R (channels must be listed in
+// alphabetical order).  EXR scanline 0 is the top of the image.
+
+bool HDRImage::SaveEXR(const std::string &filename) const {
+  if (width == 0 || height == 0) {
+    std::cerr << "ERROR: Cannot save an empty image to " << filename << std::endl;
+    return false;
+  }
+  FILE *file = fopen(filename.c_str(), "wb");
+  if (file == NULL) {
+    std::cerr << "Unable to open " << filename << " for writing\n";
+    return false;
+  }
+
+  // magic number & version 2, single part scanline
+  std::vector<unsigned char> header;
+  PutInt32(header,20000630);
+  PutInt32(header,2);
+
+  const char *channel_names[3] = { "B", "G", "R" };
+  PutAttribute(header,"channels","chlist",3*(2+16)+1);
+  for (int c = 0; c < 3; c++) {
+    PutString(header,channel_names[c]);
+    PutInt32(header,1);        // HALF
+    PutInt32(header,0);        // pLinear + 3 reserved bytes
+    PutInt32(header,1);        // x sampling
+    PutInt32(header,1);        // y sampling
+  }
+  header.push_back(0);
+  PutAttribute(header,"compression","compression",1);
+  header.push_back(0);         // NO_COMPRESSION
+  PutAttribute(header,"dataWindow","box2i",16);
+  PutInt32(header,0); PutInt32(header,0); PutInt32(header,width-1); PutInt32(header,height-1);
+  PutAttribute(header,"displayWindow","box2i",16);
+  PutInt32(header,0); PutInt32(header,0); PutInt32(header,width-1); PutInt32(header,height-1);
+  PutAttribute(header,"lineOrder","lineOrder",1);
+  header.push_back(0);         // INCREASING_Y
+  PutAttribute(header,"pixelAspectRatio","float",4);
+  PutFloat(header,1.0f);
+  PutAttribute(header,"screenWindowCenter","v2f",8);
+  PutFloat(header,0.0f); PutFloat(header,0.0f);
+  PutAttribute(header,"screenWindowWidth","float",4);
+  PutFloat(header,1.0f);
+  header.push_back(0);         // end of header
+
+  // line offset table
+  int line_bytes = 3*2*width;
+  unsigned long long offset = header.size() + 8*(unsigned long long)height;
+  for (int y = 0; y < height; y++) {
+    PutUInt64(header,offset);
+    offset += 8 + line_bytes;
+  }
+  bool ok = fwrite(&header[0],1,header.size(),file) == header.size();
+
+  // scanlines, top to bottom
+  std::vector<unsigned char> line(8+line_bytes);
+  for (int y = 0; ok && y < height; y++) {
+    unsigned char *p = &line[0];
+    int yy = y, size = line_bytes;
+    for (int i = 0; i < 4; i++) *p++ = (yy >> (8*i)) & 0xff;
+    for (int i = 0; i < 4; i++) *p++ = (size >> (8*i)) & 0xff;
+    const float *row = &data[3*(height-1-y)*width];
+    for (int c = 2; c >= 0; c--) {
+      for (int x = 0; x < width; x++) {
+        unsigned short h = FloatToHalf(row[3*x+c]);
+        *p++ = h & 0xff;
+        *p++ = h >> 8;
+      }
+    }
+    ok = fwrite(&line[0],1,line.size(),file) == line.size();
+  }
+  fclose(file);
+  if (!ok) std::cerr << "ERROR: short write to " << filename << std::endl;
+  return ok;
+}
+
+// ====================================================================================
+// 8 bit preview, clamped & converted to sRGB
+
+bool HDRImage::SavePPM(const std::string &filename) const {
+  FILE *file = fopen(filename.c_str(), "wb");
+  if (file == NULL) {
+    std::cerr << "Unable to open " << filename << " for writing\n";
+    return false;
+  }
+  fprintf (file, "P6\n");
+  fprintf (file, "%d %d\n", width,height);
+  fprintf (file, "255\n");
+
+  bool ok = true;
+  std::vector<unsigned char> line(3*width);
+  // flip y so that (0,0) is bottom left corner
+  for (int y = height-1; ok && y >= 0; y--) {
+    const float *row = &data[3*y*width];
+    for (int i = 0; i < 3*width; i++) {
+      double v = linear_to_srgb(my_max(0.0,my_min(1.0,(double)row[i])));
+      line[i] = (unsigned char)(v*255.0+0.5);
+    }
+    ok = (width == 0 || fwrite(&line[0],1,line.size(),file) == line.size());
+  }
+  fclose(file);
+  if (!ok) std::cerr << "ERROR: short write to " << filename << std::endl;
+  return ok;
+}
+
+// ====================================================================
+// ====================================================================
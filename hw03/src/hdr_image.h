@@ -0,0 +1,81 @@
+#ifndef _HDR_IMAGE_H_
+#define _HDR_IMAGE_H_
+
+#include <cassert>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "vectors.h"
+
+// ====================================================================
+// ====================================================================
+// A linear (un-clamped, un-gamma'd) floating point framebuffer for the
+// ray tracer.  Can be written out as:
+//   .pfm  portable float map (32 bit float rgb)
+//   .exr  OpenEXR, single part scanline, uncompressed, HALF rgb
+//   .ppm  8 bit binary ppm (tone mapped through linear_to_srgb)
+// All three writers pack a full scanline into a buffer and hand it to
+// fwrite in one call instead of writing a byte at a time.
+
+class HDRImage {
+public:
+  // ========================
+  // CONSTRUCTOR & DESTRUCTOR
+  HDRImage(int w = 0, int h = 0) : width(0), height(0) { Allocate(w,h); }
+  void Allocate(int w, int h) {
+    assert (w >= 0 && h >= 0);
+    width = w;
+    height = h;
+    data.assign(3*width*height,0.0f);
+  }
+
+  // =========
+  // ACCESSORS
+  int Width() const { return width; }
+  int Height() const { return height; }
+  Vec3f GetPixel(int x, int y) const {
+    const float *p = pixel(x,y);
+    return Vec3f(p[0],p[1],p[2]); }
+
+  // =========
+  // MODIFIERS
+  void Clear() { std::fill(data.begin(),data.end(),0.0f); }
+  void SetPixel(int x, int y, const Vec3f &value) {
+    float *p = pixel(x,y);
+    p[0] = value.r();
+    p[1] = value.g();
+    p[2] = value.b(); }
+  // fill a size x size block centered at (x,y) (clipped to the image),
+  // used while the progressive ray tracer is still sampling coarsely
+  void SetBlock(int x, int y, int size, const Vec3f &value);
+
+  // ====
+  // SAVE
+  // picks the format from the filename extension
+  bool Save(const std::string &filename) const;
+  bool SavePFM(const std::string &filename) const;
+  bool SaveEXR(const std::string &filename) const;
+  bool SavePPM(const std::string &filename) const;
+
+private:
+  const float* pixel(int x, int y) const {
+    assert(x >= 0 && x < width);
+    assert(y >= 0 && y < height);
+    return &data[3*(y*width + x)]; }
+  float* pixel(int x, int y) {
+    assert(x >= 0 && x < width);
+    assert(y >= 0 && y < height);
+    return &data[3*(y*width + x)]; }
+
+  // ==============
+  // REPRESENTATION
+  // rgb triples, row major, (0,0) is the bottom left corner
+  int width;
+  int height;
+  std::vector<float> data;
+};
+
+// IEEE 754 single -> half precision (round to nearest even)
+unsigned short FloatToHalf(float f);
+
+#endif
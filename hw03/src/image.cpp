@@ -1,4 +1,5 @@
 #include <cstring>
+#include <vector>
 #include "image.h"
 
 
@@ -20,18 +21,22 @@ bool Image::Save(const std::string &filename) const {
   fprintf (file, "%d %d\n", width,height);
   fprintf (file, "255\n");
 
-  // the data
+  // the data, one fwrite per scanline
   // flip y so that (0,0) is bottom left corner
-  for (int y = height-1; y >= 0; y--) {
+  std::vector<unsigned char> line(3*width);
+  bool ok = true;
+  for (int y = height-1; ok && y >= 0; y--) {
     for (int x=0; x<width; x++) {
-      Color v = GetPixel(x,y);
-      fputc ((unsigned char)(v.r),file);
-      fputc ((unsigned char)(v.g),file);
-      fputc ((unsigned char)(v.b),file);
+      const Color &v = GetPixel(x,y);
+      line[3*x+0] = (unsigned char)(v.r);
+      line[3*x+1] = (unsigned char)(v.g);
+      line[3*x+2] = (unsigned char)(v.b);
     }
+    ok = (width == 0 || fwrite(&line[0],1,line.size(),file) == line.size());
   }
   fclose(file);
-  return true;
+  if (!ok) std::cerr << "ERROR: short write to " << filename << std::endl;
+  return ok;
 }
 
 // ====================================================================================
@@ -0,0 +1,55 @@
+#include "instance.h"
+#include "mesh.h"
+#include "ray.h"
+#include "hit.h"
+
+// ====================================================================
+// ====================================================================
+
+Instance::Instance(Primitive *p, const Matrix &m) {
+  assert (p != NULL);
+  prototype = p;
+  material = p->getMaterial();
+  transform = m;
+  transform.Inverse(inverse);
+  inverse.Transpose(normal_matrix);
+}
+
+bool Instance::intersect(const Ray &r, Hit &h) const {
+  // move the ray into local space, keeping the direction unit length
+  // (some primitives depend on it) and remembering the scale on t
+  Vec3f origin = r.getOrigin();
+  Vec3f direction = r.getDirection();
+  inverse.Transform(origin);
+  inverse.TransformDirection(direction);
+  double scale = direction.Length();
+  assert (scale > 0);
+  direction.Normalize();
+  Ray local_ray(origin,direction);
+
+  Hit local_hit;
+  local_hit.set(h.getT()*scale,NULL,Vec3f(0,0,0));
+  if (!prototype->intersect(local_ray,local_hit)) return false;
+  double t = local_hit.getT() / scale;
+  if (t >= h.getT()) return false;
+
+  Vec3f normal = local_hit.getNormal();
+  normal_matrix.TransformDirection(normal);
+  normal.Normalize();
+  h.set(t,local_hit.getMaterial(),normal);
+  h.setTextureCoords(local_hit.get_s(),local_hit.get_t());
+  return true;
+}
+
+void Instance::addRasterizedFaces(Mesh *m, ArgParser *args) {
+  // compose with any enclosing instance (prototypes may nest)
+  const Matrix *parent = m->getRasterizeTransform();
+  Matrix composed = transform;
+  if (parent != NULL) composed = (*parent) * transform;
+  m->setRasterizeTransform(&composed);
+  prototype->addRasterizedFaces(m,args);
+  m->setRasterizeTransform(parent);
+}
+
+// ====================================================================
+// ====================================================================
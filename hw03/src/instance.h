@@ -0,0 +1,44 @@
+#ifndef _INSTANCE_H_
+#define _INSTANCE_H_
+
+#include "primitive.h"
+#include "matrix.h"
+
+// ====================================================================
+// ====================================================================
+// A placement of shared geometry (usually a Group) in the scene.  The
+// instance stores only a transform; rays are moved into the
+// prototype's local space for intersection and the hit is moved back.
+// The prototype is owned by the Mesh, not by the instance.
+
+class Instance : public Primitive {
+
+public:
+  // CONSTRUCTOR & DESTRUCTOR
+  Instance(Primitive *p, const Matrix &m);
+
+  // =========
+  // ACCESSORS
+  Primitive* getPrototype() const { return prototype; }
+  const Matrix& getTransform() const { return transform; }
+
+  // for ray tracing
+  bool intersect(const Ray &r, Hit &h) const;
+
+  // for OpenGL rendering & radiosity
+  void addRasterizedFaces(Mesh *m, ArgParser *args);
+
+private:
+
+  // ==============
+  // REPRESENTATION
+  Primitive *prototype;
+  Matrix transform;       // local -> world
+  Matrix inverse;         // world -> local
+  Matrix normal_matrix;   // inverse transpose, local normal -> world normal
+};
+
+// ====================================================================
+// ====================================================================
+
+#endif
@@ -14,6 +14,9 @@
 #include "primitive.h"
 #include "sphere.h"
 #include "cylinder_ring.h"
+#include "group.h"
+#include "instance.h"
+#include "matrix.h"
 #include "ray.h"
 #include "hit.h"
 #include "camera.h"
@@ -43,6 +46,8 @@ Mesh::~Mesh() {
     delete f;
   }
   for (i = 0; i < primitives.size(); i++) { delete primitives[i]; }
+  for (std::map<std::string,Group*>::iterator itr = prototypes.begin(); itr != prototypes.end(); itr++) {
+    delete itr->second; }
   for (i = 0; i < materials.size(); i++) { delete materials[i]; }
   for (i = 0; i < vertices.size(); i++) { delete vertices[i]; }
   delete bbox;
@@ -52,8 +57,10 @@ Mesh::~Mesh() {
 // MODIFIERS:   ADD & REMOVE
 // =======================================================================
 
-Vertex* Mesh::addVertex(const Vec3f &position) {
+Vertex* Mesh::addVertex(const Vec3f &pos) {
   int index = numVertices();
+  Vec3f position = pos;
+  if (rasterize_transform != NULL) rasterize_transform->Transform(position);
   vertices.push_back(new Vertex(index,position));
   // extend the bounding box to include this point
   if (bbox == NULL) 
@@ -85,20 +92,20 @@ void Mesh::addFace(Vertex *a, Vertex *b, Vertex *c, Vertex *d, Material *materia
   ed->setNext(ea);
   // verify these edges aren't already in the mesh 
   // (which would be a bug, or a non-manifold mesh)
-  assert (edges.find(std::make_pair(a,b)) == edges.end());
-  assert (edges.find(std::make_pair(b,c)) == edges.end());
-  assert (edges.find(std::make_pair(c,d)) == edges.end());
-  assert (edges.find(std::make_pair(d,a)) == edges.end());
+  assert (edges.find(ordered_vertex_pair(a,b)) == edges.end());
+  assert (edges.find(ordered_vertex_pair(b,c)) == edges.end());
+  assert (edges.find(ordered_vertex_pair(c,d)) == edges.end());
+  assert (edges.find(ordered_vertex_pair(d,a)) == edges.end());
   // add the edges to the master list
-  edges[std::make_pair(a,b)] = ea;
-  edges[std::make_pair(b,c)] = eb;
-  edges[std::make_pair(c,d)] = ec;
-  edges[std::make_pair(d,a)] = ed;
+  edges[ordered_vertex_pair(a,b)] = ea;
+  edges[ordered_vertex_pair(b,c)] = eb;
+  edges[ordered_vertex_pair(c,d)] = ec;
+  edges[ordered_vertex_pair(d,a)] = ed;
   // connect up with opposite edges (if they exist)
-  edgeshashtype::iterator ea_op = edges.find(std::make_pair(b,a)); 
-  edgeshashtype::iterator eb_op = edges.find(std::make_pair(c,b)); 
-  edgeshashtype::iterator ec_op = edges.find(std::make_pair(d,c)); 
-  edgeshashtype::iterator ed_op = edges.find(std::make_pair(a,d)); 
+  edgeshashtype::iterator ea_op = edges.find(ordered_vertex_pair(b,a)); 
+  edgeshashtype::iterator eb_op = edges.find(ordered_vertex_pair(c,b)); 
+  edgeshashtype::iterator ec_op = edges.find(ordered_vertex_pair(d,c)); 
+  edgeshashtype::iterator ed_op = edges.find(ordered_vertex_pair(a,d)); 
   if (ea_op != edges.end()) { ea_op->second->setOpposite(ea); }
   if (eb_op != edges.end()) { eb_op->second->setOpposite(eb); }
   if (ec_op != edges.end()) { ec_op->second->setOpposite(ec); }
@@ -131,10 +138,10 @@ void Mesh::removeFaceEdges(Face *f) {
   Vertex *c = ec->getStartVertex();
   Vertex *d = ed->getStartVertex();
   // remove elements from master lists
-  edges.erase(std::make_pair(a,b)); 
-  edges.erase(std::make_pair(b,c)); 
-  edges.erase(std::make_pair(c,d)); 
-  edges.erase(std::make_pair(d,a)); 
+  edges.erase(ordered_vertex_pair(a,b)); 
+  edges.erase(ordered_vertex_pair(b,c)); 
+  edges.erase(ordered_vertex_pair(c,d)); 
+  edges.erase(ordered_vertex_pair(d,a)); 
   // clean up memory
   delete ea;
   delete eb;
@@ -146,20 +153,20 @@ void Mesh::removeFaceEdges(Face *f) {
 // EDGE HELPER FUNCTIONS
 
 Edge* Mesh::getEdge(Vertex *a, Vertex *b) const {
-  edgeshashtype::const_iterator iter = edges.find(std::make_pair(a,b));
+  edgeshashtype::const_iterator iter = edges.find(ordered_vertex_pair(a,b));
   if (iter == edges.end()) return NULL;
   return iter->second;
 }
 
 Vertex* Mesh::getChildVertex(Vertex *p1, Vertex *p2) const {
-  vphashtype::const_iterator iter = vertex_parents.find(std::make_pair(p1,p2)); 
+  vphashtype::const_iterator iter = vertex_parents.find(unordered_vertex_pair(p1,p2)); 
   if (iter == vertex_parents.end()) return NULL;
   return iter->second; 
 }
 
 void Mesh::setParentsChild(Vertex *p1, Vertex *p2, Vertex *child) {
-  assert (vertex_parents.find(std::make_pair(p1,p2)) == vertex_parents.end());
-  vertex_parents[std::make_pair(p1,p2)] = child; 
+  assert (vertex_parents.find(unordered_vertex_pair(p1,p2)) == vertex_parents.end());
+  vertex_parents[unordered_vertex_pair(p1,p2)] = child; 
 }
 
 //
@@ -217,6 +224,16 @@ void Mesh::Load(const std::string &input_file, ArgParser *_args) {
       objfile >> x >> y >> z >> h >> r >> r2;
       assert (active_material != NULL);
       addPrimitive(new CylinderRing(Vec3f(x,y,z),h,r,r2,active_material));
+    } else if (token == "prototype") {
+      // this is not standard .obj format!!
+      // shared geometry, only drawn through "instance"
+      std::string name;
+      objfile >> name >> token;
+      assert (token == "{");
+      assert (prototypes.find(name) == prototypes.end());
+      prototypes[name] = LoadPrototype(objfile,active_material);
+    } else if (token == "instance") {
+      addPrimitive(LoadInstance(objfile));
     } else if (token == "background_color") {
       double r,g,b;
       objfile >> r >> g >> b;
@@ -281,6 +298,113 @@ void Mesh::Load(const std::string &input_file, ArgParser *_args) {
   }
 }
 
+// =================================================================
+// INSTANCING
+// =================================================================
+//
+//   prototype chair {
+//     m 1
+//     v ...            (vertex indices are local to the prototype)
+//     f 1 2 3 4
+//     s x y z r
+//     instance leg { ... }
+//   }
+//   instance chair {
+//     translate x y z
+//     rotate x y z degrees
+//     scale sx sy sz
+//     matrix m00 m01 ... m33
+//   }
+//
+// transforms are applied in the order listed
+
+Group* Mesh::LoadPrototype(std::istream &objfile, Material *active_material) {
+  Group *group = new Group(args);
+  std::string token;
+  while (objfile >> token) {
+    if (token == "}") {
+      return group;
+    } else if (token == "v") {
+      double x,y,z;
+      objfile >> x >> y >> z;
+      group->addVertex(Vec3f(x,y,z));
+    } else if (token == "vt") {
+      assert (group->numVertices() >= 1);
+      double s,t;
+      objfile >> s >> t;
+      group->setTextureCoordinates(group->numVertices()-1,s,t);
+    } else if (token == "f") {
+      int a,b,c,d;
+      objfile >> a >> b >> c >> d;
+      assert (active_material != NULL);
+      group->addQuad(a-1,b-1,c-1,d-1,active_material);
+    } else if (token == "s") {
+      double x,y,z,r;
+      objfile >> x >> y >> z >> r;
+      assert (active_material != NULL);
+      group->addChild(new Sphere(Vec3f(x,y,z),r,active_material));
+    } else if (token == "r") {
+      double x,y,z,h,r,r2;
+      objfile >> x >> y >> z >> h >> r >> r2;
+      assert (active_material != NULL);
+      group->addChild(new CylinderRing(Vec3f(x,y,z),h,r,r2,active_material));
+    } else if (token == "m") {
+      int m;
+      objfile >> m;
+      assert (m >= 0 && m < (int)materials.size());
+      active_material = materials[m];
+    } else if (token == "instance") {
+      group->addChild(LoadInstance(objfile));
+    } else {
+      std::cout << "UNKNOWN TOKEN IN PROTOTYPE " << token << std::endl;
+      exit(0);
+    }
+  }
+  std::cout << "ERROR! PROTOTYPE IS MISSING '}'" << std::endl;
+  exit(0);
+}
+
+Primitive* Mesh::LoadInstance(std::istream &objfile) {
+  std::string name, token;
+  objfile >> name >> token;
+  assert (token == "{");
+  std::map<std::string,Group*>::iterator itr = prototypes.find(name);
+  if (itr == prototypes.end()) {
+    std::cout << "ERROR! UNKNOWN PROTOTYPE " << name << std::endl;
+    exit(0);
+  }
+  Matrix m;
+  m.setToIdentity();
+  while (objfile >> token) {
+    if (token == "}") {
+      return new Instance(itr->second,m);
+    } else if (token == "translate") {
+      Vec3f v;
+      objfile >> v;
+      m = Matrix::MakeTranslation(v) * m;
+    } else if (token == "rotate") {
+      Vec3f axis;
+      double degrees;
+      objfile >> axis >> degrees;
+      axis.Normalize();
+      m = Matrix::MakeAxisRotation(axis,degrees*M_PI/180.0) * m;
+    } else if (token == "scale") {
+      Vec3f v;
+      objfile >> v;
+      m = Matrix::MakeScale(v) * m;
+    } else if (token == "matrix") {
+      Matrix tmp;
+      objfile >> tmp;
+      m = tmp * m;
+    } else {
+      std::cout << "UNKNOWN TOKEN IN INSTANCE " << token << std::endl;
+      exit(0);
+    }
+  }
+  std::cout << "ERROR! INSTANCE IS MISSING '}'" << std::endl;
+  exit(0);
+}
+
 // =================================================================
 // SUBDIVISION
 // =================================================================
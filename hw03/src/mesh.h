@@ -2,6 +2,8 @@
 #define MESH_H
 
 #include <vector>
+#include <map>
+#include <string>
 #include "vectors.h"
 #include "hash.h"
 #include "material.h"
@@ -15,6 +17,8 @@ class ArgParser;
 class Ray;
 class Hit;
 class Camera;
+class Matrix;
+class Group;
 
 enum FACE_TYPE { FACE_TYPE_ORIGINAL, FACE_TYPE_RASTERIZED, FACE_TYPE_SUBDIVIDED };
 
@@ -31,7 +35,7 @@ public:
 
   // ===============================
   // CONSTRUCTOR & DESTRUCTOR & LOAD
-  Mesh() { bbox = NULL; }
+  Mesh() { bbox = NULL; rasterize_transform = NULL; }
   virtual ~Mesh();
   void Load(const std::string &input_file, ArgParser *_args);
     
@@ -90,6 +94,10 @@ public:
 
   // ============================
   // CREATE OR SUBDIVIDE GEOMETRY
+  // while an Instance is rasterizing its prototype, every new vertex
+  // is placed through this (local -> world) transform
+  const Matrix* getRasterizeTransform() const { return rasterize_transform; }
+  void setRasterizeTransform(const Matrix *m) { rasterize_transform = m; }
   void addRasterizedPrimitiveFace(Vertex *a, Vertex *b, Vertex *c, Vertex *d, Material *material) {
     addFace(a,b,c,d,material,FACE_TYPE_RASTERIZED); }
   void addOriginalQuad(Vertex *a, Vertex *b, Vertex *c, Vertex *d, Material *material) {
@@ -114,6 +122,8 @@ private:
   void addFace(Vertex *a, Vertex *b, Vertex *c, Vertex *d, Material *material, enum FACE_TYPE face_type);
   void removeFaceEdges(Face *f);
   void addPrimitive(Primitive *p); 
+  Group* LoadPrototype(std::istream &objfile, Material *active_material);
+  Primitive* LoadInstance(std::istream &objfile);
 
   // ==============
   // REPRESENTATION
@@ -138,6 +148,9 @@ private:
   std::vector<Face*> original_lights; 
   // all primitives (spheres, etc.)
   std::vector<Primitive*> primitives;
+  // shared geometry referenced by Instances, by name (owned here)
+  std::map<std::string,Group*> prototypes;
+  const Matrix *rasterize_transform;
   // the primitives converted to quads
   std::vector<Face*> rasterized_primitive_faces;
   // the quads from the .obj file after subdivision
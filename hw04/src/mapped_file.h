@@ -0,0 +1,81 @@
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// ====================================================================
+// ====================================================================
+// read only view of an entire file (mmap where available, otherwise
+// the whole file is read into memory in one go)
+
+class MappedFile {
+public:
+  MappedFile() : data(NULL), size(0), mapped(false) {}
+  ~MappedFile() { Close(); }
+
+  bool Open(const std::string &filename) {
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd,&st) != 0) { close(fd); return false; }
+    size = st.st_size;
+    if (size > 0) {
+      void *p = mmap(NULL,size,PROT_READ,MAP_PRIVATE,fd,0);
+      if (p != MAP_FAILED) {
+        madvise(p,size,MADV_SEQUENTIAL);
+        data = (const char*)p;
+        mapped = true;
+      }
+    }
+    close(fd);
+    if (mapped || size == 0) return true;
+#endif
+    // fall back to reading it all in one go
+    FILE *file = fopen(filename.c_str(),"rb");
+    if (file == NULL) return false;
+    fseek(file,0,SEEK_END);
+    size = ftell(file);
+    fseek(file,0,SEEK_SET);
+    buffer.resize(size);
+    bool ok = (size == 0 || fread(&buffer[0],1,size,file) == size);
+    fclose(file);
+    data = size ? &buffer[0] : NULL;
+    return ok;
+  }
+
+  void Close() {
+#ifndef _WIN32
+    if (mapped) munmap((void*)data,size);
+#endif
+    mapped = false;
+    data = NULL;
+    size = 0;
+    buffer.clear();
+  }
+
+  const char *data;
+  size_t size;
+
+private:
+  MappedFile(const MappedFile&) { assert(0); }
+  MappedFile& operator=(const MappedFile&) { assert(0); return *this; }
+
+  bool mapped;
+  std::vector<char> buffer;
+};
+
+// ====================================================================
+// ====================================================================
+
+#endif
@@ -6,6 +6,9 @@
 #include "vertex.h"
 #include "triangle.h"
 #include "argparser.h"
+#include "obj_parser.h"
+#include "mesh_cache.h"
+#include "mesh_optimizer.h"
 
 int Triangle::next_triangle_id = 0;
 
@@ -14,22 +17,8 @@ int Triangle::next_triangle_id = 0;
 // =======================================================================
 
 Mesh::~Mesh() {
-  // delete all the triangles
-  std::vector<Triangle*> todo;
-  for (triangleshashtype::iterator iter = triangles.begin();
-       iter != triangles.end(); iter++) {
-    Triangle *t = iter->second;
-    todo.push_back(t);
-  }
-  int num_triangles = todo.size();
-  for (int i = 0; i < num_triangles; i++) {
-    removeTriangle(todo[i]);
-  }
-  // delete all the vertices
-  int num_vertices = numVertices();
-  for (int i = 0; i < num_vertices; i++) {
-    delete vertices[i];
-  }
+  // the vertices, edges & triangles all go with their pools, a block
+  // at a time (nothing needs unhooking from a mesh that is going away)
   cleanupVBOs();
 }
 
@@ -39,7 +28,7 @@ Mesh::~Mesh() {
 
 Vertex* Mesh::addVertex(const glm::vec3 &position) {
   int index = numVertices();
-  Vertex *v = new Vertex(index, position);
+  Vertex *v = new (vertex_pool.allocate()) Vertex(index, position);
   vertices.push_back(v);
   if (numVertices() == 1)
     bbox = BoundingBox(position,position);
@@ -51,11 +40,11 @@ Vertex* Mesh::addVertex(const glm::vec3 &position) {
 
 void Mesh::addTriangle(Vertex *a, Vertex *b, Vertex *c) {
   // create the triangle
-  Triangle *t = new Triangle();
+  Triangle *t = new (triangle_pool.allocate()) Triangle();
   // create the edges
-  Edge *ea = new Edge(a,b,t);
-  Edge *eb = new Edge(b,c,t);
-  Edge *ec = new Edge(c,a,t);
+  Edge *ea = new (edge_pool.allocate()) Edge(a,b,t);
+  Edge *eb = new (edge_pool.allocate()) Edge(b,c,t);
+  Edge *ec = new (edge_pool.allocate()) Edge(c,a,t);
   // point the triangle to one of its edges
   t->setEdge(ea);
   // connect the edges to each other
@@ -64,17 +53,17 @@ void Mesh::addTriangle(Vertex *a, Vertex *b, Vertex *c) {
   ec->setNext(ea);
   // verify these edges aren't already in the mesh 
   // (which would be a bug, or a non-manifold mesh)
-  assert (edges.find(std::make_pair(a,b)) == edges.end());
-  assert (edges.find(std::make_pair(b,c)) == edges.end());
-  assert (edges.find(std::make_pair(c,a)) == edges.end());
+  assert (edges.find(ordered_vertex_pair(a,b)) == edges.end());
+  assert (edges.find(ordered_vertex_pair(b,c)) == edges.end());
+  assert (edges.find(ordered_vertex_pair(c,a)) == edges.end());
   // add the edges to the master list
-  edges[std::make_pair(a,b)] = ea;
-  edges[std::make_pair(b,c)] = eb;
-  edges[std::make_pair(c,a)] = ec;
+  edges[ordered_vertex_pair(a,b)] = ea;
+  edges[ordered_vertex_pair(b,c)] = eb;
+  edges[ordered_vertex_pair(c,a)] = ec;
   // connect up with opposite edges (if they exist)
-  edgeshashtype::iterator ea_op = edges.find(std::make_pair(b,a)); 
-  edgeshashtype::iterator eb_op = edges.find(std::make_pair(c,b)); 
-  edgeshashtype::iterator ec_op = edges.find(std::make_pair(a,c)); 
+  edgeshashtype::iterator ea_op = edges.find(ordered_vertex_pair(b,a)); 
+  edgeshashtype::iterator eb_op = edges.find(ordered_vertex_pair(c,b)); 
+  edgeshashtype::iterator ec_op = edges.find(ordered_vertex_pair(a,c)); 
   if (ea_op != edges.end()) { ea_op->second->setOpposite(ea); }
   if (eb_op != edges.end()) { eb_op->second->setOpposite(eb); }
   if (ec_op != edges.end()) { ec_op->second->setOpposite(ec); }
@@ -92,21 +81,21 @@ void Mesh::removeTriangle(Triangle *t) {
   Vertex *b = eb->getStartVertex();
   Vertex *c = ec->getStartVertex();
   // remove these elements from master lists
-  edges.erase(std::make_pair(a,b)); 
-  edges.erase(std::make_pair(b,c)); 
-  edges.erase(std::make_pair(c,a)); 
+  edges.erase(ordered_vertex_pair(a,b)); 
+  edges.erase(ordered_vertex_pair(b,c)); 
+  edges.erase(ordered_vertex_pair(c,a)); 
   triangles.erase(t->getID());
-  // clean up memory
-  delete ea;
-  delete eb;
-  delete ec;
-  delete t;
+  // give the memory back to the pools
+  edge_pool.release(ea);
+  edge_pool.release(eb);
+  edge_pool.release(ec);
+  triangle_pool.release(t);
 }
 
 
 // Helper function for accessing data in the hash table
 Edge* Mesh::getMeshEdge(Vertex *a, Vertex *b) const {
-  edgeshashtype::const_iterator iter = edges.find(std::make_pair(a,b));
+  edgeshashtype::const_iterator iter = edges.find(ordered_vertex_pair(a,b));
   if (iter == edges.end()) return NULL;
   return iter->second;
 }
@@ -117,64 +106,153 @@ Edge* Mesh::getMeshEdge(Vertex *a, Vertex *b) const {
 
 void Mesh::Load() {
   std::string input_file = args->path + "/" + args->input_file;
+
+  // binary caches written by obj2cache
+  if (IsMeshCacheFile(input_file)) {
+    if (!LoadCache(input_file)) return;
+    ComputeGouraudNormals();
+    OptimizeDrawOrder();
+    std::cout << "loaded " << numTriangles() << " triangles " << std::endl;
+    return;
+  }
   
-  FILE *objfile = fopen(input_file.c_str(),"r");
-  if (objfile == NULL) {
+  ObjData data;
+  if (!LoadObj(input_file,data)) {
     std::cout << "ERROR! CANNOT OPEN '" << input_file << "'\n";
     return;
   }
+  if (data.num_skipped_lines > 0) {
+    std::cout << "WARNING: skipped " << data.num_skipped_lines << " unrecognized lines in '" << input_file << "'\n";
+  }
 
-  char line[200] = "";
-  char token[100] = "";
-  char atoken[100] = "";
-  char btoken[100] = "";
-  char ctoken[100] = "";
-  float x,y,z;
-  int a,b,c,d,e;
-  
-  int index = 0;
-  int vert_count = 0;
-  int vert_index = 1;
-  
-  while (fgets(line, 200, objfile)) {   
-    int token_count = sscanf (line, "%s\n",token);
-    if (token_count == -1) continue;
-    a = b = c = d = e = -1;
-    if (!strcmp(token,"usemtl") ||
-	!strcmp(token,"g")) {
-      vert_index = 1; 
-      index++;
-    } else if (!strcmp(token,"v")) {
-      vert_count++;
-      sscanf (line, "%s %f %f %f\n",token,&x,&y,&z);
-      addVertex(glm::vec3(x,y,z));
-    } else if (!strcmp(token,"f")) {
-      int num = sscanf (line, "%s %s %s %s\n",token,
-			atoken,btoken,ctoken);
-      sscanf (atoken,"%d",&a);
-      sscanf (btoken,"%d",&b);
-      sscanf (ctoken,"%d",&c);
-      assert (num == 4);
-      a -= vert_index;
-      b -= vert_index;
-      c -= vert_index;
-      assert (a >= 0 && a < numVertices());
-      assert (b >= 0 && b < numVertices());
-      assert (c >= 0 && c < numVertices());
-      addTriangle(getVertex(a),getVertex(b),getVertex(c)); 
-    } else if (!strcmp(token,"vt")) {
-    } else if (!strcmp(token,"vn")) {
-    } else if (token[0] == '#') {
-    } else {
-      printf ("LINE: '%s'",line);
-    }
+  int num_verts = data.numVertices();
+  int num_tris = data.numTriangles();
+  vertices.reserve(num_verts);
+  edges.reserve(3*num_tris);
+  triangles.reserve(num_tris);
+  vertex_pool.reserve(num_verts);
+  edge_pool.reserve(3*num_tris);
+  triangle_pool.reserve(num_tris);
+  for (int i = 0; i < num_verts; i++) {
+    const float *p = &data.positions[3*i];
+    addVertex(glm::vec3(p[0],p[1],p[2]));
+  }
+  for (int i = 0; i < num_tris; i++) {
+    int a = data.triangles[3*i];
+    int b = data.triangles[3*i+1];
+    int c = data.triangles[3*i+2];
+    assert (a >= 0 && a < numVertices());
+    assert (b >= 0 && b < numVertices());
+    assert (c >= 0 && c < numVertices());
+    addTriangle(getVertex(a),getVertex(b),getVertex(c)); 
   }
 
   ComputeGouraudNormals();
+  OptimizeDrawOrder();
 
   std::cout << "loaded " << numTriangles() << " triangles " << std::endl;
 }
 
+// the cache already knows every opposite half-edge, so the triangles
+// are wired up directly instead of going through addTriangle's lookups
+// (the edges table is still filled in for getMeshEdge)
+bool Mesh::LoadCache(const std::string &input_file) {
+  MeshCache cache;
+  if (!cache.Open(input_file)) {
+    std::cout << "ERROR! CANNOT OPEN '" << input_file << "'\n";
+    return false;
+  }
+  assert (numVertices() == 0 && numTriangles() == 0);
+
+  int num_verts = cache.numVertices();
+  int num_tris = cache.numTriangles();
+  const float *positions = cache.getPositions();
+  const int32_t *tris = cache.getTriangles();
+  const int32_t *opposites = cache.getOpposites();
+
+  vertices.reserve(num_verts);
+  edges.reserve(3*num_tris);
+  triangles.reserve(num_tris);
+  vertex_pool.reserve(num_verts);
+  edge_pool.reserve(3*num_tris);
+  triangle_pool.reserve(num_tris);
+  for (int i = 0; i < num_verts; i++) {
+    const float *p = &positions[3*i];
+    addVertex(glm::vec3(p[0],p[1],p[2]));
+  }
+
+  std::vector<Edge*> halfedges(3*num_tris);
+  for (int i = 0; i < num_tris; i++) {
+    Vertex *a = getVertex(tris[3*i]);
+    Vertex *b = getVertex(tris[3*i+1]);
+    Vertex *c = getVertex(tris[3*i+2]);
+    Triangle *t = new (triangle_pool.allocate()) Triangle();
+    Edge *ea = new (edge_pool.allocate()) Edge(a,b,t);
+    Edge *eb = new (edge_pool.allocate()) Edge(b,c,t);
+    Edge *ec = new (edge_pool.allocate()) Edge(c,a,t);
+    t->setEdge(ea);
+    ea->setNext(eb);
+    eb->setNext(ec);
+    ec->setNext(ea);
+    edges[ordered_vertex_pair(a,b)] = ea;
+    edges[ordered_vertex_pair(b,c)] = eb;
+    edges[ordered_vertex_pair(c,a)] = ec;
+    triangles[t->getID()] = t;
+    halfedges[3*i] = ea;
+    halfedges[3*i+1] = eb;
+    halfedges[3*i+2] = ec;
+  }
+  // a duplicate directed edge would have collapsed in the table
+  assert (numEdges() == 3*num_tris);
+
+  for (int i = 0; i < 3*num_tris; i++) {
+    int j = opposites[i];
+    if (j > i) {
+      assert (opposites[j] == i);
+      halfedges[i]->setOpposite(halfedges[j]);
+    }
+  }
+  // (this assignment has no use for the crease weights)
+  return true;
+}
+
+// =======================================================================
+
+// the triangles never change after loading, so they are put in vertex
+// cache order once (instead of the triangles table's hash order) and
+// the vertices numbered as that order first uses them
+void Mesh::OptimizeDrawOrder() {
+  std::vector<Triangle*> tris;
+  std::vector<unsigned int> indices;
+  tris.reserve(numTriangles());
+  indices.reserve(3*numTriangles());
+  for (triangleshashtype::iterator iter = triangles.begin();
+       iter != triangles.end(); iter++) {
+    Triangle *t = iter->second;
+    tris.push_back(t);
+    for (int k = 0; k < 3; k++) indices.push_back((*t)[k]->getIndex());
+  }
+  double before = ComputeACMR(indices,numVertices(),ACMR_FIFO_SIZE);
+
+  std::vector<int> order;
+  OptimizeVertexCache(indices,numVertices(),order);
+  draw_order.resize(order.size());
+  draw_indices.resize(indices.size());
+  for (unsigned int i = 0; i < order.size(); i++) {
+    draw_order[i] = tris[order[i]];
+    for (int k = 0; k < 3; k++) draw_indices[3*i+k] = indices[3*order[i]+k];
+  }
+  std::vector<int> remap;
+  int num_used = OptimizeVertexFetch(draw_indices,numVertices(),remap);
+  fetch_order.resize(num_used);
+  for (int v = 0; v < numVertices(); v++) {
+    if (remap[v] != -1) fetch_order[remap[v]] = getVertex(v);
+  }
+
+  std::cout << "vertex cache ACMR (FIFO " << ACMR_FIFO_SIZE << "): " << before << " -> "
+            << ComputeACMR(draw_indices,num_used,ACMR_FIFO_SIZE) << std::endl;
+}
+
 // =======================================================================
 
 // compute the gouraud normals of all vertices of the mesh and store at each vertex
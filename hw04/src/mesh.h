@@ -7,6 +7,10 @@
 #include "hash.h"
 #include "boundingbox.h"
 #include "vbo_structs.h"
+#include "object_pool.h"
+#include "vertex.h"
+#include "edge.h"
+#include "triangle.h"
 
 class ArgParser;
 class Vertex;
@@ -62,6 +66,9 @@ public:
 
 private:
 
+  bool LoadCache(const std::string &input_file);
+  void OptimizeDrawOrder();
+
   // HELPER FUNCTIONS FOR PAINT
   void SetupLight(const glm::vec3 &light_position);
   void SetupMirror();
@@ -84,11 +91,20 @@ private:
   // ==============
   // REPRESENTATION
   ArgParser *args;
+  // the vertices, half-edges & triangles live in these, see object_pool.h
+  ObjectPool<Vertex> vertex_pool;
+  ObjectPool<Edge> edge_pool;
+  ObjectPool<Triangle> triangle_pool;
   std::vector<Vertex*> vertices;
   edgeshashtype edges;
   triangleshashtype triangles;
   BoundingBox bbox;
 
+  // the order SetupMesh sends the (unchanging) mesh in, see OptimizeDrawOrder
+  std::vector<Triangle*> draw_order;   // vertex cache order
+  std::vector<Vertex*> fetch_order;    // the vertices, as draw_order first uses them
+  std::vector<unsigned int> draw_indices;  // draw_order's corners, into fetch_order
+
   // VBOs
   GLuint mesh_tri_verts_VBO;
   GLuint mesh_tri_indices_VBO;
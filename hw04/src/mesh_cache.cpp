@@ -0,0 +1,170 @@
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include "mesh_cache.h"
+#include "obj_parser.h"
+
+// ====================================================================
+// ====================================================================
+// READING
+
+bool MeshCache::Open(const std::string &filename) {
+  header = NULL;
+  if (!file.Open(filename)) return false;
+  if (file.size < sizeof(MeshCacheHeader)) {
+    std::cerr << "ERROR! " << filename << " is too short to be a mesh cache" << std::endl;
+    return false;
+  }
+  const MeshCacheHeader *h = (const MeshCacheHeader*)file.data;
+  if (strncmp(h->magic,MESH_CACHE_MAGIC,4) != 0) {
+    std::cerr << "ERROR! " << filename << " is not a mesh cache" << std::endl;
+    return false;
+  }
+  if (h->version != MESH_CACHE_VERSION || h->byte_order != MESH_CACHE_BYTE_ORDER ||
+      h->header_bytes != sizeof(MeshCacheHeader)) {
+    std::cerr << "ERROR! " << filename << " was written by a different version or machine,"
+              << " regenerate it with obj2cache" << std::endl;
+    return false;
+  }
+  size_t expected = sizeof(MeshCacheHeader) +
+    (size_t)h->num_vertices * 3 * sizeof(float) +
+    (size_t)h->num_triangles * 3 * sizeof(int32_t) * 2 +
+    (size_t)h->num_creases * sizeof(MeshCacheCrease);
+  if (file.size != expected) {
+    std::cerr << "ERROR! " << filename << " is truncated or corrupt" << std::endl;
+    return false;
+  }
+  const char *p = file.data + sizeof(MeshCacheHeader);
+  positions = (const float*)p;
+  p += (size_t)h->num_vertices * 3 * sizeof(float);
+  triangles = (const int32_t*)p;
+  p += (size_t)h->num_triangles * 3 * sizeof(int32_t);
+  opposites = (const int32_t*)p;
+  p += (size_t)h->num_triangles * 3 * sizeof(int32_t);
+  creases = (const MeshCacheCrease*)p;
+  header = h;
+  return true;
+}
+
+bool IsMeshCacheFile(const std::string &filename) {
+  std::string ext = MESH_CACHE_EXTENSION;
+  return filename.size() > ext.size() &&
+    filename.compare(filename.size()-ext.size(),ext.size(),ext) == 0;
+}
+
+// ====================================================================
+// ====================================================================
+// WRITING
+
+// both directions of an edge share a key, sorting brings them together
+static inline uint64_t EdgeKey(int a, int b) {
+  if (a > b) std::swap(a,b);
+  return ((uint64_t)(uint32_t)a << 32) | (uint32_t)b;
+}
+
+bool WriteMeshCache(const std::string &filename, const ObjData &data) {
+  int num_verts = data.numVertices();
+  int num_tris = data.numTriangles();
+  int num_halfedges = 3*num_tris;
+  const int *tris = num_tris ? &data.triangles[0] : NULL;
+
+  for (int i = 0; i < num_halfedges; i++) {
+    if (tris[i] < 0 || tris[i] >= num_verts) {
+      std::cerr << "ERROR! triangle " << i/3 << " uses vertex " << tris[i]
+                << ", there are only " << num_verts << std::endl;
+      return false;
+    }
+  }
+
+  // sort all the half-edges by their (undirected) edge
+  std::vector<std::pair<uint64_t,int> > keys(num_halfedges);
+  for (int i = 0; i < num_halfedges; i++) {
+    int a = tris[i];
+    int b = tris[3*(i/3) + (i%3+1)%3];
+    if (a == b) {
+      std::cerr << "ERROR! triangle " << i/3 << " is degenerate" << std::endl;
+      return false;
+    }
+    keys[i] = std::make_pair(EdgeKey(a,b),i);
+  }
+  std::sort(keys.begin(),keys.end());
+
+  // each edge has one half-edge (boundary) or two running opposite ways
+  std::vector<int32_t> opposites(num_halfedges,-1);
+  for (int i = 0; i < num_halfedges; ) {
+    int j = i+1;
+    while (j < num_halfedges && keys[j].first == keys[i].first) j++;
+    if (j-i == 2) {
+      int h0 = keys[i].second;
+      int h1 = keys[i+1].second;
+      if (tris[h0] == tris[h1]) {
+        std::cerr << "ERROR! triangles " << h0/3 << " and " << h1/3
+                  << " share an edge but are inconsistently oriented" << std::endl;
+        return false;
+      }
+      opposites[h0] = h1;
+      opposites[h1] = h0;
+    } else if (j-i > 2) {
+      int h0 = keys[i].second;
+      std::cerr << "ERROR! edge " << tris[h0] << " " << tris[3*(h0/3) + (h0%3+1)%3]
+                << " is shared by " << j-i << " triangles (non-manifold)" << std::endl;
+      return false;
+    }
+    i = j;
+  }
+
+  // find one half-edge for each crease
+  std::vector<MeshCacheCrease> creases;
+  creases.reserve(data.creases.size());
+  for (unsigned int i = 0; i < data.creases.size(); i++) {
+    const ObjCrease &c = data.creases[i];
+    std::vector<std::pair<uint64_t,int> >::iterator itr =
+      std::lower_bound(keys.begin(),keys.end(),std::make_pair(EdgeKey(c.a,c.b),-1));
+    if (itr == keys.end() || itr->first != EdgeKey(c.a,c.b)) {
+      std::cerr << "WARNING: crease " << c.a << " " << c.b << " is not an edge of the mesh, skipped" << std::endl;
+      continue;
+    }
+    MeshCacheCrease mc;
+    mc.halfedge = itr->second;
+    mc.weight = c.weight;
+    creases.push_back(mc);
+  }
+
+  MeshCacheHeader header;
+  memset(&header,0,sizeof(header));
+  memcpy(header.magic,MESH_CACHE_MAGIC,4);
+  header.version = MESH_CACHE_VERSION;
+  header.byte_order = MESH_CACHE_BYTE_ORDER;
+  header.header_bytes = sizeof(MeshCacheHeader);
+  header.num_vertices = num_verts;
+  header.num_triangles = num_tris;
+  header.num_creases = creases.size();
+
+  FILE *file = fopen(filename.c_str(),"wb");
+  if (file == NULL) {
+    std::cerr << "ERROR! cannot open " << filename << " for writing" << std::endl;
+    return false;
+  }
+  bool ok = fwrite(&header,sizeof(header),1,file) == 1;
+  if (ok && num_verts)
+    ok = fwrite(&data.positions[0],sizeof(float),3*num_verts,file) == (size_t)3*num_verts;
+  if (ok && num_tris) {
+    // ObjData stores plain ints, make sure they are the int32_t we promise
+    std::vector<int32_t> indices(tris,tris+num_halfedges);
+    ok = fwrite(&indices[0],sizeof(int32_t),num_halfedges,file) == (size_t)num_halfedges;
+    if (ok) ok = fwrite(&opposites[0],sizeof(int32_t),num_halfedges,file) == (size_t)num_halfedges;
+  }
+  if (ok && !creases.empty())
+    ok = fwrite(&creases[0],sizeof(MeshCacheCrease),creases.size(),file) == creases.size();
+  if (fclose(file) != 0) ok = false;
+  if (!ok) {
+    std::cerr << "ERROR! failed writing " << filename << std::endl;
+    remove(filename.c_str());
+  }
+  return ok;
+}
+
+// ====================================================================
+// ====================================================================
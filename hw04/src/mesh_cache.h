@@ -0,0 +1,93 @@
+#ifndef _MESH_CACHE_H_
+#define _MESH_CACHE_H_
+
+#include <string>
+#include <stdint.h>
+
+#include "mapped_file.h"
+
+class ObjData;
+
+// ====================================================================
+// ====================================================================
+// Binary, memory mappable cache of a triangle mesh (.mcache).  Written
+// offline by the obj2cache tool, it holds everything the Mesh needs
+// to build its half-edge structure in a single pass, with no edge
+// lookups: the opposite of every half-edge is precomputed.
+//
+// Layout (native byte order, every section 4 byte aligned):
+//   MeshCacheHeader
+//   float    positions[3*num_vertices]     x,y,z per vertex
+//   int32_t  triangles[3*num_triangles]    zero-based vertex indices
+//   int32_t  opposites[3*num_triangles]    opposite half-edge or -1
+//   MeshCacheCrease creases[num_creases]
+//
+// Half-edge 3*t+k runs from corner k to corner (k+1)%3 of triangle t.
+// Bump MESH_CACHE_VERSION whenever the layout changes; old caches are
+// then rejected and must be regenerated from the .obj.
+
+#define MESH_CACHE_MAGIC "MCHE"
+#define MESH_CACHE_VERSION 1
+#define MESH_CACHE_BYTE_ORDER 0x01020304
+#define MESH_CACHE_EXTENSION ".mcache"
+
+struct MeshCacheHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t header_bytes;
+  uint32_t num_vertices;
+  uint32_t num_triangles;
+  uint32_t num_creases;
+  uint32_t reserved;
+};
+
+// the crease is stored on one half-edge, it applies to its opposite too
+struct MeshCacheCrease {
+  int32_t halfedge;
+  float weight;
+};
+
+// ====================================================================
+
+class MeshCache {
+public:
+  MeshCache() : header(NULL) {}
+
+  // maps the file and checks the header and section sizes
+  bool Open(const std::string &filename);
+
+  // =========
+  // ACCESSORS
+  int numVertices() const { assert (header != NULL); return header->num_vertices; }
+  int numTriangles() const { assert (header != NULL); return header->num_triangles; }
+  int numCreases() const { assert (header != NULL); return header->num_creases; }
+  const float* getPositions() const { return positions; }
+  const int32_t* getTriangles() const { return triangles; }
+  const int32_t* getOpposites() const { return opposites; }
+  const MeshCacheCrease* getCreases() const { return creases; }
+
+private:
+
+  // ==============
+  // REPRESENTATION
+  // all of these point into the mapped file
+  MappedFile file;
+  const MeshCacheHeader *header;
+  const float *positions;
+  const int32_t *triangles;
+  const int32_t *opposites;
+  const MeshCacheCrease *creases;
+};
+
+// ====================================================================
+
+// true if the filename ends in MESH_CACHE_EXTENSION
+bool IsMeshCacheFile(const std::string &filename);
+
+// matches up the half-edges and creases of the parsed .obj and writes
+// the cache.  fails (with a message) on out of range indices and on
+// non-manifold meshes, which the half-edge Mesh cannot represent.
+bool WriteMeshCache(const std::string &filename, const ObjData &data);
+
+#endif
@@ -0,0 +1,189 @@
+#include <cmath>
+#include <cassert>
+
+#include "mesh_optimizer.h"
+
+// ====================================================================
+// ====================================================================
+// VERTEX CACHE ORDER
+
+// vertex scores are looked up, valences past this share the last entry
+#define SCORE_MAX_VALENCE 32
+
+namespace {
+
+struct ScoreTables {
+  ScoreTables() {
+    for (int i = 0; i < VERTEX_CACHE_SIZE; i++) {
+      // the last triangle's 3 vertices score the same, whichever order
+      // they went in, so the next one doesn't just fan around one of them
+      if (i < 3)
+        cache[i] = 0.75f;
+      else
+        cache[i] = powf(1.0f - (i-3)*(1.0f/(VERTEX_CACHE_SIZE-3)),1.5f);
+    }
+    // few triangles left: finish the vertex off before it is evicted
+    valence[0] = 0;
+    for (int i = 1; i <= SCORE_MAX_VALENCE; i++) valence[i] = 2.0f*powf((float)i,-0.5f);
+  }
+  float cache[VERTEX_CACHE_SIZE];
+  float valence[SCORE_MAX_VALENCE+1];
+};
+
+const ScoreTables& Tables() {
+  static ScoreTables tables;
+  return tables;
+}
+
+inline float VertexScore(int cache_position, int remaining) {
+  if (remaining == 0) return -1;
+  const ScoreTables &tables = Tables();
+  float score = tables.valence[remaining < SCORE_MAX_VALENCE ? remaining : SCORE_MAX_VALENCE];
+  if (cache_position >= 0) score += tables.cache[cache_position];
+  return score;
+}
+
+}
+
+
+void OptimizeVertexCache(const std::vector<unsigned int> &indices, int num_vertices,
+                         std::vector<int> &order) {
+  assert (indices.size() % 3 == 0);
+  int num_tris = indices.size() / 3;
+  order.clear();
+  order.reserve(num_tris);
+  if (num_tris == 0) return;
+
+  // the triangles not drawn yet around each vertex: the first
+  // remaining[v] entries from adjacency[offsets[v]]
+  std::vector<int> remaining(num_vertices,0);
+  for (unsigned int i = 0; i < indices.size(); i++) {
+    assert ((int)indices[i] < num_vertices);
+    remaining[indices[i]]++;
+  }
+  std::vector<int> offsets(num_vertices+1,0);
+  for (int v = 0; v < num_vertices; v++) offsets[v+1] = offsets[v] + remaining[v];
+  std::vector<int> adjacency(indices.size());
+  std::vector<int> fill(offsets.begin(),offsets.end()-1);
+  for (unsigned int i = 0; i < indices.size(); i++) adjacency[fill[indices[i]]++] = i/3;
+
+  std::vector<int> cache_position(num_vertices,-1);
+  std::vector<float> score(num_vertices);
+  for (int v = 0; v < num_vertices; v++) score[v] = VertexScore(-1,remaining[v]);
+
+  // start from the best triangle overall
+  int best = -1;
+  float best_score = -1;
+  for (int t = 0; t < num_tris; t++) {
+    float s = score[indices[3*t]] + score[indices[3*t+1]] + score[indices[3*t+2]];
+    if (s > best_score) { best_score = s; best = t; }
+  }
+
+  std::vector<bool> drawn(num_tris,false);
+  int cache[VERTEX_CACHE_SIZE+3];
+  int cache_count = 0;
+  int next_undrawn = 0;
+
+  while (true) {
+    order.push_back(best);
+    drawn[best] = true;
+    const unsigned int *tri = &indices[3*best];
+
+    // take it off its vertices' lists
+    for (int k = 0; k < 3; k++) {
+      int v = tri[k];
+      int *list = &adjacency[offsets[v]];
+      for (int i = 0; i < remaining[v]; i++) {
+        if (list[i] == best) {
+          list[i] = list[remaining[v]-1];
+          remaining[v]--;
+          break;
+        }
+      }
+    }
+
+    // its vertices move to the front of the cache, the rest shift back
+    // and whatever falls off the end is evicted
+    int updated[VERTEX_CACHE_SIZE+3];
+    int num_updated = 0;
+    for (int k = 0; k < 3; k++) {
+      if (k > 0 && (tri[k] == tri[0] || (k == 2 && tri[2] == tri[1]))) continue;
+      updated[num_updated++] = tri[k];
+    }
+    for (int i = 0; i < cache_count; i++) {
+      int v = cache[i];
+      if (v != (int)tri[0] && v != (int)tri[1] && v != (int)tri[2]) updated[num_updated++] = v;
+    }
+    for (int i = VERTEX_CACHE_SIZE; i < num_updated; i++) {
+      cache_position[updated[i]] = -1;
+      score[updated[i]] = VertexScore(-1,remaining[updated[i]]);
+    }
+    cache_count = (num_updated < VERTEX_CACHE_SIZE) ? num_updated : VERTEX_CACHE_SIZE;
+    for (int i = 0; i < cache_count; i++) {
+      int v = updated[i];
+      cache[i] = v;
+      cache_position[v] = i;
+      score[v] = VertexScore(i,remaining[v]);
+    }
+
+    if ((int)order.size() == num_tris) break;
+
+    // the next triangle is the best one touching the cache
+    best = -1;
+    best_score = -1;
+    for (int i = 0; i < cache_count; i++) {
+      int v = cache[i];
+      const int *list = &adjacency[offsets[v]];
+      for (int j = 0; j < remaining[v]; j++) {
+        const unsigned int *t = &indices[3*list[j]];
+        float s = score[t[0]] + score[t[1]] + score[t[2]];
+        if (s > best_score) { best_score = s; best = list[j]; }
+      }
+    }
+    // nothing left around the cache, jump to the next triangle in the
+    // input (which keeps this linear, unlike a search of all of them)
+    if (best == -1) {
+      while (drawn[next_undrawn]) next_undrawn++;
+      best = next_undrawn;
+    }
+  }
+}
+
+// ====================================================================
+// ====================================================================
+// VERTEX FETCH ORDER
+
+int OptimizeVertexFetch(std::vector<unsigned int> &indices, int num_vertices,
+                        std::vector<int> &remap) {
+  remap.assign(num_vertices,-1);
+  int num_used = 0;
+  for (unsigned int i = 0; i < indices.size(); i++) {
+    int v = indices[i];
+    assert (v < num_vertices);
+    if (remap[v] == -1) remap[v] = num_used++;
+    indices[i] = remap[v];
+  }
+  return num_used;
+}
+
+// ====================================================================
+// ====================================================================
+// AVERAGE CACHE MISS RATIO
+
+double ComputeACMR(const std::vector<unsigned int> &indices, int num_vertices, int cache_size) {
+  if (indices.empty()) return 0;
+  // a vertex is still in the FIFO until cache_size more misses have
+  // come after its own
+  std::vector<long long> inserted(num_vertices,-1);
+  long long misses = 0;
+  for (unsigned int i = 0; i < indices.size(); i++) {
+    int v = indices[i];
+    if (inserted[v] >= 0 && misses - inserted[v] <= cache_size) continue;
+    inserted[v] = misses;
+    misses++;
+  }
+  return misses / (indices.size() / 3.0);
+}
+
+// ====================================================================
+// ====================================================================
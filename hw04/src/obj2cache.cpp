@@ -0,0 +1,47 @@
+#include <iostream>
+#include <string>
+
+#include "obj_parser.h"
+#include "mesh_cache.h"
+
+// =========================================
+// Offline converter: parses a .obj once and writes the binary
+// .mcache, which Mesh::Load reads directly (pass it with -input).
+//
+//   obj2cache model.obj [model.mcache]
+// =========================================
+
+int main(int argc, char *argv[]) {
+  if (argc < 2 || argc > 3) {
+    std::cerr << "usage: " << argv[0] << " input.obj [output" << MESH_CACHE_EXTENSION << "]" << std::endl;
+    return 1;
+  }
+  std::string input_file = argv[1];
+  std::string output_file;
+  if (argc == 3) {
+    output_file = argv[2];
+  } else {
+    size_t dot = input_file.rfind('.');
+    size_t slash = input_file.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+      dot = input_file.size();
+    output_file = input_file.substr(0,dot) + MESH_CACHE_EXTENSION;
+  }
+
+  ObjData data;
+  if (!LoadObj(input_file,data)) {
+    std::cerr << "ERROR! CANNOT OPEN: " << input_file << std::endl;
+    return 1;
+  }
+  if (data.num_skipped_lines > 0) {
+    std::cout << "WARNING: skipped " << data.num_skipped_lines << " unrecognized lines in " << input_file << std::endl;
+  }
+  if (!WriteMeshCache(output_file,data)) return 1;
+
+  std::cout << "wrote " << output_file << ": " << data.numVertices() << " vertices, "
+            << data.numTriangles() << " triangles, " << data.creases.size() << " creases" << std::endl;
+  return 0;
+}
+
+// =========================================
+// =========================================
@@ -0,0 +1,117 @@
+#ifndef _OBJECT_POOL_H_
+#define _OBJECT_POOL_H_
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <type_traits>
+
+// the first block, later blocks double in size
+#define OBJECT_POOL_FIRST_BLOCK 256
+
+// ===================================================================================
+// Storage for many small objects of one type (the mesh's vertices,
+// half-edges and triangles).  Objects are carved out of large blocks,
+// and a released object's slot goes on a free list for the next one,
+// so adding and removing triangles never reaches the heap after the
+// first few blocks.
+//
+//   Edge *e = new (edge_pool.allocate()) Edge(a,b,t);
+//   ...
+//   edge_pool.release(e);     // runs ~Edge, keeps the slot
+//
+// Destroying (or clearing) the pool frees the blocks without running
+// the destructors of whatever is still in them: only for types that
+// have nothing to clean up when everything goes at once.
+// ===================================================================================
+
+template <class T>
+class ObjectPool {
+public:
+
+  // ========================
+  // CONSTRUCTOR & DESTRUCTOR
+  ObjectPool() : free_list(NULL), next_unused(NULL), end_unused(NULL), num_live(0) {}
+  ~ObjectPool() { clear(); }
+
+  // =========
+  // ACCESSORS
+  size_t numLive() const { return num_live; }
+
+  // =========
+  // MODIFIERS
+  // raw storage for one T, construct it with placement new
+  void* allocate() {
+    num_live++;
+    if (free_list != NULL) {
+      Slot *s = free_list;
+      free_list = s->next;
+      return s;
+    }
+    if (next_unused == end_unused)
+      addBlock(blocks.empty() ? OBJECT_POOL_FIRST_BLOCK : 2*block_sizes.back());
+    return next_unused++;
+  }
+
+  void release(T *t) {
+    if (t == NULL) return;
+    assert (num_live > 0);
+    t->~T();
+    Slot *s = reinterpret_cast<Slot*>(t);
+    s->next = free_list;
+    free_list = s;
+    num_live--;
+  }
+
+  // room for n more objects in one block (when the count is known up
+  // front, like when loading a mesh)
+  void reserve(size_t n) {
+    if (n > (size_t)(end_unused - next_unused)) addBlock(n);
+  }
+
+  // frees every block, see above
+  void clear() {
+    for (size_t i = 0; i < blocks.size(); i++) ::operator delete(blocks[i]);
+    blocks.clear();
+    block_sizes.clear();
+    free_list = next_unused = end_unused = NULL;
+    num_live = 0;
+  }
+
+private:
+
+  // an unused slot holds the free list link, a used one the object
+  union Slot {
+    Slot *next;
+    typename std::aligned_storage<sizeof(T),std::alignment_of<T>::value>::type storage;
+  };
+
+  void addBlock(size_t n) {
+    // whatever is left of the current block goes on the free list
+    while (next_unused != end_unused) {
+      next_unused->next = free_list;
+      free_list = next_unused++;
+    }
+    Slot *block = static_cast<Slot*>(::operator new(n*sizeof(Slot)));
+    blocks.push_back(block);
+    block_sizes.push_back(n);
+    next_unused = block;
+    end_unused = block + n;
+  }
+
+  // don't copy the blocks
+  ObjectPool(const ObjectPool &) { assert(0); }
+  const ObjectPool& operator=(const ObjectPool &) { assert(0); return *this; }
+
+  // ==============
+  // REPRESENTATION
+  std::vector<Slot*> blocks;
+  std::vector<size_t> block_sizes;
+  Slot *free_list;
+  Slot *next_unused;   // the part of the newest block never handed out
+  Slot *end_unused;
+  size_t num_live;
+};
+
+#endif // _OBJECT_POOL_H_
@@ -163,25 +163,30 @@ void Mesh::SetupFloor() {
 
 
 void Mesh::SetupMesh() {
-  for (triangleshashtype::iterator iter = triangles.begin();
-       iter != triangles.end(); iter++) {
-    Triangle *t = iter->second;
-    glm::vec3 a = (*t)[0]->getPos();
-    glm::vec3 b = (*t)[1]->getPos();
-    glm::vec3 c = (*t)[2]->getPos();    
-    glm::vec3 na = ComputeNormal(a,b,c);
-    glm::vec3 nb = na;
-    glm::vec3 nc = na;
-    if (args->gouraud_normals) {
-      na = (*t)[0]->getGouraudNormal();
-      nb = (*t)[1]->getGouraudNormal();
-      nc = (*t)[2]->getGouraudNormal();
+  if (args->gouraud_normals) {
+    // the triangles share their vertices (a vertex has one normal), so
+    // the vertex cache can reuse them
+    for (unsigned int i = 0; i < fetch_order.size(); i++) {
+      Vertex *v = fetch_order[i];
+      mesh_tri_verts.push_back(VBOPosNormalColor(v->getPos(),v->getGouraudNormal(),mesh_color));
+    }
+    for (unsigned int i = 0; i < draw_indices.size(); i += 3) {
+      mesh_tri_indices.push_back(VBOIndexedTri(draw_indices[i],draw_indices[i+1],draw_indices[i+2]));
+    }
+  } else {
+    // flat normals, every corner is its own vertex
+    for (unsigned int i = 0; i < draw_order.size(); i++) {
+      Triangle *t = draw_order[i];
+      glm::vec3 a = (*t)[0]->getPos();
+      glm::vec3 b = (*t)[1]->getPos();
+      glm::vec3 c = (*t)[2]->getPos();    
+      glm::vec3 normal = ComputeNormal(a,b,c);
+      int start = mesh_tri_verts.size();
+      mesh_tri_verts.push_back(VBOPosNormalColor(a,normal,mesh_color));
+      mesh_tri_verts.push_back(VBOPosNormalColor(b,normal,mesh_color));
+      mesh_tri_verts.push_back(VBOPosNormalColor(c,normal,mesh_color));
+      mesh_tri_indices.push_back(VBOIndexedTri(start,start+1,start+2));
     }
-    int start = mesh_tri_verts.size();
-    mesh_tri_verts.push_back(VBOPosNormalColor(a,na,mesh_color));
-    mesh_tri_verts.push_back(VBOPosNormalColor(b,nb,mesh_color));
-    mesh_tri_verts.push_back(VBOPosNormalColor(c,nc,mesh_color));
-    mesh_tri_indices.push_back(VBOIndexedTri(start,start+1,start+2));
   }
   glBindBuffer(GL_ARRAY_BUFFER,mesh_tri_verts_VBO); 
   glBufferData(GL_ARRAY_BUFFER,
@@ -203,9 +208,8 @@ void Mesh::SetupReflectedMesh() {
 
   float mirror_x = (-0.25)*diff.x + bbox.getMin().x;
 
-  for (triangleshashtype::iterator iter = triangles.begin();
-       iter != triangles.end(); iter++) {
-    Triangle *t = iter->second;
+  for (unsigned int j = 0; j < draw_order.size(); j++) {
+    Triangle *t = draw_order[j];
     
     glm::vec3 a = (*t)[0]->getPos();
     glm::vec3 b = (*t)[1]->getPos();